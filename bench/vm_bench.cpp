@@ -0,0 +1,145 @@
+/*!
+ * \file vm_bench.cpp
+ * \brief Compares execution time of syntax tree, compiled callables, bytecode interpreter and machine code on the
+ *        same programs
+ */
+#include "closures.h"
+#include "lexer.h"
+#include "parse.h"
+#include "runtime.h"
+#include "vm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace
+{
+
+struct Benchmark
+{
+    string name;
+    string source;
+};
+
+//! Language has no loops, so repeated work is done by recursive methods
+const Benchmark BENCHMARKS[] = {
+    {"fib"s, R"(
+class Fib:
+  def calc(n):
+    if n < 2:
+      return n
+    return self.calc(n - 1) + self.calc(n - 2)
+
+fib = Fib()
+print fib.calc(25)
+)"},
+    {"arithmetic"s, R"(
+class Sum:
+  def run(n, acc):
+    if n < 1:
+      return acc
+    return self.run(n - 1, acc + n * 3 / 2 - n + 1)
+
+class Repeat:
+  def run(times, sum):
+    if times < 1:
+      return 0
+    return sum.run(1500, 0) + self.run(times - 1, sum)
+
+repeat = Repeat()
+print repeat.run(200, Sum())
+)"},
+    {"fields"s, R"(
+class Counter:
+  def __init__():
+    self.value = 0
+    self.steps = 0
+
+  def add(n):
+    if n > 0:
+      self.value = self.value + n
+      self.steps = self.steps + 1
+      self.add(n - 1)
+
+  def repeat(times, n):
+    if times > 0:
+      self.add(n)
+      self.repeat(times - 1, n)
+
+counter = Counter()
+counter.repeat(200, 1000)
+print counter.value, counter.steps
+)"},
+};
+
+constexpr int RUNS = 5;
+
+//! Returns the best time of several runs, output of the program is checked to be the same every time
+template <typename Prepare> double Measure(const string &source, Prepare prepare, string &output)
+{
+    double best = 0;
+    for (int run = 0; run < RUNS; ++run)
+    {
+        istringstream input(source);
+        parse::Lexer lexer(input);
+        auto program = prepare(ParseProgram(lexer));
+
+        ostringstream out;
+        runtime::SimpleContext context{out};
+        runtime::Closure closure;
+        const auto start = chrono::steady_clock::now();
+        program->Execute(closure, context);
+        const chrono::duration<double, milli> time = chrono::steady_clock::now() - start;
+
+        best = run == 0 ? time.count() : min(best, time.count());
+        output = out.str();
+    }
+    return best;
+}
+
+} // namespace
+
+int main()
+{
+    const auto jit_threshold = vm::DefaultJitThreshold();
+    cout << "bytecode dispatch: " << vm::DispatchName() << ", machine code: " << (jit_threshold ? "on" : "off")
+         << '\n';
+    cout << "benchmark     tree, ms    closures, ms    bytecode, ms    machine code, ms    speedup\n";
+    for (const auto &benchmark : BENCHMARKS)
+    {
+        string tree_output;
+        string closures_output;
+        string vm_output;
+        string jit_output;
+        const double tree = Measure(
+            benchmark.source, [](auto program) { return program; }, tree_output);
+        const double compiled = Measure(
+            benchmark.source, [](auto program) { return closures::Compile(std::move(program)); }, closures_output);
+        const double bytecode = Measure(
+            benchmark.source, [](auto program) { return vm::Compile(std::move(program), vm::Options{nullopt}); },
+            vm_output);
+        const double native = Measure(
+            benchmark.source, [](auto program) { return vm::Compile(std::move(program)); }, jit_output);
+        if (tree_output != closures_output || tree_output != vm_output || tree_output != jit_output)
+        {
+            cerr << benchmark.name << ": outputs differ: " << tree_output << " vs " << closures_output << " vs "
+                 << vm_output << " vs " << jit_output << endl;
+            return 1;
+        }
+        cout.width(14);
+        cout << left << benchmark.name;
+        cout.width(12);
+        cout << tree;
+        cout.width(16);
+        cout << compiled;
+        cout.width(16);
+        cout << bytecode;
+        cout.width(20);
+        cout << native << tree / native << '\n';
+    }
+}
@@ -0,0 +1,760 @@
+#include "cache.h"
+
+#include "runtime.h"
+#include "statement.h"
+
+#include <cstdio>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace cache
+{
+
+using ast::Statement;
+using runtime::Class;
+using runtime::ObjectHolder;
+
+namespace
+{
+
+/*
+ * File starts with header: MAGIC, format version, source hash and source size.
+ * Then goes program statement. Every statement is a tag followed by its fields, numbers are little-endian.
+ * Class is written where it is referred first: NEW_CLASS, name, parent, methods; it gets the next index
+ * after its record is complete, so parents and classes used by methods always get smaller indices
+ */
+constexpr char MAGIC[] = {'M', 'Y', 'P', 'C'};
+constexpr uint32_t NO_CLASS = 0xFFFFFFFF;
+constexpr uint32_t NEW_CLASS = 0xFFFFFFFE;
+
+enum class Tag : uint8_t
+{
+    NumericConst,
+    StringConst,
+    BoolConst,
+    VariableValue,
+    Assignment,
+    FieldAssignment,
+    None,
+    Print,
+    MethodCall,
+    NewInstance,
+    Stringify,
+    Add,
+    Sub,
+    Mult,
+    Div,
+    Or,
+    And,
+    Not,
+    Compound,
+    MethodBody,
+    Return,
+    ClassDefinition,
+    IfElse,
+    Comparison,
+    //! Absent optional statement
+    Empty,
+};
+
+using ComparatorFunction = bool (*)(const ObjectHolder &, const ObjectHolder &, runtime::Context &);
+//! Comparators are written as indices in this array
+constexpr ComparatorFunction COMPARATORS[] = {
+    runtime::Equal,   runtime::NotEqual,    runtime::Less,
+    runtime::Greater, runtime::LessOrEqual, runtime::GreaterOrEqual,
+};
+
+class Writer : public ast::Visitor
+{
+  public:
+    explicit Writer(ostream &output) : output_(output)
+    {
+    }
+
+    void WriteHeader(string_view source)
+    {
+        output_.write(MAGIC, sizeof(MAGIC));
+        WriteU32(FORMAT_VERSION);
+        WriteU64(HashSource(source));
+        WriteU64(source.size());
+    }
+
+    //! Writes statement, nullptr is written as absent statement
+    void WriteStatement(const Statement *statement)
+    {
+        // Writer isn't used after error, so depth is not restored by it
+        if (depth_ == MAX_DEPTH)
+        {
+            throw CacheError("Program is nested too deeply to be cached"s);
+        }
+        ++depth_;
+        WriteNode(statement);
+        --depth_;
+    }
+
+    //! Checks that every written class is owned by the program
+    void CheckClassesDefined() const
+    {
+        for (const auto &[cls, index] : class_indices_)
+        {
+            if (!defined_classes_.count(cls))
+            {
+                throw CacheError("Class "s + cls->GetName() + " is not defined by program"s);
+            }
+        }
+    }
+
+  private:
+    void WriteNode(const Statement *statement)
+    {
+        if (!statement)
+        {
+            WriteTag(Tag::Empty);
+        }
+        else if (!ast::Accept(*statement, *this))
+        {
+            throw CacheError("Program contains statement that is not a syntax tree node"s);
+        }
+    }
+
+    void WriteU8(uint8_t value)
+    {
+        output_.put(static_cast<char>(value));
+    }
+
+    void WriteU32(uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            WriteU8(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void WriteU64(uint64_t value)
+    {
+        WriteU32(static_cast<uint32_t>(value));
+        WriteU32(static_cast<uint32_t>(value >> 32));
+    }
+
+    void WriteTag(Tag tag)
+    {
+        WriteU8(static_cast<uint8_t>(tag));
+    }
+
+    void WriteString(string_view value)
+    {
+        WriteU32(static_cast<uint32_t>(value.size()));
+        output_.write(value.data(), static_cast<streamsize>(value.size()));
+    }
+
+    void WriteStrings(const vector<string> &values)
+    {
+        WriteU32(static_cast<uint32_t>(values.size()));
+        for (const auto &value : values)
+        {
+            WriteString(value);
+        }
+    }
+
+    void WriteStatements(const vector<unique_ptr<Statement>> &statements)
+    {
+        WriteU32(static_cast<uint32_t>(statements.size()));
+        for (const auto &statement : statements)
+        {
+            WriteStatement(statement.get());
+        }
+    }
+
+    void WriteClass(const Class *cls)
+    {
+        if (!cls)
+        {
+            WriteU32(NO_CLASS);
+            return;
+        }
+        if (auto it = class_indices_.find(cls); it != class_indices_.end())
+        {
+            if (it->second == NEW_CLASS)
+            {
+                throw CacheError("Class "s + cls->GetName() + " refers to itself"s);
+            }
+            WriteU32(it->second);
+            return;
+        }
+
+        class_indices_.emplace(cls, NEW_CLASS);
+        WriteU32(NEW_CLASS);
+        WriteString(cls->GetName());
+        WriteClass(cls->GetParent());
+        WriteU32(static_cast<uint32_t>(cls->GetMethods().size()));
+        for (const auto &method : cls->GetMethods())
+        {
+            WriteString(method.name);
+            WriteStrings(method.formal_params);
+            WriteStatement(method.body.get());
+        }
+        class_indices_[cls] = next_class_index_++;
+    }
+
+    void WriteBinary(Tag tag, const ast::BinaryOperation &node)
+    {
+        WriteTag(tag);
+        WriteStatement(&node.GetLeft());
+        WriteStatement(&node.GetRight());
+    }
+
+    void Visit(const ast::NumericConst &node) override
+    {
+        WriteTag(Tag::NumericConst);
+        WriteU32(static_cast<uint32_t>(node.GetValue().GetValue()));
+    }
+
+    void Visit(const ast::StringConst &node) override
+    {
+        WriteTag(Tag::StringConst);
+        WriteString(node.GetValue().GetValue());
+    }
+
+    void Visit(const ast::BoolConst &node) override
+    {
+        WriteTag(Tag::BoolConst);
+        WriteU8(node.GetValue().GetValue() ? 1 : 0);
+    }
+
+    void Visit(const ast::VariableValue &node) override
+    {
+        WriteTag(Tag::VariableValue);
+        WriteStrings(node.GetIds());
+    }
+
+    void Visit(const ast::Assignment &node) override
+    {
+        WriteTag(Tag::Assignment);
+        WriteString(node.GetVariable());
+        WriteStatement(&node.GetValue());
+    }
+
+    void Visit(const ast::FieldAssignment &node) override
+    {
+        WriteTag(Tag::FieldAssignment);
+        WriteStrings(node.GetObject().GetIds());
+        WriteString(node.GetField());
+        WriteStatement(&node.GetValue());
+    }
+
+    void Visit([[maybe_unused]] const ast::None &node) override
+    {
+        WriteTag(Tag::None);
+    }
+
+    void Visit(const ast::Print &node) override
+    {
+        WriteTag(Tag::Print);
+        WriteStatements(node.GetArgs());
+    }
+
+    void Visit(const ast::MethodCall &node) override
+    {
+        WriteTag(Tag::MethodCall);
+        WriteStatement(&node.GetObject());
+        WriteString(node.GetMethod());
+        WriteStatements(node.GetArgs());
+    }
+
+    void Visit(const ast::NewInstance &node) override
+    {
+        WriteTag(Tag::NewInstance);
+        WriteClass(&node.GetClass());
+        WriteStatements(node.GetArgs());
+    }
+
+    void Visit(const ast::Stringify &node) override
+    {
+        WriteTag(Tag::Stringify);
+        WriteStatement(&node.GetArgument());
+    }
+
+    void Visit(const ast::Add &node) override
+    {
+        WriteBinary(Tag::Add, node);
+    }
+
+    void Visit(const ast::Sub &node) override
+    {
+        WriteBinary(Tag::Sub, node);
+    }
+
+    void Visit(const ast::Mult &node) override
+    {
+        WriteBinary(Tag::Mult, node);
+    }
+
+    void Visit(const ast::Div &node) override
+    {
+        WriteBinary(Tag::Div, node);
+    }
+
+    void Visit(const ast::Or &node) override
+    {
+        WriteBinary(Tag::Or, node);
+    }
+
+    void Visit(const ast::And &node) override
+    {
+        WriteBinary(Tag::And, node);
+    }
+
+    void Visit(const ast::Not &node) override
+    {
+        WriteTag(Tag::Not);
+        WriteStatement(&node.GetArgument());
+    }
+
+    void Visit(const ast::Compound &node) override
+    {
+        WriteTag(Tag::Compound);
+        WriteStatements(node.GetStatements());
+    }
+
+    void Visit(const ast::MethodBody &node) override
+    {
+        WriteTag(Tag::MethodBody);
+        WriteStatement(&node.GetBody());
+    }
+
+    void Visit(const ast::Return &node) override
+    {
+        WriteTag(Tag::Return);
+        WriteStatement(&node.GetValue());
+    }
+
+    void Visit(const ast::ClassDefinition &node) override
+    {
+        const auto *cls = node.GetClass().TryAs<Class>();
+        WriteTag(Tag::ClassDefinition);
+        WriteClass(cls);
+        defined_classes_.insert(cls);
+    }
+
+    void Visit(const ast::IfElse &node) override
+    {
+        WriteTag(Tag::IfElse);
+        WriteStatement(&node.GetCondition());
+        WriteStatement(&node.GetIfBody());
+        WriteStatement(node.GetElseBody());
+    }
+
+    void Visit(const ast::Comparison &node) override
+    {
+        const auto *function = node.GetComparator().target<ComparatorFunction>();
+        uint8_t kind = 0;
+        while (kind < size(COMPARATORS) && (!function || *function != COMPARATORS[kind]))
+        {
+            ++kind;
+        }
+        if (kind == size(COMPARATORS))
+        {
+            throw CacheError("Program contains comparison with custom comparator"s);
+        }
+        WriteTag(Tag::Comparison);
+        WriteU8(kind);
+        WriteStatement(&node.GetLeft());
+        WriteStatement(&node.GetRight());
+    }
+
+    ostream &output_;
+    unordered_map<const Class *, uint32_t> class_indices_;
+    uint32_t next_class_index_ = 0;
+    //! Statements being written, from the program down to the current one
+    size_t depth_ = 0;
+    unordered_set<const Class *> defined_classes_;
+};
+
+class Reader
+{
+  public:
+    explicit Reader(string_view data) : data_(data)
+    {
+    }
+
+    //! Returns false if data is written by other format version or for other source
+    bool ReadHeader(string_view source)
+    {
+        if (data_.substr(0, sizeof(MAGIC)) != string_view(MAGIC, sizeof(MAGIC)))
+        {
+            throw CacheError("Not a program cache"s);
+        }
+        pos_ = sizeof(MAGIC);
+        if (ReadU32() != FORMAT_VERSION)
+        {
+            return false;
+        }
+        const uint64_t hash = ReadU64();
+        return ReadU64() == source.size() && hash == HashSource(source);
+    }
+
+    unique_ptr<Statement> ReadStatement()
+    {
+        // Reader isn't used after error, so depth is not restored by it
+        if (depth_ == MAX_DEPTH)
+        {
+            throw CacheError("Damaged program cache"s);
+        }
+        ++depth_;
+        auto result = ReadNode();
+        --depth_;
+        return result;
+    }
+
+    //! Checks that data is read completely and every class is owned by the program
+    void Finish() const
+    {
+        if (pos_ != data_.size() || defined_classes_.size() != classes_.size())
+        {
+            throw CacheError("Damaged program cache"s);
+        }
+    }
+
+  private:
+    unique_ptr<Statement> ReadNode() // NOLINT
+    {
+        switch (static_cast<Tag>(ReadU8()))
+        {
+        case Tag::NumericConst:
+            return make_unique<ast::NumericConst>(static_cast<int>(ReadU32()));
+        case Tag::StringConst:
+            return make_unique<ast::StringConst>(runtime::String(ReadString()));
+        case Tag::BoolConst:
+            return make_unique<ast::BoolConst>(runtime::Bool(ReadU8() != 0));
+        case Tag::VariableValue:
+            return make_unique<ast::VariableValue>(ReadStrings());
+        case Tag::Assignment: {
+            string var = ReadString();
+            return make_unique<ast::Assignment>(std::move(var), ReadRequired());
+        }
+        case Tag::FieldAssignment: {
+            ast::VariableValue object(ReadStrings());
+            string field = ReadString();
+            return make_unique<ast::FieldAssignment>(std::move(object), std::move(field), ReadRequired());
+        }
+        case Tag::None:
+            return make_unique<ast::None>();
+        case Tag::Print:
+            return make_unique<ast::Print>(ReadStatements());
+        case Tag::MethodCall: {
+            auto object = ReadRequired();
+            string method = ReadString();
+            return make_unique<ast::MethodCall>(std::move(object), std::move(method), ReadStatements());
+        }
+        case Tag::NewInstance: {
+            const Class *cls = ReadClass();
+            if (!cls)
+            {
+                throw CacheError("Damaged program cache"s);
+            }
+            return make_unique<ast::NewInstance>(*cls, ReadStatements());
+        }
+        case Tag::Stringify:
+            return make_unique<ast::Stringify>(ReadRequired());
+        case Tag::Add:
+            return ReadBinary<ast::Add>();
+        case Tag::Sub:
+            return ReadBinary<ast::Sub>();
+        case Tag::Mult:
+            return ReadBinary<ast::Mult>();
+        case Tag::Div:
+            return ReadBinary<ast::Div>();
+        case Tag::Or:
+            return ReadBinary<ast::Or>();
+        case Tag::And:
+            return ReadBinary<ast::And>();
+        case Tag::Not:
+            return make_unique<ast::Not>(ReadRequired());
+        case Tag::Compound: {
+            auto result = make_unique<ast::Compound>();
+            for (auto &statement : ReadStatements())
+            {
+                result->AddStatement(std::move(statement));
+            }
+            return result;
+        }
+        case Tag::MethodBody:
+            return make_unique<ast::MethodBody>(ReadRequired());
+        case Tag::Return:
+            return make_unique<ast::Return>(ReadRequired());
+        case Tag::ClassDefinition: {
+            const Class *cls = ReadClass();
+            if (!cls)
+            {
+                throw CacheError("Damaged program cache"s);
+            }
+            defined_classes_.insert(cls);
+            return make_unique<ast::ClassDefinition>(class_holders_.at(cls));
+        }
+        case Tag::IfElse: {
+            auto condition = ReadRequired();
+            auto if_body = ReadRequired();
+            return make_unique<ast::IfElse>(std::move(condition), std::move(if_body), ReadStatement());
+        }
+        case Tag::Comparison: {
+            const uint8_t kind = ReadU8();
+            if (kind >= size(COMPARATORS))
+            {
+                throw CacheError("Damaged program cache"s);
+            }
+            auto lhs = ReadRequired();
+            return make_unique<ast::Comparison>(COMPARATORS[kind], std::move(lhs), ReadRequired());
+        }
+        case Tag::Empty:
+            return nullptr;
+        }
+        throw CacheError("Damaged program cache"s);
+    }
+
+    string_view ReadBytes(size_t size)
+    {
+        if (size > data_.size() - pos_)
+        {
+            throw CacheError("Damaged program cache"s);
+        }
+        string_view result = data_.substr(pos_, size);
+        pos_ += size;
+        return result;
+    }
+
+    uint8_t ReadU8()
+    {
+        return static_cast<uint8_t>(ReadBytes(1)[0]);
+    }
+
+    uint32_t ReadU32()
+    {
+        const string_view bytes = ReadBytes(4);
+        uint32_t result = 0;
+        for (int i = 3; i >= 0; --i)
+        {
+            result = (result << 8) | static_cast<uint8_t>(bytes[i]);
+        }
+        return result;
+    }
+
+    uint64_t ReadU64()
+    {
+        const uint64_t low = ReadU32();
+        return low | (static_cast<uint64_t>(ReadU32()) << 32);
+    }
+
+    //! Reads count of elements, each of them takes at least one byte
+    uint32_t ReadCount()
+    {
+        const uint32_t count = ReadU32();
+        if (count > data_.size() - pos_)
+        {
+            throw CacheError("Damaged program cache"s);
+        }
+        return count;
+    }
+
+    string ReadString()
+    {
+        return string(ReadBytes(ReadU32()));
+    }
+
+    vector<string> ReadStrings()
+    {
+        vector<string> result(ReadCount());
+        for (auto &value : result)
+        {
+            value = ReadString();
+        }
+        return result;
+    }
+
+    unique_ptr<Statement> ReadRequired()
+    {
+        auto result = ReadStatement();
+        if (!result)
+        {
+            throw CacheError("Damaged program cache"s);
+        }
+        return result;
+    }
+
+    vector<unique_ptr<Statement>> ReadStatements()
+    {
+        const uint32_t count = ReadCount();
+        vector<unique_ptr<Statement>> result;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            result.push_back(ReadRequired());
+        }
+        return result;
+    }
+
+    template <typename Operation> unique_ptr<Statement> ReadBinary()
+    {
+        auto lhs = ReadRequired();
+        return make_unique<Operation>(std::move(lhs), ReadRequired());
+    }
+
+    const Class *ReadClass() // NOLINT
+    {
+        const uint32_t index = ReadU32();
+        if (index == NO_CLASS)
+        {
+            return nullptr;
+        }
+        if (index != NEW_CLASS)
+        {
+            if (index >= classes_.size())
+            {
+                throw CacheError("Damaged program cache"s);
+            }
+            return classes_[index];
+        }
+
+        string name = ReadString();
+        const Class *parent = ReadClass();
+        vector<runtime::Method> methods(ReadCount());
+        for (auto &method : methods)
+        {
+            method.name = ReadString();
+            method.formal_params = ReadStrings();
+            method.body = ReadRequired();
+        }
+        auto holder = ObjectHolder::Own(Class(std::move(name), std::move(methods), parent));
+        const auto *cls = holder.TryAs<Class>();
+        classes_.push_back(cls);
+        class_holders_.emplace(cls, std::move(holder));
+        return cls;
+    }
+
+    string_view data_;
+    size_t pos_ = 0;
+    //! Statements being read, from the program down to the current one
+    size_t depth_ = 0;
+    vector<const Class *> classes_;
+    unordered_map<const Class *, ObjectHolder> class_holders_;
+    unordered_set<const Class *> defined_classes_;
+};
+
+} // namespace
+
+uint64_t HashSource(string_view source)
+{
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : source)
+    {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+void WriteProgram(ostream &output, const runtime::Executable &program, string_view source)
+{
+    Writer writer(output);
+    writer.WriteHeader(source);
+    writer.WriteStatement(&program);
+    writer.CheckClassesDefined();
+}
+
+unique_ptr<runtime::Executable> ReadProgram(string_view data, string_view source)
+{
+    Reader reader(data);
+    if (!reader.ReadHeader(source))
+    {
+        return nullptr;
+    }
+    auto result = reader.ReadStatement();
+    reader.Finish();
+    return result;
+}
+
+MappedFile::MappedFile(const string &path)
+{
+    const int fd = open(path.c_str(), O_RDONLY); // NOLINT
+    if (fd < 0)
+    {
+        return;
+    }
+    struct stat info
+    {
+    };
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        void *data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) // NOLINT
+        {
+            data_ = data;
+            size_ = static_cast<size_t>(info.st_size);
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_)
+    {
+        munmap(data_, size_);
+    }
+}
+
+string_view MappedFile::Data() const
+{
+    return {static_cast<const char *>(data_), size_};
+}
+
+unique_ptr<runtime::Executable> LoadProgram(const string &path, string_view source)
+{
+    const MappedFile file(path);
+    if (file.Data().empty())
+    {
+        return nullptr;
+    }
+    try
+    {
+        return ReadProgram(file.Data(), source);
+    }
+    catch (const CacheError &)
+    {
+        // Damaged cache is the same as missing one, it is rewritten after parsing
+        return nullptr;
+    }
+}
+
+void StoreProgram(const string &path, const runtime::Executable &program, string_view source)
+{
+    const string temp_path = path + ".tmp"s + to_string(getpid());
+    try
+    {
+        ofstream output(temp_path, ios::binary | ios::trunc);
+        WriteProgram(output, program, source);
+        output.close();
+        if (!output)
+        {
+            throw CacheError("Can't write program cache "s + path);
+        }
+    }
+    catch (...)
+    {
+        remove(temp_path.c_str());
+        throw;
+    }
+    if (rename(temp_path.c_str(), path.c_str()) != 0)
+    {
+        remove(temp_path.c_str());
+        throw CacheError("Can't write program cache "s + path);
+    }
+}
+
+} // namespace cache
@@ -0,0 +1,75 @@
+/*!
+ * \file cache.h
+ * \brief Precompiled programs: binary form of parsed program that is loaded without lexing and parsing
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace runtime
+{
+class Executable;
+}
+
+namespace cache
+{
+
+struct CacheError : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+//! Format version, programs written by other versions are not loaded
+constexpr std::uint32_t FORMAT_VERSION = 1;
+
+//! Statements nested deeper are not written, and they are taken for damaged data when read, since reading them
+//! recursively could overflow the stack
+constexpr std::size_t MAX_DEPTH = 1000;
+
+//! Returns hash of program text, it identifies the text program was parsed from
+std::uint64_t HashSource(std::string_view source);
+
+/*!
+ * Writes classes, methods, constants and statements of program in binary form.
+ * Throws CacheError if program contains statements that are not syntax tree nodes, classes
+ * that are not defined by the program itself, or statements nested too deeply to be read back
+ */
+void WriteProgram(std::ostream &output, const runtime::Executable &program, std::string_view source);
+
+/*!
+ * Restores program from data written by WriteProgram.
+ * Returns nullptr if data is written by other format version or for other source,
+ * throws CacheError if data is damaged
+ */
+std::unique_ptr<runtime::Executable> ReadProgram(std::string_view data, std::string_view source);
+
+//! Read-only memory mapping of the whole file
+class MappedFile
+{
+  public:
+    //! Maps file if it exists, otherwise mapping is empty
+    explicit MappedFile(const std::string &path);
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile();
+
+    [[nodiscard]] std::string_view Data() const;
+
+  private:
+    void *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+//! Returns program from cache file if file exists and is written for this source, otherwise nullptr
+std::unique_ptr<runtime::Executable> LoadProgram(const std::string &path, std::string_view source);
+
+//! Writes cache file of program. File is replaced at once, so concurrent runs never see it partially written
+void StoreProgram(const std::string &path, const runtime::Executable &program, std::string_view source);
+
+} // namespace cache
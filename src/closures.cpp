@@ -0,0 +1,734 @@
+#include "closures.h"
+
+#include "statement.h"
+
+#include <algorithm>
+#include <functional>
+#include <ostream>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+namespace closures
+{
+
+using ast::Statement;
+using runtime::Class;
+using runtime::ClassInstance;
+using runtime::Closure;
+using runtime::Context;
+using runtime::ObjectHolder;
+
+namespace
+{
+
+const string INIT_METHOD = "__init__"s;
+const string RETURNED_VALUE = "returned_value"s;
+
+//! Compiled statement, it's executed the same way the original one is
+using Code = function<ObjectHolder(Closure &, Context &)>;
+using ComparatorFunction = bool (*)(const ObjectHolder &, const ObjectHolder &, Context &);
+
+//! Whether statement sets "returned_value" in the closure it's executed in
+enum class Exit
+{
+    Never,
+    Maybe,
+    Always,
+};
+
+//! Methods of program classes and their statistics
+class Tiering
+{
+  public:
+    explicit Tiering(const Options &options)
+        : threshold_(options.tier_up_threshold), stats_(options.stats ? *options.stats : own_stats_),
+          hot_methods_(options.hot_methods)
+    {
+    }
+
+    //! Replaces methods of class and its parents with ones that count calls, if it's not done yet
+    void Prepare(const Class &cls);
+
+  private:
+    size_t threshold_;
+    Stats own_stats_;
+    Stats &stats_;
+    unordered_set<const runtime::Method *> hot_methods_;
+    unordered_set<const Class *> prepared_;
+};
+
+//! Method body that is executed as it is while it's cold, and compiled when it becomes hot
+class TieredMethod : public runtime::Executable
+{
+  public:
+    TieredMethod(unique_ptr<runtime::Executable> original, bool check_every_statement, size_t threshold,
+                 Tiering &tiering, MethodStats &stats)
+        : original_(std::move(original)), check_every_statement_(check_every_statement), threshold_(threshold),
+          tiering_(tiering), stats_(stats)
+    {
+    }
+
+    ObjectHolder Execute(Closure &closure, Context &context) override;
+
+  private:
+    void Compile();
+
+    unique_ptr<runtime::Executable> original_;
+    bool check_every_statement_;
+    size_t threshold_;
+    Tiering &tiering_;
+    MethodStats &stats_;
+    Code code_;
+};
+
+ClassInstance &AsInstance(const ObjectHolder &object, const string &what)
+{
+    if (auto *instance = object.TryAs<ClassInstance>())
+    {
+        return *instance;
+    }
+    throw runtime_error(what + " of object that is not a class instance"s);
+}
+
+//! Computes values one after another
+vector<ObjectHolder> Values(const vector<Code> &codes, Closure &closure, Context &context)
+{
+    vector<ObjectHolder> values;
+    const runtime::RootedValues rooted(values);
+    values.reserve(codes.size());
+    for (const auto &code : codes)
+    {
+        values.push_back(code(closure, context));
+    }
+    return values;
+}
+
+//! Returns object whose type is proven statically
+template <typename T> const T &As(const ObjectHolder &object)
+{
+    return *static_cast<const T *>(object.Get());
+}
+
+/*!
+ * Returns operation computing Result from values of operands of type Operand. Types of proven operands are
+ * not checked, other operands are passed to "fallback" if they are not of that type
+ */
+template <typename Operand, typename Result, typename Operation, typename Fallback>
+Code Specialize(Code lhs, Code rhs, bool proven, Fallback fallback)
+{
+    if (proven)
+    {
+        return [lhs = std::move(lhs), rhs = std::move(rhs)](Closure &closure, Context &context) {
+            const ObjectHolder left = lhs(closure, context);
+            const ObjectHolder right = rhs(closure, context);
+            return ObjectHolder::Own(Result(Operation{}(As<Operand>(left).GetValue(), As<Operand>(right).GetValue())));
+        };
+    }
+    return [lhs = std::move(lhs), rhs = std::move(rhs), fallback](Closure &closure, Context &context) {
+        const ObjectHolder left = lhs(closure, context);
+        const ObjectHolder right = rhs(closure, context);
+        const auto *left_value = left.TryAs<Operand>();
+        const auto *right_value = right.TryAs<Operand>();
+        if (left_value && right_value)
+        {
+            return ObjectHolder::Own(Result(Operation{}(left_value->GetValue(), right_value->GetValue())));
+        }
+        return fallback(left, right, context);
+    };
+}
+
+class Compiler : public ast::Visitor
+{
+  public:
+    //! Statements of compound are followed by check of "returned_value" only where it can be set already,
+    //! that is at top level and in methods with such parameter
+    Compiler(Tiering &tiering, bool check_every_statement)
+        : tiering_(tiering), check_every_statement_(check_every_statement)
+    {
+    }
+
+    //! Compiles statement, statement that is not a syntax tree node is executed as it is.
+    //! Whether statement sets "returned_value" is written to "exit"
+    Code Compile(const Statement &statement, Exit *exit = nullptr)
+    {
+        const Exit outer = exit_;
+        exit_ = Exit::Never;
+        if (!ast::Accept(statement, *this))
+        {
+            code_ = Execute(const_cast<Statement &>(statement)); // NOLINT
+            exit_ = Exit::Maybe;
+        }
+        if (exit)
+        {
+            *exit = exit_;
+        }
+        exit_ = max(outer, exit_);
+        return std::move(code_);
+    }
+
+  private:
+    static Code Execute(Statement &statement)
+    {
+        return [&statement](Closure &closure, Context &context) { return statement.Execute(closure, context); };
+    }
+
+    static Code Constant(ObjectHolder value)
+    {
+        // Constant is held by the code rather than by closure
+        return [value = runtime::Pin(std::move(value))]([[maybe_unused]] Closure &closure,
+                                                        [[maybe_unused]] Context &context) { return value; };
+    }
+
+    vector<Code> CompileAll(const vector<unique_ptr<Statement>> &statements)
+    {
+        vector<Code> codes;
+        codes.reserve(statements.size());
+        for (const auto &statement : statements)
+        {
+            codes.push_back(Compile(*statement));
+        }
+        return codes;
+    }
+
+    //! Operation of any operands computed by "Compute"
+    template <ObjectHolder (*Compute)(const ObjectHolder &, const ObjectHolder &, Context &)>
+    static Code Generic(Code lhs, Code rhs)
+    {
+        return [lhs = std::move(lhs), rhs = std::move(rhs)](Closure &closure, Context &context) {
+            const ObjectHolder left = lhs(closure, context);
+            const ObjectHolder right = rhs(closure, context);
+            return Compute(left, right, context);
+        };
+    }
+
+    //! Arithmetic operation specialized for numbers, and for strings if they support it
+    template <typename Operation, ObjectHolder (*Compute)(const ObjectHolder &, const ObjectHolder &, Context &),
+              bool Strings = false>
+    Code Arithmetic(const ast::BinaryOperation &node)
+    {
+        Code lhs = Compile(node.GetLeft());
+        Code rhs = Compile(node.GetRight());
+        const auto fallback = [](const ObjectHolder &left, const ObjectHolder &right, Context &context) {
+            return Compute(left, right, context);
+        };
+        if (node.GetOperandTypes() == ast::OperandTypes::Numbers)
+        {
+            return Specialize<runtime::Number, runtime::Number, Operation>(std::move(lhs), std::move(rhs),
+                                                                            node.OperandTypesProven(), fallback);
+        }
+        if constexpr (Strings)
+        {
+            if (node.GetOperandTypes() == ast::OperandTypes::Strings)
+            {
+                return Specialize<runtime::String, runtime::String, Operation>(std::move(lhs), std::move(rhs),
+                                                                                node.OperandTypesProven(), fallback);
+            }
+        }
+        return Generic<Compute>(std::move(lhs), std::move(rhs));
+    }
+
+    //! Comparison of the runtime comparator, it compares values of numbers and strings with Operation
+    template <typename Operation> Code Compare(const ast::Comparison &node, Code lhs, Code rhs, ComparatorFunction cmp)
+    {
+        const auto fallback = [cmp](const ObjectHolder &left, const ObjectHolder &right, Context &context) {
+            return ObjectHolder::Own(runtime::Bool(cmp(left, right, context)));
+        };
+        switch (node.GetOperandTypes())
+        {
+        case ast::OperandTypes::Numbers:
+            return Specialize<runtime::Number, runtime::Bool, Operation>(std::move(lhs), std::move(rhs),
+                                                                          node.OperandTypesProven(), fallback);
+        case ast::OperandTypes::Strings:
+            return Specialize<runtime::String, runtime::Bool, Operation>(std::move(lhs), std::move(rhs),
+                                                                          node.OperandTypesProven(), fallback);
+        default:
+            return [lhs = std::move(lhs), rhs = std::move(rhs), fallback](Closure &closure, Context &context) {
+                const ObjectHolder left = lhs(closure, context);
+                const ObjectHolder right = rhs(closure, context);
+                return fallback(left, right, context);
+            };
+        }
+    }
+
+    void Visit(const ast::NumericConst &node) override
+    {
+        code_ = Constant(ObjectHolder::Own(runtime::Number(node.GetValue())));
+    }
+
+    void Visit(const ast::StringConst &node) override
+    {
+        code_ = Constant(ObjectHolder::Own(runtime::String(node.GetValue())));
+    }
+
+    void Visit(const ast::BoolConst &node) override
+    {
+        code_ = Constant(ObjectHolder::Own(runtime::Bool(node.GetValue())));
+    }
+
+    void Visit(const ast::VariableValue &node) override
+    {
+        const auto &ids = node.GetIds();
+        Code code = [name = ids.front(), error = "Unknown variable - "s + ids.front()](
+                        Closure &closure, [[maybe_unused]] Context &context) {
+            auto it = closure.find(name);
+            if (it == closure.end())
+            {
+                throw runtime_error(error);
+            }
+            return it->second;
+        };
+        for (size_t i = 1; i < ids.size(); ++i)
+        {
+            code = [object = std::move(code), name = ids[i], error = "Unknown variable - "s + ids[i]](
+                       Closure &closure, Context &context) {
+                const ObjectHolder value = object(closure, context);
+                auto *instance = value.TryAs<ClassInstance>();
+                if (!instance)
+                {
+                    throw runtime_error(error);
+                }
+                return instance->Fields()[name];
+            };
+        }
+        code_ = std::move(code);
+    }
+
+    void Visit(const ast::Assignment &node) override
+    {
+        Code value = Compile(node.GetValue());
+        code_ = [name = node.GetVariable(), value = std::move(value)](Closure &closure, Context &context) {
+            ObjectHolder result = value(closure, context);
+            closure[name] = result;
+            return result;
+        };
+        if (node.GetVariable() == RETURNED_VALUE)
+        {
+            exit_ = Exit::Always;
+        }
+    }
+
+    void Visit(const ast::FieldAssignment &node) override
+    {
+        Code object = Compile(node.GetObject());
+        Code value = Compile(node.GetValue());
+        code_ = [object = std::move(object), value = std::move(value), name = node.GetField(),
+                 what = "Field "s + node.GetField()](Closure &closure, Context &context) {
+            const ObjectHolder target = object(closure, context);
+            ObjectHolder result = value(closure, context);
+            AsInstance(target, what).Fields()[name] = result;
+            return result;
+        };
+    }
+
+    void Visit([[maybe_unused]] const ast::None &node) override
+    {
+        code_ = Constant(ObjectHolder::None());
+    }
+
+    void Visit(const ast::Print &node) override
+    {
+        // Every argument is printed before the next one is computed
+        code_ = [args = CompileAll(node.GetArgs())](Closure &closure, Context &context) {
+            ostream &out = context.GetOutputStream();
+            for (size_t i = 0; i < args.size(); ++i)
+            {
+                if (const ObjectHolder value = args[i](closure, context))
+                {
+                    value->Print(out, context);
+                }
+                else
+                {
+                    out << "None"s;
+                }
+                if (i + 1 != args.size())
+                {
+                    out << ' ';
+                }
+            }
+            out << '\n';
+            return ObjectHolder::None();
+        };
+    }
+
+    void Visit(const ast::MethodCall &node) override
+    {
+        // Arguments are computed before object
+        vector<Code> args = CompileAll(node.GetArgs());
+        Code object = Compile(node.GetObject());
+        const Class *receiver = node.GetReceiverClass();
+        const auto *method = receiver ? receiver->GetMethod(node.GetMethod()) : nullptr;
+        if (method && method->formal_params.size() == args.size())
+        {
+            tiering_.Prepare(*receiver);
+            code_ = [args = std::move(args), object = std::move(object), name = node.GetMethod(),
+                     what = "Method "s + node.GetMethod(), receiver, method](Closure &closure, Context &context) {
+                const vector<ObjectHolder> actual_args = Values(args, closure, context);
+                const runtime::RootedValues rooted(actual_args);
+                const ObjectHolder target = object(closure, context);
+                auto &instance = AsInstance(target, what);
+                // Objects of the class seen before call the method found at compile time
+                if (&instance.GetClass() == receiver)
+                {
+                    return instance.Call(*method, actual_args, context);
+                }
+                return instance.Call(name, actual_args, context);
+            };
+            return;
+        }
+        code_ = [args = std::move(args), object = std::move(object), name = node.GetMethod(),
+                 what = "Method "s + node.GetMethod()](Closure &closure, Context &context) {
+            const vector<ObjectHolder> actual_args = Values(args, closure, context);
+            const runtime::RootedValues rooted(actual_args);
+            const ObjectHolder target = object(closure, context);
+            return AsInstance(target, what).Call(name, actual_args, context);
+        };
+    }
+
+    void Visit(const ast::NewInstance &node) override
+    {
+        // Arguments are computed only if there is suitable constructor, and classes don't change after parsing
+        const Class *cls = &node.GetClass();
+        tiering_.Prepare(*cls);
+        const auto *init = node.GetClass().GetMethod(INIT_METHOD);
+        if (!init || init->formal_params.size() != node.GetArgs().size())
+        {
+            code_ = [cls]([[maybe_unused]] Closure &closure, [[maybe_unused]] Context &context) {
+                return ObjectHolder::Own(ClassInstance(*cls));
+            };
+            return;
+        }
+        code_ = [cls, args = CompileAll(node.GetArgs())](Closure &closure, Context &context) {
+            const vector<ObjectHolder> actual_args = Values(args, closure, context);
+            const runtime::RootedValues rooted(actual_args);
+            ObjectHolder object = ObjectHolder::Own(ClassInstance(*cls));
+            if (auto post_init_object = object.TryAs<ClassInstance>()->Call(INIT_METHOD, actual_args, context))
+            {
+                return post_init_object;
+            }
+            return object;
+        };
+    }
+
+    void Visit(const ast::Stringify &node) override
+    {
+        code_ = [argument = Compile(node.GetArgument())](Closure &closure, Context &context) {
+            return ast::Stringify::Compute(argument(closure, context), context);
+        };
+    }
+
+    void Visit(const ast::Add &node) override
+    {
+        code_ = Arithmetic<plus<>, ast::Add::Compute, true>(node);
+    }
+
+    void Visit(const ast::Sub &node) override
+    {
+        code_ = Arithmetic<minus<>, ast::Sub::Compute>(node);
+    }
+
+    void Visit(const ast::Mult &node) override
+    {
+        code_ = Arithmetic<multiplies<>, ast::Mult::Compute>(node);
+    }
+
+    void Visit(const ast::Div &node) override
+    {
+        Code lhs = Compile(node.GetLeft());
+        Code rhs = Compile(node.GetRight());
+        if (node.GetOperandTypes() != ast::OperandTypes::Numbers)
+        {
+            code_ = Generic<ast::Div::Compute>(std::move(lhs), std::move(rhs));
+            return;
+        }
+        // Division by zero is an error, it's raised by Compute
+        code_ = [lhs = std::move(lhs), rhs = std::move(rhs)](Closure &closure, Context &context) {
+            const ObjectHolder left = lhs(closure, context);
+            const ObjectHolder right = rhs(closure, context);
+            const auto *left_value = left.TryAs<runtime::Number>();
+            const auto *right_value = right.TryAs<runtime::Number>();
+            if (left_value && right_value && right_value->GetValue() != 0)
+            {
+                return ObjectHolder::Own(runtime::Number(left_value->GetValue() / right_value->GetValue()));
+            }
+            return ast::Div::Compute(left, right, context);
+        };
+    }
+
+    //! Right operand is computed only if left one doesn't decide the result
+    void Logical(const ast::BinaryOperation &node, bool is_or)
+    {
+        Exit left_exit = Exit::Never;
+        Exit right_exit = Exit::Never;
+        Code lhs = Compile(node.GetLeft(), &left_exit);
+        Code rhs = Compile(node.GetRight(), &right_exit);
+        code_ = [lhs = std::move(lhs), rhs = std::move(rhs), is_or](Closure &closure, Context &context) {
+            if (runtime::IsTrue(lhs(closure, context)) == is_or)
+            {
+                return ObjectHolder::Own(runtime::Bool(is_or));
+            }
+            return ObjectHolder::Own(runtime::Bool(runtime::IsTrue(rhs(closure, context))));
+        };
+        exit_ = max(left_exit, min(right_exit, Exit::Maybe));
+    }
+
+    void Visit(const ast::Or &node) override
+    {
+        Logical(node, true);
+    }
+
+    void Visit(const ast::And &node) override
+    {
+        Logical(node, false);
+    }
+
+    void Visit(const ast::Not &node) override
+    {
+        code_ = [argument = Compile(node.GetArgument())](Closure &closure, Context &context) {
+            return ObjectHolder::Own(runtime::Bool(!runtime::IsTrue(argument(closure, context))));
+        };
+    }
+
+    void Visit(const ast::Compound &node) override
+    {
+        struct Step
+        {
+            Code code;
+            //! Compound stops after the statement if "returned_value" is set
+            bool check;
+        };
+        vector<Step> steps;
+        for (const auto &statement : node.GetStatements())
+        {
+            Exit exit = Exit::Never;
+            Code code = Compile(*statement, &exit);
+            // Statements after the one that always sets "returned_value" are not reachable
+            steps.push_back({std::move(code), check_every_statement_ || exit == Exit::Maybe});
+            if (exit == Exit::Always)
+            {
+                break;
+            }
+        }
+        code_ = [steps = std::move(steps)](Closure &closure, Context &context) {
+            for (const auto &step : steps)
+            {
+                step.code(closure, context);
+                if (step.check && closure.count(RETURNED_VALUE))
+                {
+                    break;
+                }
+            }
+            return ObjectHolder::None();
+        };
+    }
+
+    void Visit(const ast::MethodBody &node) override
+    {
+        // Method body inside of other statement is not produced by parser, it keeps its own semantics
+        code_ = Execute(const_cast<ast::MethodBody &>(node)); // NOLINT
+        exit_ = Exit::Maybe;
+    }
+
+    void Visit(const ast::Return &node) override
+    {
+        code_ = [value = Compile(node.GetValue())](Closure &closure, Context &context) {
+            ObjectHolder result = value(closure, context);
+            closure[RETURNED_VALUE] = std::move(result);
+            return ObjectHolder::None();
+        };
+        exit_ = Exit::Always;
+    }
+
+    void Visit(const ast::ClassDefinition &node) override
+    {
+        tiering_.Prepare(*node.GetClass().TryAs<Class>());
+        code_ = [name = node.GetClass().TryAs<Class>()->GetName(),
+                 cls = node.GetClass()](Closure &closure, [[maybe_unused]] Context &context) {
+            closure[name] = cls;
+            return ObjectHolder::None();
+        };
+    }
+
+    void Visit(const ast::IfElse &node) override
+    {
+        Exit if_exit = Exit::Never;
+        Exit else_exit = Exit::Never;
+        Code condition = Compile(node.GetCondition());
+        Code if_body = Compile(node.GetIfBody(), &if_exit);
+        Code else_body = node.GetElseBody() ? Compile(*node.GetElseBody(), &else_exit) : Code{};
+        code_ = [condition = std::move(condition), if_body = std::move(if_body), else_body = std::move(else_body),
+                 bool_condition = node.HasBoolCondition()](Closure &closure, Context &context) {
+            const ObjectHolder value = condition(closure, context);
+            if (bool_condition ? As<runtime::Bool>(value).GetValue() : runtime::IsTrue(value))
+            {
+                if_body(closure, context);
+            }
+            else if (else_body)
+            {
+                else_body(closure, context);
+            }
+            return ObjectHolder::None();
+        };
+        // Only one of the bodies is executed
+        if (exit_ == Exit::Always && (if_exit != Exit::Always || else_exit != Exit::Always))
+        {
+            exit_ = Exit::Maybe;
+        }
+    }
+
+    void Visit(const ast::Comparison &node) override
+    {
+        Code lhs = Compile(node.GetLeft());
+        Code rhs = Compile(node.GetRight());
+        const auto *function = node.GetComparator().target<ComparatorFunction>();
+        const ComparatorFunction cmp = function ? *function : nullptr;
+        if (cmp == runtime::Equal)
+        {
+            code_ = Compare<equal_to<>>(node, std::move(lhs), std::move(rhs), cmp);
+        }
+        else if (cmp == runtime::NotEqual)
+        {
+            code_ = Compare<not_equal_to<>>(node, std::move(lhs), std::move(rhs), cmp);
+        }
+        else if (cmp == runtime::Less)
+        {
+            code_ = Compare<less<>>(node, std::move(lhs), std::move(rhs), cmp);
+        }
+        else if (cmp == runtime::Greater)
+        {
+            code_ = Compare<greater<>>(node, std::move(lhs), std::move(rhs), cmp);
+        }
+        else if (cmp == runtime::LessOrEqual)
+        {
+            code_ = Compare<less_equal<>>(node, std::move(lhs), std::move(rhs), cmp);
+        }
+        else if (cmp == runtime::GreaterOrEqual)
+        {
+            code_ = Compare<greater_equal<>>(node, std::move(lhs), std::move(rhs), cmp);
+        }
+        else
+        {
+            // Custom comparator is called as it is
+            code_ = [lhs = std::move(lhs), rhs = std::move(rhs),
+                     comparator = node.GetComparator()](Closure &closure, Context &context) {
+                const ObjectHolder left = lhs(closure, context);
+                const ObjectHolder right = rhs(closure, context);
+                return ObjectHolder::Own(runtime::Bool(comparator(left, right, context)));
+            };
+        }
+    }
+
+    Tiering &tiering_;
+    bool check_every_statement_;
+    //! Result of the last visited node
+    Code code_;
+    Exit exit_ = Exit::Never;
+};
+
+void Tiering::Prepare(const Class &cls) // NOLINT
+{
+    if (!prepared_.insert(&cls).second)
+    {
+        return;
+    }
+    if (cls.GetParent())
+    {
+        Prepare(*cls.GetParent());
+    }
+    // Classes don't change after parsing, but their methods are replaced by the owner of program
+    for (auto &method : const_cast<Class &>(cls).GetMethods()) // NOLINT
+    {
+        const auto &params = method.formal_params;
+        auto &stats = stats_.methods.emplace_back();
+        stats.name = cls.GetName() + "."s + method.name;
+        stats.method = &method;
+        method.body = make_unique<TieredMethod>(std::move(method.body),
+                                                find(params.begin(), params.end(), RETURNED_VALUE) != params.end(),
+                                                hot_methods_.count(&method) ? 0 : threshold_, *this, stats);
+    }
+}
+
+ObjectHolder TieredMethod::Execute(Closure &closure, Context &context)
+{
+    if (!code_ && stats_.calls == threshold_)
+    {
+        Compile();
+    }
+    ++stats_.calls;
+    return code_ ? code_(closure, context) : original_->Execute(closure, context);
+}
+
+void TieredMethod::Compile()
+{
+    // Body that is not produced by parser is executed as it is
+    const auto *body = dynamic_cast<const ast::MethodBody *>(original_.get());
+    if (!body)
+    {
+        return;
+    }
+    Compiler compiler(tiering_, check_every_statement_);
+    code_ = [statement = compiler.Compile(body->GetBody())](Closure &closure, Context &context) {
+        statement(closure, context);
+        auto it = closure.find(RETURNED_VALUE);
+        return it != closure.end() ? it->second : ObjectHolder::None();
+    };
+    stats_.compiled_after = stats_.calls;
+}
+
+//! Compiled program, keeps the original one
+class Program : public runtime::Executable
+{
+  public:
+    Program(unique_ptr<runtime::Executable> original, const Options &options)
+        : original_(std::move(original)), tiering_(options)
+    {
+        // Program is executed once, it's compiled anyway since its classes are prepared by compilation
+        code_ = Compiler(tiering_, true).Compile(*original_);
+    }
+
+    ObjectHolder Execute(Closure &closure, Context &context) override
+    {
+        return code_(closure, context);
+    }
+
+  private:
+    unique_ptr<runtime::Executable> original_;
+    Tiering tiering_;
+    Code code_;
+};
+
+} // namespace
+
+void PrintStats(const Stats &stats, ostream &output)
+{
+    vector<const MethodStats *> methods;
+    for (const auto &method : stats.methods)
+    {
+        if (method.calls > 0)
+        {
+            methods.push_back(&method);
+        }
+    }
+    stable_sort(methods.begin(), methods.end(),
+                [](const auto *lhs, const auto *rhs) { return lhs->calls > rhs->calls; });
+    for (const auto *method : methods)
+    {
+        output << method->name << ": " << method->calls << (method->calls == 1 ? " call, "s : " calls, "s);
+        if (method->compiled_after)
+        {
+            output << "compiled after " << *method->compiled_after << '\n';
+        }
+        else
+        {
+            output << "not compiled\n";
+        }
+    }
+}
+
+unique_ptr<runtime::Executable> Compile(unique_ptr<runtime::Executable> program, const Options &options)
+{
+    return make_unique<Program>(std::move(program), options);
+}
+
+} // namespace closures
@@ -0,0 +1,66 @@
+/*!
+ * \file closures.h
+ * \brief Closure compilation: syntax tree is turned into tree of C++ callables specialized for every node
+ */
+#pragma once
+
+#include "runtime.h"
+
+#include <deque>
+#include <iosfwd>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_set>
+
+namespace closures
+{
+
+//! Method calls after which method is compiled
+constexpr size_t TIER_UP_THRESHOLD = 10;
+
+//! Calls of method counted from the start of program
+struct MethodStats
+{
+    //! Class and method name separated by dot
+    std::string name;
+    //! Method of program class
+    const runtime::Method *method = nullptr;
+    size_t calls = 0;
+    //! Number of calls method was executed as syntax tree before it was compiled, nothing if it's not compiled
+    std::optional<size_t> compiled_after;
+};
+
+struct Stats
+{
+    //! Methods in order of classes definition
+    std::deque<MethodStats> methods;
+};
+
+//! Writes methods that were called, the most called first, and whether they were compiled
+void PrintStats(const Stats &stats, std::ostream &output);
+
+struct Options
+{
+    //! Method is executed as syntax tree this number of calls, and compiled afterwards
+    size_t tier_up_threshold = TIER_UP_THRESHOLD;
+    //! Statistics of methods are collected here if it's set, it must outlive compiled program
+    Stats *stats = nullptr;
+    //! Methods that are compiled before their first call, i.e. the ones that were hot in previous runs
+    std::unordered_set<const runtime::Method *> hot_methods;
+};
+
+/*!
+ * Compiles program into nested callables, every one of them calls its children directly. Constants are
+ * created and names are bound at compile time, operations proven to have numbers or strings compute their
+ * values without checks, and "returned_value" is checked only after statements that may set it.
+ * Program is compiled at once, methods are executed as syntax tree while they are cold and compiled when
+ * they are called often enough. Calls made for objects of the same class every time call their method
+ * without looking it up. Methods of program classes are replaced with ones that count calls, so
+ * objects of these classes must not outlive compiled program. Statements that are not syntax tree nodes are
+ * executed as they are
+ */
+std::unique_ptr<runtime::Executable> Compile(std::unique_ptr<runtime::Executable> program,
+                                             const Options &options = {});
+
+} // namespace closures
@@ -0,0 +1,266 @@
+#include "cycles.h"
+
+#include <iostream>
+
+using namespace std;
+
+namespace runtime
+{
+
+// Tracing builds collect every object of the heap instead, see heap.cpp
+#ifndef MYTHON_TRACING_GC
+
+//! Tracked instances of every generation in intrusive lists
+class Collector
+{
+  public:
+    void Track(const shared_ptr<ClassInstance> &instance)
+    {
+        instance->tracking_.self = instance;
+        Link(*instance, 0);
+        if (options.thresholds[0] == 0 || generations_[0].size <= options.thresholds[0] || collecting_)
+        {
+            return;
+        }
+        // The oldest generation whose younger one was collected often enough is collected with younger ones
+        size_t generation = GENERATIONS - 1;
+        while (generation > 0 && generations_[generation].collections <= options.thresholds[generation])
+        {
+            --generation;
+        }
+        Collect(generation);
+    }
+
+    void Untrack(ClassInstance &instance)
+    {
+        Unlink(instance);
+    }
+
+    size_t Collect(size_t generation)
+    {
+        collecting_ = true;
+        vector<ClassInstance *> examined;
+        for (size_t i = 0; i <= generation; ++i)
+        {
+            for (ClassInstance *instance = generations_[i].head; instance; instance = instance->tracking_.next)
+            {
+                examined.push_back(instance);
+            }
+        }
+        // References that don't come from fields of examined instances are left
+        for (ClassInstance *instance : examined)
+        {
+            instance->tracking_.refs = instance->tracking_.self.use_count();
+        }
+        for (ClassInstance *instance : examined)
+        {
+            for (const auto &[name, field] : instance->fields_)
+            {
+                ClassInstance *target = Examined(field, generation);
+                if (target && field.IsOwner())
+                {
+                    --target->tracking_.refs;
+                }
+            }
+        }
+        // Fields that don't own instances keep them as well, so that they aren't left dangling by collection
+        vector<ClassInstance *> reachable;
+        for (ClassInstance *instance : examined)
+        {
+            if (instance->tracking_.refs > 0 || instance->tracking_.calls > 0)
+            {
+                instance->tracking_.refs = 1;
+                reachable.push_back(instance);
+            }
+        }
+        while (!reachable.empty())
+        {
+            ClassInstance *instance = reachable.back();
+            reachable.pop_back();
+            for (const auto &[name, field] : instance->fields_)
+            {
+                ClassInstance *target = Examined(field, generation);
+                if (target && target->tracking_.refs == 0)
+                {
+                    target->tracking_.refs = 1;
+                    reachable.push_back(target);
+                }
+            }
+        }
+
+        vector<shared_ptr<ClassInstance>> garbage;
+        const size_t older = min(generation + 1, GENERATIONS - 1);
+        for (ClassInstance *instance : examined)
+        {
+            if (instance->tracking_.refs == 0)
+            {
+                garbage.push_back(instance->tracking_.self.lock());
+            }
+            else if (instance->tracking_.generation != static_cast<int>(older))
+            {
+                Unlink(*instance);
+                Link(*instance, older);
+            }
+        }
+        for (size_t i = 0; i <= generation; ++i)
+        {
+            generations_[i].collections = 0;
+        }
+        if (generation + 1 < GENERATIONS)
+        {
+            ++generations_[generation + 1].collections;
+        }
+        ++stats.collections[generation];
+        stats.examined += examined.size();
+        stats.collected += garbage.size();
+
+        // Garbage is held until every cycle is broken, instances it owns elsewhere may be freed meanwhile
+        for (const auto &instance : garbage)
+        {
+            Closure fields;
+            fields.swap(instance->fields_);
+        }
+        const size_t collected = garbage.size();
+        garbage.clear();
+        collecting_ = false;
+        return collected;
+    }
+
+    [[nodiscard]] size_t Tracked() const
+    {
+        size_t tracked = 0;
+        for (const auto &generation : generations_)
+        {
+            tracked += generation.size;
+        }
+        return tracked;
+    }
+
+    CollectorOptions options;
+    CollectorStats stats;
+
+  private:
+    struct Generation
+    {
+        ClassInstance *head = nullptr;
+        size_t size = 0;
+        //! Collections of younger generation since this one was collected
+        size_t collections = 0;
+    };
+
+    //! Returns instance field refers to if it's tracked in collected generations, nullptr otherwise
+    static ClassInstance *Examined(const ObjectHolder &field, size_t generation)
+    {
+        auto *instance = field.TryAs<ClassInstance>();
+        if (!instance || instance->tracking_.generation < 0 ||
+            static_cast<size_t>(instance->tracking_.generation) > generation)
+        {
+            return nullptr;
+        }
+        return instance;
+    }
+
+    void Link(ClassInstance &instance, size_t generation)
+    {
+        auto &list = generations_[generation];
+        instance.tracking_.generation = static_cast<int>(generation);
+        instance.tracking_.prev = nullptr;
+        instance.tracking_.next = list.head;
+        if (list.head)
+        {
+            list.head->tracking_.prev = &instance;
+        }
+        list.head = &instance;
+        ++list.size;
+    }
+
+    void Unlink(ClassInstance &instance)
+    {
+        auto &list = generations_[instance.tracking_.generation];
+        if (instance.tracking_.prev)
+        {
+            instance.tracking_.prev->tracking_.next = instance.tracking_.next;
+        }
+        else
+        {
+            list.head = instance.tracking_.next;
+        }
+        if (instance.tracking_.next)
+        {
+            instance.tracking_.next->tracking_.prev = instance.tracking_.prev;
+        }
+        instance.tracking_.prev = instance.tracking_.next = nullptr;
+        instance.tracking_.generation = -1;
+        --list.size;
+    }
+
+    array<Generation, GENERATIONS> generations_;
+    //! Instances freed by collection don't start another one
+    bool collecting_ = false;
+};
+
+namespace
+{
+
+//! Collector isn't destroyed, so instances may outlive it at exit
+Collector &GetCollector()
+{
+    static auto *collector = new Collector; // NOLINT
+    return *collector;
+}
+
+} // namespace
+
+void TrackInstance(const shared_ptr<ClassInstance> &instance)
+{
+    GetCollector().Track(instance);
+}
+
+void UntrackInstance(ClassInstance &instance)
+{
+    GetCollector().Untrack(instance);
+}
+
+void SetCollectorOptions(const CollectorOptions &options)
+{
+    GetCollector().options = options;
+}
+
+const CollectorOptions &GetCollectorOptions()
+{
+    return GetCollector().options;
+}
+
+const CollectorStats &GetCollectorStats()
+{
+    return GetCollector().stats;
+}
+
+size_t CollectCycles(size_t generation)
+{
+    return GetCollector().Collect(min(generation, GENERATIONS - 1));
+}
+
+size_t TrackedInstances()
+{
+    return GetCollector().Tracked();
+}
+
+#endif
+
+void PrintCollectorStats(const CollectorStats &stats, ostream &output)
+{
+#ifdef MYTHON_TRACING_GC
+    output << "gc: " << stats.collections[0] << " collections";
+#else
+    output << "gc:";
+    for (size_t generation = 0; generation < GENERATIONS; ++generation)
+    {
+        output << (generation ? ", "sv : " "sv) << stats.collections[generation] << " collections of generation "
+               << generation;
+    }
+#endif
+    output << ", " << stats.examined << " examined, " << stats.collected << " collected" << endl;
+}
+
+} // namespace runtime
@@ -0,0 +1,82 @@
+/*!
+ * \file cycles.h
+ * \brief Collector of reference cycles between class instances
+ *
+ * Instances reference each other through their fields, so instances of a cycle, i.e. "x.me = x", keep each
+ * other alive after the program drops them. Instances owned by ObjectHolder are tracked in generations, young
+ * instances that survive collection move to the older generation. Collection finds instances of the collected
+ * generations that are referenced only by fields of each other: the number of owners of every instance less
+ * the number of fields of collected instances that own it is the number of references from elsewhere. Such
+ * instances, and instances whose methods are being executed, are reachable along with everything their fields
+ * refer to. Fields of unreachable instances are cleared, so their cycles are broken and they are freed.
+ * Collection runs when young instances outnumber the first threshold, older generation is collected as well
+ * after the number of collections of younger one exceeds its threshold.
+ * Collector is shared by the process, programs are executed by a single thread. Threads of parallel parsing
+ * create classes only, which are neither tracked nor allocated from the heap, and they register no roots.
+ *
+ * Builds with tracing collector (MYTHON_MEMORY=tracing) allocate every object but classes from a heap instead,
+ * ObjectHolder is a plain pointer there. Collection marks objects reachable from closures, which include
+ * variables of executed methods, from registered Roots and from the native stack, and frees the others. Fields
+ * of instances are traced precisely, words of the stack are taken for objects if they point into objects of the
+ * heap, so that temporaries of executed statements are kept. Objects are not moved, as the stack isn't precise.
+ * Collection runs when objects allocated since previous one outnumber both the first threshold and objects
+ * that survived it, it takes the first threshold only. Collections are counted as collections of generation 0,
+ * marked objects are examined ones.
+ */
+#pragma once
+
+#include "runtime.h"
+
+#include <array>
+#include <iosfwd>
+
+namespace runtime
+{
+
+constexpr size_t GENERATIONS = 3;
+
+#ifdef MYTHON_TRACING_GC
+//! Thresholds the collector takes, heap isn't divided into generations
+constexpr size_t THRESHOLDS = 1;
+#else
+constexpr size_t THRESHOLDS = GENERATIONS;
+#endif
+
+struct CollectorOptions
+{
+    //! Young instances that start collection, then collections of generation that start collection of the next
+    //! one, zero first threshold disables automatic collection
+    std::array<size_t, GENERATIONS> thresholds = {700, 10, 10};
+};
+
+struct CollectorStats
+{
+    //! Collections of every generation, collection of a generation collects younger ones as well
+    std::array<size_t, GENERATIONS> collections{};
+    //! Instances whose fields were traced
+    size_t examined = 0;
+    //! Unreachable instances that were freed
+    size_t collected = 0;
+};
+
+void SetCollectorOptions(const CollectorOptions &options);
+[[nodiscard]] const CollectorOptions &GetCollectorOptions();
+
+[[nodiscard]] const CollectorStats &GetCollectorStats();
+
+//! Writes collections of every generation, numbers of examined and collected instances; tracing builds write
+//! number of collections without generations
+void PrintCollectorStats(const CollectorStats &stats, std::ostream &output);
+
+//! Collects given generation and younger ones, returns number of freed instances
+size_t CollectCycles(size_t generation = GENERATIONS - 1);
+
+//! Returns number of instances tracked by collector, or number of objects of the heap in tracing builds
+[[nodiscard]] size_t TrackedInstances();
+
+#ifndef MYTHON_TRACING_GC
+//! Stops tracking of instance that is being destroyed
+void UntrackInstance(ClassInstance &instance);
+#endif
+
+} // namespace runtime
@@ -0,0 +1,234 @@
+#include "dce.h"
+
+#include <algorithm>
+#include <optional>
+#include <unordered_set>
+
+using namespace std;
+
+namespace ast
+{
+
+using runtime::Class;
+
+namespace
+{
+
+//! Returns truth of condition that is a constant, nullopt for other conditions
+optional<bool> ConstantTruth(const Statement &condition)
+{
+    if (const auto *constant = dynamic_cast<const BoolConst *>(&condition))
+    {
+        return constant->GetValue().GetValue();
+    }
+    if (const auto *constant = dynamic_cast<const NumericConst *>(&condition))
+    {
+        return constant->GetValue().GetValue() != 0;
+    }
+    if (const auto *constant = dynamic_cast<const StringConst *>(&condition))
+    {
+        return !constant->GetValue().GetValue().empty();
+    }
+    if (dynamic_cast<const None *>(&condition))
+    {
+        return false;
+    }
+    return nullopt;
+}
+
+//! Returns true if statement sets returned value whenever it completes
+bool AlwaysReturns(const Statement &statement)
+{
+    if (dynamic_cast<const Return *>(&statement))
+    {
+        return true;
+    }
+    if (const auto *compound = dynamic_cast<const Compound *>(&statement))
+    {
+        const auto &statements = compound->GetStatements();
+        return any_of(statements.begin(), statements.end(), [](const auto &child) { return AlwaysReturns(*child); });
+    }
+    if (const auto *if_else = dynamic_cast<const IfElse *>(&statement))
+    {
+        return if_else->GetElseBody() && AlwaysReturns(if_else->GetIfBody()) &&
+               AlwaysReturns(*if_else->GetElseBody());
+    }
+    return false;
+}
+
+//! Rewrites node whose children are rewritten already
+void Prune(unique_ptr<Statement> &statement)
+{
+    if (auto *if_else = dynamic_cast<IfElse *>(statement.get()))
+    {
+        const auto truth = ConstantTruth(if_else->GetCondition());
+        if (!truth)
+        {
+            return;
+        }
+        // Branch is taken out of the node before the node is destroyed
+        unique_ptr<Statement> branch;
+        if_else->RewriteChildren([&branch, &if_else, truth](unique_ptr<Statement> &child) {
+            if (child.get() == (*truth ? &if_else->GetIfBody() : if_else->GetElseBody()))
+            {
+                branch = std::move(child);
+            }
+        });
+        statement = branch ? std::move(branch) : make_unique<None>();
+    }
+    else if (auto *compound = dynamic_cast<Compound *>(statement.get()))
+    {
+        auto &statements = compound->GetStatements();
+        const auto returns =
+            find_if(statements.begin(), statements.end(), [](const auto &child) { return AlwaysReturns(*child); });
+        if (returns != statements.end())
+        {
+            statements.erase(next(returns), statements.end());
+        }
+        // None statement does nothing, it's left in place of removed conditional statements
+        statements.erase(remove_if(statements.begin(), statements.end(),
+                                   [](const auto &child) { return dynamic_cast<const None *>(child.get()); }),
+                         statements.end());
+    }
+}
+
+//! Collects classes and method names that code uses
+class References : public TreeVisitor
+{
+  public:
+    void VisitChild(const Statement &statement) override
+    {
+        if (!ast::Accept(statement, *this))
+        {
+            unknown = true;
+        }
+    }
+
+    void Visit(const VariableValue &node) override
+    {
+        variables.insert(node.GetIds().front());
+    }
+
+    void Visit(const MethodCall &node) override
+    {
+        methods.insert(node.GetMethod());
+        TreeVisitor::Visit(node);
+    }
+
+    void Visit(const NewInstance &node) override
+    {
+        classes.insert(&node.GetClass());
+        TreeVisitor::Visit(node);
+    }
+
+    void Visit(const MethodBody &node) override
+    {
+        unknown = unknown || !node.IsParsed();
+        TreeVisitor::Visit(node);
+    }
+
+    //! Class defined below top level is always used, its methods are visited when they are called
+    void Visit(const ClassDefinition &node) override
+    {
+        classes.insert(node.GetClass().TryAs<Class>());
+        nested.push_back(node.GetClass().TryAs<Class>());
+    }
+
+    unordered_set<string> variables;
+    unordered_set<string> methods;
+    unordered_set<const Class *> classes;
+    //! Classes defined below top level in order they were found
+    vector<Class *> nested;
+    //! Code that is not parsed yet or is not syntax tree was found
+    bool unknown = false;
+};
+
+bool IsSpecialMethod(const string &name)
+{
+    return name.size() > 4 && name.compare(0, 2, "__") == 0 && name.compare(name.size() - 2, 2, "__") == 0;
+}
+
+} // namespace
+
+void EliminateDeadCode(unique_ptr<Statement> &statement)
+{
+    RewriteTree(statement, Prune);
+}
+
+void RemoveUnusedClasses(unique_ptr<Statement> &program)
+{
+    auto *compound = dynamic_cast<Compound *>(program.get());
+    if (!compound)
+    {
+        return;
+    }
+    // Top-level code is reachable, class definitions are not visited until their classes are used
+    References references;
+    vector<Class *> top_level;
+    for (const auto &statement : compound->GetStatements())
+    {
+        if (const auto *definition = dynamic_cast<const ClassDefinition *>(statement.get()))
+        {
+            top_level.push_back(definition->GetClass().TryAs<Class>());
+        }
+        else
+        {
+            references.VisitChild(*statement);
+        }
+    }
+
+    unordered_set<const runtime::Method *> called;
+    for (bool changed = true; changed && !references.unknown;)
+    {
+        changed = false;
+        for (const Class *cls : top_level)
+        {
+            if (references.variables.count(cls->GetName()))
+            {
+                references.classes.insert(cls);
+            }
+        }
+        // Methods of parent are called through instances of its children
+        for (const Class *cls : vector(references.classes.begin(), references.classes.end()))
+        {
+            for (const Class *parent = cls->GetParent(); parent; parent = parent->GetParent())
+            {
+                references.classes.insert(parent);
+            }
+        }
+        for (const Class *cls : vector(references.classes.begin(), references.classes.end()))
+        {
+            for (const auto &method : cls->GetMethods())
+            {
+                if (!called.count(&method) && (IsSpecialMethod(method.name) || references.methods.count(method.name)))
+                {
+                    called.insert(&method);
+                    references.VisitChild(*method.body);
+                    changed = true;
+                }
+            }
+        }
+    }
+    if (references.unknown)
+    {
+        return;
+    }
+
+    auto &statements = compound->GetStatements();
+    statements.erase(remove_if(statements.begin(), statements.end(),
+                               [&references](const auto &statement) {
+                                   const auto *definition = dynamic_cast<const ClassDefinition *>(statement.get());
+                                   return definition &&
+                                          !references.classes.count(definition->GetClass().TryAs<Class>());
+                               }),
+                     statements.end());
+    vector<Class *> used = references.nested;
+    copy_if(top_level.begin(), top_level.end(), back_inserter(used),
+            [&references](const Class *cls) { return references.classes.count(cls) != 0; });
+    for (Class *cls : used)
+    {
+        cls->RemoveMethods([&called](const runtime::Method &method) { return called.count(&method) == 0; });
+    }
+}
+
+} // namespace ast
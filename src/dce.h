@@ -0,0 +1,30 @@
+/*!
+ * \file dce.h
+ * \brief Dead code elimination: statements that never execute and classes that are never used are removed
+ */
+#pragma once
+
+#include "statement.h"
+
+namespace ast
+{
+
+/*!
+ * Replaces conditional statements whose condition is a constant by the branch it selects and removes statements
+ * that follow a statement that always returns in the same compound, in statement and its children, including
+ * methods of classes it defines
+ */
+void EliminateDeadCode(std::unique_ptr<Statement> &statement);
+
+/*!
+ * Removes definitions of classes that program never uses and methods that are never called. Class is used if
+ * its instance is created, its name is read as a variable, it's a parent of a used class or it's not defined
+ * at top level. Method is called if it's special, i.e. "__init__" or "__str__", or if a method of the same name
+ * is called by top-level code or by a called method. Only calls that are reachable count, so classes and
+ * methods that are used by unused ones only are removed as well.
+ * Nothing is removed if program has method bodies that are not parsed yet or statements that are not syntax
+ * tree nodes, since what they use is unknown
+ */
+void RemoveUnusedClasses(std::unique_ptr<Statement> &program);
+
+} // namespace ast
@@ -0,0 +1,323 @@
+#include "escape.h"
+
+#include "fuse.h"
+
+#include <typeinfo>
+
+using namespace std;
+
+namespace ast
+{
+
+using runtime::Closure;
+using runtime::Context;
+using runtime::Number;
+using runtime::ObjectHolder;
+
+namespace
+{
+
+//! How parent uses value of its child
+enum class Use
+{
+    //! Value may outlive parent, i.e. it's assigned, passed to method or returned
+    Escapes,
+    //! Value is operand of arithmetic operation or comparison
+    Value,
+    //! Only truth of value is used by logical operation or condition
+    Truth,
+};
+
+bool IsArithmetic(const type_info &type)
+{
+    return type == typeid(Add) || type == typeid(Sub) || type == typeid(Mult) || type == typeid(Div);
+}
+
+bool IsCondition(const type_info &type)
+{
+    return type == typeid(Comparison) || type == typeid(Not) || type == typeid(And) || type == typeid(Or);
+}
+
+//! Syntax tree nodes are executed through accessors of their parents, accessors are const only
+Statement &Mutable(const Statement &statement)
+{
+    return const_cast<Statement &>(statement); // NOLINT
+}
+
+//! Value of expression that doesn't escape it: number is kept in place, value of other type is held by object
+struct Local
+{
+    static Local Of(ObjectHolder object)
+    {
+        const runtime::Object *ptr = object.Get();
+        if (ptr && typeid(*ptr) == typeid(Number))
+        {
+            const int number = static_cast<const Number *>(ptr)->GetValue();
+            return {std::move(object), number, true};
+        }
+        return {std::move(object), 0, false};
+    }
+
+    static Local Of(int number)
+    {
+        return {ObjectHolder::None(), number, true};
+    }
+
+    //! Returns object holding value, number computed in place is moved to heap at last
+    ObjectHolder Box() const
+    {
+        return is_number && !object ? ObjectHolder::Own(Number(number)) : object;
+    }
+
+    ObjectHolder object;
+    int number;
+    bool is_number;
+};
+
+Local Evaluate(Statement &statement, Closure &closure, Context &context) // NOLINT
+{
+    const type_info &type = typeid(statement);
+    if (!IsArithmetic(type))
+    {
+        return Local::Of(statement.Execute(closure, context));
+    }
+    const auto &operation = static_cast<const BinaryOperation &>(statement);
+    const Local lhs = Evaluate(Mutable(operation.GetLeft()), closure, context);
+    const Local rhs = Evaluate(Mutable(operation.GetRight()), closure, context);
+    if (lhs.is_number && rhs.is_number)
+    {
+        if (type == typeid(Add))
+        {
+            return Local::Of(rhs.number + lhs.number);
+        }
+        if (type == typeid(Sub))
+        {
+            return Local::Of(lhs.number - rhs.number);
+        }
+        if (type == typeid(Mult))
+        {
+            return Local::Of(lhs.number * rhs.number);
+        }
+        if (rhs.number != 0)
+        {
+            return Local::Of(lhs.number / rhs.number);
+        }
+    }
+    // Operation computes operands of other types and reports errors
+    if (type == typeid(Add))
+    {
+        return Local::Of(Add::Compute(lhs.Box(), rhs.Box(), context));
+    }
+    if (type == typeid(Sub))
+    {
+        return Local::Of(Sub::Compute(lhs.Box(), rhs.Box(), context));
+    }
+    if (type == typeid(Mult))
+    {
+        return Local::Of(Mult::Compute(lhs.Box(), rhs.Box(), context));
+    }
+    return Local::Of(Div::Compute(lhs.Box(), rhs.Box(), context));
+}
+
+bool Truth(Statement &statement, Closure &closure, Context &context) // NOLINT
+{
+    const type_info &type = typeid(statement);
+    if (type == typeid(Comparison))
+    {
+        auto &comparison = static_cast<Comparison &>(statement);
+        const Local lhs = Evaluate(Mutable(comparison.GetLeft()), closure, context);
+        const Local rhs = Evaluate(Mutable(comparison.GetRight()), closure, context);
+        if (lhs.is_number && rhs.is_number && comparison.ComparesValues())
+        {
+            return comparison.CompareNumbers(lhs.number, rhs.number);
+        }
+        return comparison.Compare(lhs.Box(), rhs.Box(), context);
+    }
+    if (type == typeid(Not))
+    {
+        return !Truth(Mutable(static_cast<const Not &>(statement).GetArgument()), closure, context);
+    }
+    if (type == typeid(And))
+    {
+        const auto &operation = static_cast<const And &>(statement);
+        return Truth(Mutable(operation.GetLeft()), closure, context) &&
+               Truth(Mutable(operation.GetRight()), closure, context);
+    }
+    if (type == typeid(Or))
+    {
+        const auto &operation = static_cast<const Or &>(statement);
+        return Truth(Mutable(operation.GetLeft()), closure, context) ||
+               Truth(Mutable(operation.GetRight()), closure, context);
+    }
+    return runtime::IsTrue(statement.Execute(closure, context));
+}
+
+//! Arithmetic operation whose operands are arithmetic operations as well
+class LocalArithmetic : public Fused<BinaryOperation>
+{
+  public:
+    explicit LocalArithmetic(unique_ptr<BinaryOperation> original) : Fused(std::move(original))
+    {
+        Init();
+    }
+
+    [[nodiscard]] const char *GetName() const override
+    {
+        return "LocalArithmetic";
+    }
+
+    ObjectHolder Execute(Closure &closure, Context &context) override
+    {
+        return Evaluate(*original_, closure, context).Box();
+    }
+
+  private:
+    bool Bind() override
+    {
+        return true;
+    }
+};
+
+//! Comparison or logical operation whose operands don't escape it, only Bool it returns does
+class LocalCondition : public Fused<Node>
+{
+  public:
+    explicit LocalCondition(unique_ptr<Node> original) : Fused(std::move(original))
+    {
+        Init();
+    }
+
+    [[nodiscard]] const char *GetName() const override
+    {
+        return "LocalCondition";
+    }
+
+    ObjectHolder Execute(Closure &closure, Context &context) override
+    {
+        return ObjectHolder::Own(runtime::Bool(Truth(*original_, closure, context)));
+    }
+
+  private:
+    bool Bind() override
+    {
+        return true;
+    }
+};
+
+//! if <comparison or logical operation>: truth of condition is computed without Bool
+class LocalIfElse : public Fused<IfElse>
+{
+  public:
+    explicit LocalIfElse(unique_ptr<IfElse> original) : Fused(std::move(original))
+    {
+        Init();
+    }
+
+    [[nodiscard]] const char *GetName() const override
+    {
+        return "LocalIfElse";
+    }
+
+    ObjectHolder Execute(Closure &closure, Context &context) override
+    {
+        if (Truth(*condition_, closure, context))
+        {
+            if_body_->Execute(closure, context);
+        }
+        else if (else_body_)
+        {
+            else_body_->Execute(closure, context);
+        }
+        return ObjectHolder::None();
+    }
+
+  private:
+    bool Bind() override
+    {
+        condition_ = &Mutable(original_->GetCondition());
+        if_body_ = &Mutable(original_->GetIfBody());
+        else_body_ = original_->GetElseBody() ? &Mutable(*original_->GetElseBody()) : nullptr;
+        return true;
+    }
+
+    Statement *condition_ = nullptr;
+    Statement *if_body_ = nullptr;
+    Statement *else_body_ = nullptr;
+};
+
+//! Replaces node of type Original by node of type L that owns it
+template <typename L, typename Original> void Replace(unique_ptr<Statement> &statement)
+{
+    auto *node = static_cast<Original *>(statement.get());
+    statement.release();
+    statement = make_unique<L>(unique_ptr<Original>(node));
+}
+
+//! Returns true if any child of node has one of types "matches" accepts
+template <typename Matches> bool AnyChild(Node &node, Matches matches)
+{
+    bool found = false;
+    node.RewriteChildren([&found, &matches](unique_ptr<Statement> &child) {
+        found = found || matches(typeid(*child));
+    });
+    return found;
+}
+
+void Rewrite(unique_ptr<Statement> &statement, Use use) // NOLINT
+{
+    auto *node = dynamic_cast<Node *>(statement.get());
+    if (!node)
+    {
+        return;
+    }
+    const type_info &type = typeid(*node);
+    if (IsArithmetic(type))
+    {
+        node->RewriteChildren([](unique_ptr<Statement> &child) { Rewrite(child, Use::Value); });
+        // Operation used as value is computed by its parent
+        if (use != Use::Value && AnyChild(*node, IsArithmetic))
+        {
+            Replace<LocalArithmetic, BinaryOperation>(statement);
+        }
+    }
+    else if (type == typeid(Comparison))
+    {
+        node->RewriteChildren([](unique_ptr<Statement> &child) { Rewrite(child, Use::Value); });
+        if (use != Use::Truth && AnyChild(*node, IsArithmetic))
+        {
+            Replace<LocalCondition, Node>(statement);
+        }
+    }
+    else if (IsCondition(type))
+    {
+        node->RewriteChildren([](unique_ptr<Statement> &child) { Rewrite(child, Use::Truth); });
+        if (use != Use::Truth && AnyChild(*node, IsCondition))
+        {
+            Replace<LocalCondition, Node>(statement);
+        }
+    }
+    else if (type == typeid(IfElse))
+    {
+        const Statement *condition = &static_cast<IfElse *>(node)->GetCondition();
+        node->RewriteChildren([condition](unique_ptr<Statement> &child) {
+            Rewrite(child, child.get() == condition ? Use::Truth : Use::Escapes);
+        });
+        if (IsCondition(typeid(static_cast<IfElse *>(node)->GetCondition())))
+        {
+            Replace<LocalIfElse, IfElse>(statement);
+        }
+    }
+    else
+    {
+        node->RewriteChildren([](unique_ptr<Statement> &child) { Rewrite(child, Use::Escapes); });
+    }
+}
+
+} // namespace
+
+void KeepTemporariesLocal(unique_ptr<Statement> &statement)
+{
+    Rewrite(statement, Use::Escapes);
+}
+
+} // namespace ast
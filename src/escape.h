@@ -0,0 +1,23 @@
+/*!
+ * \file escape.h
+ * \brief Escape analysis: intermediate values of expressions are computed without objects holding them
+ */
+#pragma once
+
+#include "statement.h"
+
+namespace ast
+{
+
+/*!
+ * Finds values that don't escape the expression or statement computing them: results of arithmetic operations
+ * that are operands of other arithmetic operations or comparisons, and results of comparisons and logical
+ * operations that are operands of logical operations or conditions of "if". Expression with such values is
+ * replaced by a node that keeps numbers computed in between in place and uses truth of conditions without
+ * creating Bool, only its own result is held by an object. Operands of other types are computed the way
+ * operations compute them. Replaced node is visited as the original one, so it's seen by passes that run
+ * afterwards as it was
+ */
+void KeepTemporariesLocal(std::unique_ptr<Statement> &statement);
+
+} // namespace ast
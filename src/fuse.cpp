@@ -0,0 +1,303 @@
+#include "fuse.h"
+
+#include <typeinfo>
+
+using namespace std;
+
+namespace ast
+{
+
+using runtime::ClassInstance;
+using runtime::Closure;
+using runtime::Context;
+using runtime::Number;
+using runtime::ObjectHolder;
+
+namespace
+{
+
+const string RETURNED_VALUE = "returned_value"s;
+
+[[noreturn]] void ThrowUnknownVariable(const string &name)
+{
+    throw runtime_error("Unknown variable - "s + name);
+}
+
+//! Returns single name of variable or nullptr if statement is not a variable without fields
+const string *VariableName(const Statement &statement)
+{
+    const auto *variable = dynamic_cast<const VariableValue *>(&statement);
+    return variable && variable->GetIds().size() == 1 ? &variable->GetIds().front() : nullptr;
+}
+
+//! x = x + <constant>
+class IncrementAssignment : public Fused<Assignment>
+{
+  public:
+    explicit IncrementAssignment(unique_ptr<Assignment> original) : Fused(std::move(original))
+    {
+        Init();
+    }
+
+    [[nodiscard]] const char *GetName() const override
+    {
+        return "Fused IncrementAssignment";
+    }
+
+    static bool Matches(const Assignment &node)
+    {
+        const auto *add = dynamic_cast<const Add *>(&node.GetValue());
+        if (!add)
+        {
+            return false;
+        }
+        const string *name = VariableName(add->GetLeft());
+        return name && *name == node.GetVariable() &&
+               (dynamic_cast<const NumericConst *>(&add->GetRight()) ||
+                dynamic_cast<const StringConst *>(&add->GetRight()));
+    }
+
+    ObjectHolder Execute(Closure &closure, Context &context) override
+    {
+        if (!bound_)
+        {
+            return original_->Execute(closure, context);
+        }
+        auto it = closure.find(original_->GetVariable());
+        if (it == closure.end())
+        {
+            ThrowUnknownVariable(original_->GetVariable());
+        }
+        const auto *lhs = it->second.TryAs<Number>();
+        if (lhs && number_)
+        {
+            it->second = ObjectHolder::Own(Number(lhs->GetValue() + *number_));
+            return it->second;
+        }
+        ObjectHolder result = Add::Compute(it->second, constant_, context);
+        return closure[original_->GetVariable()] = std::move(result);
+    }
+
+  private:
+    bool Bind() override
+    {
+        if (!Matches(*original_))
+        {
+            return false;
+        }
+        const Statement &rhs = static_cast<const Add &>(original_->GetValue()).GetRight();
+        if (const auto *number = dynamic_cast<const NumericConst *>(&rhs))
+        {
+            number_ = number->GetValue().GetValue();
+            constant_ = runtime::Pin(ObjectHolder::Own(Number(*number_)));
+        }
+        else
+        {
+            number_.reset();
+            constant_ = runtime::Pin(
+                ObjectHolder::Own(runtime::String(static_cast<const StringConst &>(rhs).GetValue())));
+        }
+        return true;
+    }
+
+    optional<int> number_;
+    //! Constant is owned by the node, so it stays valid when the original constant is rewritten
+    ObjectHolder constant_;
+};
+
+//! object.field = variable
+class VariableFieldAssignment : public Fused<FieldAssignment>
+{
+  public:
+    explicit VariableFieldAssignment(unique_ptr<FieldAssignment> original) : Fused(std::move(original))
+    {
+        Init();
+    }
+
+    [[nodiscard]] const char *GetName() const override
+    {
+        return "Fused VariableFieldAssignment";
+    }
+
+    static bool Matches(const FieldAssignment &node)
+    {
+        return node.GetObject().GetIds().size() == 1 && VariableName(node.GetValue());
+    }
+
+    ObjectHolder Execute(Closure &closure, Context &context) override
+    {
+        if (!bound_)
+        {
+            return original_->Execute(closure, context);
+        }
+        const string &object_name = original_->GetObject().GetIds().front();
+        auto object = closure.find(object_name);
+        if (object == closure.end())
+        {
+            ThrowUnknownVariable(object_name);
+        }
+        auto *instance = object->second.TryAs<ClassInstance>();
+        if (!instance)
+        {
+            return original_->Execute(closure, context);
+        }
+        auto value = closure.find(*value_name_);
+        if (value == closure.end())
+        {
+            ThrowUnknownVariable(*value_name_);
+        }
+        return instance->Fields()[original_->GetField()] = value->second;
+    }
+
+  private:
+    bool Bind() override
+    {
+        value_name_ = Matches(*original_) ? VariableName(original_->GetValue()) : nullptr;
+        return value_name_ != nullptr;
+    }
+
+    const string *value_name_ = nullptr;
+};
+
+//! return object.field
+class FieldReturn : public Fused<Return>
+{
+  public:
+    explicit FieldReturn(unique_ptr<Return> original) : Fused(std::move(original))
+    {
+        Init();
+    }
+
+    [[nodiscard]] const char *GetName() const override
+    {
+        return "Fused FieldReturn";
+    }
+
+    static bool Matches(const Return &node)
+    {
+        const auto *variable = dynamic_cast<const VariableValue *>(&node.GetValue());
+        return variable && variable->GetIds().size() == 2;
+    }
+
+    ObjectHolder Execute(Closure &closure, Context &context) override
+    {
+        if (!bound_)
+        {
+            return original_->Execute(closure, context);
+        }
+        auto object = closure.find(ids_->front());
+        if (object == closure.end())
+        {
+            ThrowUnknownVariable(ids_->front());
+        }
+        auto *instance = object->second.TryAs<ClassInstance>();
+        if (!instance)
+        {
+            return original_->Execute(closure, context);
+        }
+        ObjectHolder value = instance->Fields()[ids_->back()];
+        closure[RETURNED_VALUE] = std::move(value);
+        return ObjectHolder::None();
+    }
+
+  private:
+    bool Bind() override
+    {
+        ids_ = Matches(*original_) ? &static_cast<const VariableValue &>(original_->GetValue()).GetIds() : nullptr;
+        return ids_ != nullptr;
+    }
+
+    const vector<string> *ids_ = nullptr;
+};
+
+//! if <comparison>: condition is computed without creating Bool, comparison is specialized for its operands
+class ComparisonIfElse : public Fused<IfElse>
+{
+  public:
+    explicit ComparisonIfElse(unique_ptr<IfElse> original) : Fused(std::move(original))
+    {
+        Init();
+    }
+
+    [[nodiscard]] const char *GetName() const override
+    {
+        return "Fused ComparisonIfElse";
+    }
+
+    static bool Matches(const IfElse &node)
+    {
+        return dynamic_cast<const Comparison *>(&node.GetCondition()) != nullptr;
+    }
+
+    ObjectHolder Execute(Closure &closure, Context &context) override
+    {
+        if (!bound_)
+        {
+            return original_->Execute(closure, context);
+        }
+        const ObjectHolder lhs = lhs_->Execute(closure, context);
+        const ObjectHolder rhs = rhs_->Execute(closure, context);
+        if (comparison_->Compare(lhs, rhs, context))
+        {
+            if_body_->Execute(closure, context);
+        }
+        else if (else_body_)
+        {
+            else_body_->Execute(closure, context);
+        }
+        return ObjectHolder::None();
+    }
+
+  private:
+    bool Bind() override
+    {
+        if (!Matches(*original_))
+        {
+            return false;
+        }
+        // Statements are executed by the original nodes as well, accessors are const only
+        const auto *comparison = static_cast<const Comparison *>(&original_->GetCondition());
+        comparison_ = const_cast<Comparison *>(comparison);             // NOLINT
+        lhs_ = const_cast<Statement *>(&comparison->GetLeft());         // NOLINT
+        rhs_ = const_cast<Statement *>(&comparison->GetRight());        // NOLINT
+        if_body_ = const_cast<Statement *>(&original_->GetIfBody());    // NOLINT
+        else_body_ = const_cast<Statement *>(original_->GetElseBody()); // NOLINT
+        return true;
+    }
+
+    Comparison *comparison_ = nullptr;
+    Statement *lhs_ = nullptr;
+    Statement *rhs_ = nullptr;
+    Statement *if_body_ = nullptr;
+    Statement *else_body_ = nullptr;
+};
+
+//! Replaces statement by fused node of type F if statement is node of type Original of the fused shape
+template <typename F, typename Original> bool TryFuse(unique_ptr<Statement> &statement)
+{
+    auto *node = dynamic_cast<Original *>(statement.get());
+    if (!node || typeid(*node) != typeid(Original) || !F::Matches(*node))
+    {
+        return false;
+    }
+    statement.release();
+    statement = make_unique<F>(unique_ptr<Original>(node));
+    return true;
+}
+
+} // namespace
+
+void FuseStatements(unique_ptr<Statement> &statement) // NOLINT
+{
+    auto *node = dynamic_cast<Node *>(statement.get());
+    if (!node)
+    {
+        return;
+    }
+    node->RewriteChildren(FuseStatements);
+    TryFuse<IncrementAssignment, Assignment>(statement) ||
+        TryFuse<VariableFieldAssignment, FieldAssignment>(statement) || TryFuse<FieldReturn, Return>(statement) ||
+        TryFuse<ComparisonIfElse, IfElse>(statement);
+}
+
+} // namespace ast
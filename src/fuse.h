@@ -0,0 +1,76 @@
+/*!
+ * \file fuse.h
+ * \brief Fused syntax tree nodes: common statement shapes executed in one step
+ */
+#pragma once
+
+#include "statement.h"
+
+namespace ast
+{
+
+//! Node that replaces original one and is visited as it, tree dump writes both of them
+class Replacement : public Node
+{
+  public:
+    //! Name of replacement node, i.e. "Fused IncrementAssignment"
+    [[nodiscard]] virtual const char *GetName() const = 0;
+    [[nodiscard]] virtual const Node &GetOriginal() const = 0;
+    //! Returns false if replacement executes the original node, because its shape no longer matches
+    [[nodiscard]] virtual bool IsBound() const = 0;
+};
+
+/*!
+ * Owns the original node and is visited as it. Children of the original node may be rewritten, then fused
+ * node binds to them again and executes the original node if its shape no longer matches
+ */
+template <typename Original> class Fused : public Replacement
+{
+  public:
+    explicit Fused(std::unique_ptr<Original> original) : original_(std::move(original))
+    {
+    }
+
+    void Accept(Visitor &visitor) const override
+    {
+        original_->Accept(visitor);
+    }
+
+    [[nodiscard]] const Node &GetOriginal() const override
+    {
+        return *original_;
+    }
+
+    [[nodiscard]] bool IsBound() const override
+    {
+        return bound_;
+    }
+
+    void RewriteChildren(const Rewriter &rewriter) override
+    {
+        original_->RewriteChildren(rewriter);
+        bound_ = Bind();
+    }
+
+  protected:
+    //! Must be called by constructor of the derived node
+    void Init()
+    {
+        bound_ = Bind();
+    }
+
+    //! Caches what fused execution needs, returns false if the original node doesn't have fused shape
+    virtual bool Bind() = 0;
+
+    std::unique_ptr<Original> original_;
+    bool bound_ = false;
+};
+
+/*!
+ * Replaces statements of shapes "x = x + <constant>", "object.field = variable", "return object.field"
+ * and "if <comparison>:" in statement and its children, including methods of classes it defines.
+ * Fused node is visited as the original one and executes the same way, without intermediate nodes
+ */
+void FuseStatements(std::unique_ptr<Statement> &statement);
+
+} // namespace ast
@@ -0,0 +1,324 @@
+#include "cycles.h"
+
+// Builds that count owners of objects collect cycles of instances instead, see cycles.cpp
+#ifdef MYTHON_TRACING_GC
+
+#include <algorithm>
+#include <typeinfo>
+#include <unordered_set>
+
+#include <pthread.h>
+
+using namespace std;
+
+namespace runtime
+{
+
+//! Objects allocated by ObjectHolder::Own, and roots that refer to them besides the native stack
+class Heap : public Tracer
+{
+  public:
+    void Manage(Object *object, size_t size)
+    {
+        // Heap may grow as much as it has survived the last collection
+        if (options.thresholds[0] != 0 && allocated_ >= max(options.thresholds[0], survivors_) && !collecting_)
+        {
+            Collect();
+        }
+        if (typeid(*object) == typeid(ClassInstance))
+        {
+            Roots &fields = static_cast<ClassInstance *>(object)->Fields();
+            fields.Unroot();
+        }
+        object->color_ = Object::Color::White;
+        objects_.push_back({object, size});
+        ++allocated_;
+    }
+
+    void Link(Roots &roots)
+    {
+        roots.prev_ = nullptr;
+        roots.next_ = roots_;
+        if (roots_)
+        {
+            roots_->prev_ = &roots;
+        }
+        roots_ = &roots;
+        roots.rooted_ = true;
+    }
+
+    void Unlink(Roots &roots)
+    {
+        if (roots.prev_)
+        {
+            roots.prev_->next_ = roots.next_;
+        }
+        else
+        {
+            roots_ = roots.next_;
+        }
+        if (roots.next_)
+        {
+            roots.next_->prev_ = roots.prev_;
+        }
+        roots.prev_ = roots.next_ = nullptr;
+        roots.rooted_ = false;
+    }
+
+    void Pin(const ObjectHolder &object)
+    {
+        pinned_.push_back(object);
+    }
+
+    size_t Collect()
+    {
+        collecting_ = true;
+        // Words of the stack are looked up among addresses of objects
+        sort(objects_.begin(), objects_.end());
+        for (const Roots *roots = roots_; roots; roots = roots->next_)
+        {
+            roots->Trace(*this);
+        }
+        for (const auto &object : pinned_)
+        {
+            Mark(object);
+        }
+        ScanStack();
+        size_t marked = 0;
+        while (!gray_.empty())
+        {
+            Object *object = gray_.back();
+            gray_.pop_back();
+            ++marked;
+            if (typeid(*object) == typeid(ClassInstance))
+            {
+                for (const auto &[name, field] : static_cast<ClassInstance *>(object)->Fields())
+                {
+                    Mark(field);
+                }
+            }
+        }
+        unmanaged_.clear();
+
+        size_t kept = 0;
+        for (const Allocation &allocation : objects_)
+        {
+            if (allocation.object->color_ == Object::Color::Black)
+            {
+                allocation.object->color_ = Object::Color::White;
+                objects_[kept++] = allocation;
+            }
+            else
+            {
+                delete allocation.object; // NOLINT
+            }
+        }
+        const size_t freed = objects_.size() - kept;
+        objects_.resize(kept);
+        survivors_ = kept;
+        allocated_ = 0;
+        ++stats.collections[0];
+        stats.examined += marked;
+        stats.collected += freed;
+        collecting_ = false;
+        return freed;
+    }
+
+    void Mark(const ObjectHolder &object) override
+    {
+        Object *ptr = object.Get();
+        if (!ptr)
+        {
+            return;
+        }
+        if (ptr->color_ == Object::Color::White)
+        {
+            ptr->color_ = Object::Color::Black;
+            gray_.push_back(ptr);
+        }
+        // Instance shared by ObjectHolder, i.e. on the stack of tests, may refer to objects of the heap
+        else if (ptr->color_ == Object::Color::Unmanaged && unmanaged_.insert(ptr).second)
+        {
+            gray_.push_back(ptr);
+        }
+    }
+
+    [[nodiscard]] size_t Size() const
+    {
+        return objects_.size();
+    }
+
+    CollectorOptions options;
+    CollectorStats stats;
+
+  private:
+    //! Callee-saved registers are spilled to this frame, which is scanned along with its callers
+    [[gnu::noinline]] void ScanStack()
+    {
+        __builtin_unwind_init();
+        ScanStackFrom();
+        // Call isn't a tail call, so that spilled registers stay on the stack while it's scanned
+        asm volatile("" ::: "memory");
+    }
+
+    [[gnu::noinline, gnu::no_sanitize_address]] void ScanStackFrom()
+    {
+        const void *top = __builtin_frame_address(0);
+        const auto begin = reinterpret_cast<uintptr_t>(top) & ~(uintptr_t{alignof(void *)} - 1);
+        const auto end = reinterpret_cast<uintptr_t>(StackEnd());
+        if (objects_.empty())
+        {
+            return;
+        }
+        const auto lowest = Address(objects_.front());
+        const auto highest = Address(objects_.back()) + objects_.back().size;
+        for (uintptr_t address = begin; address + sizeof(void *) <= end; address += sizeof(void *))
+        {
+            const uintptr_t word = *reinterpret_cast<const uintptr_t *>(address); // NOLINT
+            if (word < lowest || word >= highest)
+            {
+                continue;
+            }
+            // Word may point inside of object, i.e. to fields of instance that is no longer referred to otherwise
+            auto it = upper_bound(objects_.begin(), objects_.end(), word,
+                                  [](uintptr_t value, const Allocation &object) { return value < Address(object); });
+            --it;
+            if (word < Address(*it) + it->size)
+            {
+                Mark(ObjectHolder::Share(*it->object));
+            }
+        }
+    }
+
+    //! Returns the highest address of the stack of current thread
+    static const void *StackEnd()
+    {
+        thread_local const void *end = [] {
+            pthread_attr_t attributes;
+            pthread_getattr_np(pthread_self(), &attributes);
+            void *address = nullptr;
+            size_t size = 0;
+            pthread_attr_getstack(&attributes, &address, &size);
+            pthread_attr_destroy(&attributes);
+            return static_cast<const void *>(static_cast<const char *>(address) + size);
+        }();
+        return end;
+    }
+
+    //! Object of the heap, words of the stack that point to any of its bytes keep it
+    struct Allocation
+    {
+        Object *object;
+        size_t size;
+
+        bool operator<(const Allocation &other) const
+        {
+            return object < other.object;
+        }
+    };
+
+    static uintptr_t Address(const Allocation &allocation)
+    {
+        return reinterpret_cast<uintptr_t>(allocation.object); // NOLINT
+    }
+
+    vector<Allocation> objects_;
+    //! Objects found reachable whose fields are not marked yet
+    vector<Object *> gray_;
+    //! Objects outside of the heap whose fields are marked, they have no color of their own
+    unordered_set<const Object *> unmanaged_;
+    Roots *roots_ = nullptr;
+    vector<ObjectHolder> pinned_;
+    size_t allocated_ = 0;
+    size_t survivors_ = 0;
+    //! Objects freed by collection don't start another one
+    bool collecting_ = false;
+};
+
+namespace
+{
+
+//! Heap isn't destroyed, so roots may outlive it at exit
+Heap &GetHeap()
+{
+    static auto *heap = new Heap; // NOLINT
+    return *heap;
+}
+
+} // namespace
+
+void ManageObject(Object *object, size_t size)
+{
+    GetHeap().Manage(object, size);
+}
+
+Roots::Roots()
+{
+    GetHeap().Link(*this);
+}
+
+Roots::Roots([[maybe_unused]] const Roots &other)
+{
+    GetHeap().Link(*this);
+}
+
+Roots &Roots::operator=([[maybe_unused]] const Roots &other)
+{
+    return *this;
+}
+
+Roots::~Roots()
+{
+    Unroot();
+}
+
+void Roots::Unroot()
+{
+    if (rooted_)
+    {
+        GetHeap().Unlink(*this);
+    }
+}
+
+void Closure::Trace(Tracer &tracer) const
+{
+    for (const auto &[name, value] : *this)
+    {
+        tracer.Mark(value);
+    }
+}
+
+ObjectHolder Pin(ObjectHolder object)
+{
+    GetHeap().Pin(object);
+    return object;
+}
+
+void SetCollectorOptions(const CollectorOptions &options)
+{
+    GetHeap().options = options;
+}
+
+const CollectorOptions &GetCollectorOptions()
+{
+    return GetHeap().options;
+}
+
+const CollectorStats &GetCollectorStats()
+{
+    return GetHeap().stats;
+}
+
+size_t CollectCycles([[maybe_unused]] size_t generation)
+{
+    return GetHeap().Collect();
+}
+
+size_t TrackedInstances()
+{
+    return GetHeap().Size();
+}
+
+} // namespace runtime
+
+#endif
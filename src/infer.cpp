@@ -0,0 +1,606 @@
+#include "infer.h"
+
+#include <map>
+#include <set>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+namespace ast
+{
+
+using runtime::Class;
+using runtime::Method;
+
+namespace
+{
+
+//! Set of runtime types value may have
+using Types = uint8_t;
+constexpr Types NONE_TYPE = 1;
+constexpr Types NUMBER = 2;
+constexpr Types STRING = 4;
+constexpr Types BOOL = 8;
+constexpr Types INSTANCE = 16;
+constexpr Types CLASS = 32;
+constexpr Types ANY = NONE_TYPE | NUMBER | STRING | BOOL | INSTANCE | CLASS;
+
+const string SELF = "self"s;
+const string INIT_METHOD = "__init__"s;
+const string RETURNED_VALUE = "returned_value"s;
+
+//! Runtime calls these methods with argument of any type
+const unordered_set<string> RUNTIME_METHODS = {"__add__"s, "__eq__"s, "__lt__"s};
+
+//! Returns true if statement sets "returned_value" whichever way it's executed
+bool AlwaysReturns(const Statement &statement) // NOLINT
+{
+    if (dynamic_cast<const Return *>(&statement))
+    {
+        return true;
+    }
+    if (const auto *assignment = dynamic_cast<const Assignment *>(&statement))
+    {
+        return assignment->GetVariable() == RETURNED_VALUE;
+    }
+    if (const auto *compound = dynamic_cast<const Compound *>(&statement))
+    {
+        for (const auto &child : compound->GetStatements())
+        {
+            if (AlwaysReturns(*child))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    if (const auto *if_else = dynamic_cast<const IfElse *>(&statement))
+    {
+        return if_else->GetElseBody() && AlwaysReturns(if_else->GetIfBody()) &&
+               AlwaysReturns(*if_else->GetElseBody());
+    }
+    return false;
+}
+
+bool IsSubclass(const Class *cls, const Class &base)
+{
+    for (; cls; cls = cls->GetParent())
+    {
+        if (cls == &base)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Types grow monotonically, so analysis of the whole program is repeated until nothing changes.
+ * Variables are scoped by method, nullptr is top level. Fields are identified by name only, since type of
+ * object is not tracked. Field that is not assigned yet is None, it's known to be assigned only when it's
+ * read as "self.field" and __init__ of every instantiated class the method can be called for
+ * assigns the field before anything else happens
+ */
+class Inference : public Visitor
+{
+  public:
+    //! Returns false if effects of some statements of program are unknown
+    bool Run(const Statement &program)
+    {
+        // Classes and the ways they are instantiated are found first, fields known to be assigned depend on them
+        do
+        {
+            changed_ = false;
+            AnalyzeAll(program);
+        } while (changed_ && !unknown_);
+        if (unknown_)
+        {
+            return false;
+        }
+        FindInitializedFields();
+
+        variables_.clear();
+        fields_.clear();
+        do
+        {
+            changed_ = false;
+            types_.clear();
+            AnalyzeAll(program);
+        } while (changed_);
+        return true;
+    }
+
+    //! Returns types of values statement produced during the last analysis, ANY if it wasn't analyzed
+    [[nodiscard]] Types TypeOf(const Statement &statement) const
+    {
+        auto it = types_.find(&statement);
+        return it != types_.end() ? it->second : ANY;
+    }
+
+  private:
+    void AnalyzeAll(const Statement &program)
+    {
+        method_ = nullptr;
+        Infer(program);
+        // Classes are found while methods are analyzed
+        for (size_t i = 0; i < classes_.size(); ++i)
+        {
+            for (const auto &method : classes_[i]->GetMethods())
+            {
+                AnalyzeMethod(method);
+            }
+        }
+    }
+
+    void AnalyzeMethod(const Method &method)
+    {
+        const auto *body = dynamic_cast<const MethodBody *>(method.body.get());
+        if (!body || !body->IsParsed())
+        {
+            unknown_ = true;
+            return;
+        }
+        method_ = &method;
+        Join(variables_[{method_, SELF}], INSTANCE);
+        if (RUNTIME_METHODS.count(method.name))
+        {
+            for (const auto &param : method.formal_params)
+            {
+                Join(variables_[{method_, param}], ANY);
+            }
+        }
+        Infer(body->GetBody());
+        method_ = nullptr;
+    }
+
+    Types Infer(const Statement &statement)
+    {
+        result_ = ANY;
+        if (!ast::Accept(statement, *this))
+        {
+            unknown_ = true;
+        }
+        types_[&statement] = result_;
+        return result_;
+    }
+
+    void Join(Types &types, Types added)
+    {
+        if ((types | added) != types)
+        {
+            types |= added;
+            changed_ = true;
+        }
+    }
+
+    Types Variable(const string &name) const
+    {
+        auto it = variables_.find({method_, name});
+        return it != variables_.end() ? it->second : 0;
+    }
+
+    Types Field(const string &name) const
+    {
+        auto it = fields_.find(name);
+        return it != fields_.end() ? it->second : 0;
+    }
+
+    //! Returns types method call may produce
+    Types Result(const Method &method) const
+    {
+        if (self_assigned_.count(&method))
+        {
+            // Call returns "self" if it is assigned
+            return ANY;
+        }
+        auto it = variables_.find({&method, RETURNED_VALUE});
+        const Types returned = it != variables_.end() ? it->second : 0;
+        const auto *body = dynamic_cast<const MethodBody *>(method.body.get());
+        return body && body->IsParsed() && AlwaysReturns(body->GetBody()) ? returned : returned | NONE_TYPE;
+    }
+
+    void Know(const Class &cls)
+    {
+        for (const Class *known = &cls; known && !known_classes_.count(known); known = known->GetParent())
+        {
+            known_classes_.insert(known);
+            classes_.push_back(known);
+            changed_ = true;
+        }
+    }
+
+    void PassArguments(const Method &method, const vector<Types> &args)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            Join(variables_[{&method, method.formal_params[i]}], args[i]);
+        }
+    }
+
+    vector<Types> InferAll(const vector<unique_ptr<Statement>> &statements)
+    {
+        vector<Types> result;
+        for (const auto &statement : statements)
+        {
+            result.push_back(Infer(*statement));
+        }
+        return result;
+    }
+
+    //! Returns fields __init__ of class assigns before anything else happens, if it's always called
+    set<string> InitializedFields(const Class &cls) const
+    {
+        const Method *init = cls.GetMethod(INIT_METHOD);
+        if (!init || self_assigned_.count(init))
+        {
+            return {};
+        }
+        for (size_t argc : instantiations_.at(&cls))
+        {
+            if (argc != init->formal_params.size())
+            {
+                return {};
+            }
+        }
+        const auto &body = static_cast<const MethodBody &>(*init->body);
+        const auto *compound = dynamic_cast<const Compound *>(&body.GetBody());
+        if (!compound)
+        {
+            return {};
+        }
+        set<string> result;
+        for (const auto &statement : compound->GetStatements())
+        {
+            const auto *assignment = dynamic_cast<const FieldAssignment *>(statement.get());
+            if (!assignment || assignment->GetObject().GetIds() != vector<string>{SELF})
+            {
+                break;
+            }
+            // Values that can't run other code
+            const auto &value = assignment->GetValue();
+            const auto *variable = dynamic_cast<const VariableValue *>(&value);
+            if (!(variable && variable->GetIds().size() == 1) && !dynamic_cast<const NumericConst *>(&value) &&
+                !dynamic_cast<const StringConst *>(&value) && !dynamic_cast<const BoolConst *>(&value) &&
+                !dynamic_cast<const None *>(&value))
+            {
+                break;
+            }
+            result.insert(assignment->GetField());
+        }
+        return result;
+    }
+
+    void FindInitializedFields()
+    {
+        for (const Class *owner : classes_)
+        {
+            optional<set<string>> fields;
+            for (const auto &[cls, argcs] : instantiations_)
+            {
+                if (!IsSubclass(cls, *owner))
+                {
+                    continue;
+                }
+                set<string> cls_fields = InitializedFields(*cls);
+                if (!fields)
+                {
+                    fields = std::move(cls_fields);
+                    continue;
+                }
+                set<string> common;
+                for (const auto &field : *fields)
+                {
+                    if (cls_fields.count(field))
+                    {
+                        common.insert(field);
+                    }
+                }
+                fields = std::move(common);
+            }
+            for (const auto &method : owner->GetMethods())
+            {
+                if (fields && !self_assigned_.count(&method))
+                {
+                    initialized_fields_[&method] = *fields;
+                }
+            }
+        }
+    }
+
+    bool IsInitialized(const vector<string> &ids) const
+    {
+        auto it = initialized_fields_.find(method_);
+        return ids.size() == 2 && ids.front() == SELF && it != initialized_fields_.end() && it->second.count(ids[1]);
+    }
+
+    void Visit([[maybe_unused]] const NumericConst &node) override
+    {
+        result_ = NUMBER;
+    }
+
+    void Visit([[maybe_unused]] const StringConst &node) override
+    {
+        result_ = STRING;
+    }
+
+    void Visit([[maybe_unused]] const BoolConst &node) override
+    {
+        result_ = BOOL;
+    }
+
+    void Visit(const VariableValue &node) override
+    {
+        const auto &ids = node.GetIds();
+        Types types = Variable(ids.front());
+        for (size_t i = 1; i < ids.size(); ++i)
+        {
+            types = Field(ids[i]) | (i == 1 && IsInitialized(ids) ? 0 : NONE_TYPE);
+        }
+        result_ = types;
+    }
+
+    void Visit(const Assignment &node) override
+    {
+        const Types types = Infer(node.GetValue());
+        Join(variables_[{method_, node.GetVariable()}], types);
+        if (method_ && node.GetVariable() == SELF && self_assigned_.insert(method_).second)
+        {
+            changed_ = true;
+        }
+        result_ = types;
+    }
+
+    void Visit(const FieldAssignment &node) override
+    {
+        Infer(node.GetObject());
+        const Types types = Infer(node.GetValue());
+        Join(fields_[node.GetField()], types);
+        result_ = types;
+    }
+
+    void Visit([[maybe_unused]] const None &node) override
+    {
+        result_ = NONE_TYPE;
+    }
+
+    void Visit(const Print &node) override
+    {
+        InferAll(node.GetArgs());
+        result_ = NONE_TYPE;
+    }
+
+    void Visit(const MethodCall &node) override
+    {
+        const vector<Types> args = InferAll(node.GetArgs());
+        Infer(node.GetObject());
+        // Any method with this name may be called, call of a method that doesn't exist throws
+        Types types = 0;
+        for (const Class *cls : classes_)
+        {
+            for (const auto &method : cls->GetMethods())
+            {
+                if (method.name == node.GetMethod() && method.formal_params.size() == args.size())
+                {
+                    PassArguments(method, args);
+                    types |= Result(method);
+                }
+            }
+        }
+        result_ = types;
+    }
+
+    void Visit(const NewInstance &node) override
+    {
+        const Class &cls = node.GetClass();
+        Know(cls);
+        if (instantiations_[&cls].insert(node.GetArgs().size()).second)
+        {
+            changed_ = true;
+        }
+        const Method *init = cls.GetMethod(INIT_METHOD);
+        if (!init || init->formal_params.size() != node.GetArgs().size())
+        {
+            result_ = INSTANCE;
+            return;
+        }
+        PassArguments(*init, InferAll(node.GetArgs()));
+        // Object returned by __init__ replaces the new one unless it's None
+        result_ = INSTANCE | (Result(*init) & ~NONE_TYPE);
+    }
+
+    void Visit(const Stringify &node) override
+    {
+        Infer(node.GetArgument());
+        result_ = STRING;
+    }
+
+    void Visit(const Add &node) override
+    {
+        const Types lhs = Infer(node.GetLeft());
+        const Types rhs = Infer(node.GetRight());
+        Types types = 0;
+        if ((lhs & NUMBER) && (rhs & NUMBER))
+        {
+            types |= NUMBER;
+        }
+        if ((lhs & STRING) && (rhs & STRING))
+        {
+            types |= STRING;
+        }
+        if (lhs & INSTANCE)
+        {
+            // __add__ may return anything
+            types |= ANY;
+        }
+        result_ = types;
+    }
+
+    void VisitArithmetic(const BinaryOperation &node)
+    {
+        Infer(node.GetLeft());
+        Infer(node.GetRight());
+        result_ = NUMBER;
+    }
+
+    void Visit(const Sub &node) override
+    {
+        VisitArithmetic(node);
+    }
+
+    void Visit(const Mult &node) override
+    {
+        VisitArithmetic(node);
+    }
+
+    void Visit(const Div &node) override
+    {
+        VisitArithmetic(node);
+    }
+
+    void VisitLogical(const BinaryOperation &node)
+    {
+        Infer(node.GetLeft());
+        Infer(node.GetRight());
+        result_ = BOOL;
+    }
+
+    void Visit(const Or &node) override
+    {
+        VisitLogical(node);
+    }
+
+    void Visit(const And &node) override
+    {
+        VisitLogical(node);
+    }
+
+    void Visit(const Not &node) override
+    {
+        Infer(node.GetArgument());
+        result_ = BOOL;
+    }
+
+    void Visit(const Compound &node) override
+    {
+        InferAll(node.GetStatements());
+        result_ = NONE_TYPE;
+    }
+
+    void Visit(const MethodBody &node) override
+    {
+        if (!node.IsParsed())
+        {
+            unknown_ = true;
+            return;
+        }
+        Infer(node.GetBody());
+        result_ = ANY;
+    }
+
+    void Visit(const Return &node) override
+    {
+        Join(variables_[{method_, RETURNED_VALUE}], Infer(node.GetValue()));
+        result_ = NONE_TYPE;
+    }
+
+    void Visit(const ClassDefinition &node) override
+    {
+        const auto *cls = node.GetClass().TryAs<Class>();
+        Know(*cls);
+        Join(variables_[{method_, cls->GetName()}], CLASS);
+        result_ = NONE_TYPE;
+    }
+
+    void Visit(const IfElse &node) override
+    {
+        Infer(node.GetCondition());
+        Infer(node.GetIfBody());
+        if (const auto *else_body = node.GetElseBody())
+        {
+            Infer(*else_body);
+        }
+        result_ = NONE_TYPE;
+    }
+
+    void Visit(const Comparison &node) override
+    {
+        VisitLogical(node);
+    }
+
+    const Method *method_ = nullptr;
+    Types result_ = ANY;
+    bool changed_ = false;
+    bool unknown_ = false;
+
+    map<pair<const Method *, string>, Types> variables_;
+    unordered_map<string, Types> fields_;
+    unordered_map<const Statement *, Types> types_;
+
+    vector<const Class *> classes_;
+    unordered_set<const Class *> known_classes_;
+    //! Numbers of arguments every class is instantiated with
+    map<const Class *, set<size_t>> instantiations_;
+    unordered_set<const Method *> self_assigned_;
+    unordered_map<const Method *, set<string>> initialized_fields_;
+};
+
+OperandTypes ProvenTypes(Types lhs, Types rhs)
+{
+    if (lhs == NUMBER && rhs == NUMBER)
+    {
+        return OperandTypes::Numbers;
+    }
+    if (lhs == STRING && rhs == STRING)
+    {
+        return OperandTypes::Strings;
+    }
+    return OperandTypes::Unknown;
+}
+
+void Annotate(unique_ptr<Statement> &statement, const Inference &inference) // NOLINT
+{
+    auto *node = dynamic_cast<Node *>(statement.get());
+    if (!node)
+    {
+        return;
+    }
+    node->RewriteChildren([&inference](unique_ptr<Statement> &child) { Annotate(child, inference); });
+
+    const type_info &type = typeid(*node);
+    if (type == typeid(Add) || type == typeid(Sub) || type == typeid(Mult) || type == typeid(Div) ||
+        type == typeid(Comparison))
+    {
+        auto &operation = static_cast<BinaryOperation &>(*node);
+        const OperandTypes types =
+            ProvenTypes(inference.TypeOf(operation.GetLeft()), inference.TypeOf(operation.GetRight()));
+        // Only addition and comparisons are defined for strings
+        if (types == OperandTypes::Numbers ||
+            (types == OperandTypes::Strings && (type == typeid(Add) || type == typeid(Comparison))))
+        {
+            operation.ProveOperandTypes(types);
+        }
+    }
+    else if (type == typeid(IfElse))
+    {
+        auto &if_else = static_cast<IfElse &>(*node);
+        if (inference.TypeOf(if_else.GetCondition()) == BOOL)
+        {
+            if_else.ProveBoolCondition();
+        }
+    }
+}
+
+} // namespace
+
+void InferTypes(unique_ptr<Statement> &program)
+{
+    Inference inference;
+    if (inference.Run(*program))
+    {
+        Annotate(program, inference);
+    }
+}
+
+} // namespace ast
@@ -0,0 +1,22 @@
+/*!
+ * \file infer.h
+ * \brief Static type inference: operations whose operand types are known are executed without type checks
+ */
+#pragma once
+
+#include "statement.h"
+
+namespace ast
+{
+
+/*!
+ * Infers types of variables, fields and method results of program, flow-insensitively: every variable has
+ * union of types of all values assigned to it. Arithmetic operations and comparisons whose operands always
+ * have the same type and conditions that are always Bool are marked, so they skip type checks.
+ * Program is assumed to run in empty closure. Nothing is marked if program has method bodies that are not
+ * parsed yet or statements that are not syntax tree nodes, since their effects are unknown.
+ * Fused nodes are not seen through, so inference runs before FuseStatements
+ */
+void InferTypes(std::unique_ptr<Statement> &program);
+
+} // namespace ast
@@ -0,0 +1,252 @@
+#include "inline.h"
+
+#include "fuse.h"
+
+#include <typeinfo>
+#include <unordered_map>
+
+using namespace std;
+
+namespace ast
+{
+
+using runtime::Class;
+using runtime::ClassInstance;
+using runtime::Closure;
+using runtime::Context;
+using runtime::Method;
+using runtime::ObjectHolder;
+
+namespace
+{
+
+const string SELF = "self"s;
+const string RETURNED_VALUE = "returned_value"s;
+
+//! Body of trivial method, executed by call without closure
+struct InlineBody
+{
+    enum class Kind
+    {
+        //! return self.field
+        Getter,
+        //! self.field = argument
+        Setter,
+        //! return <constant>
+        Constant,
+    };
+
+    Kind kind;
+    string field;
+    ObjectHolder constant;
+};
+
+using InlineBodies = unordered_map<const Method *, InlineBody>;
+
+//! Returns true if statement is a field of self, "self.field"
+bool IsSelfField(const Statement &statement)
+{
+    const auto *variable = dynamic_cast<const VariableValue *>(&statement);
+    return variable && variable->GetIds().size() == 2 && variable->GetIds().front() == SELF;
+}
+
+ObjectHolder Constant(const Statement &statement)
+{
+    if (const auto *number = dynamic_cast<const NumericConst *>(&statement))
+    {
+        return ObjectHolder::Own(runtime::Number(number->GetValue()));
+    }
+    if (const auto *str = dynamic_cast<const StringConst *>(&statement))
+    {
+        return ObjectHolder::Own(runtime::String(str->GetValue()));
+    }
+    if (const auto *boolean = dynamic_cast<const BoolConst *>(&statement))
+    {
+        return ObjectHolder::Own(runtime::Bool(boolean->GetValue()));
+    }
+    return ObjectHolder::None();
+}
+
+bool IsConstant(const Statement &statement)
+{
+    return dynamic_cast<const NumericConst *>(&statement) || dynamic_cast<const StringConst *>(&statement) ||
+           dynamic_cast<const BoolConst *>(&statement) || dynamic_cast<const None *>(&statement);
+}
+
+//! Returns inlined body of method, nothing if method isn't trivial
+optional<InlineBody> TryInline(const Method &method)
+{
+    // Parameters hide self, the one named "returned_value" is the result of method
+    for (const auto &param : method.formal_params)
+    {
+        if (param == SELF || param == RETURNED_VALUE)
+        {
+            return nullopt;
+        }
+    }
+    const auto *body = dynamic_cast<const MethodBody *>(method.body.get());
+    if (!body || !body->IsParsed())
+    {
+        return nullopt;
+    }
+    const auto *compound = dynamic_cast<const Compound *>(&body->GetBody());
+    if (!compound || compound->GetStatements().size() != 1)
+    {
+        return nullopt;
+    }
+    const Statement &statement = *compound->GetStatements().front();
+    if (const auto *ret = dynamic_cast<const Return *>(&statement))
+    {
+        if (IsSelfField(ret->GetValue()))
+        {
+            return InlineBody{InlineBody::Kind::Getter,
+                              static_cast<const VariableValue &>(ret->GetValue()).GetIds().back(), {}};
+        }
+        if (IsConstant(ret->GetValue()))
+        {
+            return InlineBody{InlineBody::Kind::Constant, {}, runtime::Pin(Constant(ret->GetValue()))};
+        }
+        return nullopt;
+    }
+    if (const auto *assignment = dynamic_cast<const FieldAssignment *>(&statement))
+    {
+        const auto *value = dynamic_cast<const VariableValue *>(&assignment->GetValue());
+        if (assignment->GetObject().GetIds() == vector<string>{SELF} && method.formal_params.size() == 1 && value &&
+            value->GetIds() == method.formal_params)
+        {
+            return InlineBody{InlineBody::Kind::Setter, assignment->GetField(), {}};
+        }
+    }
+    return nullopt;
+}
+
+//! object.method() or object.method(argument)
+class InlinedCall : public Fused<MethodCall>
+{
+  public:
+    InlinedCall(unique_ptr<MethodCall> original, shared_ptr<const InlineBodies> bodies)
+        : Fused(std::move(original)), bodies_(std::move(bodies))
+    {
+        Init();
+    }
+
+    [[nodiscard]] const char *GetName() const override
+    {
+        return "InlinedCall";
+    }
+
+    static bool Matches(const MethodCall &node)
+    {
+        return node.GetArgs().size() <= 1;
+    }
+
+    ObjectHolder Execute(Closure &closure, Context &context) override
+    {
+        if (!bound_)
+        {
+            return original_->Execute(closure, context);
+        }
+        ObjectHolder argument = argument_ ? argument_->Execute(closure, context) : ObjectHolder();
+        ObjectHolder object = object_->Execute(closure, context);
+        auto *instance = object.TryAs<ClassInstance>();
+        if (!instance)
+        {
+            throw runtime_error("Method "s + original_->GetMethod() + " of object that is not a class instance"s);
+        }
+        // Class is the guard of inlined body, it's checked every call, and it's the receiver of original call
+        const Class &cls = instance->GetClass();
+        if (&cls != class_)
+        {
+            original_->ObserveReceiver(cls);
+            class_ = &cls;
+            body_ = Lookup(cls);
+        }
+        if (!body_)
+        {
+            vector<ObjectHolder> args;
+            if (argument_)
+            {
+                args.push_back(std::move(argument));
+            }
+            return instance->Call(original_->GetMethod(), args, context);
+        }
+        switch (body_->kind)
+        {
+        case InlineBody::Kind::Getter:
+            return instance->Fields()[body_->field];
+        case InlineBody::Kind::Setter:
+            instance->Fields()[body_->field] = std::move(argument);
+            return ObjectHolder::None();
+        case InlineBody::Kind::Constant:
+            return body_->constant;
+        }
+        return ObjectHolder::None();
+    }
+
+  private:
+    bool Bind() override
+    {
+        if (!Matches(*original_))
+        {
+            return false;
+        }
+        // Statements are executed by the original node as well, accessors are const only
+        object_ = const_cast<Statement *>(&original_->GetObject()); // NOLINT
+        argument_ = original_->GetArgs().empty() ? nullptr : original_->GetArgs().front().get();
+        return true;
+    }
+
+    //! Returns inlined body of method called for object of class, nullptr if it's called
+    const InlineBody *Lookup(const Class &cls) const
+    {
+        const Method *method = cls.GetMethod(original_->GetMethod());
+        if (!method || method->formal_params.size() != original_->GetArgs().size())
+        {
+            return nullptr;
+        }
+        auto it = bodies_->find(method);
+        return it != bodies_->end() ? &it->second : nullptr;
+    }
+
+    shared_ptr<const InlineBodies> bodies_;
+    Statement *object_ = nullptr;
+    Statement *argument_ = nullptr;
+    const Class *class_ = nullptr;
+    const InlineBody *body_ = nullptr;
+};
+
+void Inline(unique_ptr<Statement> &statement, const shared_ptr<InlineBodies> &bodies) // NOLINT
+{
+    auto *node = dynamic_cast<Node *>(statement.get());
+    if (!node)
+    {
+        return;
+    }
+    if (const auto *definition = dynamic_cast<const ClassDefinition *>(node))
+    {
+        for (const auto &method : definition->GetClass().TryAs<Class>()->GetMethods())
+        {
+            if (auto body = TryInline(method))
+            {
+                bodies->emplace(&method, std::move(*body));
+            }
+        }
+    }
+    node->RewriteChildren([&bodies](unique_ptr<Statement> &child) { Inline(child, bodies); });
+
+    auto *call = dynamic_cast<MethodCall *>(node);
+    if (call && typeid(*call) == typeid(MethodCall) && InlinedCall::Matches(*call))
+    {
+        statement.release();
+        statement = make_unique<InlinedCall>(unique_ptr<MethodCall>(call), bodies);
+    }
+}
+
+} // namespace
+
+void InlineMethods(unique_ptr<Statement> &statement)
+{
+    Inline(statement, make_shared<InlineBodies>());
+}
+
+} // namespace ast
@@ -0,0 +1,21 @@
+/*!
+ * \file inline.h
+ * \brief Method inlining: calls of trivial methods are executed without calling them
+ */
+#pragma once
+
+#include "statement.h"
+
+namespace ast
+{
+
+/*!
+ * Replaces method calls with at most one argument in statement and its children, including methods of
+ * classes it defines. Replaced call remembers class of the last object it was called for, and if method of
+ * that class is a getter "return self.field", a setter "self.field = argument" or returns constant, executes
+ * its body in place, without closure of the call. Call for object of other class looks up method again.
+ * Only methods of classes defined by statement are inlined, methods that are not parsed yet are called
+ */
+void InlineMethods(std::unique_ptr<Statement> &statement);
+
+} // namespace ast
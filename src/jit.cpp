@@ -0,0 +1,314 @@
+#include "jit.h"
+
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+#if defined(MYTHON_JIT) && defined(__x86_64__) && defined(__linux__)
+#define MYTHON_JIT_ENABLED 1
+#include <sys/mman.h>
+#else
+#define MYTHON_JIT_ENABLED 0
+#endif
+
+using namespace std;
+
+namespace jit
+{
+
+namespace
+{
+
+constexpr size_t UNBOUND = numeric_limits<size_t>::max();
+
+// Registers and instructions that are used, rbx keeps the argument across calls
+constexpr uint8_t PUSH_RBX = 0x53;
+constexpr uint8_t POP_RBX = 0x5B;
+constexpr uint8_t RET = 0xC3;
+constexpr uint8_t REX_W = 0x48;
+constexpr uint8_t MOV_RM = 0x89;
+constexpr uint8_t MODRM_RBX_RDI = 0xFB; // mov rbx, rdi
+constexpr uint8_t MODRM_RDI_RBX = 0xDF; // mov rdi, rbx
+constexpr uint8_t MOV_RSI_IMM = 0xBE;
+constexpr uint8_t MOV_RAX_IMM = 0xB8;
+constexpr uint8_t CALL_RM = 0xFF;
+constexpr uint8_t MODRM_CALL_RAX = 0xD0;
+constexpr uint8_t CMP_IMM8 = 0x83;
+constexpr uint8_t MODRM_CMP_EAX = 0xF8;
+constexpr uint8_t CMP_EAX_IMM32 = 0x3D;
+constexpr uint8_t JMP_REL32 = 0xE9;
+constexpr uint8_t JCC_PREFIX = 0x0F;
+constexpr uint8_t JCC_REL32 = 0x80;
+// Condition codes, they are added to opcodes of conditional instructions
+constexpr uint8_t CC_OVERFLOW = 0x0;
+constexpr uint8_t CC_EQUAL = 0x4;
+constexpr uint8_t CC_NOT_EQUAL = 0x5;
+constexpr uint8_t CC_ABOVE = 0x7;
+
+// Operations on numbers: rax keeps pointer to the top of stack and number type, rcx and rdx pointers to objects,
+// esi and edx their values, result is left in esi, so that it's the operand of the next call
+constexpr uint8_t MOV_R_RM = 0x8B;
+constexpr uint8_t MODRM_RAX_RBX_DISP32 = 0x83; // mov rax, [rbx + disp32]
+constexpr uint8_t MODRM_RCX_RAX_DISP32 = 0x88; // mov rcx, [rax + disp32]
+constexpr uint8_t MODRM_RDX_RAX_DISP32 = 0x90; // mov rdx, [rax + disp32]
+constexpr uint8_t MODRM_ESI_RCX_DISP32 = 0xB1; // mov esi, [rcx + disp32]
+constexpr uint8_t MODRM_EDX_RDX_DISP32 = 0x92; // mov edx, [rdx + disp32]
+constexpr uint8_t TEST_RM = 0x85;
+constexpr uint8_t MODRM_RCX_RCX = 0xC9;
+constexpr uint8_t MODRM_RDX_RDX = 0xD2;
+constexpr uint8_t CMP_RM_R = 0x39;
+constexpr uint8_t MODRM_AT_RCX_RAX = 0x01; // cmp [rcx], rax
+constexpr uint8_t MODRM_AT_RDX_RAX = 0x02; // cmp [rdx], rax
+constexpr uint8_t MODRM_ESI_EDX = 0xD6;    // op esi, edx
+constexpr uint8_t ADD_RM_R = 0x01;
+constexpr uint8_t SUB_RM_R = 0x29;
+constexpr uint8_t SETCC = 0x90;
+constexpr uint8_t MODRM_AL = 0xC0;
+constexpr uint8_t MOVZX_R_RM8 = 0xB6;
+constexpr uint8_t MODRM_ESI_AL = 0xF0;
+
+//! Returns displacement of value that is "count" values below the top of stack
+int32_t BelowTop(const NumberLayout &layout, size_t count)
+{
+    return -static_cast<int32_t>(layout.value_size * count);
+}
+
+} // namespace
+
+bool Supported()
+{
+    return MYTHON_JIT_ENABLED != 0;
+}
+
+unique_ptr<NativeCode> NativeCode::Create(const vector<uint8_t> &bytes)
+{
+#if MYTHON_JIT_ENABLED
+    // Memory is never writable and executable at the same time
+    void *memory = mmap(nullptr, bytes.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    memcpy(memory, bytes.data(), bytes.size());
+    if (mprotect(memory, bytes.size(), PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(memory, bytes.size());
+        return nullptr;
+    }
+    return unique_ptr<NativeCode>(new NativeCode(memory, bytes.size()));
+#else
+    static_cast<void>(bytes);
+    return nullptr;
+#endif
+}
+
+NativeCode::NativeCode(void *memory, size_t size) : memory_(memory), size_(size)
+{
+}
+
+NativeCode::~NativeCode()
+{
+#if MYTHON_JIT_ENABLED
+    munmap(memory_, size_);
+#endif
+}
+
+void NativeCode::Run(void *argument) const
+{
+    reinterpret_cast<void (*)(void *)>(memory_)(argument); // NOLINT
+}
+
+Assembler::Assembler()
+{
+    // Stack is aligned to 16 bytes before calls after return address and rbx are pushed
+    Byte(PUSH_RBX);
+    Byte(REX_W);
+    Byte(MOV_RM);
+    Byte(MODRM_RBX_RDI);
+}
+
+Assembler::Label Assembler::NewLabel()
+{
+    labels_.push_back(UNBOUND);
+    return labels_.size() - 1;
+}
+
+void Assembler::Bind(Label label)
+{
+    labels_[label] = bytes_.size();
+}
+
+void Assembler::Call(Function function, const void *operand)
+{
+    Byte(REX_W);
+    Byte(MOV_RSI_IMM);
+    Value(reinterpret_cast<uint64_t>(operand)); // NOLINT
+    CallFunction(function);
+}
+
+void Assembler::JumpIfEqual(uint32_t value, Label label)
+{
+    Compare(value);
+    JumpIf(CC_EQUAL, label);
+}
+
+void Assembler::JumpIfAbove(uint32_t value, Label label)
+{
+    Compare(value);
+    JumpIf(CC_ABOVE, label);
+}
+
+void Assembler::Jump(Label label)
+{
+    Byte(JMP_REL32);
+    Displacement(label);
+}
+
+void Assembler::Return()
+{
+    Byte(POP_RBX);
+    Byte(RET);
+}
+
+void Assembler::LoadNumbers(const NumberLayout &layout, Label not_numbers)
+{
+    Byte(REX_W);
+    Byte(MOV_R_RM);
+    Byte(MODRM_RAX_RBX_DISP32);
+    Value(static_cast<int32_t>(layout.stack_top));
+    Byte(REX_W);
+    Byte(MOV_R_RM);
+    Byte(MODRM_RCX_RAX_DISP32);
+    Value(BelowTop(layout, 2));
+    Byte(REX_W);
+    Byte(MOV_R_RM);
+    Byte(MODRM_RDX_RAX_DISP32);
+    Value(BelowTop(layout, 1));
+
+    // None is kept as null pointer
+    Byte(REX_W);
+    Byte(TEST_RM);
+    Byte(MODRM_RCX_RCX);
+    JumpIf(CC_EQUAL, not_numbers);
+    Byte(REX_W);
+    Byte(TEST_RM);
+    Byte(MODRM_RDX_RDX);
+    JumpIf(CC_EQUAL, not_numbers);
+
+    // Objects of other types, including types derived from number, have other virtual tables
+    Byte(REX_W);
+    Byte(MOV_RAX_IMM);
+    Value(reinterpret_cast<uint64_t>(layout.number_type)); // NOLINT
+    Byte(REX_W);
+    Byte(CMP_RM_R);
+    Byte(MODRM_AT_RCX_RAX);
+    JumpIf(CC_NOT_EQUAL, not_numbers);
+    Byte(REX_W);
+    Byte(CMP_RM_R);
+    Byte(MODRM_AT_RDX_RAX);
+    JumpIf(CC_NOT_EQUAL, not_numbers);
+
+    Byte(MOV_R_RM);
+    Byte(MODRM_ESI_RCX_DISP32);
+    Value(static_cast<int32_t>(layout.number_value));
+    Byte(MOV_R_RM);
+    Byte(MODRM_EDX_RDX_DISP32);
+    Value(static_cast<int32_t>(layout.number_value));
+}
+
+void Assembler::AddNumbers(Label overflow)
+{
+    Byte(ADD_RM_R);
+    Byte(MODRM_ESI_EDX);
+    JumpIf(CC_OVERFLOW, overflow);
+}
+
+void Assembler::SubtractNumbers(Label overflow)
+{
+    Byte(SUB_RM_R);
+    Byte(MODRM_ESI_EDX);
+    JumpIf(CC_OVERFLOW, overflow);
+}
+
+void Assembler::CompareNumbers(Condition condition)
+{
+    Byte(CMP_RM_R);
+    Byte(MODRM_ESI_EDX);
+    Byte(JCC_PREFIX);
+    Byte(static_cast<uint8_t>(SETCC | static_cast<uint8_t>(condition)));
+    Byte(MODRM_AL);
+    Byte(JCC_PREFIX);
+    Byte(MOVZX_R_RM8);
+    Byte(MODRM_ESI_AL);
+}
+
+void Assembler::CallWithResult(Function function)
+{
+    // Writing esi clears upper half of rsi, so operand is the result as unsigned 32-bit number
+    CallFunction(function);
+}
+
+unique_ptr<NativeCode> Assembler::Finish()
+{
+    for (const auto &[at, label] : fixups_)
+    {
+        assert(labels_.at(label) != UNBOUND && "Jump to label that is not bound");
+        const auto displacement = static_cast<int32_t>(static_cast<int64_t>(labels_.at(label)) -
+                                                       static_cast<int64_t>(at + sizeof(int32_t)));
+        memcpy(bytes_.data() + at, &displacement, sizeof(displacement));
+    }
+    return NativeCode::Create(bytes_);
+}
+
+void Assembler::Byte(uint8_t byte)
+{
+    bytes_.push_back(byte);
+}
+
+template <typename T> void Assembler::Value(T value)
+{
+    // x86-64 is little-endian, as the host is
+    uint8_t bytes[sizeof(T)];
+    memcpy(bytes, &value, sizeof(T));
+    bytes_.insert(bytes_.end(), bytes, bytes + sizeof(T));
+}
+
+void Assembler::Compare(uint32_t value)
+{
+    if (value <= numeric_limits<int8_t>::max())
+    {
+        Byte(CMP_IMM8);
+        Byte(MODRM_CMP_EAX);
+        Byte(static_cast<uint8_t>(value));
+        return;
+    }
+    Byte(CMP_EAX_IMM32);
+    Value(value);
+}
+
+void Assembler::CallFunction(Function function)
+{
+    Byte(REX_W);
+    Byte(MOV_RM);
+    Byte(MODRM_RDI_RBX);
+    Byte(REX_W);
+    Byte(MOV_RAX_IMM);
+    Value(reinterpret_cast<uint64_t>(function)); // NOLINT
+    Byte(CALL_RM);
+    Byte(MODRM_CALL_RAX);
+}
+
+void Assembler::JumpIf(uint8_t condition, Label label)
+{
+    Byte(JCC_PREFIX);
+    Byte(static_cast<uint8_t>(JCC_REL32 | condition));
+    Displacement(label);
+}
+
+void Assembler::Displacement(Label label)
+{
+    fixups_.emplace_back(bytes_.size(), label);
+    Value(int32_t{0});
+}
+
+} // namespace jit
@@ -0,0 +1,127 @@
+/*!
+ * \file jit.h
+ * \brief Generation of x86-64 machine code: code calls functions one after another and jumps by their results,
+ *        operations on numbers are done by the code itself
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace jit
+{
+
+//! Returns true if machine code can be executed, i.e. it's x86-64 Linux and JIT is not disabled by build
+bool Supported();
+
+//! Machine code in executable memory
+class NativeCode
+{
+  public:
+    //! Returns nullptr if machine code can't be executed or memory can't be allocated
+    static std::unique_ptr<NativeCode> Create(const std::vector<uint8_t> &bytes);
+
+    NativeCode(const NativeCode &) = delete;
+    NativeCode &operator=(const NativeCode &) = delete;
+    ~NativeCode();
+
+    //! Executes code, argument is passed to every function it calls
+    void Run(void *argument) const;
+
+  private:
+    NativeCode(void *memory, size_t size);
+
+    void *memory_;
+    size_t size_;
+};
+
+/*!
+ * Describes where code finds numbers: the argument keeps pointer to the top of a stack of values, each value starts
+ * with pointer to its object, and number is an object with the given type whose value is an int
+ */
+struct NumberLayout
+{
+    //! Offset of pointer to the top of stack in the argument
+    size_t stack_top;
+    //! Size of value on stack
+    size_t value_size;
+    //! Pointer to virtual table, which every number object starts with
+    const void *number_type;
+    //! Offset of int value in number object
+    size_t number_value;
+};
+
+/*!
+ * Emits machine code of function taking single pointer argument. Functions called by code take that argument
+ * and an operand, and return uint32_t that is compared to decide where to go next. Called functions must
+ * not throw, since machine code has no unwind information
+ */
+class Assembler
+{
+  public:
+    using Label = size_t;
+    using Function = uint32_t (*)(void *argument, const void *operand);
+
+    //! Comparison of numbers, values are condition codes of x86
+    enum class Condition : uint8_t
+    {
+        Equal = 0x4,
+        NotEqual = 0x5,
+        Less = 0xC,
+        GreaterOrEqual = 0xD,
+        LessOrEqual = 0xE,
+        Greater = 0xF,
+    };
+
+    //! Emits prologue that keeps the argument in callee-saved register
+    Assembler();
+
+    Label NewLabel();
+    //! Binds label to the current position
+    void Bind(Label label);
+
+    //! Calls function(argument, operand)
+    void Call(Function function, const void *operand);
+    //! Jumps to label if result of the last call is equal to value
+    void JumpIfEqual(uint32_t value, Label label);
+    //! Jumps to label if result of the last call is above value
+    void JumpIfAbove(uint32_t value, Label label);
+    void Jump(Label label);
+    //! Returns from the code
+    void Return();
+
+    //! Reads numbers of two values on top of stack, the lower one is left operand. Jumps to label if any of
+    //! the values is not a number
+    void LoadNumbers(const NumberLayout &layout, Label not_numbers);
+    //! Adds right operand to left one, jumps to label on overflow
+    void AddNumbers(Label overflow);
+    //! Subtracts right operand from left one, jumps to label on overflow
+    void SubtractNumbers(Label overflow);
+    //! Compares operands, result is 1 if condition holds and 0 otherwise
+    void CompareNumbers(Condition condition);
+    //! Calls function(argument, result), where result of the last operation on numbers is passed as operand
+    void CallWithResult(Function function);
+
+    //! Returns nullptr if code can't be executed. Every label that is used must be bound
+    std::unique_ptr<NativeCode> Finish();
+
+  private:
+    void Byte(uint8_t byte);
+    template <typename T> void Value(T value);
+    void Compare(uint32_t value);
+    //! Calls function with the argument, operand must be set already
+    void CallFunction(Function function);
+    void JumpIf(uint8_t condition, Label label);
+    //! Emits 32-bit displacement to label, it's patched when code is finished
+    void Displacement(Label label);
+
+    std::vector<uint8_t> bytes_;
+    //! Positions of labels, SIZE_MAX for labels that are not bound yet
+    std::vector<size_t> labels_;
+    //! Positions of displacements and their labels
+    std::vector<std::pair<size_t, Label>> fixups_;
+};
+
+} // namespace jit
@@ -1,20 +1,155 @@
 #include "lexer.h"
 
+#include "scan.h"
+
 #include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
 #include <limits>
+#include <string_view>
 
 using namespace std;
 
 namespace parse
 {
 
-constexpr auto max_size = std::numeric_limits<std::streamsize>::max();
+namespace
+{
+
+//! Character classes, a single char may belong to several of them
+enum CharClass : uint8_t
+{
+    DIGIT = 1U << 0U,
+    ID_START = 1U << 1U,
+    SPECIAL = 1U << 2U,
+    COMPARISON = 1U << 3U,
+};
+
+constexpr array<uint8_t, 256> MakeCharClasses()
+{
+    array<uint8_t, 256> result{};
+    for (int ch = '0'; ch <= '9'; ++ch)
+    {
+        result[ch] |= DIGIT;
+    }
+    for (int ch = 'a'; ch <= 'z'; ++ch)
+    {
+        result[ch] |= ID_START;
+        result[ch - 'a' + 'A'] |= ID_START;
+    }
+    result['_'] |= ID_START;
+    for (unsigned char ch : "=!<>"sv)
+    {
+        result[ch] |= COMPARISON;
+    }
+    for (unsigned char ch : ".,:+-*/()=<>"sv)
+    {
+        result[ch] |= SPECIAL;
+    }
+    return result;
+}
+
+constexpr array<uint8_t, 256> char_classes = MakeCharClasses();
+
+//! Checks whether symbol obtained from stream (might be EOF) belongs to given classes
+constexpr bool HasClass(int ch, uint8_t classes)
+{
+    return ch != EOF && (char_classes[static_cast<unsigned char>(ch)] & classes) != 0;
+}
+
+//! Predefined language keywords
+struct Keyword
+{
+    string_view word;
+    Token token;
+};
+
+constexpr array<Keyword, 12> keywords = {{
+    {"class"sv, token_type::Class{}},
+    {"return"sv, token_type::Return{}},
+    {"if"sv, token_type::If{}},
+    {"else"sv, token_type::Else{}},
+    {"def"sv, token_type::Def{}},
+    {"print"sv, token_type::Print{}},
+    {"and"sv, token_type::And{}},
+    {"or"sv, token_type::Or{}},
+    {"not"sv, token_type::Not{}},
+    {"None"sv, token_type::None{}},
+    {"True"sv, token_type::True{}},
+    {"False"sv, token_type::False{}},
+}};
+
+constexpr size_t keyword_slots = 16;
+
+//! Perfect hash for the keywords above, collisions are rejected at compile time
+constexpr size_t KeywordHash(string_view word)
+{
+    return (2 * word.size() + 3 * static_cast<unsigned char>(word.front()) + static_cast<unsigned char>(word.back())) %
+           keyword_slots;
+}
+
+constexpr array<int8_t, keyword_slots> MakeKeywordSlots()
+{
+    array<int8_t, keyword_slots> result{};
+    for (auto &slot : result)
+    {
+        slot = -1;
+    }
+    for (size_t i = 0; i < keywords.size(); ++i)
+    {
+        auto &slot = result[KeywordHash(keywords[i].word)];
+        slot = slot == -1 ? static_cast<int8_t>(i) : -2;
+    }
+    return result;
+}
+
+constexpr array<int8_t, keyword_slots> keyword_slot_to_index = MakeKeywordSlots();
+
+constexpr bool IsPerfectHash()
+{
+    size_t used{0};
+    for (auto slot : keyword_slot_to_index)
+    {
+        if (slot == -2)
+        {
+            return false;
+        }
+        used += slot >= 0;
+    }
+    return used == keywords.size();
+}
+
+static_assert(IsPerfectHash(), "Keyword hash has collisions, adjust KeywordHash coefficients");
+
+//! Returns keyword description or nullptr if word is not a keyword
+const Keyword *FindKeyword(string_view word)
+{
+    const int8_t index = keyword_slot_to_index[KeywordHash(word)];
+    if (index >= 0 && keywords[index].word == word)
+    {
+        return &keywords[index];
+    }
+    return nullptr;
+}
+
+//! Returns text of name or string literal, checks that its length fits into token
+string_view TokenText(string_view text)
+{
+    if (text.size() > numeric_limits<uint32_t>::max())
+    {
+        throw LexerError("Token is too long"s);
+    }
+    return text;
+}
+
+} // namespace
 
 bool operator==(const Token &lhs, const Token &rhs)
 {
     using namespace token_type;
 
-    if (lhs.index() != rhs.index())
+    if (lhs.Kind() != rhs.Kind())
     {
         return false;
     }
@@ -87,11 +222,32 @@ std::ostream &operator<<(std::ostream &os, const Token &rhs)
     return os << "Unknown token :("sv;
 }
 
-Lexer::Lexer(std::istream &input) : input_(input)
+std::string_view SourceBuffer::Append(std::string_view text)
+{
+    if (block_capacity_ - block_used_ < text.size())
+    {
+        block_capacity_ = std::max(block_size, text.size());
+        blocks_.emplace_back(new char[block_capacity_]);
+        block_used_ = 0;
+    }
+    char *dest = blocks_.back().get() + block_used_;
+    std::copy(text.begin(), text.end(), dest);
+    block_used_ += text.size();
+    return {dest, text.size()};
+}
+
+Lexer::Lexer(std::istream &input) : input_(&input)
 {
     SkipUselessSymbols();
     token_ = token_type::Newline{};
-    token_ = NextToken();
+    NextToken();
+}
+
+Lexer::Lexer(std::string_view source) : unread_(source)
+{
+    SkipUselessSymbols();
+    token_ = token_type::Newline{};
+    NextToken();
 }
 
 //! Returns current token
@@ -100,13 +256,63 @@ const Token &Lexer::CurrentToken() const
     return token_;
 }
 
-//! Generates token after reading from input stream, this is core function of lexer
-Token Lexer::NextToken()
+//! Makes next source line current one, returns false if there are no more lines
+bool Lexer::ReadLine()
+{
+    if (input_)
+    {
+        if (!std::getline(*input_, scratch_))
+        {
+            return false;
+        }
+        if (!input_->eof())
+        {
+            scratch_ += '\n';
+        }
+        line_ = source_.Append(scratch_);
+    }
+    else
+    {
+        if (unread_.empty())
+        {
+            return false;
+        }
+        const size_t end = std::min(scan::Find(unread_, 0, '\n'), unread_.size() - 1);
+        line_ = unread_.substr(0, end + 1);
+        unread_.remove_prefix(end + 1);
+    }
+    pos_ = 0;
+    return true;
+}
+
+//! Returns next symbol without extracting it or EOF
+int Lexer::Peek()
+{
+    if (pos_ == line_.size() && !ReadLine())
+    {
+        return EOF;
+    }
+    return static_cast<unsigned char>(line_[pos_]);
+}
+
+//! Extracts next symbol, returns EOF if source is over
+int Lexer::Get()
+{
+    const int ch = Peek();
+    if (ch != EOF)
+    {
+        ++pos_;
+    }
+    return ch;
+}
+
+//! Generates token after reading from source, this is core function of lexer
+const Token &Lexer::NextToken()
 {
 
     if (token_ == token_type::Eof{})
     {
-        return token_type::Eof{};
+        return token_;
     }
 
     else if (token_ == token_type::Newline{})
@@ -120,11 +326,18 @@ Token Lexer::NextToken()
     }
 
     // Here comes block with the same indentation, spaces should be ignored
-    for (; input_.peek() == ' '; input_.ignore())
+    if (Peek() == ' ')
     {
+        pos_ = scan::SkipSpaces(line_, pos_);
     }
 
-    int ch = input_.get();
+    // Comment lasts till the end of line, newline itself is still a token
+    if (Peek() == '#')
+    {
+        pos_ = line_.back() == '\n' ? line_.size() - 1 : line_.size();
+    }
+
+    const int ch = Peek();
     if (ch == EOF)
     {
         if (token_ == token_type::Indent{} || token_ == token_type::Dedent{} || token_ == token_type::Newline{})
@@ -136,62 +349,82 @@ Token Lexer::NextToken()
 
     else if (ch == '\n')
     {
+        ++pos_;
         return token_ = token_type::Newline{};
     }
 
-    else if (isdigit(ch))
+    else if (HasClass(ch, DIGIT))
     {
-        input_.putback(static_cast<char>(ch));
         return token_ = GetNumber();
     }
 
     else if (ch == '\'' || ch == '\"')
     {
-        input_.putback(static_cast<char>(ch));
         return token_ = GetStrLiteral();
     }
 
-    else if (ch == '#')
+    else if (HasClass(ch, COMPARISON) && pos_ + 1 < line_.size() && line_[pos_ + 1] == '=')
     {
-        input_.ignore(max_size, '\n');
-        SkipUselessSymbols();
-        switch (input_.peek())
-        {
-        case EOF:
-            return token_ = token_type::Eof{};
-        case '#':
-            return token_ = NextToken();
-        default:
-            return token_ = token_type::Newline{};
-        }
+        return token_ = GetCompOperator();
     }
 
-    else if (ch == '=' && input_.peek() != '=')
+    else if (HasClass(ch, ID_START))
     {
-        return token_ = token_type::Char{'='};
+        return token_ = GetName();
     }
 
-    else if (comparison_symbols.count(static_cast<char>(ch)) && input_.peek() == '=')
+    else if (HasClass(ch, SPECIAL))
     {
-        input_.putback(static_cast<char>(ch));
-        return token_ = GetCompOperator();
+        ++pos_;
+        return token_ = token_type::Char{static_cast<char>(ch)};
     }
 
-    else if (isalpha(ch) || ch == '_')
+    else
     {
-        input_.putback(static_cast<char>(ch));
-        return token_ = GetName();
+        throw LexerError("Error occurred in token generation process");
     }
+}
 
-    else if (special_symbols.count(static_cast<char>(ch)))
+std::string Lexer::SkipBlock()
+{
+    if (!token_.Is<token_type::Indent>() || indent_diff_ != 0)
     {
-        return token_ = token_type::Char{static_cast<char>(ch)};
+        throw LexerError("Block is expected to be indented once"s);
     }
 
-    else
+    // Block indentation is removed from every line, comments and empty lines may be indented less
+    const size_t block_spaces = 2 * static_cast<size_t>(indent_);
+    string text;
+    int spaces{0};
+    while (true)
     {
-        throw LexerError("Error occurred in token generation process");
+        text.append(line_.substr(min(block_spaces, pos_)));
+        if (text.back() != '\n')
+        {
+            text += '\n';
+        }
+
+        pos_ = line_.size();
+        spaces = 0;
+        if (!ReadLine())
+        {
+            break;
+        }
+        pos_ = scan::SkipSpaces(line_, 0);
+        if (pos_ < line_.size() && line_[pos_] != '#' && line_[pos_] != '\n')
+        {
+            spaces = static_cast<int>(pos_);
+            if (spaces / 2 < indent_)
+            {
+                break;
+            }
+        }
     }
+
+    indent_diff_ = spaces / 2 - indent_;
+    indent_ = spaces / 2;
+    token_ = GetIndentDedent();
+    return text;
 }
 
 //! Extracts indentation changes
@@ -209,33 +442,53 @@ Token Lexer::GetIndentDedent()
 //! Extracts numeric constant
 Token Lexer::GetNumber()
 {
-    int ch = input_.get();
-    string number{};
-    for (; isdigit(ch); number += ch, ch = input_.get())
+    const size_t begin = pos_;
+    for (; pos_ < line_.size() && HasClass(line_[pos_], DIGIT); ++pos_)
     {
     }
-    input_.putback(ch);
-    return token_type::Number{stoi(number)};
+
+    int value{0};
+    auto [end, error] = from_chars(line_.data() + begin, line_.data() + pos_, value);
+    if (error != errc{})
+    {
+        throw LexerError("Incorrect numeric constant "s + string(line_.substr(begin, pos_ - begin)));
+    }
+    return token_type::Number{value};
 }
 
-//! Extracts string literal
+//! Extracts string literal. Literal without escape sequences is returned as view of the source,
+//! otherwise it's decoded into literals pool
 Token Lexer::GetStrLiteral()
 {
-    const int open_ch = input_.get();
-    string text{};
+    const char open_ch = line_[pos_++];
+
+    const size_t begin = pos_;
+    pos_ = scan::FindEither(line_, pos_, open_ch, '\\');
+    if (pos_ < line_.size() && line_[pos_] == open_ch)
+    {
+        return token_type::String{TokenText(line_.substr(begin, pos_++ - begin))};
+    }
+
+    string &text = scratch_;
+    text.assign(line_.substr(begin, pos_ - begin));
 
     while (true)
     {
-        int ch = input_.get();
+        int ch = Get();
+
+        if (ch == EOF)
+        {
+            throw LexerError("Unterminated string literal"s);
+        }
 
         if (ch != open_ch && ch != '\\')
         {
-            text += ch;
+            text += static_cast<char>(ch);
         }
 
         else if (ch == '\\')
         {
-            switch (ch = input_.get())
+            switch (ch = Get())
             {
             case 'n':
                 text += '\n';
@@ -243,8 +496,10 @@ Token Lexer::GetStrLiteral()
             case 't':
                 text += '\t';
                 break;
+            case EOF:
+                throw LexerError("Unterminated string literal"s);
             default:
-                text += ch;
+                text += static_cast<char>(ch);
             }
         }
 
@@ -253,67 +508,67 @@ Token Lexer::GetStrLiteral()
             break;
         }
     }
-    return token_type::String{text};
+    return token_type::String{literals_.emplace_back(TokenText(text))};
 }
 
 //! Extracts user-defined name or one of predefined keywords
 Token Lexer::GetName()
 {
-    int ch = input_.get();
-    string word{};
-    for (; ch == '_' || isdigit(ch) || isalpha(ch); word += ch, ch = input_.get())
+    const size_t begin = pos_;
+    for (; pos_ < line_.size() && HasClass(line_[pos_], ID_START | DIGIT); ++pos_)
     {
     }
-    input_.putback(ch);
+    const string_view word = line_.substr(begin, pos_ - begin);
 
-    if (token_type::keyword_to_token.count(word))
+    if (const Keyword *keyword = FindKeyword(word))
     {
-        return token_type::keyword_to_token.at(word);
+        return keyword->token;
     }
-    return token_type::Id{word};
+    return token_type::Id{Intern(TokenText(word))};
+}
+
+//! Returns view of the first occurrence of name, adding it to the symbol table if it's not there yet
+std::string_view Lexer::Intern(std::string_view name)
+{
+    return *symbols_.insert(name).first;
 }
 
 //! Extracts comparison operators consisting from two symbols
 Token Lexer::GetCompOperator()
 {
-    string op(2, ' ');
-    input_.get(&op[0], 3);
+    const string_view op = line_.substr(pos_, 2);
+    pos_ += 2;
 
-    if (op == "<=")
+    if (op == "<="sv)
         return token_type::LessOrEq{};
 
-    else if (op == ">=")
+    else if (op == ">="sv)
         return token_type::GreaterOrEq{};
 
-    else if (op == "==")
+    else if (op == "=="sv)
         return token_type::Eq{};
 
-    else if (op == "!=")
+    else if (op == "!="sv)
         return token_type::NotEq{};
 
     throw LexerError("Expected two chars long comparison operator"s);
 }
 
-//! Skips comments, spaces, newlines etc
+//! Skips comments, spaces, empty lines etc. and computes indentation of the next meaningful line
 void Lexer::SkipUselessSymbols()
 {
     int spaces{0};
-    for (; input_.peek() == ' '; input_.ignore(), ++spaces)
+    while (Peek() != EOF)
     {
-    }
-
-    switch (input_.peek())
-    {
-    case '#': {
-        input_.ignore(max_size, '\n');
-        SkipUselessSymbols();
-        return;
-    }
-    case '\n': {
-        input_.ignore();
-        SkipUselessSymbols();
-        return;
-    }
+        const size_t line_begin = pos_;
+        pos_ = scan::SkipSpaces(line_, pos_);
+        spaces = static_cast<int>(pos_ - line_begin);
+        if (pos_ < line_.size() && line_[pos_] != '#' && line_[pos_] != '\n')
+        {
+            break;
+        }
+        pos_ = line_.size();
+        spaces = 0;
     }
 
     indent_diff_ = spaces / 2 - indent_;
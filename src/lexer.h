@@ -5,15 +5,20 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
+#include <deque>
 #include <iosfwd>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <type_traits>
 #include <unordered_set>
 #include <variant>
+#include <vector>
 
 namespace parse
 {
@@ -27,10 +32,10 @@ struct Number
     int value;
 };
 
-//! User-defined names (variables, classes, etc)
+//! User-defined names (variables, classes, etc), refers to lexer symbol table
 struct Id
 {
-    std::string value;
+    std::string_view value;
 };
 
 //! ASCII symbol
@@ -39,10 +44,10 @@ struct Char
     char value;
 };
 
-//! String literal
+//! String literal, refers to lexer string literals pool
 struct String
 {
-    std::string value;
+    std::string_view value;
 };
 
 //! %Class operator
@@ -146,43 +151,141 @@ struct False
 };
 } // namespace token_type
 
-using TokenBase =
-    std::variant<token_type::Number, token_type::Id, token_type::Char, token_type::String, token_type::Class,
-                 token_type::Return, token_type::If, token_type::Else, token_type::Def, token_type::Newline,
-                 token_type::Print, token_type::Indent, token_type::Dedent, token_type::And, token_type::Or,
-                 token_type::Not, token_type::Eq, token_type::NotEq, token_type::LessOrEq, token_type::GreaterOrEq,
-                 token_type::None, token_type::True, token_type::False, token_type::Eof>;
+//! Types of tokens, position of a type in the list is the kind of its tokens
+template <typename... Types> struct TokenTypes
+{
+    //! Returns position of type T in the list
+    template <typename T> static constexpr uint8_t KindOf()
+    {
+        static_assert((std::is_same_v<T, Types> || ...), "Type is not a token type");
+        uint8_t kind = 0;
+        bool found = false;
+        ((found = found || std::is_same_v<T, Types>, kind += found ? 0 : 1), ...);
+        return kind;
+    }
+};
+
+using AllTokenTypes =
+    TokenTypes<token_type::Number, token_type::Id, token_type::Char, token_type::String, token_type::Class,
+               token_type::Return, token_type::If, token_type::Else, token_type::Def, token_type::Newline,
+               token_type::Print, token_type::Indent, token_type::Dedent, token_type::And, token_type::Or,
+               token_type::Not, token_type::Eq, token_type::NotEq, token_type::LessOrEq, token_type::GreaterOrEq,
+               token_type::None, token_type::True, token_type::False, token_type::Eof>;
 
-struct Token : TokenBase
+/*!
+ * Token of one of token_type types. It's kept in 16 bytes: kind of token, length of text and either a number,
+ * a symbol or a pointer to text of name or string literal owned by lexer. Token of a type with value is returned
+ * by As and TryAs as a new object of that type
+ */
+class Token
 {
-    using TokenBase::TokenBase;
+  public:
+    //! Creates Number{0} token
+    constexpr Token() : Token(token_type::Number{0})
+    {
+    }
+
+    constexpr Token(token_type::Number token) : kind_(AllTokenTypes::KindOf<token_type::Number>()), value_(token.value)
+    {
+    }
+
+    constexpr Token(token_type::Char token) : kind_(AllTokenTypes::KindOf<token_type::Char>()), value_(token.value)
+    {
+    }
+
+    //! Name must be shorter than 4 GiB, lexer checks that
+    constexpr Token(token_type::Id token)
+        : kind_(AllTokenTypes::KindOf<token_type::Id>()), size_(static_cast<uint32_t>(token.value.size())),
+          value_(token.value.data())
+    {
+    }
+
+    //! Literal must be shorter than 4 GiB, lexer checks that
+    constexpr Token(token_type::String token)
+        : kind_(AllTokenTypes::KindOf<token_type::String>()), size_(static_cast<uint32_t>(token.value.size())),
+          value_(token.value.data())
+    {
+    }
+
+    //! Creates token of type without value, i.e. keyword or symbol sequence
+    template <typename T, typename = std::enable_if_t<std::is_empty_v<T>>>
+    constexpr Token(T /*token*/) : kind_(AllTokenTypes::KindOf<T>())
+    {
+    }
 
     template <typename T> [[nodiscard]] bool Is() const
     {
-        return std::holds_alternative<T>(*this);
+        return kind_ == AllTokenTypes::KindOf<T>();
+    }
+
+    //! Returns token as type T, throws std::bad_variant_access if token has another type
+    template <typename T> [[nodiscard]] T As() const
+    {
+        if (!Is<T>())
+        {
+            throw std::bad_variant_access();
+        }
+        if constexpr (std::is_same_v<T, token_type::Number>)
+        {
+            return T{value_.number};
+        }
+        else if constexpr (std::is_same_v<T, token_type::Char>)
+        {
+            return T{value_.symbol};
+        }
+        else if constexpr (std::is_same_v<T, token_type::Id> || std::is_same_v<T, token_type::String>)
+        {
+            return T{std::string_view(value_.text, size_)};
+        }
+        else
+        {
+            return T{};
+        }
     }
 
-    template <typename T> [[nodiscard]] const T &As() const
+    //! Returns token as type T if it has that type
+    template <typename T> [[nodiscard]] std::optional<T> TryAs() const
     {
-        return std::get<T>(*this);
+        if (!Is<T>())
+        {
+            return std::nullopt;
+        }
+        return As<T>();
     }
 
-    template <typename T> [[nodiscard]] const T *TryAs() const
+    //! Returns position of token type in AllTokenTypes
+    [[nodiscard]] uint8_t Kind() const
     {
-        return std::get_if<T>(this);
+        return kind_;
     }
-};
 
-namespace token_type
-{
-//! Predefined language keywords
-static const std::unordered_map<std::string, Token> keyword_to_token = {
-    {"class", Class{}}, {"return", Return{}}, {"if", If{}},   {"else", Else{}}, {"def", Def{}},   {"print", Print{}},
-    {"and", And{}},     {"or", Or{}},         {"not", Not{}}, {"None", None{}}, {"True", True{}}, {"False", False{}}};
-} // namespace token_type
+  private:
+    union Value {
+        int number;
+        char symbol;
+        const char *text;
 
-static const std::unordered_set<char> comparison_symbols = {'=', '!', '<', '>'};
-static const std::unordered_set<char> special_symbols = {'.', ',', ':', '+', '-', '*', '/', '(', ')', '=', '<', '>'};
+        constexpr Value() : number(0)
+        {
+        }
+        constexpr Value(int number) : number(number)
+        {
+        }
+        constexpr Value(char symbol) : symbol(symbol)
+        {
+        }
+        constexpr Value(const char *text) : text(text)
+        {
+        }
+    };
+
+    uint8_t kind_;
+    uint32_t size_{0};
+    Value value_;
+};
+
+static_assert(std::is_trivially_copyable_v<Token>, "Tokens are passed around by value and must stay cheap to copy");
+static_assert(sizeof(Token) <= 16, "Token must fit in two machine words");
 
 bool operator==(const Token &lhs, const Token &rhs);
 bool operator!=(const Token &lhs, const Token &rhs);
@@ -195,19 +298,48 @@ class LexerError : public std::runtime_error
     using std::runtime_error::runtime_error;
 };
 
+/*!
+ * Keeps source text that was read from input stream. Appended text is never moved,
+ * so views returned by Append stay valid for the whole buffer lifetime
+ */
+class SourceBuffer
+{
+  public:
+    //! Stores copy of given text and returns view of that copy
+    std::string_view Append(std::string_view text);
+
+  private:
+    static constexpr size_t block_size = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    size_t block_used_{0};
+    size_t block_capacity_{0};
+};
+
+/*!
+ * Splits source text into tokens. Lexer reads its input line by line and retains it, names and string literals
+ * inside of tokens are views of that text (escaped literals are decoded into pool owned by the lexer),
+ * so they stay valid for the whole lexer lifetime
+ */
 class Lexer
 {
   public:
+    //! Reads source from stream, line by line
     explicit Lexer(std::istream &input);
+    //! Uses source text as it is, without copying. Text must outlive lexer and its tokens
+    explicit Lexer(std::string_view source);
+
+    Lexer(const Lexer &) = delete;
+    Lexer &operator=(const Lexer &) = delete;
 
     //! Returns current token or token_type::Eof if token stream is over
     [[nodiscard]] const Token &CurrentToken() const;
 
     //! Returns next token or token_type::Eof if token stream is over
-    Token NextToken();
+    const Token &NextToken();
 
     //! Returns current token as type T if it's really that type; otherwise throws LexerError
-    template <typename T> const T &Expect() const
+    template <typename T> T Expect() const
     {
         using namespace std::literals;
         if (token_.Is<T>())
@@ -231,7 +363,7 @@ class Lexer
     }
 
     //! Returns next token as type T if it's really that type; otherwise throws LexerError
-    template <typename T> const T &ExpectNext()
+    template <typename T> T ExpectNext()
     {
         NextToken();
         return Expect<T>();
@@ -250,11 +382,41 @@ class Lexer
         throw LexerError("Incorrect value"s);
     }
 
+    /*!
+     * Skips block that starts at current Indent token without splitting it into tokens and returns its text,
+     * with block indentation removed, so that text can be lexed on its own.
+     * Afterwards current token is Dedent that closes the block, just like block was read token by token
+     */
+    std::string SkipBlock();
+
   private:
     int indent_{0};
     int indent_diff_{0};
     Token token_;
-    std::istream &input_;
+
+    //! Input stream, nullptr if lexer works with text given to constructor
+    std::istream *input_{nullptr};
+    //! Lines already read from input stream
+    SourceBuffer source_;
+    //! Text given to constructor that was not split into lines yet
+    std::string_view unread_;
+
+    //! Current line (including '\n' symbol if it's present) and position of the next symbol in it
+    std::string_view line_;
+    size_t pos_{0};
+
+    //! Reusable buffer for text that is being read or decoded
+    std::string scratch_;
+    //! Interned names, each distinct name is stored only once
+    std::unordered_set<std::string_view> symbols_;
+    //! String literals with escape sequences, decoded
+    std::deque<std::string> literals_;
+
+    bool ReadLine();
+    int Peek();
+    int Get();
+
+    std::string_view Intern(std::string_view name);
 
     Token GetName();
     Token GetCompOperator();
@@ -1,19 +1,523 @@
+#include "cache.h"
+#include "closures.h"
+#include "cycles.h"
+#include "dce.h"
+#include "escape.h"
+#include "fuse.h"
+#include "infer.h"
+#include "inline.h"
 #include "lexer.h"
+#include "memo.h"
 #include "parse.h"
+#include "passes.h"
+#include "profile.h"
+#include "repl.h"
 #include "runtime.h"
 #include "statement.h"
+#include "transpile.h"
+#include "vm.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
 #include <iostream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
 
-int main()
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace
+{
+
+constexpr std::string_view parse_threads_option = "--parse-threads=";
+constexpr std::string_view cache_option = "--cache=";
+constexpr std::string_view lazy_option = "--lazy-methods";
+constexpr std::string_view stream_option = "--stream";
+constexpr std::string_view repl_option = "--repl";
+constexpr std::string_view vm_option = "--vm";
+constexpr std::string_view closures_option = "--closures";
+constexpr std::string_view tier_threshold_option = "--tier-threshold=";
+constexpr std::string_view tier_stats_option = "--tier-stats";
+constexpr std::string_view profile_option = "--profile=";
+constexpr std::string_view jit_threshold_option = "--jit-threshold=";
+constexpr std::string_view no_jit_option = "--no-jit";
+constexpr std::string_view no_fuse_option = "--no-fuse";
+constexpr std::string_view no_infer_option = "--no-infer";
+constexpr std::string_view no_inline_option = "--no-inline";
+constexpr std::string_view no_memoize_option = "--no-memoize";
+constexpr std::string_view memo_size_option = "--memo-size=";
+constexpr std::string_view memo_stats_option = "--memo-stats";
+constexpr std::string_view gc_thresholds_option = "--gc-thresholds=";
+constexpr std::string_view gc_stats_option = "--gc-stats";
+constexpr std::string_view transpile_option = "--transpile";
+constexpr std::string_view level_option = "-O";
+constexpr std::string_view disable_pass_option = "--disable-pass=";
+constexpr std::string_view dump_ast_option = "--dump-ast";
+constexpr std::string_view time_passes_option = "--time-passes";
+
+struct Options
+{
+    //! Option gives number of threads, so parallel parsing is enabled by the option only
+    bool parse_parallel = false;
+    size_t parse_threads = 0;
+    std::string cache_path;
+    MethodParsing methods = MethodParsing::Eager;
+    bool stream = false;
+    bool repl = false;
+    bool vm = false;
+    bool closures = false;
+    std::optional<size_t> tier_threshold;
+    bool tier_stats = false;
+    std::string profile_path;
+    bool jit = true;
+    std::optional<size_t> jit_threshold;
+    //! Level that isn't given is the default one, REPL doesn't rewrite statements at any level
+    std::optional<passes::Level> level;
+    std::vector<std::string> disabled_passes;
+    std::optional<size_t> memo_size;
+    bool memo_stats = false;
+    bool dump_ast = false;
+    bool time_passes = false;
+    runtime::CollectorOptions collector;
+    bool gc_stats = false;
+    bool transpile = false;
+};
+
+//! Parses the whole argument as a number, returns nothing if it isn't one
+std::optional<size_t> ParseNumber(std::string_view arg)
+{
+    size_t value = 0;
+    const auto [end, error] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+    if (error != std::errc() || end != arg.data() + arg.size())
+    {
+        return std::nullopt;
+    }
+    return value;
+}
+
+//! Parses from one to THRESHOLDS thresholds separated by commas, thresholds that are not given keep their defaults
+bool ParseThresholds(std::string_view arg, std::array<size_t, runtime::GENERATIONS> &thresholds)
+{
+    for (size_t generation = 0; generation < runtime::THRESHOLDS; ++generation)
+    {
+        const size_t end = std::min(arg.find(','), arg.size());
+        const auto threshold = ParseNumber(arg.substr(0, end));
+        if (!threshold)
+        {
+            return false;
+        }
+        thresholds[generation] = *threshold;
+        if (end == arg.size())
+        {
+            return true;
+        }
+        arg.remove_prefix(end + 1);
+    }
+    return false;
+}
+
+//! Returns thresholds the collector takes as they are written in usage, i.e. "N[,N[,N]]"
+std::string ThresholdsUsage()
+{
+    std::string usage = "N";
+    for (size_t generation = 1; generation < runtime::THRESHOLDS; ++generation)
+    {
+        usage += "[,N";
+    }
+    return usage + std::string(runtime::THRESHOLDS - 1, ']');
+}
+
+std::optional<Options> ParseOptions(int argc, char *argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (arg.substr(0, parse_threads_option.size()) == parse_threads_option)
+        {
+            const auto threads = ParseNumber(arg.substr(parse_threads_option.size()));
+            if (!threads || *threads == 0)
+            {
+                return std::nullopt;
+            }
+            options.parse_parallel = true;
+            options.parse_threads = *threads;
+        }
+        else if (arg.substr(0, cache_option.size()) == cache_option)
+        {
+            options.cache_path = arg.substr(cache_option.size());
+        }
+        else if (arg == lazy_option)
+        {
+            options.methods = MethodParsing::Lazy;
+        }
+        else if (arg == stream_option)
+        {
+            options.stream = true;
+        }
+        else if (arg == repl_option)
+        {
+            options.repl = true;
+        }
+        else if (arg == vm_option)
+        {
+            options.vm = true;
+        }
+        else if (arg == closures_option)
+        {
+            options.closures = true;
+        }
+        else if (arg.substr(0, tier_threshold_option.size()) == tier_threshold_option)
+        {
+            options.tier_threshold = ParseNumber(arg.substr(tier_threshold_option.size()));
+            if (!options.tier_threshold)
+            {
+                return std::nullopt;
+            }
+        }
+        else if (arg == tier_stats_option)
+        {
+            options.tier_stats = true;
+        }
+        else if (arg.substr(0, profile_option.size()) == profile_option)
+        {
+            options.profile_path = arg.substr(profile_option.size());
+        }
+        else if (arg.substr(0, jit_threshold_option.size()) == jit_threshold_option)
+        {
+            options.jit_threshold = ParseNumber(arg.substr(jit_threshold_option.size()));
+            if (!options.jit_threshold)
+            {
+                return std::nullopt;
+            }
+        }
+        else if (arg == no_jit_option)
+        {
+            options.jit = false;
+        }
+        else if (arg == no_fuse_option)
+        {
+            options.disabled_passes.emplace_back("fuse");
+        }
+        else if (arg == no_infer_option)
+        {
+            options.disabled_passes.emplace_back("infer");
+        }
+        else if (arg == no_inline_option)
+        {
+            options.disabled_passes.emplace_back("inline");
+        }
+        else if (arg == no_memoize_option)
+        {
+            options.disabled_passes.emplace_back("memoize");
+        }
+        else if (arg.substr(0, memo_size_option.size()) == memo_size_option)
+        {
+            options.memo_size = ParseNumber(arg.substr(memo_size_option.size()));
+            if (!options.memo_size)
+            {
+                return std::nullopt;
+            }
+        }
+        else if (arg == memo_stats_option)
+        {
+            options.memo_stats = true;
+        }
+        else if (arg.substr(0, level_option.size()) == level_option)
+        {
+            const auto level = passes::ParseLevel(arg.substr(level_option.size()));
+            if (!level)
+            {
+                return std::nullopt;
+            }
+            options.level = *level;
+        }
+        else if (arg.substr(0, disable_pass_option.size()) == disable_pass_option)
+        {
+            options.disabled_passes.emplace_back(arg.substr(disable_pass_option.size()));
+        }
+        else if (arg == dump_ast_option)
+        {
+            options.dump_ast = true;
+        }
+        else if (arg == time_passes_option)
+        {
+            options.time_passes = true;
+        }
+        else if (arg.substr(0, gc_thresholds_option.size()) == gc_thresholds_option)
+        {
+            if (!ParseThresholds(arg.substr(gc_thresholds_option.size()), options.collector.thresholds))
+            {
+                return std::nullopt;
+            }
+        }
+        else if (arg == gc_stats_option)
+        {
+            options.gc_stats = true;
+        }
+        else if (arg == transpile_option)
+        {
+            options.transpile = true;
+        }
+        else
+        {
+            return std::nullopt;
+        }
+    }
+    // Both parallel parsing and cache need the whole source, bytecode and closures are compiled for the whole
+    // program
+    if ((options.stream || options.repl) &&
+        (options.parse_parallel || !options.cache_path.empty() || options.vm || options.closures))
+    {
+        return std::nullopt;
+    }
+    // Statements of stream are rewritten one by one as they are read
+    if ((options.stream || options.repl) && (options.dump_ast || options.time_passes || options.memo_size ||
+                                             options.memo_stats))
+    {
+        return std::nullopt;
+    }
+    // Entered blocks are executed as they are parsed, methods included
+    if (options.repl && (options.level || !options.disabled_passes.empty() || options.methods == MethodParsing::Lazy))
+    {
+        return std::nullopt;
+    }
+    if (options.vm && options.closures)
+    {
+        return std::nullopt;
+    }
+    // Program is translated rather than executed
+    if (options.transpile && (options.stream || options.repl || options.vm || options.closures))
+    {
+        return std::nullopt;
+    }
+    // Methods are tiered up from syntax tree to closures, which count their calls for profile
+    if ((options.tier_threshold || options.tier_stats || !options.profile_path.empty()) && !options.closures)
+    {
+        return std::nullopt;
+    }
+    // Machine code is compiled from bytecode
+    if ((!options.jit || options.jit_threshold) && !options.vm)
+    {
+        return std::nullopt;
+    }
+    return options;
+}
+
+//! Executes each top-level statement as soon as it's read, output is flushed after every statement
+void RunStream(const Options &options)
 {
     parse::Lexer lexer(std::cin);
+    StatementStream statements(lexer, options.methods);
+    runtime::SimpleContext context{std::cout};
+    runtime::Closure closure;
+    // Constants are shared with closure rather than copied, so executed statements are kept
+    std::vector<std::unique_ptr<runtime::Executable>> executed;
+    passes::PassManager pass_manager(options.level.value_or(passes::Level::O2));
+    pass_manager.Add("dce", passes::Level::O1, ast::EliminateDeadCode);
+    pass_manager.Add("escape", passes::Level::O1, ast::KeepTemporariesLocal);
+    pass_manager.Add("fuse", passes::Level::O1, ast::FuseStatements);
+    for (const auto &name : options.disabled_passes)
+    {
+        pass_manager.Disable(name);
+    }
+    while (auto statement = statements.Next())
+    {
+        pass_manager.Run(statement);
+        statement->Execute(closure, context);
+        std::cout.flush();
+        executed.push_back(std::move(statement));
+        // Top-level return ends the program, as it does for the program parsed at once
+        if (closure.count("returned_value"))
+        {
+            break;
+        }
+    }
+}
+
+void Run(const Options &options)
+{
+    // Whole program is parsed before execution anyway, so it's read at once and lexed in place
+    const std::string source{std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>()};
+    // Statistics are collected while compiled program runs
+    closures::Stats stats;
+    memo::Stats memo_stats;
     runtime::SimpleContext context{std::cout};
     runtime::Closure closure;
-    auto program = ParseProgram(lexer);
+    std::unique_ptr<runtime::Executable> program;
+    if (!options.cache_path.empty())
+    {
+        program = cache::LoadProgram(options.cache_path, source);
+    }
+    if (!program)
+    {
+        if (options.parse_parallel)
+        {
+            program = ParseProgramParallel(source, options.parse_threads);
+        }
+        else
+        {
+            parse::Lexer lexer(source);
+            program = ParseProgram(lexer, options.methods);
+        }
+        if (!options.cache_path.empty())
+        {
+            try
+            {
+                cache::StoreProgram(options.cache_path, *program, source);
+            }
+            catch (const std::exception &e)
+            {
+                // Program runs without cache anyway, i.e. when lazily parsed method has syntax error
+                std::cerr << e.what() << std::endl;
+            }
+        }
+    }
+    passes::PassManager pass_manager(options.level.value_or(passes::Level::O2));
+    for (const auto &name : options.disabled_passes)
+    {
+        pass_manager.Disable(name);
+    }
+    pass_manager.SetDump(options.dump_ast ? &std::cerr : nullptr);
+    // Dead code would widen inferred types and is kept by compilers and profile otherwise
+    pass_manager.Add("dce", passes::Level::O1, ast::EliminateDeadCode);
+    pass_manager.Add("tree-shake", passes::Level::O2, ast::RemoveUnusedClasses);
+    // Types are inferred for the whole program only, fused nodes hide operations from inference
+    pass_manager.Add("infer", passes::Level::O1, ast::InferTypes);
+    // Profile specializes what inference didn't prove, and it refers to the original nodes. It runs at every
+    // level, as profile of methods it hasn't found would be lost
+    std::optional<profile::Profile> profile;
+    std::unordered_set<const runtime::Method *> hot_methods;
+    if (!options.profile_path.empty())
+    {
+        profile.emplace(options.profile_path);
+        pass_manager.Add("profile", passes::Level::O0, [&](std::unique_ptr<runtime::Executable> &program) {
+            hot_methods = profile->Apply(*program, options.tier_threshold.value_or(closures::TIER_UP_THRESHOLD));
+        });
+    }
+    // Translated program calls methods itself, so it's translated before inlining and fusion
+    if (!options.transpile)
+    {
+        // Memoized calls are not inlined, inlined calls are cheaper than memo table anyway
+        memo::Options memo_options;
+        memo_options.capacity = options.memo_size.value_or(memo::MEMO_CAPACITY);
+        memo_options.stats = &memo_stats;
+        pass_manager.Add("memoize", passes::Level::O2, [memo_options](std::unique_ptr<runtime::Executable> &program) {
+            memo::MemoizePureMethods(program, memo_options);
+        });
+        // Types are inferred for the original calls, so methods are inlined afterwards
+        pass_manager.Add("inline", passes::Level::O2, ast::InlineMethods);
+        // Conditions kept local replace fused comparisons of "if"
+        pass_manager.Add("escape", passes::Level::O1, ast::KeepTemporariesLocal);
+        pass_manager.Add("fuse", passes::Level::O1, ast::FuseStatements);
+    }
+    pass_manager.Run(program);
+    if (options.time_passes)
+    {
+        passes::PrintTimings(pass_manager.GetTimings(), std::cerr);
+    }
+    if (options.transpile)
+    {
+        aot::Transpile(*program, std::cout);
+        return;
+    }
+    if (options.vm)
+    {
+        // Threshold doesn't enable machine code where it's not supported
+        vm::Options vm_options;
+        if (!options.jit)
+        {
+            vm_options.jit_threshold.reset();
+        }
+        else if (options.jit_threshold && vm_options.jit_threshold)
+        {
+            vm_options.jit_threshold = options.jit_threshold;
+        }
+        program = vm::Compile(std::move(program), vm_options);
+    }
+    else if (options.closures)
+    {
+        closures::Options closures_options;
+        if (options.tier_threshold)
+        {
+            closures_options.tier_up_threshold = *options.tier_threshold;
+        }
+        if (options.tier_stats || profile)
+        {
+            closures_options.stats = &stats;
+        }
+        closures_options.hot_methods = std::move(hot_methods);
+        program = closures::Compile(std::move(program), closures_options);
+    }
     auto obj_holder = program->Execute(closure, context);
     if (obj_holder)
     {
         std::cout << std::endl;
         obj_holder->Print(std::cout, context);
     }
-}
\ No newline at end of file
+    if (options.tier_stats)
+    {
+        closures::PrintStats(stats, std::cerr);
+    }
+    if (options.memo_stats)
+    {
+        memo::PrintStats(memo_stats, std::cerr);
+    }
+    if (profile)
+    {
+        try
+        {
+            profile->Store(stats);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const auto options = ParseOptions(argc, argv);
+    if (!options)
+    {
+        std::cerr << "Usage: " << argv[0] << " [" << parse_threads_option << "N | " << cache_option << "FILE | "
+                  << stream_option << " | " << repl_option << "] [" << lazy_option << "] [" << vm_option << " ["
+                  << jit_threshold_option << "N | " << no_jit_option << "] | " << closures_option << " ["
+                  << tier_threshold_option << "N] [" << tier_stats_option << "] [" << profile_option << "FILE]] ["
+                  << no_fuse_option << "] [" << no_infer_option << "] [" << no_inline_option << "] ["
+                  << no_memoize_option << " | " << memo_size_option << "N] [" << memo_stats_option << "] ["
+                  << level_option << "0|1|2] [" << disable_pass_option << "NAME] [" << dump_ast_option << "] ["
+                  << time_passes_option << "] [" << gc_thresholds_option << ThresholdsUsage() << "] ["
+                  << gc_stats_option << "] [" << transpile_option << "] < program" << std::endl;
+        return 1;
+    }
+
+    runtime::SetCollectorOptions(options->collector);
+    if (options->repl)
+    {
+        repl::Run(std::cin, std::cout, isatty(STDIN_FILENO) != 0);
+    }
+    else if (options->stream)
+    {
+        RunStream(*options);
+    }
+    else
+    {
+        Run(*options);
+    }
+    if (options->gc_stats)
+    {
+        runtime::PrintCollectorStats(runtime::GetCollectorStats(), std::cerr);
+        // Peak memory is compared between builds with different memory management
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        std::cerr << "gc: peak RSS " << usage.ru_maxrss << " KB" << std::endl;
+    }
+}
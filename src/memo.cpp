@@ -0,0 +1,420 @@
+#include "memo.h"
+
+#include "fuse.h"
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
+
+using namespace std;
+
+namespace memo
+{
+
+using ast::Statement;
+using runtime::Class;
+using runtime::ClassInstance;
+using runtime::Closure;
+using runtime::Context;
+using runtime::Method;
+using runtime::ObjectHolder;
+
+namespace
+{
+
+const string SELF = "self"s;
+const string RETURNED_VALUE = "returned_value"s;
+
+//! Argument or result that may be kept: None, number, string or boolean
+using Value = variant<monostate, int, string, bool>;
+
+//! Returns value of object, nothing if it's of other type
+optional<Value> ValueOf(const ObjectHolder &object)
+{
+    const runtime::Object *ptr = object.Get();
+    if (!ptr)
+    {
+        return Value{};
+    }
+    if (typeid(*ptr) == typeid(runtime::Number))
+    {
+        return static_cast<const runtime::Number *>(ptr)->GetValue();
+    }
+    if (typeid(*ptr) == typeid(runtime::String))
+    {
+        return static_cast<const runtime::String *>(ptr)->GetValue();
+    }
+    if (typeid(*ptr) == typeid(runtime::Bool))
+    {
+        return static_cast<const runtime::Bool *>(ptr)->GetValue();
+    }
+    return nullopt;
+}
+
+struct Key
+{
+    const Method *method;
+    const Class *cls;
+    vector<Value> args;
+
+    bool operator==(const Key &other) const
+    {
+        return method == other.method && cls == other.cls && args == other.args;
+    }
+};
+
+struct KeyHasher
+{
+    size_t operator()(const Key &key) const
+    {
+        size_t hash = std::hash<const void *>{}(key.method) * 31 + std::hash<const void *>{}(key.cls);
+        for (const auto &arg : key.args)
+        {
+            hash = hash * 31 + std::hash<Value>{}(arg);
+        }
+        return hash;
+    }
+};
+
+//! Results of pure methods, shared by every call of program
+class Table : private runtime::Roots
+{
+  public:
+    explicit Table(const Options &options) : capacity_(options.capacity), stats_(options.stats)
+    {
+    }
+
+    //! Kept results are held by the table only
+    void Trace(runtime::Tracer &tracer) const override
+    {
+        for (const auto &[key, result] : results_)
+        {
+            tracer.Mark(result);
+        }
+    }
+
+    //! Returns kept result or nullptr
+    const ObjectHolder *Find(const Key &key)
+    {
+        auto it = results_.find(key);
+        if (it == results_.end())
+        {
+            return nullptr;
+        }
+        if (stats_)
+        {
+            ++stats_->hits;
+        }
+        return &it->second;
+    }
+
+    void Keep(Key key, ObjectHolder result)
+    {
+        if (results_.size() >= capacity_)
+        {
+            if (stats_)
+            {
+                stats_->evicted += results_.size();
+            }
+            results_.clear();
+        }
+        if (capacity_ > 0)
+        {
+            results_.emplace(std::move(key), std::move(result));
+        }
+        if (stats_)
+        {
+            ++stats_->misses;
+        }
+    }
+
+  private:
+    size_t capacity_;
+    Stats *stats_;
+    unordered_map<Key, ObjectHolder, KeyHasher> results_;
+};
+
+//! Pure methods of every class, methods inherited by class are pure for it on their own
+using PureMethods = set<pair<const Class *, const Method *>>;
+
+//! Finds what method body does, stops being pure at the first effect it finds
+class Effects : public ast::TreeVisitor
+{
+  public:
+    void VisitChild(const Statement &statement) override
+    {
+        if (!ast::Accept(statement, *this))
+        {
+            pure = false;
+        }
+    }
+
+    void Visit(const ast::VariableValue &node) override
+    {
+        // Fields depend on object, and "self" may be returned or passed on
+        pure = pure && node.GetIds().size() == 1 && node.GetIds().front() != SELF;
+    }
+
+    void Visit(const ast::Assignment &node) override
+    {
+        // Method returns "self" if it's assigned
+        pure = pure && node.GetVariable() != SELF;
+        TreeVisitor::Visit(node);
+    }
+
+    void Visit([[maybe_unused]] const ast::FieldAssignment &node) override
+    {
+        pure = false;
+    }
+
+    void Visit([[maybe_unused]] const ast::Print &node) override
+    {
+        pure = false;
+    }
+
+    void Visit(const ast::MethodCall &node) override
+    {
+        const auto *object = dynamic_cast<const ast::VariableValue *>(&node.GetObject());
+        if (!object || object->GetIds() != vector<string>{SELF})
+        {
+            pure = false;
+            return;
+        }
+        calls.emplace_back(node.GetMethod(), node.GetArgs().size());
+        for (const auto &arg : node.GetArgs())
+        {
+            VisitChild(*arg);
+        }
+    }
+
+    void Visit([[maybe_unused]] const ast::NewInstance &node) override
+    {
+        pure = false;
+    }
+
+    void Visit(const ast::MethodBody &node) override
+    {
+        pure = pure && node.IsParsed();
+        TreeVisitor::Visit(node);
+    }
+
+    void Visit([[maybe_unused]] const ast::ClassDefinition &node) override
+    {
+        pure = false;
+    }
+
+    void Visit(const ast::Comparison &node) override
+    {
+        pure = pure && node.ComparesValues();
+        TreeVisitor::Visit(node);
+    }
+
+    bool pure = true;
+    //! Methods called for "self", their names and numbers of arguments
+    vector<pair<string, size_t>> calls;
+};
+
+//! Collects classes defined anywhere in program
+class Classes : public ast::TreeVisitor
+{
+  public:
+    void Visit(const ast::ClassDefinition &node) override
+    {
+        classes.push_back(node.GetClass().TryAs<Class>());
+        TreeVisitor::Visit(node);
+    }
+
+    vector<const Class *> classes;
+};
+
+//! Returns methods that are pure for their classes and call other methods
+PureMethods FindPureMethods(const Statement &program)
+{
+    Classes finder;
+    ast::Accept(program, finder);
+
+    // Every method class has, including inherited ones, is a candidate until it's proven to have effects
+    map<pair<const Class *, const Method *>, Effects> candidates;
+    for (const Class *cls : finder.classes)
+    {
+        for (const Class *owner = cls; owner; owner = owner->GetParent())
+        {
+            for (const auto &method : owner->GetMethods())
+            {
+                if (cls->GetMethod(method.name) != &method || candidates.count({cls, &method}))
+                {
+                    continue;
+                }
+                Effects effects;
+                for (const auto &param : method.formal_params)
+                {
+                    effects.pure = effects.pure && param != SELF && param != RETURNED_VALUE;
+                }
+                effects.VisitChild(*method.body);
+                candidates.emplace(pair{cls, &method}, std::move(effects));
+            }
+        }
+    }
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        for (auto &[candidate, effects] : candidates)
+        {
+            if (!effects.pure)
+            {
+                continue;
+            }
+            const Class *cls = candidate.first;
+            for (const auto &[name, argc] : effects.calls)
+            {
+                const Method *callee = cls->GetMethod(name);
+                auto it = callee ? candidates.find({cls, callee}) : candidates.end();
+                if (it == candidates.end() || callee->formal_params.size() != argc || !it->second.pure)
+                {
+                    effects.pure = false;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    PureMethods pure;
+    for (const auto &[candidate, effects] : candidates)
+    {
+        if (effects.pure && !effects.calls.empty())
+        {
+            pure.insert(candidate);
+        }
+    }
+    return pure;
+}
+
+//! object.method(arguments)
+class MemoizedCall : public ast::Fused<ast::MethodCall>
+{
+  public:
+    MemoizedCall(unique_ptr<ast::MethodCall> original, shared_ptr<const PureMethods> pure, shared_ptr<Table> table)
+        : Fused(std::move(original)), pure_(std::move(pure)), table_(std::move(table))
+    {
+        Init();
+    }
+
+    [[nodiscard]] const char *GetName() const override
+    {
+        return "MemoizedCall";
+    }
+
+    ObjectHolder Execute(Closure &closure, Context &context) override
+    {
+        vector<ObjectHolder> args;
+        const runtime::RootedValues rooted(args);
+        args.reserve(args_->size());
+        for (const auto &arg : *args_)
+        {
+            args.push_back(arg->Execute(closure, context));
+        }
+        ObjectHolder object = object_->Execute(closure, context);
+        auto *instance = object.TryAs<ClassInstance>();
+        if (!instance)
+        {
+            throw runtime_error("Method "s + original_->GetMethod() + " of object that is not a class instance"s);
+        }
+        const Class &cls = instance->GetClass();
+        if (&cls != class_)
+        {
+            original_->ObserveReceiver(cls);
+            class_ = &cls;
+            method_ = Lookup(cls);
+        }
+        if (!method_)
+        {
+            return instance->Call(original_->GetMethod(), args, context);
+        }
+        Key key{method_, class_, {}};
+        key.args.reserve(args.size());
+        for (const auto &arg : args)
+        {
+            auto value = ValueOf(arg);
+            if (!value)
+            {
+                return instance->Call(*method_, args, context);
+            }
+            key.args.push_back(std::move(*value));
+        }
+        if (const ObjectHolder *result = table_->Find(key))
+        {
+            return *result;
+        }
+        ObjectHolder result = instance->Call(*method_, args, context);
+        if (ValueOf(result))
+        {
+            table_->Keep(std::move(key), result);
+        }
+        return result;
+    }
+
+  private:
+    bool Bind() override
+    {
+        // Statements are executed by the original node as well, accessors are const only
+        object_ = const_cast<Statement *>(&original_->GetObject()); // NOLINT
+        args_ = &original_->GetArgs();
+        return true;
+    }
+
+    //! Returns method called for object of class if it's pure for the class, nullptr otherwise
+    const Method *Lookup(const Class &cls) const
+    {
+        const Method *method = cls.GetMethod(original_->GetMethod());
+        if (!method || method->formal_params.size() != args_->size() || !pure_->count({&cls, method}))
+        {
+            return nullptr;
+        }
+        return method;
+    }
+
+    shared_ptr<const PureMethods> pure_;
+    shared_ptr<Table> table_;
+    Statement *object_ = nullptr;
+    const vector<unique_ptr<Statement>> *args_ = nullptr;
+    const Class *class_ = nullptr;
+    const Method *method_ = nullptr;
+};
+
+} // namespace
+
+void PrintStats(const Stats &stats, ostream &output)
+{
+    output << "memo: " << stats.hits << " hits, " << stats.misses << " misses, " << stats.evicted << " evicted"
+           << endl;
+}
+
+void MemoizePureMethods(unique_ptr<Statement> &program, const Options &options)
+{
+    auto pure = make_shared<const PureMethods>(FindPureMethods(*program));
+    if (pure->empty())
+    {
+        return;
+    }
+    unordered_set<string> names;
+    for (const auto &[cls, method] : *pure)
+    {
+        names.insert(method->name);
+    }
+    auto table = make_shared<Table>(options);
+    ast::RewriteTree(program, [&](unique_ptr<Statement> &statement) {
+        auto *call = dynamic_cast<ast::MethodCall *>(statement.get());
+        if (call && typeid(*call) == typeid(ast::MethodCall) && names.count(call->GetMethod()))
+        {
+            statement.release();
+            statement = make_unique<MemoizedCall>(unique_ptr<ast::MethodCall>(call), pure, table);
+        }
+    });
+}
+
+} // namespace memo
@@ -0,0 +1,51 @@
+/*!
+ * \file memo.h
+ * \brief Memoization: results of pure methods are reused for calls with the same arguments
+ */
+#pragma once
+
+#include "statement.h"
+
+#include <iosfwd>
+
+namespace memo
+{
+
+//! Results kept by default, table is emptied when it's full
+constexpr size_t MEMO_CAPACITY = size_t{1} << 16;
+
+struct Stats
+{
+    //! Calls answered by the table
+    size_t hits = 0;
+    //! Calls of pure methods that were executed and whose results were kept
+    size_t misses = 0;
+    //! Results dropped because table was full
+    size_t evicted = 0;
+};
+
+//! Writes number of hits, misses and evicted results
+void PrintStats(const Stats &stats, std::ostream &output);
+
+struct Options
+{
+    //! Maximum number of results in the table
+    size_t capacity = MEMO_CAPACITY;
+    //! Statistics are collected here if it's set, it must outlive program
+    Stats *stats = nullptr;
+};
+
+/*!
+ * Finds methods of program classes that are pure for objects of a class: they don't print, don't read or
+ * write fields, don't create objects, use "self" only to call methods that are pure as well, and call at least
+ * one of them, so that they may recompute results. Method inherited by a class is checked for that class, as
+ * methods it calls may be overridden. Method calls in program are replaced by nodes that keep results of pure
+ * methods called with numbers, strings, booleans or None in a table shared by the whole program, keyed by
+ * method, class of object and arguments, and return kept result instead of calling the method again. Results
+ * of other types are not kept. Replaced call is visited as the original one.
+ * Methods whose bodies are not parsed yet or are not syntax tree nodes are not pure, since their effects are
+ * unknown
+ */
+void MemoizePureMethods(std::unique_ptr<ast::Statement> &program, const Options &options = {});
+
+} // namespace memo
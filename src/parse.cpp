@@ -1,8 +1,16 @@
 #include "parse.h"
 
 #include "lexer.h"
+#include "scan.h"
 #include "statement.h"
 
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
 using namespace std;
 
 namespace TokenType = parse::token_type;
@@ -11,8 +19,8 @@ namespace
 {
 bool operator==(const parse::Token &token, char c)
 {
-    const auto *p = token.TryAs<TokenType::Char>();
-    return p != nullptr && p->value == c;
+    const auto p = token.TryAs<TokenType::Char>();
+    return p && p->value == c;
 }
 
 bool operator!=(const parse::Token &token, char c)
@@ -20,10 +28,67 @@ bool operator!=(const parse::Token &token, char c)
     return !(token == c);
 }
 
+//! Classes of a program part that is parsed separately from other parts.
+//! References to classes declared in preceding parts are bound after all parts are parsed
+struct ForwardClasses
+{
+    //! Returns true if class with given name is declared in preceding parts
+    function<bool(string_view)> is_declared;
+
+    //! Classes declared in this part, in order of declaration
+    vector<runtime::ObjectHolder> declared;
+    //! Instantiations and parents that refer to classes of preceding parts
+    vector<pair<ast::NewInstance *, string>> instances;
+    vector<pair<runtime::Class *, string>> parents;
+};
+
+//! Temporary class of instantiations that are bound later
+const runtime::Class &UnresolvedClass()
+{
+    static const runtime::Class unresolved{"<unresolved>"s, {}, nullptr};
+    return unresolved;
+}
+
+//! Checks whether text starts with given keyword
+bool StartsWithKeyword(string_view text, string_view keyword)
+{
+    if (text.substr(0, keyword.size()) != keyword || text.size() == keyword.size())
+    {
+        return false;
+    }
+    const char next = text[keyword.size()];
+    return next != '_' && !isalnum(static_cast<unsigned char>(next));
+}
+
+//! Checks whether block text declares a class on any of its lines, strings don't span lines
+bool DeclaresClass(string_view text)
+{
+    for (size_t begin = 0; begin < text.size();)
+    {
+        const size_t end = min(text.find('\n', begin), text.size());
+        const size_t text_begin = parse::scan::SkipSpaces(text, begin);
+        if (text_begin < end && StartsWithKeyword(text.substr(text_begin, end - text_begin + 1), "class"sv))
+        {
+            return true;
+        }
+        begin = end + 1;
+    }
+    return false;
+}
+
+//! Classes of the program with their positions in declaration order, lazily parsed method bodies refer to them
+using LazyClasses = unordered_map<string, pair<const runtime::Class *, size_t>>;
+
+//! Parses method body text, only first "visible" classes were declared when method was declared
+unique_ptr<ast::Statement> ParseLazyBody(const string &text, const LazyClasses &classes, size_t visible);
+
 class Parser
 {
   public:
-    explicit Parser(parse::Lexer &lexer) : lexer_(lexer)
+    explicit Parser(parse::Lexer &lexer, ForwardClasses *forward = nullptr,
+                    MethodParsing methods = MethodParsing::Eager)
+        : lexer_(&lexer), forward_(forward),
+          lazy_classes_(methods == MethodParsing::Lazy ? make_shared<LazyClasses>() : nullptr)
     {
     }
 
@@ -32,7 +97,7 @@ class Parser
     unique_ptr<ast::Statement> ParseProgram()
     {
         auto result = make_unique<ast::Compound>();
-        while (!lexer_.CurrentToken().Is<TokenType::Eof>())
+        while (!lexer_->CurrentToken().Is<TokenType::Eof>())
         {
             result->AddStatement(ParseStatement());
         }
@@ -40,53 +105,137 @@ class Parser
         return result;
     }
 
+    //! Same as ParseProgram, but returns statements themselves
+    vector<unique_ptr<ast::Statement>> ParseStatements()
+    {
+        vector<unique_ptr<ast::Statement>> result;
+        while (!lexer_->CurrentToken().Is<TokenType::Eof>())
+        {
+            result.push_back(ParseStatement());
+        }
+        return result;
+    }
+
+    //! Returns next statement of program or nullptr if program is over. Newline that ends simple statement
+    //! stays current, so that source after the statement is not read before the statement is executed
+    unique_ptr<ast::Statement> ParseNextStatement()
+    {
+        if (newline_pending_)
+        {
+            newline_pending_ = false;
+            lexer_->NextToken();
+        }
+
+        const auto &tok = lexer_->CurrentToken();
+        if (tok.Is<TokenType::Eof>())
+        {
+            return nullptr;
+        }
+        // Compound statements end when the next statement begins, that can't be deferred
+        if (tok.Is<TokenType::Class>() || tok.Is<TokenType::If>())
+        {
+            return ParseStatement();
+        }
+        auto result = ParseSimpleStatement();
+        lexer_->Expect<TokenType::Newline>();
+        newline_pending_ = true;
+        return result;
+    }
+
   private:
     //! Suite -> NEWLINE INDENT (Statement)+ DEDENT
     unique_ptr<ast::Statement> ParseSuite() // NOLINT
     {
-        lexer_.Expect<TokenType::Newline>();
-        lexer_.ExpectNext<TokenType::Indent>();
+        lexer_->Expect<TokenType::Newline>();
+        lexer_->ExpectNext<TokenType::Indent>();
 
-        lexer_.NextToken();
+        lexer_->NextToken();
 
         auto result = make_unique<ast::Compound>();
-        while (!lexer_.CurrentToken().Is<TokenType::Dedent>())
+        while (!lexer_->CurrentToken().Is<TokenType::Dedent>())
         {
             result->AddStatement(ParseStatement()); // NOLINT
         }
 
-        lexer_.Expect<TokenType::Dedent>();
-        lexer_.NextToken();
+        lexer_->Expect<TokenType::Dedent>();
+        lexer_->NextToken();
 
         return result;
     }
 
+    //! Same as ParseSuite, but suite is only skipped and it is parsed when method is executed first time
+    unique_ptr<ast::Statement> SkipSuite()
+    {
+        lexer_->Expect<TokenType::Newline>();
+        lexer_->ExpectNext<TokenType::Indent>();
+
+        string text = lexer_->SkipBlock();
+
+        lexer_->Expect<TokenType::Dedent>();
+        lexer_->NextToken();
+
+        // Classes declared by body are known to statements after it, as they are when body is parsed at once
+        if (DeclaresClass(text))
+        {
+            parse::Lexer body_lexer(text);
+            parse::Lexer *outer = exchange(lexer_, &body_lexer);
+            auto body = make_unique<ast::Compound>();
+            try
+            {
+                while (!lexer_->CurrentToken().Is<TokenType::Eof>())
+                {
+                    body->AddStatement(ParseStatement()); // NOLINT
+                }
+            }
+            catch (...)
+            {
+                lexer_ = outer;
+                throw;
+            }
+            lexer_ = outer;
+            return make_unique<ast::MethodBody>(std::move(body));
+        }
+
+        // Class of this method is not declared yet, it takes the next position
+        return make_unique<ast::MethodBody>(
+            [text = std::move(text), classes = lazy_classes_, visible = lazy_classes_->size()]() {
+                return ParseLazyBody(text, *classes, visible);
+            });
+    }
+
     //! Methods -> [def id(Params) : Suite]*
     vector<runtime::Method> ParseMethods() // NOLINT
     {
         vector<runtime::Method> result;
 
-        while (lexer_.CurrentToken().Is<TokenType::Def>())
+        while (lexer_->CurrentToken().Is<TokenType::Def>())
         {
             runtime::Method m;
 
-            m.name = lexer_.ExpectNext<TokenType::Id>().value;
-            lexer_.ExpectNext<TokenType::Char>('(');
+            m.name = lexer_->ExpectNext<TokenType::Id>().value;
+            lexer_->ExpectNext<TokenType::Char>('(');
 
-            if (lexer_.NextToken().Is<TokenType::Id>())
+            if (lexer_->NextToken().Is<TokenType::Id>())
             {
-                m.formal_params.push_back(lexer_.Expect<TokenType::Id>().value);
-                while (lexer_.NextToken() == ',')
+                m.formal_params.emplace_back(lexer_->Expect<TokenType::Id>().value);
+                while (lexer_->NextToken() == ',')
                 {
-                    m.formal_params.push_back(lexer_.ExpectNext<TokenType::Id>().value);
+                    m.formal_params.emplace_back(lexer_->ExpectNext<TokenType::Id>().value);
                 }
             }
 
-            lexer_.Expect<TokenType::Char>(')');
-            lexer_.ExpectNext<TokenType::Char>(':');
-            lexer_.NextToken();
+            lexer_->Expect<TokenType::Char>(')');
+            lexer_->ExpectNext<TokenType::Char>(':');
+            lexer_->NextToken();
 
-            m.body = std::make_unique<ast::MethodBody>(ParseSuite()); // NOLINT
+            if (lazy_classes_)
+            {
+                m.body = SkipSuite();
+            }
+            else
+            {
+                m.body = std::make_unique<ast::MethodBody>(ParseSuite()); // NOLINT
+            }
 
             result.push_back(std::move(m));
         }
@@ -96,33 +245,40 @@ class Parser
     //! ClassDefinition -> Id ['(' Id ')'] : new_line indent MethodList dedent
     unique_ptr<ast::Statement> ParseClassDefinition() // NOLINT
     {
-        string class_name = lexer_.Expect<TokenType::Id>().value;
+        string class_name(lexer_->Expect<TokenType::Id>().value);
 
-        lexer_.NextToken();
+        lexer_->NextToken();
 
         const runtime::Class *base_class = nullptr;
-        if (lexer_.CurrentToken() == '(')
+        string forward_base_class;
+        if (lexer_->CurrentToken() == '(')
         {
-            auto name = lexer_.ExpectNext<TokenType::Id>().value;
-            lexer_.ExpectNext<TokenType::Char>(')');
-            lexer_.NextToken();
+            string name(lexer_->ExpectNext<TokenType::Id>().value);
+            lexer_->ExpectNext<TokenType::Char>(')');
+            lexer_->NextToken();
 
-            auto it = declared_classes_.find(name);
-            if (it == declared_classes_.end())
+            if (auto it = declared_classes_.find(name); it != declared_classes_.end())
+            {
+                base_class = static_cast<const runtime::Class *>(it->second.Get()); // NOLINT
+            }
+            else if (forward_ && forward_->is_declared(name))
+            {
+                forward_base_class = std::move(name);
+            }
+            else
             {
                 throw ParseError("Base class "s + name + " not found for class "s + class_name);
             }
-            base_class = static_cast<const runtime::Class *>(it->second.Get()); // NOLINT
         }
 
-        lexer_.Expect<TokenType::Char>(':');
-        lexer_.ExpectNext<TokenType::Newline>();
-        lexer_.ExpectNext<TokenType::Indent>();
-        lexer_.ExpectNext<TokenType::Def>();
+        lexer_->Expect<TokenType::Char>(':');
+        lexer_->ExpectNext<TokenType::Newline>();
+        lexer_->ExpectNext<TokenType::Indent>();
+        lexer_->ExpectNext<TokenType::Def>();
         vector<runtime::Method> methods = ParseMethods(); // NOLINT
 
-        lexer_.Expect<TokenType::Dedent>();
-        lexer_.NextToken();
+        lexer_->Expect<TokenType::Dedent>();
+        lexer_->NextToken();
 
         auto [it, inserted] = declared_classes_.insert({
             class_name,
@@ -134,16 +290,32 @@ class Parser
             throw ParseError("Class "s + class_name + " already exists"s);
         }
 
+        if (lazy_classes_)
+        {
+            const size_t position = lazy_classes_->size();
+            lazy_classes_->emplace(class_name, make_pair(it->second.TryAs<runtime::Class>(), position));
+        }
+
+        if (forward_)
+        {
+            forward_->declared.push_back(it->second);
+            if (!forward_base_class.empty())
+            {
+                forward_->parents.emplace_back(it->second.TryAs<runtime::Class>(), std::move(forward_base_class));
+            }
+        }
+
         return make_unique<ast::ClassDefinition>(it->second);
     }
 
     vector<string> ParseDottedIds()
     {
-        vector<string> result(1, lexer_.Expect<TokenType::Id>().value);
+        vector<string> result;
+        result.emplace_back(lexer_->Expect<TokenType::Id>().value);
 
-        while (lexer_.NextToken() == '.')
+        while (lexer_->NextToken() == '.')
         {
-            result.push_back(lexer_.ExpectNext<TokenType::Id>().value);
+            result.emplace_back(lexer_->ExpectNext<TokenType::Id>().value);
         }
 
         return result;
@@ -153,15 +325,15 @@ class Parser
     //!               | DottedIds '(' ExprList ')'
     unique_ptr<ast::Statement> ParseAssignmentOrCall()
     {
-        lexer_.Expect<TokenType::Id>();
+        lexer_->Expect<TokenType::Id>();
 
         vector<string> id_list = ParseDottedIds();
         string last_name = id_list.back();
         id_list.pop_back();
 
-        if (lexer_.CurrentToken() == '=')
+        if (lexer_->CurrentToken() == '=')
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
 
             if (id_list.empty())
             {
@@ -170,8 +342,8 @@ class Parser
             return make_unique<ast::FieldAssignment>(ast::VariableValue{std::move(id_list)}, std::move(last_name),
                                                      ParseTest());
         }
-        lexer_.Expect<TokenType::Char>('(');
-        lexer_.NextToken();
+        lexer_->Expect<TokenType::Char>('(');
+        lexer_->NextToken();
 
         if (id_list.empty())
         {
@@ -179,12 +351,12 @@ class Parser
         }
 
         vector<unique_ptr<ast::Statement>> args;
-        if (lexer_.CurrentToken() != ')')
+        if (lexer_->CurrentToken() != ')')
         {
             args = ParseTestList();
         }
-        lexer_.Expect<TokenType::Char>(')');
-        lexer_.NextToken();
+        lexer_->Expect<TokenType::Char>(')');
+        lexer_->NextToken();
 
         return make_unique<ast::MethodCall>(make_unique<ast::VariableValue>(std::move(id_list)), std::move(last_name),
                                             std::move(args));
@@ -194,10 +366,10 @@ class Parser
     unique_ptr<ast::Statement> ParseExpression() // NOLINT
     {
         unique_ptr<ast::Statement> result = ParseAdder();
-        while (lexer_.CurrentToken() == '+' || lexer_.CurrentToken() == '-')
+        while (lexer_->CurrentToken() == '+' || lexer_->CurrentToken() == '-')
         {
-            char op = lexer_.CurrentToken().As<TokenType::Char>().value;
-            lexer_.NextToken();
+            char op = lexer_->CurrentToken().As<TokenType::Char>().value;
+            lexer_->NextToken();
 
             if (op == '+')
             {
@@ -215,10 +387,10 @@ class Parser
     unique_ptr<ast::Statement> ParseAdder() // NOLINT
     {
         unique_ptr<ast::Statement> result = ParseMult();
-        while (lexer_.CurrentToken() == '*' || lexer_.CurrentToken() == '/')
+        while (lexer_->CurrentToken() == '*' || lexer_->CurrentToken() == '/')
         {
-            char op = lexer_.CurrentToken().As<TokenType::Char>().value;
-            lexer_.NextToken();
+            char op = lexer_->CurrentToken().As<TokenType::Char>().value;
+            lexer_->NextToken();
 
             if (op == '*')
             {
@@ -243,44 +415,44 @@ class Parser
     //!       | DottedIds
     unique_ptr<ast::Statement> ParseMult() // NOLINT
     {
-        if (lexer_.CurrentToken() == '(')
+        if (lexer_->CurrentToken() == '(')
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             auto result = ParseTest();
-            lexer_.Expect<TokenType::Char>(')');
-            lexer_.NextToken();
+            lexer_->Expect<TokenType::Char>(')');
+            lexer_->NextToken();
             return result;
         }
-        if (lexer_.CurrentToken() == '-')
+        if (lexer_->CurrentToken() == '-')
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             return make_unique<ast::Mult>(ParseMult(), make_unique<ast::NumericConst>(-1));
         }
-        if (const auto *num = lexer_.CurrentToken().TryAs<TokenType::Number>())
+        if (const auto num = lexer_->CurrentToken().TryAs<TokenType::Number>())
         {
             int result = num->value;
-            lexer_.NextToken();
+            lexer_->NextToken();
             return make_unique<ast::NumericConst>(result);
         }
-        if (const auto *str = lexer_.CurrentToken().TryAs<TokenType::String>())
+        if (const auto str = lexer_->CurrentToken().TryAs<TokenType::String>())
         {
-            string result = str->value;
-            lexer_.NextToken();
-            return make_unique<ast::StringConst>(std::move(result));
+            auto result = make_unique<ast::StringConst>(runtime::String(string(str->value)));
+            lexer_->NextToken();
+            return result;
         }
-        if (lexer_.CurrentToken().Is<TokenType::True>())
+        if (lexer_->CurrentToken().Is<TokenType::True>())
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             return make_unique<ast::BoolConst>(runtime::Bool(true));
         }
-        if (lexer_.CurrentToken().Is<TokenType::False>())
+        if (lexer_->CurrentToken().Is<TokenType::False>())
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             return make_unique<ast::BoolConst>(runtime::Bool(false));
         }
-        if (lexer_.CurrentToken().Is<TokenType::None>())
+        if (lexer_->CurrentToken().Is<TokenType::None>())
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             return make_unique<ast::None>();
         }
 
@@ -291,16 +463,16 @@ class Parser
     {
         vector<string> names = ParseDottedIds();
 
-        if (lexer_.CurrentToken() == '(')
+        if (lexer_->CurrentToken() == '(')
         {
             // various calls
             vector<unique_ptr<ast::Statement>> args;
-            if (lexer_.NextToken() != ')')
+            if (lexer_->NextToken() != ')')
             {
                 args = ParseTestList();
             }
-            lexer_.Expect<TokenType::Char>(')');
-            lexer_.NextToken();
+            lexer_->Expect<TokenType::Char>(')');
+            lexer_->NextToken();
 
             auto method_name = names.back();
             names.pop_back();
@@ -315,6 +487,12 @@ class Parser
                 return make_unique<ast::NewInstance>(static_cast<const runtime::Class &>(*it->second),
                                                      std::move(args)); // NOLINT
             }
+            if (forward_ && forward_->is_declared(method_name))
+            {
+                auto result = make_unique<ast::NewInstance>(UnresolvedClass(), std::move(args));
+                forward_->instances.emplace_back(result.get(), std::move(method_name));
+                return result;
+            }
             if (method_name == "str"sv)
             {
                 if (args.size() != 1)
@@ -333,9 +511,9 @@ class Parser
         vector<unique_ptr<ast::Statement>> result;
         result.push_back(ParseTest());
 
-        while (lexer_.CurrentToken() == ',')
+        while (lexer_->CurrentToken() == ',')
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             result.push_back(ParseTest());
         }
         return result;
@@ -344,21 +522,21 @@ class Parser
     //! Condition -> if LogicalExpr: Suite [else: Suite]
     unique_ptr<ast::Statement> ParseCondition() // NOLINT
     {
-        lexer_.Expect<TokenType::If>();
-        lexer_.NextToken();
+        lexer_->Expect<TokenType::If>();
+        lexer_->NextToken();
 
         auto condition = ParseTest();
 
-        lexer_.Expect<TokenType::Char>(':');
-        lexer_.NextToken();
+        lexer_->Expect<TokenType::Char>(':');
+        lexer_->NextToken();
 
         auto if_body = ParseSuite();
 
         unique_ptr<ast::Statement> else_body;
-        if (lexer_.CurrentToken().Is<TokenType::Else>())
+        if (lexer_->CurrentToken().Is<TokenType::Else>())
         {
-            lexer_.ExpectNext<TokenType::Char>(':');
-            lexer_.NextToken();
+            lexer_->ExpectNext<TokenType::Char>(':');
+            lexer_->NextToken();
             else_body = ParseSuite();
         }
 
@@ -372,9 +550,9 @@ class Parser
     unique_ptr<ast::Statement> ParseTest() // NOLINT
     {
         auto result = ParseAndTest();
-        while (lexer_.CurrentToken().Is<TokenType::Or>())
+        while (lexer_->CurrentToken().Is<TokenType::Or>())
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             result = make_unique<ast::Or>(std::move(result), ParseAndTest());
         }
         return result;
@@ -383,9 +561,9 @@ class Parser
     unique_ptr<ast::Statement> ParseAndTest() // NOLINT
     {
         auto result = ParseNotTest();
-        while (lexer_.CurrentToken().Is<TokenType::And>())
+        while (lexer_->CurrentToken().Is<TokenType::And>())
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             result = make_unique<ast::And>(std::move(result), ParseNotTest());
         }
         return result;
@@ -393,9 +571,9 @@ class Parser
 
     unique_ptr<ast::Statement> ParseNotTest() // NOLINT
     {
-        if (lexer_.CurrentToken().Is<TokenType::Not>())
+        if (lexer_->CurrentToken().Is<TokenType::Not>())
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             return make_unique<ast::Not>(ParseNotTest()); // NOLINT
         }
         return ParseComparison();
@@ -406,36 +584,36 @@ class Parser
     {
         auto result = ParseExpression();
 
-        const auto tok = lexer_.CurrentToken();
+        const auto &tok = lexer_->CurrentToken();
 
         if (tok == '<')
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             return make_unique<ast::Comparison>(runtime::Less, std::move(result), ParseExpression());
         }
         if (tok == '>')
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             return make_unique<ast::Comparison>(runtime::Greater, std::move(result), ParseExpression());
         }
         if (tok.Is<TokenType::Eq>())
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             return make_unique<ast::Comparison>(runtime::Equal, std::move(result), ParseExpression());
         }
         if (tok.Is<TokenType::NotEq>())
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             return make_unique<ast::Comparison>(runtime::NotEqual, std::move(result), ParseExpression());
         }
         if (tok.Is<TokenType::LessOrEq>())
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             return make_unique<ast::Comparison>(runtime::LessOrEqual, std::move(result), ParseExpression());
         }
         if (tok.Is<TokenType::GreaterOrEq>())
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             return make_unique<ast::Comparison>(runtime::GreaterOrEqual, std::move(result), ParseExpression());
         }
         return result;
@@ -446,11 +624,11 @@ class Parser
     //!           | if Condition
     unique_ptr<ast::Statement> ParseStatement() // NOLINT
     {
-        const auto &tok = lexer_.CurrentToken();
+        const auto &tok = lexer_->CurrentToken();
 
         if (tok.Is<TokenType::Class>())
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             return ParseClassDefinition(); // NOLINT
         }
         if (tok.Is<TokenType::If>())
@@ -458,8 +636,8 @@ class Parser
             return ParseCondition();
         }
         auto result = ParseSimpleStatement();
-        lexer_.Expect<TokenType::Newline>();
-        lexer_.NextToken();
+        lexer_->Expect<TokenType::Newline>();
+        lexer_->NextToken();
         return result;
     }
 
@@ -468,18 +646,18 @@ class Parser
     //!               | AssignmentOrCall
     unique_ptr<ast::Statement> ParseSimpleStatement()
     {
-        const auto &tok = lexer_.CurrentToken();
+        const auto &tok = lexer_->CurrentToken();
 
         if (tok.Is<TokenType::Return>())
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             return make_unique<ast::Return>(ParseTest());
         }
         if (tok.Is<TokenType::Print>())
         {
-            lexer_.NextToken();
+            lexer_->NextToken();
             vector<unique_ptr<ast::Statement>> args;
-            if (!lexer_.CurrentToken().Is<TokenType::Newline>())
+            if (!lexer_->CurrentToken().Is<TokenType::Newline>())
             {
                 args = ParseTestList();
             }
@@ -488,13 +666,244 @@ class Parser
         return ParseAssignmentOrCall();
     }
 
-    parse::Lexer &lexer_;
-    runtime::Closure declared_classes_;
+    //! Lexer of the program, or of method body that is parsed at once in lazy mode
+    parse::Lexer *lexer_;
+    //! Classes aren't allocated from the heap of tracing builds, so they aren't roots, and threads of parallel
+    //! parsing don't touch the heap
+    unordered_map<string, runtime::ObjectHolder> declared_classes_;
+    ForwardClasses *forward_;
+    //! Classes for lazily parsed method bodies, nullptr if bodies are parsed at once
+    shared_ptr<LazyClasses> lazy_classes_;
+    //! Newline that ends the last statement is not consumed yet
+    bool newline_pending_ = false;
+};
+
+unique_ptr<ast::Statement> ParseLazyBody(const string &text, const LazyClasses &classes, size_t visible)
+{
+    // Classes are bound the same way as classes of preceding parts in parallel parsing
+    ForwardClasses forward;
+    forward.is_declared = [&classes, visible](string_view name) {
+        auto it = classes.find(string(name));
+        return it != classes.end() && it->second.second < visible;
+    };
+
+    parse::Lexer lexer(text);
+    auto result = make_unique<ast::Compound>();
+    for (auto &statement : Parser{lexer, &forward}.ParseStatements())
+    {
+        result->AddStatement(std::move(statement));
+    }
+
+    for (auto &[instance, name] : forward.instances)
+    {
+        instance->SetClass(*classes.at(name).first);
+    }
+    for (auto &[cls, name] : forward.parents)
+    {
+        cls->SetParent(classes.at(name).first);
+    }
+    return result;
+}
+
+//! Top-level structure of a program, obtained without tokenizing it
+struct ProgramLayout
+{
+    //! Offsets of lines that start top-level statements
+    vector<size_t> statements;
+    //! Offsets of the first declaration of every class
+    unordered_map<string_view, size_t> classes;
 };
 
+ProgramLayout ScanLayout(string_view source)
+{
+    ProgramLayout layout;
+    for (size_t begin = 0; begin < source.size();)
+    {
+        const size_t end = min(parse::scan::Find(source, begin, '\n'), source.size() - 1) + 1;
+        const size_t text_begin = parse::scan::SkipSpaces(source, begin);
+        if (text_begin >= end || source[text_begin] == '\n' || source[text_begin] == '#')
+        {
+            begin = end;
+            continue;
+        }
+
+        const string_view text = source.substr(text_begin, end - text_begin);
+        // Indentation is measured in pairs of spaces, "else" continues preceding "if"
+        if (text_begin - begin < 2 && !StartsWithKeyword(text, "else"sv))
+        {
+            layout.statements.push_back(begin);
+        }
+        if (StartsWithKeyword(text, "class"sv))
+        {
+            const size_t name_begin = parse::scan::SkipSpaces(text, 5);
+            size_t name_end = name_begin;
+            for (; name_end < text.size() &&
+                   (isalnum(static_cast<unsigned char>(text[name_end])) || text[name_end] == '_');
+                 ++name_end)
+            {
+            }
+            layout.classes.emplace(text.substr(name_begin, name_end - name_begin), text_begin);
+        }
+        begin = end;
+    }
+    return layout;
+}
+
 } // namespace
 
-unique_ptr<runtime::Executable> ParseProgram(parse::Lexer &lexer)
+unique_ptr<runtime::Executable> ParseProgram(parse::Lexer &lexer, MethodParsing methods)
+{
+    return Parser{lexer, nullptr, methods}.ParseProgram();
+}
+
+unique_ptr<runtime::Executable> IncrementalParser::Parse(string_view block)
+{
+    // Classes of preceding blocks are bound the same way as classes of preceding parts in parallel parsing
+    ForwardClasses forward;
+    forward.is_declared = [this](string_view name) { return declared_classes_.count(string(name)) > 0; };
+
+    parse::Lexer lexer(block);
+    auto statements = Parser{lexer, &forward}.ParseStatements();
+
+    for (auto &[instance, name] : forward.instances)
+    {
+        instance->SetClass(static_cast<const runtime::Class &>(*declared_classes_.at(name))); // NOLINT
+    }
+    for (auto &[cls, name] : forward.parents)
+    {
+        cls->SetParent(static_cast<const runtime::Class *>(declared_classes_.at(name).Get())); // NOLINT
+    }
+    // Block is parsed completely, only now its classes become visible, replacing classes with the same names
+    for (const auto &cls : forward.declared)
+    {
+        declared_classes_[cls.TryAs<runtime::Class>()->GetName()] = cls;
+    }
+
+    auto result = make_unique<ast::Compound>();
+    for (auto &statement : statements)
+    {
+        result->AddStatement(std::move(statement));
+    }
+    return result;
+}
+
+struct StatementStream::Impl
+{
+    Parser parser;
+};
+
+StatementStream::StatementStream(parse::Lexer &lexer, MethodParsing methods)
+    : impl_(make_unique<Impl>(Impl{Parser{lexer, nullptr, methods}}))
+{
+}
+
+StatementStream::~StatementStream() = default;
+
+unique_ptr<runtime::Executable> StatementStream::Next()
+{
+    return impl_->parser.ParseNextStatement();
+}
+
+unique_ptr<runtime::Executable> ParseProgramParallel(string_view source, size_t threads)
 {
-    return Parser{lexer}.ParseProgram();
+    if (threads == 0)
+    {
+        threads = max(1U, thread::hardware_concurrency());
+    }
+    const ProgramLayout layout = ScanLayout(source);
+
+    // Several parts per thread keep threads busy when parts take different time to parse
+    vector<size_t> bounds{0};
+    const size_t part_size = max<size_t>(1, source.size() / (threads * 4));
+    for (size_t offset : layout.statements)
+    {
+        if (offset - bounds.back() >= part_size)
+        {
+            bounds.push_back(offset);
+        }
+    }
+    bounds.push_back(source.size());
+
+    struct Part
+    {
+        vector<unique_ptr<ast::Statement>> statements;
+        ForwardClasses classes;
+        exception_ptr error;
+    };
+    vector<Part> parts(bounds.size() - 1);
+
+    atomic<size_t> next_part{0};
+    auto worker = [&]() {
+        for (size_t i = next_part++; i < parts.size(); i = next_part++)
+        {
+            Part &part = parts[i];
+            const size_t begin = bounds[i];
+            part.classes.is_declared = [&layout, begin](string_view name) {
+                auto it = layout.classes.find(name);
+                return it != layout.classes.end() && it->second < begin;
+            };
+            try
+            {
+                parse::Lexer lexer(source.substr(begin, bounds[i + 1] - begin));
+                part.statements = Parser{lexer, &part.classes}.ParseStatements();
+            }
+            catch (...)
+            {
+                part.error = current_exception();
+            }
+        }
+    };
+
+    vector<thread> pool;
+    for (size_t i = 1; i < min(threads, parts.size()); ++i)
+    {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : pool)
+    {
+        t.join();
+    }
+
+    // Parts are stitched in source order, so errors and class visibility are the same as in sequential parsing
+    auto result = make_unique<ast::Compound>();
+    runtime::Closure declared_classes;
+    for (Part &part : parts)
+    {
+        if (part.error)
+        {
+            rethrow_exception(part.error);
+        }
+        for (auto &[instance, name] : part.classes.instances)
+        {
+            auto it = declared_classes.find(name);
+            if (it == declared_classes.end())
+            {
+                throw ParseError("Unknown call to "s + name + "()"s);
+            }
+            instance->SetClass(static_cast<const runtime::Class &>(*it->second)); // NOLINT
+        }
+        for (auto &[cls, name] : part.classes.parents)
+        {
+            auto it = declared_classes.find(name);
+            if (it == declared_classes.end())
+            {
+                throw ParseError("Base class "s + name + " not found for class "s + cls->GetName());
+            }
+            cls->SetParent(static_cast<const runtime::Class *>(it->second.Get())); // NOLINT
+        }
+        for (const auto &cls : part.classes.declared)
+        {
+            const string &name = cls.TryAs<runtime::Class>()->GetName();
+            if (!declared_classes.emplace(name, cls).second)
+            {
+                throw ParseError("Class "s + name + " already exists"s);
+            }
+        }
+        for (auto &statement : part.statements)
+        {
+            result->AddStatement(std::move(statement));
+        }
+    }
+    return result;
 }
\ No newline at end of file
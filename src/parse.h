@@ -4,22 +4,74 @@
  */
 #pragma once
 
+#include "runtime.h"
+
 #include <memory>
 #include <stdexcept>
+#include <string_view>
 
 namespace parse
 {
 class Lexer;
 }
 
-namespace runtime
-{
-class Executable;
-}
-
 struct ParseError : std::runtime_error
 {
     using std::runtime_error::runtime_error;
 };
 
-std::unique_ptr<runtime::Executable> ParseProgram(parse::Lexer &lexer);
\ No newline at end of file
+//! How method bodies are parsed
+enum class MethodParsing
+{
+    //! Along with the rest of program
+    Eager,
+    //! Bodies are only skipped, each of them is parsed when method is executed first time.
+    //! Errors in method body are reported when it's parsed. Bodies that declare classes are parsed at once,
+    //! so that statements after them know these classes
+    Lazy,
+};
+
+std::unique_ptr<runtime::Executable> ParseProgram(parse::Lexer &lexer, MethodParsing methods = MethodParsing::Eager);
+
+/*!
+ * Parses program one top-level statement at a time, so that each statement can be executed before the rest
+ * of program is read. Statements share classes declared by preceding ones, just like in the whole program
+ */
+class StatementStream
+{
+  public:
+    explicit StatementStream(parse::Lexer &lexer, MethodParsing methods = MethodParsing::Eager);
+    StatementStream(const StatementStream &) = delete;
+    StatementStream &operator=(const StatementStream &) = delete;
+    ~StatementStream();
+
+    //! Returns next top-level statement or nullptr if program is over.
+    //! Statement must outlive objects it created, as constants are shared with them rather than copied
+    std::unique_ptr<runtime::Executable> Next();
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+/*!
+ * Parses program that is entered block by block, i.e. in interactive mode. Each block is lexed and parsed
+ * on its own and sees classes declared by preceding blocks. Block may declare class again: new class replaces
+ * old one for the following blocks, while classes and methods parsed before keep referring to the old one
+ */
+class IncrementalParser
+{
+  public:
+    //! Parses block of complete top-level statements. Block that fails to parse changes nothing
+    std::unique_ptr<runtime::Executable> Parse(std::string_view block);
+
+  private:
+    runtime::Closure declared_classes_;
+};
+
+/*!
+ * Splits source text by top-level statements, lexes and parses its parts concurrently and stitches them back
+ * in source order. Result and errors are the same as ParseProgram produces for this text.
+ * Text must outlive the call only. Zero "threads" means as many threads as hardware supports
+ */
+std::unique_ptr<runtime::Executable> ParseProgramParallel(std::string_view source, size_t threads = 0);
\ No newline at end of file
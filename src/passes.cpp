@@ -0,0 +1,349 @@
+#include "passes.h"
+
+#include "fuse.h"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+namespace passes
+{
+
+using ast::Statement;
+
+namespace
+{
+
+using ComparatorFunction = bool (*)(const runtime::ObjectHolder &, const runtime::ObjectHolder &, runtime::Context &);
+
+struct ComparatorName
+{
+    ComparatorFunction function;
+    const char *name;
+};
+
+const ComparatorName COMPARATORS[] = {
+    {runtime::Equal, "=="},       {runtime::NotEqual, "!="},     {runtime::Less, "<"},
+    {runtime::Greater, ">"},      {runtime::LessOrEqual, "<="}, {runtime::GreaterOrEqual, ">="},
+};
+
+const char *OperandTypesName(ast::OperandTypes types)
+{
+    switch (types)
+    {
+    case ast::OperandTypes::Numbers:
+        return "numbers";
+    case ast::OperandTypes::Strings:
+        return "strings";
+    case ast::OperandTypes::Generic:
+        return "generic";
+    default:
+        return nullptr;
+    }
+}
+
+//! Writes node per line, children are indented one level deeper than their parent
+class Dumper : public ast::TreeVisitor
+{
+  public:
+    explicit Dumper(ostream &output) : output_(output)
+    {
+    }
+
+    void VisitChild(const Statement &statement) override
+    {
+        // Replacement is visited as its original node, so it's written first with the original below it
+        if (const auto *replacement = dynamic_cast<const ast::Replacement *>(&statement))
+        {
+            Line(replacement->GetName() + (replacement->IsBound() ? ""s : " <not bound>"s));
+            ++depth_;
+            VisitChild(replacement->GetOriginal());
+            --depth_;
+            return;
+        }
+        if (!ast::Accept(statement, *this))
+        {
+            Line("<native>"s);
+        }
+    }
+
+    void Visit(const ast::NumericConst &node) override
+    {
+        Line("NumericConst "s + to_string(node.GetValue().GetValue()));
+    }
+
+    void Visit(const ast::StringConst &node) override
+    {
+        Line("StringConst '"s + node.GetValue().GetValue() + "'"s);
+    }
+
+    void Visit(const ast::BoolConst &node) override
+    {
+        Line(node.GetValue().GetValue() ? "BoolConst True"s : "BoolConst False"s);
+    }
+
+    void Visit(const ast::VariableValue &node) override
+    {
+        string ids;
+        for (const auto &id : node.GetIds())
+        {
+            ids += (ids.empty() ? ""s : "."s) + id;
+        }
+        Line("VariableValue "s + ids);
+    }
+
+    void Visit(const ast::Assignment &node) override
+    {
+        Children("Assignment "s + node.GetVariable(), node);
+    }
+
+    void Visit(const ast::FieldAssignment &node) override
+    {
+        Children("FieldAssignment ."s + node.GetField(), node);
+    }
+
+    void Visit(const ast::None &node) override
+    {
+        Children("None"s, node);
+    }
+
+    void Visit(const ast::Print &node) override
+    {
+        Children("Print"s, node);
+    }
+
+    void Visit(const ast::MethodCall &node) override
+    {
+        Children("MethodCall "s + node.GetMethod(), node);
+    }
+
+    void Visit(const ast::NewInstance &node) override
+    {
+        Children("NewInstance "s + node.GetClass().GetName(), node);
+    }
+
+    void Visit(const ast::Stringify &node) override
+    {
+        Children("Stringify"s, node);
+    }
+
+    void Visit(const ast::Add &node) override
+    {
+        Children(Operation("Add"s, node), node);
+    }
+
+    void Visit(const ast::Sub &node) override
+    {
+        Children(Operation("Sub"s, node), node);
+    }
+
+    void Visit(const ast::Mult &node) override
+    {
+        Children(Operation("Mult"s, node), node);
+    }
+
+    void Visit(const ast::Div &node) override
+    {
+        Children(Operation("Div"s, node), node);
+    }
+
+    void Visit(const ast::Or &node) override
+    {
+        Children("Or"s, node);
+    }
+
+    void Visit(const ast::And &node) override
+    {
+        Children("And"s, node);
+    }
+
+    void Visit(const ast::Not &node) override
+    {
+        Children("Not"s, node);
+    }
+
+    void Visit(const ast::Compound &node) override
+    {
+        Children("Compound"s, node);
+    }
+
+    void Visit(const ast::MethodBody &node) override
+    {
+        Children(node.IsParsed() ? "MethodBody"s : "MethodBody <not parsed>"s, node);
+    }
+
+    void Visit(const ast::Return &node) override
+    {
+        Children("Return"s, node);
+    }
+
+    void Visit(const ast::ClassDefinition &node) override
+    {
+        const auto &cls = *node.GetClass().TryAs<runtime::Class>();
+        const string parent = cls.GetParent() ? "("s + cls.GetParent()->GetName() + ")"s : ""s;
+        Line("ClassDefinition "s + cls.GetName() + parent);
+        ++depth_;
+        for (const auto &method : cls.GetMethods())
+        {
+            string params;
+            for (const auto &param : method.formal_params)
+            {
+                params += (params.empty() ? ""s : ", "s) + param;
+            }
+            Line("def "s + method.name + "("s + params + ")"s);
+            ++depth_;
+            VisitChild(*method.body);
+            --depth_;
+        }
+        --depth_;
+    }
+
+    void Visit(const ast::IfElse &node) override
+    {
+        Children(node.HasBoolCondition() ? "IfElse bool"s : "IfElse"s, node);
+    }
+
+    void Visit(const ast::Comparison &node) override
+    {
+        const auto *function = node.GetComparator().target<ComparatorFunction>();
+        const auto *name = find_if(begin(COMPARATORS), end(COMPARATORS), [function](const ComparatorName &name) {
+            return function && name.function == *function;
+        });
+        Children(Operation("Comparison "s + (name == end(COMPARATORS) ? "custom"s : name->name), node), node);
+    }
+
+  private:
+    void Line(const string &text)
+    {
+        output_ << string(depth_ * 2, ' ') << text << '\n';
+    }
+
+    //! Writes node and visits its children one level deeper
+    template <typename N> void Children(const string &text, const N &node)
+    {
+        Line(text);
+        ++depth_;
+        TreeVisitor::Visit(node);
+        --depth_;
+    }
+
+    //! Adds operand types operation is specialized for
+    static string Operation(string text, const ast::BinaryOperation &node)
+    {
+        if (const char *types = OperandTypesName(node.GetOperandTypes()))
+        {
+            text += " ["s + types + (node.OperandTypesProven() ? ", proven]"s : "]"s);
+        }
+        return text;
+    }
+
+    ostream &output_;
+    size_t depth_ = 0;
+};
+
+} // namespace
+
+optional<Level> ParseLevel(string_view text)
+{
+    if (text == "0"sv)
+    {
+        return Level::O0;
+    }
+    if (text == "1"sv)
+    {
+        return Level::O1;
+    }
+    if (text == "2"sv)
+    {
+        return Level::O2;
+    }
+    return nullopt;
+}
+
+PassManager::PassManager(Level level) : level_(level)
+{
+}
+
+void PassManager::Add(string name, Level level, Transform transform)
+{
+    passes_.push_back({std::move(name), level, std::move(transform)});
+}
+
+void PassManager::Disable(const string &name)
+{
+    disabled_.insert(name);
+}
+
+void PassManager::SetDump(ostream *output)
+{
+    dump_ = output;
+}
+
+vector<string> PassManager::Enabled() const
+{
+    vector<string> names;
+    for (const auto &pass : passes_)
+    {
+        if (IsEnabled(pass))
+        {
+            names.push_back(pass.name);
+        }
+    }
+    return names;
+}
+
+void PassManager::Run(unique_ptr<Statement> &program)
+{
+    timings_.clear();
+    if (dump_)
+    {
+        *dump_ << "=== parsed ===\n";
+        DumpTree(*program, *dump_);
+    }
+    for (const auto &pass : passes_)
+    {
+        if (!IsEnabled(pass))
+        {
+            continue;
+        }
+        const auto start = chrono::steady_clock::now();
+        pass.transform(program);
+        timings_.push_back({pass.name, chrono::steady_clock::now() - start});
+        if (dump_)
+        {
+            *dump_ << "=== after " << pass.name << " ===\n";
+            DumpTree(*program, *dump_);
+        }
+    }
+}
+
+const vector<PassManager::Timing> &PassManager::GetTimings() const
+{
+    return timings_;
+}
+
+bool PassManager::IsEnabled(const Pass &pass) const
+{
+    return pass.level <= level_ && disabled_.count(pass.name) == 0;
+}
+
+void PrintTimings(const vector<PassManager::Timing> &timings, ostream &output)
+{
+    chrono::nanoseconds total{0};
+    for (const auto &timing : timings)
+    {
+        output << timing.name << ' ' << chrono::duration_cast<chrono::microseconds>(timing.time).count() << " us\n";
+        total += timing.time;
+    }
+    output << "total " << chrono::duration_cast<chrono::microseconds>(total).count() << " us" << endl;
+}
+
+void DumpTree(const Statement &statement, ostream &output)
+{
+    Dumper dumper(output);
+    dumper.VisitChild(statement);
+    output.flush();
+}
+
+} // namespace passes
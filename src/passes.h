@@ -0,0 +1,98 @@
+/*!
+ * \file passes.h
+ * \brief Pass manager: ordered rewrites of program syntax tree, selected by optimization level
+ */
+#pragma once
+
+#include "statement.h"
+
+#include <chrono>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace passes
+{
+
+//! Optimization level, passes of a level run at every level above it as well
+enum class Level
+{
+    //! Program is executed as it's parsed
+    O0,
+    //! Operations are specialized and fused within methods
+    O1,
+    //! Method calls are rewritten as well
+    O2,
+};
+
+//! Returns level for "0", "1" or "2"
+std::optional<Level> ParseLevel(std::string_view text);
+
+/*!
+ * Runs rewrites of program in order they were added. Pass of a level higher than the selected one or disabled
+ * by name is skipped. Time of every pass that ran is measured, and syntax tree may be dumped before the first
+ * pass and after every pass that ran
+ */
+class PassManager
+{
+  public:
+    //! Rewrites program, it may replace the program statement itself
+    using Transform = ast::Node::Rewriter;
+
+    //! Pass that ran and its time
+    struct Timing
+    {
+        std::string name;
+        std::chrono::nanoseconds time;
+    };
+
+    explicit PassManager(Level level = Level::O2);
+
+    //! Adds pass that runs at "level" and above. Pass of level O0 runs unless it's disabled
+    void Add(std::string name, Level level, Transform transform);
+
+    //! Pass with given name doesn't run, name may belong to a pass that is added later or never
+    void Disable(const std::string &name);
+
+    //! Syntax tree is written to "output" around passes, nullptr turns dump off
+    void SetDump(std::ostream *output);
+
+    //! Returns names of passes that will run, in order
+    [[nodiscard]] std::vector<std::string> Enabled() const;
+
+    //! Runs enabled passes over program, timings of the previous run are replaced
+    void Run(std::unique_ptr<ast::Statement> &program);
+
+    [[nodiscard]] const std::vector<Timing> &GetTimings() const;
+
+  private:
+    struct Pass
+    {
+        std::string name;
+        Level level;
+        Transform transform;
+    };
+
+    [[nodiscard]] bool IsEnabled(const Pass &pass) const;
+
+    Level level_;
+    std::vector<Pass> passes_;
+    std::unordered_set<std::string> disabled_;
+    std::ostream *dump_ = nullptr;
+    std::vector<Timing> timings_;
+};
+
+//! Writes time of every pass and their total in microseconds
+void PrintTimings(const std::vector<PassManager::Timing> &timings, std::ostream &output);
+
+/*!
+ * Writes syntax tree of statement, one node per line indented by its depth. Class definition is followed by
+ * its methods, method bodies that are not parsed yet are not parsed by dump. Nodes that replace others, i.e.
+ * fused, memoized or inlined ones, are written by their names with the nodes they replaced as their children
+ */
+void DumpTree(const ast::Statement &statement, std::ostream &output);
+
+} // namespace passes
@@ -0,0 +1,423 @@
+#include "profile.h"
+
+#include "cache.h"
+#include "statement.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace profile
+{
+
+using ast::Statement;
+using runtime::Class;
+
+namespace
+{
+
+const string HEADER = "mython-profile"s;
+//! Receiver of call that was made for objects of different classes or not made at all
+const string NO_RECEIVER = "-"s;
+
+//! Finds methods of classes defined by program, their operations and calls, and text that identifies them
+class Collector : public ast::Visitor
+{
+  public:
+    explicit Collector(vector<Profile::Method> &methods) : methods_(methods)
+    {
+    }
+
+    void Collect(const Statement &statement)
+    {
+        if (!ast::Accept(statement, *this))
+        {
+            Token("?"s);
+        }
+    }
+
+    //! Returns class defined by program with given name, nullptr if there is no such class or several ones
+    [[nodiscard]] const Class *FindClass(const string &name) const
+    {
+        const auto it = classes_.find(name);
+        return it == classes_.end() ? nullptr : it->second;
+    }
+
+    void Visit(const ast::NumericConst &node) override
+    {
+        Token("n"s + to_string(node.GetValue().GetValue()));
+    }
+
+    void Visit(const ast::StringConst &node) override
+    {
+        Token("s"s + to_string(node.GetValue().GetValue().size()) + ":"s + node.GetValue().GetValue());
+    }
+
+    void Visit(const ast::BoolConst &node) override
+    {
+        Token(node.GetValue().GetValue() ? "True"s : "False"s);
+    }
+
+    void Visit(const ast::VariableValue &node) override
+    {
+        Token("var"s);
+        for (const auto &id : node.GetIds())
+        {
+            Token(id);
+        }
+    }
+
+    void Visit(const ast::Assignment &node) override
+    {
+        Token("="s + node.GetVariable());
+        Collect(node.GetValue());
+    }
+
+    void Visit(const ast::FieldAssignment &node) override
+    {
+        Token("field="s + node.GetField());
+        Visit(node.GetObject());
+        Collect(node.GetValue());
+    }
+
+    void Visit([[maybe_unused]] const ast::None &node) override
+    {
+        Token("None"s);
+    }
+
+    void Visit(const ast::Print &node) override
+    {
+        Token("print"s);
+        CollectAll(node.GetArgs());
+    }
+
+    void Visit(const ast::MethodCall &node) override
+    {
+        if (!current_.empty())
+        {
+            methods_[current_.back()].calls.push_back(const_cast<ast::MethodCall *>(&node));
+        }
+        Token("call"s + node.GetMethod());
+        Collect(node.GetObject());
+        CollectAll(node.GetArgs());
+    }
+
+    void Visit(const ast::NewInstance &node) override
+    {
+        Token("new"s + node.GetClass().GetName());
+        CollectAll(node.GetArgs());
+    }
+
+    void Visit(const ast::Stringify &node) override
+    {
+        Token("str"s);
+        Collect(node.GetArgument());
+    }
+
+    void Visit(const ast::Add &node) override
+    {
+        Binary("+"s, node);
+    }
+
+    void Visit(const ast::Sub &node) override
+    {
+        Binary("-"s, node);
+    }
+
+    void Visit(const ast::Mult &node) override
+    {
+        Binary("*"s, node);
+    }
+
+    void Visit(const ast::Div &node) override
+    {
+        Binary("/"s, node);
+    }
+
+    void Visit(const ast::Or &node) override
+    {
+        Binary("or"s, node);
+    }
+
+    void Visit(const ast::And &node) override
+    {
+        Binary("and"s, node);
+    }
+
+    void Visit(const ast::Not &node) override
+    {
+        Token("not"s);
+        Collect(node.GetArgument());
+    }
+
+    void Visit(const ast::Compound &node) override
+    {
+        Token("{"s);
+        CollectAll(node.GetStatements());
+        Token("}"s);
+    }
+
+    void Visit(const ast::MethodBody &node) override
+    {
+        Token("body"s);
+        Collect(node.GetBody());
+    }
+
+    void Visit(const ast::Return &node) override
+    {
+        Token("return"s);
+        Collect(node.GetValue());
+    }
+
+    void Visit(const ast::ClassDefinition &node) override
+    {
+        const auto &cls = static_cast<const Class &>(*node.GetClass());
+        Token("class"s + cls.GetName());
+        const auto [it, inserted] = classes_.emplace(cls.GetName(), &cls);
+        if (!inserted && it->second != &cls)
+        {
+            it->second = nullptr;
+        }
+
+        for (const auto &method : cls.GetMethods())
+        {
+            current_.push_back(methods_.size());
+            methods_.push_back({cls.GetName() + "."s + method.name + "("s, &method, {}, {}});
+            for (const auto &param : method.formal_params)
+            {
+                Token(param);
+            }
+            Token(")"s);
+            Collect(*method.body);
+            current_.pop_back();
+        }
+    }
+
+    void Visit(const ast::IfElse &node) override
+    {
+        Token("if"s);
+        Collect(node.GetCondition());
+        Collect(node.GetIfBody());
+        if (node.GetElseBody())
+        {
+            Token("else"s);
+            Collect(*node.GetElseBody());
+        }
+    }
+
+    void Visit(const ast::Comparison &node) override
+    {
+        using ComparatorFunction = bool (*)(const runtime::ObjectHolder &, const runtime::ObjectHolder &,
+                                            runtime::Context &);
+        const auto *function = node.GetComparator().target<ComparatorFunction>();
+        string name = "cmp"s;
+        const pair<ComparatorFunction, const char *> comparators[] = {
+            {runtime::Equal, "=="},      {runtime::NotEqual, "!="},    {runtime::Less, "<"},
+            {runtime::Greater, ">"},     {runtime::LessOrEqual, "<="}, {runtime::GreaterOrEqual, ">="},
+        };
+        for (const auto &[comparator, symbol] : comparators)
+        {
+            if (function && *function == comparator)
+            {
+                name = symbol;
+            }
+        }
+        Binary(name, node);
+    }
+
+  private:
+    //! Appends token to text of every method being collected, nested ones are part of enclosing methods' text
+    void Token(const string &token)
+    {
+        for (const size_t index : current_)
+        {
+            methods_[index].text += token;
+            methods_[index].text += ' ';
+        }
+    }
+
+    void CollectAll(const vector<unique_ptr<Statement>> &statements)
+    {
+        Token(to_string(statements.size()));
+        for (const auto &statement : statements)
+        {
+            Collect(*statement);
+        }
+    }
+
+    void Binary(const string &token, const ast::BinaryOperation &node)
+    {
+        if (!current_.empty())
+        {
+            methods_[current_.back()].operations.push_back(const_cast<ast::BinaryOperation *>(&node));
+        }
+        Token(token);
+        Collect(node.GetLeft());
+        Collect(node.GetRight());
+    }
+
+    vector<Profile::Method> &methods_;
+    //! Indices of methods being collected, innermost last
+    vector<size_t> current_;
+    unordered_map<string, const Class *> classes_;
+};
+
+//! Reads profile, throws ProfileError if it is damaged or written by other version
+unordered_map<uint64_t, Profile::Entry> Read(istream &input)
+{
+    string header;
+    uint32_t version = 0;
+    if (!(input >> header >> version) || header != HEADER || version != FORMAT_VERSION)
+    {
+        throw ProfileError("Not a profile"s);
+    }
+
+    unordered_map<uint64_t, Profile::Entry> entries;
+    string kind;
+    while (input >> kind)
+    {
+        uint64_t hash = 0;
+        Profile::Entry entry;
+        size_t size = 0;
+        if (kind != "method"s || !(input >> hex >> hash >> dec >> entry.calls >> size))
+        {
+            throw ProfileError("Damaged profile"s);
+        }
+        for (size_t i = 0; i < size; ++i)
+        {
+            unsigned types = 0;
+            if (!(input >> types) || types > static_cast<unsigned>(ast::OperandTypes::Generic))
+            {
+                throw ProfileError("Damaged profile"s);
+            }
+            entry.operand_types.push_back(static_cast<uint8_t>(types));
+        }
+        if (!(input >> size))
+        {
+            throw ProfileError("Damaged profile"s);
+        }
+        entry.receivers.resize(size);
+        for (auto &receiver : entry.receivers)
+        {
+            if (!(input >> receiver))
+            {
+                throw ProfileError("Damaged profile"s);
+            }
+            if (receiver == NO_RECEIVER)
+            {
+                receiver.clear();
+            }
+        }
+        entries[hash] = std::move(entry);
+    }
+    return entries;
+}
+
+} // namespace
+
+Profile::Profile(string path) : path_(std::move(path))
+{
+    ifstream input(path_);
+    if (!input)
+    {
+        return;
+    }
+    try
+    {
+        entries_ = Read(input);
+    }
+    catch (const ProfileError &)
+    {
+        // Damaged profile is the same as missing one, it is rewritten after the run
+    }
+}
+
+unordered_set<const runtime::Method *> Profile::Apply(const runtime::Executable &program, size_t threshold)
+{
+    methods_.clear();
+    Collector collector(methods_);
+    collector.Collect(program);
+
+    unordered_set<const runtime::Method *> hot_methods;
+    for (const auto &method : methods_)
+    {
+        const auto it = entries_.find(cache::HashSource(method.text));
+        if (it == entries_.end())
+        {
+            continue;
+        }
+        const Entry &entry = it->second;
+        if (entry.operand_types.size() != method.operations.size() || entry.receivers.size() != method.calls.size())
+        {
+            continue;
+        }
+        for (size_t i = 0; i < method.operations.size(); ++i)
+        {
+            method.operations[i]->ExpectOperandTypes(static_cast<ast::OperandTypes>(entry.operand_types[i]));
+        }
+        for (size_t i = 0; i < method.calls.size(); ++i)
+        {
+            if (const Class *receiver = collector.FindClass(entry.receivers[i]))
+            {
+                method.calls[i]->ObserveReceiver(*receiver);
+            }
+        }
+        if (entry.calls > threshold)
+        {
+            hot_methods.insert(method.method);
+        }
+    }
+    return hot_methods;
+}
+
+void Profile::Store(const closures::Stats &stats) const
+{
+    unordered_map<const runtime::Method *, size_t> calls;
+    for (const auto &method : stats.methods)
+    {
+        calls[method.method] = method.calls;
+    }
+
+    ostringstream output;
+    output << HEADER << ' ' << FORMAT_VERSION << '\n';
+    for (const auto &method : methods_)
+    {
+        const auto it = calls.find(method.method);
+        output << "method "s << hex << cache::HashSource(method.text) << dec << ' '
+               << (it == calls.end() ? 0 : it->second) << ' ' << method.operations.size();
+        for (const auto *operation : method.operations)
+        {
+            output << ' ' << static_cast<unsigned>(operation->GetOperandTypes());
+        }
+        output << ' ' << method.calls.size();
+        for (const auto *call : method.calls)
+        {
+            const Class *receiver = call->GetReceiverClass();
+            output << ' ' << (receiver ? receiver->GetName() : NO_RECEIVER);
+        }
+        output << '\n';
+    }
+
+    const string temp_path = path_ + ".tmp"s + to_string(getpid());
+    {
+        ofstream file(temp_path, ios::trunc);
+        file << output.str();
+        file.close();
+        if (!file)
+        {
+            remove(temp_path.c_str());
+            throw ProfileError("Can't write profile "s + path_);
+        }
+    }
+    if (rename(temp_path.c_str(), path_.c_str()) != 0)
+    {
+        remove(temp_path.c_str());
+        throw ProfileError("Can't write profile "s + path_);
+    }
+}
+
+} // namespace profile
@@ -0,0 +1,79 @@
+/*!
+ * \file profile.h
+ * \brief Profile-guided optimization: what methods did at run time is kept in a file for the next runs
+ */
+#pragma once
+
+#include "closures.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ast
+{
+class BinaryOperation;
+class MethodCall;
+} // namespace ast
+
+namespace profile
+{
+
+struct ProfileError : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+//! Format version, profiles written by other versions are ignored
+constexpr std::uint32_t FORMAT_VERSION = 1;
+
+/*!
+ * Profile of program methods: number of their calls, operand types of their operations and classes of objects
+ * their calls were made for. Method is identified by hash of its class name, name, parameters and body, so
+ * changed method doesn't get profile of its previous version
+ */
+class Profile
+{
+  public:
+    //! Reads profile file, profile is empty if file doesn't exist, is damaged or is written by other version
+    explicit Profile(std::string path);
+
+    /*!
+     * Finds methods of program and specializes their operations and calls for what previous runs have seen.
+     * Returns methods that were called more than "threshold" times, i.e. compiled by previous runs.
+     * Lazily parsed method bodies are parsed
+     */
+    std::unordered_set<const runtime::Method *> Apply(const runtime::Executable &program, size_t threshold);
+
+    //! Writes profile of methods found by Apply with their calls counted by "stats". File is replaced at once,
+    //! throws ProfileError if it can't be written
+    void Store(const closures::Stats &stats) const;
+
+    //! Profile of method
+    struct Entry
+    {
+        size_t calls = 0;
+        std::vector<std::uint8_t> operand_types;
+        //! Class names, empty for calls made for objects of different classes or not made at all
+        std::vector<std::string> receivers;
+    };
+
+    //! Method found in program, its operations and calls are in order of syntax tree traversal
+    struct Method
+    {
+        std::string text;
+        const runtime::Method *method = nullptr;
+        std::vector<ast::BinaryOperation *> operations;
+        std::vector<ast::MethodCall *> calls;
+    };
+
+  private:
+    std::string path_;
+    std::unordered_map<std::uint64_t, Entry> entries_;
+    std::vector<Method> methods_;
+};
+
+} // namespace profile
@@ -0,0 +1,116 @@
+#include "repl.h"
+
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace repl
+{
+
+namespace
+{
+//! Returns line without comment and trailing spaces
+string_view StripLine(string_view line)
+{
+    char quote = 0;
+    for (size_t i = 0; i < line.size(); ++i)
+    {
+        const char c = line[i];
+        if (quote)
+        {
+            if (c == '\\')
+            {
+                ++i;
+            }
+            else if (c == quote)
+            {
+                quote = 0;
+            }
+        }
+        else if (c == '\'' || c == '"')
+        {
+            quote = c;
+        }
+        else if (c == '#')
+        {
+            line = line.substr(0, i);
+            break;
+        }
+    }
+    const size_t end = line.find_last_not_of(" \t\r");
+    return end == string_view::npos ? string_view{} : line.substr(0, end + 1);
+}
+
+bool OpensBlock(string_view line)
+{
+    const string_view text = StripLine(line);
+    return !text.empty() && text.back() == ':';
+}
+} // namespace
+
+Session::Session(ostream &output) : context_(output)
+{
+}
+
+void Session::Execute(string_view block)
+{
+    executed_.push_back(parser_.Parse(block));
+    executed_.back()->Execute(closure_, context_);
+}
+
+const runtime::Closure &Session::GetClosure() const
+{
+    return closure_;
+}
+
+void Run(istream &input, ostream &output, bool prompt)
+{
+    Session session(output);
+    string line;
+    while (true)
+    {
+        if (prompt)
+        {
+            output << ">>> "sv << flush;
+        }
+        if (!getline(input, line))
+        {
+            break;
+        }
+
+        string block = line + '\n';
+        if (OpensBlock(line))
+        {
+            while (true)
+            {
+                if (prompt)
+                {
+                    output << "... "sv << flush;
+                }
+                if (!getline(input, line) || line.find_first_not_of(" \t\r"sv) == string::npos)
+                {
+                    break;
+                }
+                block += line;
+                block += '\n';
+            }
+        }
+
+        try
+        {
+            session.Execute(block);
+        }
+        catch (const exception &e)
+        {
+            output << "Error: "sv << e.what() << endl;
+        }
+        output << flush;
+    }
+    if (prompt)
+    {
+        output << endl;
+    }
+}
+
+} // namespace repl
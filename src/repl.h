@@ -0,0 +1,44 @@
+/*!
+ * \file repl.h
+ * \brief Interactive mode: statements are executed as soon as they are entered
+ */
+#pragma once
+
+#include "parse.h"
+#include "runtime.h"
+
+#include <iosfwd>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace repl
+{
+
+//! Keeps variables and classes between entered blocks
+class Session
+{
+  public:
+    explicit Session(std::ostream &output);
+
+    //! Parses and executes block of complete top-level statements. Parsing and execution errors are thrown,
+    //! session stays usable after them
+    void Execute(std::string_view block);
+
+    [[nodiscard]] const runtime::Closure &GetClosure() const;
+
+  private:
+    IncrementalParser parser_;
+    runtime::SimpleContext context_;
+    runtime::Closure closure_;
+    //! Constants are shared with closure rather than copied, so executed statements are kept
+    std::vector<std::unique_ptr<runtime::Executable>> executed_;
+};
+
+/*!
+ * Reads blocks from input and executes them until input is over. Line that opens block (ends with ':')
+ * is continued by following lines up to an empty one. Errors are reported to output and don't stop the session
+ */
+void Run(std::istream &input, std::ostream &output, bool prompt);
+
+} // namespace repl
@@ -1,5 +1,8 @@
 #include "runtime.h"
 
+#include "cycles.h"
+
+#include <algorithm>
 #include <cassert>
 #include <optional>
 #include <sstream>
@@ -9,9 +12,7 @@ using namespace std;
 namespace runtime
 {
 
-ObjectHolder::ObjectHolder(std::shared_ptr<Object> data) : data_(std::move(data))
-{
-}
+#ifdef MYTHON_TRACING_GC
 
 void ObjectHolder::AssertIsValid() const
 {
@@ -20,12 +21,36 @@ void ObjectHolder::AssertIsValid() const
 
 ObjectHolder ObjectHolder::Share(Object &object)
 {
-    return ObjectHolder(std::shared_ptr<Object>(&object, [](auto * /*p*/) { /* do nothing */ }));
+    return ObjectHolder(&object);
 }
 
-ObjectHolder ObjectHolder::None()
+#else
+
+namespace
 {
-    return {};
+
+//! Deleter of objects shared by ObjectHolder that doesn't own them
+struct KeepObject
+{
+    void operator()([[maybe_unused]] Object *object) const
+    {
+    }
+};
+
+} // namespace
+
+ObjectHolder::ObjectHolder(std::shared_ptr<Object> data) : data_(std::move(data))
+{
+}
+
+void ObjectHolder::AssertIsValid() const
+{
+    assert(data_ != nullptr);
+}
+
+ObjectHolder ObjectHolder::Share(Object &object)
+{
+    return ObjectHolder(std::shared_ptr<Object>(&object, KeepObject{}));
 }
 
 ObjectHolder::ObjectHolder(const ObjectHolder &other) = default;
@@ -39,6 +64,13 @@ ObjectHolder &ObjectHolder::operator=(ObjectHolder &&other) noexcept
     return *this;
 }
 
+#endif
+
+ObjectHolder ObjectHolder::None()
+{
+    return {};
+}
+
 Object &ObjectHolder::operator*() const
 {
     AssertIsValid();
@@ -53,7 +85,11 @@ Object *ObjectHolder::operator->() const
 
 Object *ObjectHolder::Get() const
 {
+#ifdef MYTHON_TRACING_GC
+    return data_;
+#else
     return data_.get();
+#endif
 }
 
 ObjectHolder::operator bool() const
@@ -61,6 +97,33 @@ ObjectHolder::operator bool() const
     return Get() != nullptr;
 }
 
+bool ObjectHolder::IsOwner() const
+{
+#ifdef MYTHON_TRACING_GC
+    return data_ != nullptr;
+#else
+    return data_ && !std::get_deleter<KeepObject>(data_);
+#endif
+}
+
+#ifndef MYTHON_TRACING_GC
+
+ObjectHolder Pin(ObjectHolder object)
+{
+    // Owners of constants keep them
+    return object;
+}
+
+#endif
+
+void RootedValues::Trace(Tracer &tracer) const
+{
+    for (const auto &value : values_)
+    {
+        tracer.Mark(value);
+    }
+}
+
 bool IsTrue(const ObjectHolder &object)
 {
     if (!object)
@@ -102,6 +165,11 @@ bool ClassInstance::HasMethod(const std::string &method, size_t argc) const
     return false;
 }
 
+const Class &ClassInstance::GetClass() const
+{
+    return class_;
+}
+
 Closure &ClassInstance::Fields()
 {
     return fields_;
@@ -116,19 +184,47 @@ ClassInstance::ClassInstance(const Class &cls) : class_{cls}
 {
 }
 
+#ifndef MYTHON_TRACING_GC
+
+ClassInstance::~ClassInstance()
+{
+    if (tracking_.generation >= 0)
+    {
+        UntrackInstance(*this);
+    }
+}
+
+#endif
+
 ObjectHolder ClassInstance::Call(const std::string &method, const std::vector<ObjectHolder> &args, Context &ctx)
 {
     if (!HasMethod(method, args.size()))
     {
         throw std::runtime_error("Method does not exist"s);
     }
-    const auto *method_ptr = class_.GetMethod(method);
+    return Call(*class_.GetMethod(method), args, ctx);
+}
+
+ObjectHolder ClassInstance::Call(const Method &method, const std::vector<ObjectHolder> &args, Context &ctx)
+{
+#ifndef MYTHON_TRACING_GC
+    // Instance is referred to by "self" that doesn't own it, so collector keeps it while method is executed
+    ++tracking_.calls;
+    struct Finish
+    {
+        ~Finish()
+        {
+            --calls;
+        }
+        size_t &calls;
+    } finish{tracking_.calls};
+#endif
     Closure closure = {{"self", ObjectHolder::Share(*this)}};
     for (size_t i{0}; i < args.size(); ++i)
     {
-        closure[method_ptr->formal_params[i]] = args[i];
+        closure[method.formal_params[i]] = args[i];
     }
-    ObjectHolder res = method_ptr->body->Execute(closure, ctx);
+    ObjectHolder res = method.body->Execute(closure, ctx);
     if (closure.at("self").Get() != this)
     {
         return closure.at("self");
@@ -163,6 +259,36 @@ const Method *Class::GetMethod(const std::string &name) const
     return name_;
 }
 
+const std::vector<Method> &Class::GetMethods() const
+{
+    return methods_;
+}
+
+std::vector<Method> &Class::GetMethods()
+{
+    return methods_;
+}
+
+void Class::RemoveMethods(const std::function<bool(const Method &)> &predicate)
+{
+    methods_.erase(std::remove_if(methods_.begin(), methods_.end(), predicate), methods_.end());
+    name_to_method_.clear();
+    for (size_t i = 0; i < methods_.size(); ++i)
+    {
+        name_to_method_[methods_[i].name] = i;
+    }
+}
+
+const Class *Class::GetParent() const
+{
+    return parent_;
+}
+
+void Class::SetParent(const Class *parent)
+{
+    parent_ = parent;
+}
+
 void Class::Print(ostream &os, [[maybe_unused]] Context &context)
 {
     os << "Class "sv << GetName();
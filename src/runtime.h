@@ -5,10 +5,12 @@
 #pragma once
 
 #include <cassert>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -30,11 +32,48 @@ class Context
 class Object
 {
   public:
+#ifdef MYTHON_TRACING_GC
+    Object() = default;
+    //! Copy of object is not allocated by heap until it's owned
+    Object([[maybe_unused]] const Object &other)
+    {
+    }
+    Object &operator=([[maybe_unused]] const Object &other)
+    {
+        return *this;
+    }
+#endif
     virtual ~Object() = default;
     //! Each object must have string representation, which can be printed
     virtual void Print(std::ostream &os, Context &context) = 0;
+
+#ifdef MYTHON_TRACING_GC
+  private:
+    friend class Heap;
+
+    //! Objects allocated by the heap are white until collector finds them reachable and makes them black
+    enum class Color : unsigned char
+    {
+        Unmanaged,
+        White,
+        Black,
+    };
+
+    Color color_ = Color::Unmanaged;
+#endif
 };
 
+class Class;
+class ClassInstance;
+
+#ifdef MYTHON_TRACING_GC
+//! Passes object owned by ObjectHolder and its size to the heap, which may collect garbage before, see cycles.h
+void ManageObject(Object *object, size_t size);
+#else
+//! Tracks instance owned by ObjectHolder for collector of cycles, which may run collection, see cycles.h
+void TrackInstance(const std::shared_ptr<ClassInstance> &instance);
+#endif
+
 //! Special wrapper, contains methods that make it easier to construct Objects and access their values.
 class ObjectHolder
 {
@@ -42,17 +81,47 @@ class ObjectHolder
     //! Create empty value
     ObjectHolder() = default;
 
+#ifdef MYTHON_TRACING_GC
+    ObjectHolder(const ObjectHolder &other) = default;
+    ObjectHolder &operator=(const ObjectHolder &other) = default;
+    ObjectHolder(ObjectHolder &&other) noexcept : data_(other.data_)
+    {
+        other.data_ = nullptr;
+    }
+    ObjectHolder &operator=(ObjectHolder &&other) noexcept
+    {
+        data_ = other.data_;
+        other.data_ = nullptr;
+        return *this;
+    }
+#else
     ObjectHolder(const ObjectHolder &other);
     ObjectHolder &operator=(const ObjectHolder &other);
     ObjectHolder(ObjectHolder &&other) noexcept;
     ObjectHolder &operator=(ObjectHolder &&other) noexcept;
+#endif
 
     //! Returns ObjectHolder that owns object of type T
     //! T - type derived from Object
     //! Object is copied or moved to heap
     template <typename T> [[nodiscard]] static ObjectHolder Own(T &&object)
     {
-        return ObjectHolder(std::make_shared<T>(std::forward<T>(object)));
+#ifdef MYTHON_TRACING_GC
+        // Classes are part of the program, they live as long as it does
+        auto *data = new std::decay_t<T>(std::forward<T>(object));
+        if constexpr (!std::is_same_v<std::decay_t<T>, Class>)
+        {
+            ManageObject(data, sizeof(*data));
+        }
+        return ObjectHolder(data);
+#else
+        auto data = std::make_shared<std::decay_t<T>>(std::forward<T>(object));
+        if constexpr (std::is_same_v<std::decay_t<T>, ClassInstance>)
+        {
+            TrackInstance(data);
+        }
+        return ObjectHolder(std::move(data));
+#endif
     }
 
     //! Returns non-owning ObjectHolder (shared_ptr with empty deleter), similar to weak_ptr
@@ -79,18 +148,89 @@ class ObjectHolder
     //! Returns true if ObjectHolder is not empty
     explicit operator bool() const;
 
+    //! Returns true if object is owned, false for None and ObjectHolder returned by Share
+    //! Objects are owned by the heap in tracing builds, so every object is
+    [[nodiscard]] bool IsOwner() const;
+
   private:
-    explicit ObjectHolder(std::shared_ptr<Object> data);
     void AssertIsValid() const;
 
+#ifdef MYTHON_TRACING_GC
+    explicit ObjectHolder(Object *data) : data_(data)
+    {
+    }
+
+    Object *data_ = nullptr;
+#else
+    explicit ObjectHolder(std::shared_ptr<Object> data);
+
     std::shared_ptr<Object> data_;
+#endif
 };
 
+//! Marks objects reachable from roots, it's implemented by the tracing collector
+class Tracer
+{
+  public:
+    virtual void Mark(const ObjectHolder &object) = 0;
+
+  protected:
+    ~Tracer() = default;
+};
+
+/*!
+ * Objects that are held outside of closures, i.e. by caches of compiled code, and that tracing collector marks
+ * as roots while they exist. Collector of reference cycles doesn't need them, nothing is registered then
+ */
+class Roots
+{
+  public:
+    virtual void Trace(Tracer &tracer) const = 0;
+
+#ifdef MYTHON_TRACING_GC
+  protected:
+    Roots();
+    Roots(const Roots &other);
+    Roots &operator=(const Roots &other);
+    ~Roots();
+
+    //! Stops marking of objects, i.e. for closure of object fields, which are traced through the object
+    void Unroot();
+
+  private:
+    friend class Heap;
+
+    Roots *prev_ = nullptr;
+    Roots *next_ = nullptr;
+    bool rooted_ = false;
+#else
+  protected:
+    ~Roots() = default;
+#endif
+};
+
+//! Keeps values, i.e. evaluated arguments of call, alive while they are not in any closure yet
+class RootedValues : private Roots
+{
+  public:
+    explicit RootedValues(const std::vector<ObjectHolder> &values) : values_(values)
+    {
+    }
+
+    void Trace(Tracer &tracer) const override;
+
+  private:
+    const std::vector<ObjectHolder> &values_;
+};
+
+//! Object lives as long as program does, used for constants of compiled code; returns object
+ObjectHolder Pin(ObjectHolder object);
+
 //! Stores value of type T
 template <typename T> class ValueObject : public Object
 {
   public:
-    ValueObject(T v) : value_(v)
+    ValueObject(T v) : value_(std::move(v))
     {
     }
 
@@ -108,8 +248,24 @@ template <typename T> class ValueObject : public Object
     T value_;
 };
 
+#ifdef MYTHON_TRACING_GC
+//! Symbols table, connects object name and its value
+//! Variables of program and of executed methods are roots of tracing collector
+class Closure : public std::unordered_map<std::string, ObjectHolder>, private Roots
+{
+  public:
+    using unordered_map::unordered_map;
+
+    void Trace(Tracer &tracer) const override;
+
+  private:
+    //! Fields of instances allocated from the heap are traced through instances
+    friend class Heap;
+};
+#else
 //! Symbols table, connects object name and its value
 using Closure = std::unordered_map<std::string, ObjectHolder>;
+#endif
 
 //! Checks whether object contains value convertible to boolean "True"
 //! Non-zero numbers, non-empty strings are "True", everything else is "False"
@@ -163,6 +319,20 @@ class Class : public Object
     //! Returns class name
     [[nodiscard]] const std::string &GetName() const;
 
+    //! Returns methods declared by class itself, without inherited ones
+    [[nodiscard]] const std::vector<Method> &GetMethods() const;
+    //! Same, method bodies may be replaced by passes over syntax tree
+    [[nodiscard]] std::vector<Method> &GetMethods();
+
+    //! Removes methods declared by class itself for which "predicate" returns true
+    void RemoveMethods(const std::function<bool(const Method &)> &predicate);
+
+    //! Returns parent class or nullptr
+    [[nodiscard]] const Class *GetParent() const;
+
+    //! Replaces parent class, used to bind parents that were not parsed yet when class was created
+    void SetParent(const Class *parent);
+
     //! prints "Class <name>"
     void Print(std::ostream &os, Context &context) override;
 
@@ -178,6 +348,9 @@ class ClassInstance : public Object
 {
   public:
     explicit ClassInstance(const Class &cls);
+#ifndef MYTHON_TRACING_GC
+    ~ClassInstance() override;
+#endif
 
     //! If objects has __str__ methods, outputs string representation, otherwise prints memory address
     void Print(std::ostream &os, Context &context) override;
@@ -188,9 +361,15 @@ class ClassInstance : public Object
      */
     ObjectHolder Call(const std::string &method, const std::vector<ObjectHolder> &args, Context &ctx);
 
+    //! Calls method found in advance, it must be the one class of instance has for its name and number of "args"
+    ObjectHolder Call(const Method &method, const std::vector<ObjectHolder> &args, Context &ctx);
+
     //! Checks if there is method that takes "argc" amount of arguments
     [[nodiscard]] bool HasMethod(const std::string &method, size_t argc) const;
 
+    //! Returns class of the object
+    [[nodiscard]] const Class &GetClass() const;
+
     //! Returns closure containing object fields
     [[nodiscard]] Closure &Fields();
     //! Returns constant closure containing object fields
@@ -199,6 +378,37 @@ class ClassInstance : public Object
   private:
     const Class &class_;
     Closure fields_;
+
+#ifndef MYTHON_TRACING_GC
+    friend class Collector;
+
+    //! State of instance kept by collector of cycles, copy of instance is not tracked
+    struct Tracking
+    {
+        Tracking() = default;
+        Tracking([[maybe_unused]] const Tracking &other)
+        {
+        }
+        Tracking &operator=([[maybe_unused]] const Tracking &other)
+        {
+            return *this;
+        }
+
+        //! Instance itself, number of its owners is found through it
+        std::weak_ptr<ClassInstance> self;
+        //! Neighbours in the list of generation
+        ClassInstance *prev = nullptr;
+        ClassInstance *next = nullptr;
+        //! Generation of tracked instance, -1 if it isn't tracked
+        int generation = -1;
+        //! Number of methods of instance being executed
+        size_t calls = 0;
+        //! References from outside of collected generations, used while collecting
+        long refs = 0;
+    };
+
+    Tracking tracking_;
+#endif
 };
 
 /*!
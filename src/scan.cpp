@@ -0,0 +1,222 @@
+#include "scan.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MINI_PYTHON_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace parse
+{
+
+namespace scan
+{
+
+namespace
+{
+
+size_t SkipSpacesScalar(string_view text, size_t pos)
+{
+    for (; pos < text.size() && text[pos] == ' '; ++pos)
+    {
+    }
+    return pos;
+}
+
+size_t FindScalar(string_view text, size_t pos, char ch)
+{
+    for (; pos < text.size() && text[pos] != ch; ++pos)
+    {
+    }
+    return pos;
+}
+
+size_t FindEitherScalar(string_view text, size_t pos, char first, char second)
+{
+    for (; pos < text.size() && text[pos] != first && text[pos] != second; ++pos)
+    {
+    }
+    return pos;
+}
+
+#ifdef MINI_PYTHON_X86_SIMD
+
+// Each function handles whole 16 or 32 bytes blocks and leaves the tail to its scalar counterpart.
+// Masks have bit set for every byte that stops the scan
+
+inline const __m128i *Block16(string_view text, size_t pos)
+{
+    return reinterpret_cast<const __m128i *>(text.data() + pos); // NOLINT
+}
+
+size_t SkipSpacesSse2(string_view text, size_t pos)
+{
+    const __m128i spaces = _mm_set1_epi8(' ');
+    for (; pos + 16 <= text.size(); pos += 16)
+    {
+        const __m128i block = _mm_loadu_si128(Block16(text, pos));
+        const unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, spaces))) & 0xFFFFU;
+        if (mask)
+        {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+    return SkipSpacesScalar(text, pos);
+}
+
+size_t FindSse2(string_view text, size_t pos, char ch)
+{
+    const __m128i needle = _mm_set1_epi8(ch);
+    for (; pos + 16 <= text.size(); pos += 16)
+    {
+        const __m128i block = _mm_loadu_si128(Block16(text, pos));
+        const auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+        if (mask)
+        {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+    return FindScalar(text, pos, ch);
+}
+
+size_t FindEitherSse2(string_view text, size_t pos, char first, char second)
+{
+    const __m128i first_needle = _mm_set1_epi8(first);
+    const __m128i second_needle = _mm_set1_epi8(second);
+    for (; pos + 16 <= text.size(); pos += 16)
+    {
+        const __m128i block = _mm_loadu_si128(Block16(text, pos));
+        const __m128i found = _mm_or_si128(_mm_cmpeq_epi8(block, first_needle), _mm_cmpeq_epi8(block, second_needle));
+        const auto mask = static_cast<unsigned>(_mm_movemask_epi8(found));
+        if (mask)
+        {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+    return FindEitherScalar(text, pos, first, second);
+}
+
+inline const __m256i *Block32(string_view text, size_t pos)
+{
+    return reinterpret_cast<const __m256i *>(text.data() + pos); // NOLINT
+}
+
+__attribute__((target("avx2"))) size_t SkipSpacesAvx2(string_view text, size_t pos)
+{
+    const __m256i spaces = _mm256_set1_epi8(' ');
+    for (; pos + 32 <= text.size(); pos += 32)
+    {
+        const __m256i block = _mm256_loadu_si256(Block32(text, pos));
+        const unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, spaces)));
+        if (mask)
+        {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+    return SkipSpacesSse2(text, pos);
+}
+
+__attribute__((target("avx2"))) size_t FindAvx2(string_view text, size_t pos, char ch)
+{
+    const __m256i needle = _mm256_set1_epi8(ch);
+    for (; pos + 32 <= text.size(); pos += 32)
+    {
+        const __m256i block = _mm256_loadu_si256(Block32(text, pos));
+        const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+        if (mask)
+        {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+    return FindSse2(text, pos, ch);
+}
+
+__attribute__((target("avx2"))) size_t FindEitherAvx2(string_view text, size_t pos, char first, char second)
+{
+    const __m256i first_needle = _mm256_set1_epi8(first);
+    const __m256i second_needle = _mm256_set1_epi8(second);
+    for (; pos + 32 <= text.size(); pos += 32)
+    {
+        const __m256i block = _mm256_loadu_si256(Block32(text, pos));
+        const __m256i found =
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, first_needle), _mm256_cmpeq_epi8(block, second_needle));
+        const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(found));
+        if (mask)
+        {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+    return FindEitherSse2(text, pos, first, second);
+}
+
+#endif
+
+struct Implementation
+{
+    Isa isa;
+    size_t (*skip_spaces)(string_view, size_t);
+    size_t (*find)(string_view, size_t, char);
+    size_t (*find_either)(string_view, size_t, char, char);
+};
+
+Implementation Select(Isa isa)
+{
+#ifdef MINI_PYTHON_X86_SIMD
+    if (isa == Isa::Avx2 && DetectIsa() == Isa::Avx2)
+    {
+        return {Isa::Avx2, SkipSpacesAvx2, FindAvx2, FindEitherAvx2};
+    }
+    if (isa != Isa::Scalar)
+    {
+        return {Isa::Sse2, SkipSpacesSse2, FindSse2, FindEitherSse2};
+    }
+#endif
+    return {Isa::Scalar, SkipSpacesScalar, FindScalar, FindEitherScalar};
+}
+
+Implementation &Active()
+{
+    static Implementation implementation = Select(DetectIsa());
+    return implementation;
+}
+
+} // namespace
+
+Isa DetectIsa()
+{
+#ifdef MINI_PYTHON_X86_SIMD
+    return __builtin_cpu_supports("avx2") ? Isa::Avx2 : Isa::Sse2;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+Isa ActiveIsa()
+{
+    return Active().isa;
+}
+
+void UseIsa(Isa isa)
+{
+    Active() = Select(isa);
+}
+
+size_t SkipSpaces(string_view text, size_t pos)
+{
+    return Active().skip_spaces(text, pos);
+}
+
+size_t Find(string_view text, size_t pos, char ch)
+{
+    return Active().find(text, pos, ch);
+}
+
+size_t FindEither(string_view text, size_t pos, char first, char second)
+{
+    return Active().find_either(text, pos, first, second);
+}
+
+} // namespace scan
+
+} // namespace parse
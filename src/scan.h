@@ -0,0 +1,45 @@
+/*!
+ * \file scan.h
+ * \brief Vectorized byte scanning used by lexer
+ */
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace parse
+{
+
+namespace scan
+{
+
+//! Instruction sets scanning functions can be built with
+enum class Isa
+{
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+//! Returns the best instruction set supported by both build and CPU
+Isa DetectIsa();
+
+//! Returns instruction set scanning functions currently use
+Isa ActiveIsa();
+
+//! Makes scanning functions use given instruction set, falls back to the best available one if it's unsupported.
+//! Not thread-safe, intended for tests and benchmarks
+void UseIsa(Isa isa);
+
+//! Returns position of the first symbol other than space starting from "pos" or text size if there is none
+size_t SkipSpaces(std::string_view text, size_t pos);
+
+//! Returns position of the first "ch" symbol starting from "pos" or text size if there is none
+size_t Find(std::string_view text, size_t pos, char ch);
+
+//! Returns position of the first "first" or "second" symbol starting from "pos" or text size if there is none
+size_t FindEither(std::string_view text, size_t pos, char first, char second);
+
+} // namespace scan
+
+} // namespace parse
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <memory>
 #include <sstream>
+#include <typeinfo>
 #include <utility>
 
 using namespace std;
@@ -24,8 +25,205 @@ namespace
 {
 const string ADD_METHOD = "__add__"s;
 const string INIT_METHOD = "__init__"s;
+
+//! Returns object if it is of type T exactly, it's cheaper than TryAs
+template <typename T> const T *ExactlyAs(const ObjectHolder &object)
+{
+    const runtime::Object *ptr = object.Get();
+    return ptr && typeid(*ptr) == typeid(T) ? static_cast<const T *>(ptr) : nullptr;
+}
+
+//! Returns operand of type T, or nullptr if its type is not proven and it has other type
+template <typename T> const T *OperandAs(const ObjectHolder &operand, bool proven)
+{
+    return proven ? static_cast<const T *>(operand.Get()) : ExactlyAs<T>(operand);
+}
+
+OperandTypes TypesOf(const ObjectHolder &lhs, const ObjectHolder &rhs)
+{
+    if (ExactlyAs<Number>(lhs) && ExactlyAs<Number>(rhs))
+    {
+        return OperandTypes::Numbers;
+    }
+    if (ExactlyAs<String>(lhs) && ExactlyAs<String>(rhs))
+    {
+        return OperandTypes::Strings;
+    }
+    return OperandTypes::Generic;
+}
 } // namespace
 
+bool Accept(const Statement &statement, Visitor &visitor)
+{
+    if (const auto *node = dynamic_cast<const Node *>(&statement))
+    {
+        node->Accept(visitor);
+        return true;
+    }
+    return false;
+}
+
+void TreeVisitor::VisitChild(const Statement &statement)
+{
+    ast::Accept(statement, *this);
+}
+
+void TreeVisitor::Visit([[maybe_unused]] const NumericConst &node)
+{
+}
+
+void TreeVisitor::Visit([[maybe_unused]] const StringConst &node)
+{
+}
+
+void TreeVisitor::Visit([[maybe_unused]] const BoolConst &node)
+{
+}
+
+void TreeVisitor::Visit([[maybe_unused]] const VariableValue &node)
+{
+}
+
+void TreeVisitor::Visit(const Assignment &node)
+{
+    VisitChild(node.GetValue());
+}
+
+void TreeVisitor::Visit(const FieldAssignment &node)
+{
+    VisitChild(node.GetObject());
+    VisitChild(node.GetValue());
+}
+
+void TreeVisitor::Visit([[maybe_unused]] const None &node)
+{
+}
+
+void TreeVisitor::Visit(const Print &node)
+{
+    for (const auto &arg : node.GetArgs())
+    {
+        VisitChild(*arg);
+    }
+}
+
+void TreeVisitor::Visit(const MethodCall &node)
+{
+    VisitChild(node.GetObject());
+    for (const auto &arg : node.GetArgs())
+    {
+        VisitChild(*arg);
+    }
+}
+
+void TreeVisitor::Visit(const NewInstance &node)
+{
+    for (const auto &arg : node.GetArgs())
+    {
+        VisitChild(*arg);
+    }
+}
+
+void TreeVisitor::Visit(const Stringify &node)
+{
+    VisitChild(node.GetArgument());
+}
+
+void TreeVisitor::Visit(const Add &node)
+{
+    VisitChild(node.GetLeft());
+    VisitChild(node.GetRight());
+}
+
+void TreeVisitor::Visit(const Sub &node)
+{
+    VisitChild(node.GetLeft());
+    VisitChild(node.GetRight());
+}
+
+void TreeVisitor::Visit(const Mult &node)
+{
+    VisitChild(node.GetLeft());
+    VisitChild(node.GetRight());
+}
+
+void TreeVisitor::Visit(const Div &node)
+{
+    VisitChild(node.GetLeft());
+    VisitChild(node.GetRight());
+}
+
+void TreeVisitor::Visit(const Or &node)
+{
+    VisitChild(node.GetLeft());
+    VisitChild(node.GetRight());
+}
+
+void TreeVisitor::Visit(const And &node)
+{
+    VisitChild(node.GetLeft());
+    VisitChild(node.GetRight());
+}
+
+void TreeVisitor::Visit(const Not &node)
+{
+    VisitChild(node.GetArgument());
+}
+
+void TreeVisitor::Visit(const Compound &node)
+{
+    for (const auto &statement : node.GetStatements())
+    {
+        VisitChild(*statement);
+    }
+}
+
+void TreeVisitor::Visit(const MethodBody &node)
+{
+    if (node.IsParsed())
+    {
+        VisitChild(node.GetBody());
+    }
+}
+
+void TreeVisitor::Visit(const Return &node)
+{
+    VisitChild(node.GetValue());
+}
+
+void TreeVisitor::Visit(const ClassDefinition &node)
+{
+    for (const auto &method : node.GetClass().TryAs<Class>()->GetMethods())
+    {
+        VisitChild(*method.body);
+    }
+}
+
+void TreeVisitor::Visit(const IfElse &node)
+{
+    VisitChild(node.GetCondition());
+    VisitChild(node.GetIfBody());
+    if (const Statement *else_body = node.GetElseBody())
+    {
+        VisitChild(*else_body);
+    }
+}
+
+void TreeVisitor::Visit(const Comparison &node)
+{
+    VisitChild(node.GetLeft());
+    VisitChild(node.GetRight());
+}
+
+void RewriteTree(unique_ptr<Statement> &statement, const Node::Rewriter &rewriter) // NOLINT
+{
+    if (auto *node = dynamic_cast<Node *>(statement.get()))
+    {
+        node->RewriteChildren([&rewriter](unique_ptr<Statement> &child) { RewriteTree(child, rewriter); });
+    }
+    rewriter(statement);
+}
+
 ObjectHolder Assignment::Execute(Closure &closure, Context &context)
 {
     closure[var_] = rv_->Execute(closure, context);
@@ -36,6 +234,26 @@ Assignment::Assignment(std::string var, std::unique_ptr<Statement> &&rv) : var_(
 {
 }
 
+void Assignment::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
+void Assignment::RewriteChildren(const Rewriter &rewriter)
+{
+    rewriter(rv_);
+}
+
+const std::string &Assignment::GetVariable() const
+{
+    return var_;
+}
+
+const Statement &Assignment::GetValue() const
+{
+    return *rv_;
+}
+
 VariableValue::VariableValue(const std::string &name) : ids_({name})
 {
 }
@@ -68,6 +286,16 @@ ObjectHolder VariableValue::Execute(Closure &closure, [[maybe_unused]] Context &
     return obj;
 }
 
+void VariableValue::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
+const std::vector<std::string> &VariableValue::GetIds() const
+{
+    return ids_;
+}
+
 unique_ptr<Print> Print::Variable(const std::string &name)
 {
     return make_unique<Print>(std::make_unique<VariableValue>(name));
@@ -103,6 +331,24 @@ ObjectHolder Print::Execute(Closure &closure, Context &context)
     return ObjectHolder::None();
 }
 
+void Print::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
+void Print::RewriteChildren(const Rewriter &rewriter)
+{
+    for (auto &arg : args_)
+    {
+        rewriter(arg);
+    }
+}
+
+const std::vector<std::unique_ptr<Statement>> &Print::GetArgs() const
+{
+    return args_;
+}
+
 MethodCall::MethodCall(std::unique_ptr<Statement> &&object, std::string method,
                        std::vector<std::unique_ptr<Statement>> &&args)
     : object_(std::move(object)), method_(std::move(method)), args_(std::move(args))
@@ -112,16 +358,68 @@ MethodCall::MethodCall(std::unique_ptr<Statement> &&object, std::string method,
 ObjectHolder MethodCall::Execute(Closure &closure, Context &context)
 {
     vector<ObjectHolder> curr_args;
+    const runtime::RootedValues rooted(curr_args);
     for (auto &arg : args_)
     {
         curr_args.push_back(arg->Execute(closure, context));
     }
-    return object_->Execute(closure, context).TryAs<ClassInstance>()->Call(method_, curr_args, context);
+    auto *instance = object_->Execute(closure, context).TryAs<ClassInstance>();
+    ObserveReceiver(instance->GetClass());
+    return instance->Call(method_, curr_args, context);
+}
+
+void MethodCall::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
+void MethodCall::RewriteChildren(const Rewriter &rewriter)
+{
+    // Arguments are computed before object
+    for (auto &arg : args_)
+    {
+        rewriter(arg);
+    }
+    rewriter(object_);
+}
+
+const Statement &MethodCall::GetObject() const
+{
+    return *object_;
+}
+
+const std::string &MethodCall::GetMethod() const
+{
+    return method_;
+}
+
+const std::vector<std::unique_ptr<Statement>> &MethodCall::GetArgs() const
+{
+    return args_;
+}
+
+const runtime::Class *MethodCall::GetReceiverClass() const
+{
+    return receiver_;
+}
+
+void MethodCall::ObserveReceiver(const runtime::Class &cls)
+{
+    if (receiver_ == &cls || polymorphic_)
+    {
+        return;
+    }
+    polymorphic_ = receiver_ != nullptr;
+    receiver_ = polymorphic_ ? nullptr : &cls;
 }
 
 ObjectHolder Stringify::Execute(Closure &closure, Context &context)
 {
-    ObjectHolder obj = argument_->Execute(closure, context);
+    return Compute(argument_->Execute(closure, context), context);
+}
+
+ObjectHolder Stringify::Compute(const ObjectHolder &obj, Context &context)
+{
     ostringstream os;
     if (!obj)
     {
@@ -139,10 +437,44 @@ ObjectHolder Stringify::Execute(Closure &closure, Context &context)
     return ObjectHolder::Own(String(os.str()));
 }
 
+void Stringify::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
+void UnaryOperation::RewriteChildren(const Rewriter &rewriter)
+{
+    rewriter(argument_);
+}
+
 ObjectHolder Add::Execute(Closure &closure, Context &context)
 {
-    ObjectHolder left = left_->Execute(closure, context), right = right_->Execute(closure, context);
+    ObjectHolder left = left_->Execute(closure, context);
+    ObjectHolder right = right_->Execute(closure, context);
+    if (operand_types_ == OperandTypes::Numbers)
+    {
+        const auto *lhs = OperandAs<Number>(left, operand_types_proven_);
+        const auto *rhs = OperandAs<Number>(right, operand_types_proven_);
+        if (lhs && rhs)
+        {
+            return ObjectHolder::Own(Number(rhs->GetValue() + lhs->GetValue()));
+        }
+    }
+    else if (operand_types_ == OperandTypes::Strings)
+    {
+        const auto *lhs = OperandAs<String>(left, operand_types_proven_);
+        const auto *rhs = OperandAs<String>(right, operand_types_proven_);
+        if (lhs && rhs)
+        {
+            return ObjectHolder::Own(String(lhs->GetValue() + rhs->GetValue()));
+        }
+    }
+    ObserveOperands(left, right);
+    return Compute(left, right, context);
+}
 
+ObjectHolder Add::Compute(const ObjectHolder &left, const ObjectHolder &right, Context &context)
+{
     if (auto *lp = left.TryAs<String>())
     {
         if (auto *rp = right.TryAs<String>())
@@ -173,10 +505,59 @@ ObjectHolder Add::Execute(Closure &closure, Context &context)
     throw runtime_error("Incorrect addition");
 }
 
+void Add::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
+void BinaryOperation::RewriteChildren(const Rewriter &rewriter)
+{
+    rewriter(left_);
+    rewriter(right_);
+}
+
+void BinaryOperation::ProveOperandTypes(OperandTypes types)
+{
+    if (operand_types_ != OperandTypes::Generic)
+    {
+        operand_types_ = types;
+        operand_types_proven_ = true;
+    }
+}
+
+void BinaryOperation::ExpectOperandTypes(OperandTypes types)
+{
+    if (operand_types_ == OperandTypes::Unknown)
+    {
+        operand_types_ = types;
+    }
+}
+
+void BinaryOperation::ObserveOperands(const ObjectHolder &lhs, const ObjectHolder &rhs)
+{
+    operand_types_ = operand_types_ == OperandTypes::Unknown ? TypesOf(lhs, rhs) : OperandTypes::Generic;
+}
+
 ObjectHolder Sub::Execute(Closure &closure, Context &context)
 {
-    auto *left = left_->Execute(closure, context).TryAs<Number>(),
-         *right = right_->Execute(closure, context).TryAs<Number>();
+    ObjectHolder left = left_->Execute(closure, context);
+    ObjectHolder right = right_->Execute(closure, context);
+    if (operand_types_ == OperandTypes::Numbers)
+    {
+        const auto *lhs = OperandAs<Number>(left, operand_types_proven_);
+        const auto *rhs = OperandAs<Number>(right, operand_types_proven_);
+        if (lhs && rhs)
+        {
+            return ObjectHolder::Own(Number(lhs->GetValue() - rhs->GetValue()));
+        }
+    }
+    ObserveOperands(left, right);
+    return Compute(left, right, context);
+}
+
+ObjectHolder Sub::Compute(const ObjectHolder &lhs, const ObjectHolder &rhs, [[maybe_unused]] Context &context)
+{
+    auto *left = lhs.TryAs<Number>(), *right = rhs.TryAs<Number>();
     if (left && right)
     {
         return ObjectHolder::Own(Number(left->GetValue() - right->GetValue()));
@@ -184,10 +565,31 @@ ObjectHolder Sub::Execute(Closure &closure, Context &context)
     throw runtime_error("Incorrect subtraction");
 }
 
+void Sub::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
 ObjectHolder Mult::Execute(Closure &closure, Context &context)
 {
-    auto *left = left_->Execute(closure, context).TryAs<Number>(),
-         *right = right_->Execute(closure, context).TryAs<Number>();
+    ObjectHolder left = left_->Execute(closure, context);
+    ObjectHolder right = right_->Execute(closure, context);
+    if (operand_types_ == OperandTypes::Numbers)
+    {
+        const auto *lhs = OperandAs<Number>(left, operand_types_proven_);
+        const auto *rhs = OperandAs<Number>(right, operand_types_proven_);
+        if (lhs && rhs)
+        {
+            return ObjectHolder::Own(Number(lhs->GetValue() * rhs->GetValue()));
+        }
+    }
+    ObserveOperands(left, right);
+    return Compute(left, right, context);
+}
+
+ObjectHolder Mult::Compute(const ObjectHolder &lhs, const ObjectHolder &rhs, [[maybe_unused]] Context &context)
+{
+    auto *left = lhs.TryAs<Number>(), *right = rhs.TryAs<Number>();
     if (left && right)
     {
         return ObjectHolder::Own(Number(left->GetValue() * right->GetValue()));
@@ -195,10 +597,31 @@ ObjectHolder Mult::Execute(Closure &closure, Context &context)
     throw runtime_error("Incorrect multiplication");
 }
 
+void Mult::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
 ObjectHolder Div::Execute(Closure &closure, Context &context)
 {
-    auto *left = left_->Execute(closure, context).TryAs<Number>(),
-         *right = right_->Execute(closure, context).TryAs<Number>();
+    ObjectHolder left = left_->Execute(closure, context);
+    ObjectHolder right = right_->Execute(closure, context);
+    if (operand_types_ == OperandTypes::Numbers)
+    {
+        const auto *lhs = OperandAs<Number>(left, operand_types_proven_);
+        const auto *rhs = OperandAs<Number>(right, operand_types_proven_);
+        if (lhs && rhs && rhs->GetValue() != 0)
+        {
+            return ObjectHolder::Own(Number(lhs->GetValue() / rhs->GetValue()));
+        }
+    }
+    ObserveOperands(left, right);
+    return Compute(left, right, context);
+}
+
+ObjectHolder Div::Compute(const ObjectHolder &lhs, const ObjectHolder &rhs, [[maybe_unused]] Context &context)
+{
+    auto *left = lhs.TryAs<Number>(), *right = rhs.TryAs<Number>();
     if (left && right)
     {
         if (right->GetValue())
@@ -209,6 +632,11 @@ ObjectHolder Div::Execute(Closure &closure, Context &context)
     throw runtime_error("Incorrect division");
 }
 
+void Div::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
 ObjectHolder Compound::Execute(Closure &closure, Context &context)
 {
     for (const auto &st : statements_)
@@ -222,12 +650,50 @@ ObjectHolder Compound::Execute(Closure &closure, Context &context)
     return ObjectHolder::None();
 }
 
+void Compound::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
+void Compound::RewriteChildren(const Rewriter &rewriter)
+{
+    for (auto &statement : statements_)
+    {
+        rewriter(statement);
+    }
+}
+
+const std::vector<std::unique_ptr<Statement>> &Compound::GetStatements() const
+{
+    return statements_;
+}
+
+std::vector<std::unique_ptr<Statement>> &Compound::GetStatements()
+{
+    return statements_;
+}
+
 ObjectHolder Return::Execute(Closure &closure, Context &context)
 {
     closure["returned_value"] = statement_->Execute(closure, context);
     return ObjectHolder::None();
 }
 
+void Return::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
+void Return::RewriteChildren(const Rewriter &rewriter)
+{
+    rewriter(statement_);
+}
+
+const Statement &Return::GetValue() const
+{
+    return *statement_;
+}
+
 ClassDefinition::ClassDefinition(ObjectHolder cls) : cls_(std::move(cls))
 {
 }
@@ -238,6 +704,24 @@ ObjectHolder ClassDefinition::Execute(Closure &closure, [[maybe_unused]] Context
     return ObjectHolder::None();
 }
 
+void ClassDefinition::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
+void ClassDefinition::RewriteChildren(const Rewriter &rewriter)
+{
+    for (auto &method : cls_.TryAs<Class>()->GetMethods())
+    {
+        rewriter(method.body);
+    }
+}
+
+const ObjectHolder &ClassDefinition::GetClass() const
+{
+    return cls_;
+}
+
 FieldAssignment::FieldAssignment(VariableValue object, std::string field_name, std::unique_ptr<Statement> &&rv)
     : object_(std::move(object)), field_name_(std::move(field_name)), rv_(std::move(rv))
 {
@@ -250,6 +734,31 @@ ObjectHolder FieldAssignment::Execute(Closure &closure, Context &context)
     return fields.at(field_name_);
 }
 
+void FieldAssignment::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
+void FieldAssignment::RewriteChildren(const Rewriter &rewriter)
+{
+    rewriter(rv_);
+}
+
+const VariableValue &FieldAssignment::GetObject() const
+{
+    return object_;
+}
+
+const std::string &FieldAssignment::GetField() const
+{
+    return field_name_;
+}
+
+const Statement &FieldAssignment::GetValue() const
+{
+    return *rv_;
+}
+
 IfElse::IfElse(std::unique_ptr<Statement> &&condition, std::unique_ptr<Statement> &&if_body,
                std::unique_ptr<Statement> &&else_body)
     : condition_(std::move(condition)), if_body_(std::move(if_body)), else_body_(std::move(else_body))
@@ -258,7 +767,8 @@ IfElse::IfElse(std::unique_ptr<Statement> &&condition, std::unique_ptr<Statement
 
 ObjectHolder IfElse::Execute(Closure &closure, Context &context)
 {
-    if (IsTrue(condition_->Execute(closure, context)))
+    const ObjectHolder condition = condition_->Execute(closure, context);
+    if (bool_condition_ ? static_cast<const Bool *>(condition.Get())->GetValue() : IsTrue(condition))
     {
         if_body_->Execute(closure, context);
     }
@@ -269,6 +779,41 @@ ObjectHolder IfElse::Execute(Closure &closure, Context &context)
     return ObjectHolder::None();
 }
 
+void IfElse::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
+void IfElse::ProveBoolCondition()
+{
+    bool_condition_ = true;
+}
+
+void IfElse::RewriteChildren(const Rewriter &rewriter)
+{
+    rewriter(condition_);
+    rewriter(if_body_);
+    if (else_body_)
+    {
+        rewriter(else_body_);
+    }
+}
+
+const Statement &IfElse::GetCondition() const
+{
+    return *condition_;
+}
+
+const Statement &IfElse::GetIfBody() const
+{
+    return *if_body_;
+}
+
+const Statement *IfElse::GetElseBody() const
+{
+    return else_body_.get();
+}
+
 ObjectHolder Or::Execute(Closure &closure, Context &context)
 {
     bool left = IsTrue(left_->Execute(closure, context));
@@ -279,6 +824,11 @@ ObjectHolder Or::Execute(Closure &closure, Context &context)
     return ObjectHolder::Own(Bool(true));
 }
 
+void Or::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
 ObjectHolder And::Execute(Closure &closure, Context &context)
 {
     bool left = IsTrue(left_->Execute(closure, context));
@@ -289,35 +839,132 @@ ObjectHolder And::Execute(Closure &closure, Context &context)
     return ObjectHolder::Own(Bool(false));
 }
 
+void And::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
 ObjectHolder Not::Execute(Closure &closure, Context &context)
 {
     return ObjectHolder::Own(Bool(!IsTrue(argument_->Execute(closure, context))));
 }
 
+void Not::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
+struct Comparison::ValueComparators
+{
+    using ComparatorFunction = bool (*)(const ObjectHolder &, const ObjectHolder &, Context &);
+
+    ComparatorFunction function;
+    bool (*numbers)(int, int);
+    bool (*strings)(const string &, const string &);
+};
+
 Comparison::Comparison(Comparator cmp, unique_ptr<Statement> &&lhs, unique_ptr<Statement> &&rhs)
-    : BinaryOperation(std::move(lhs), std::move(rhs)), cmp_(std::move(cmp))
+    : BinaryOperation(std::move(lhs), std::move(rhs)), cmp_(std::move(cmp)), values_(nullptr)
 {
+    // Every runtime comparison of two numbers or two strings is comparison of their values
+    static const ValueComparators comparators[] = {
+        {runtime::Equal, [](int lhs, int rhs) { return lhs == rhs; },
+         [](const string &lhs, const string &rhs) { return lhs == rhs; }},
+        {runtime::NotEqual, [](int lhs, int rhs) { return lhs != rhs; },
+         [](const string &lhs, const string &rhs) { return lhs != rhs; }},
+        {runtime::Less, [](int lhs, int rhs) { return lhs < rhs; },
+         [](const string &lhs, const string &rhs) { return lhs < rhs; }},
+        {runtime::Greater, [](int lhs, int rhs) { return lhs > rhs; },
+         [](const string &lhs, const string &rhs) { return lhs > rhs; }},
+        {runtime::LessOrEqual, [](int lhs, int rhs) { return lhs <= rhs; },
+         [](const string &lhs, const string &rhs) { return lhs <= rhs; }},
+        {runtime::GreaterOrEqual, [](int lhs, int rhs) { return lhs >= rhs; },
+         [](const string &lhs, const string &rhs) { return lhs >= rhs; }},
+    };
+    if (const auto *function = cmp_.target<ValueComparators::ComparatorFunction>())
+    {
+        for (const auto &comparator : comparators)
+        {
+            if (*function == comparator.function)
+            {
+                values_ = &comparator;
+            }
+        }
+    }
+    // Custom comparator is never specialized
+    operand_types_ = values_ ? OperandTypes::Unknown : OperandTypes::Generic;
 }
 
 ObjectHolder Comparison::Execute(Closure &closure, Context &context)
 {
-    return ObjectHolder::Own(Bool(cmp_(left_->Execute(closure, context), right_->Execute(closure, context), context)));
+    ObjectHolder left = left_->Execute(closure, context);
+    return ObjectHolder::Own(Bool(Compare(left, right_->Execute(closure, context), context)));
+}
+
+bool Comparison::Compare(const ObjectHolder &lhs, const ObjectHolder &rhs, Context &context)
+{
+    if (operand_types_ == OperandTypes::Numbers)
+    {
+        const auto *left = OperandAs<Number>(lhs, operand_types_proven_);
+        const auto *right = OperandAs<Number>(rhs, operand_types_proven_);
+        if (left && right)
+        {
+            return values_->numbers(left->GetValue(), right->GetValue());
+        }
+    }
+    else if (operand_types_ == OperandTypes::Strings)
+    {
+        const auto *left = OperandAs<String>(lhs, operand_types_proven_);
+        const auto *right = OperandAs<String>(rhs, operand_types_proven_);
+        if (left && right)
+        {
+            return values_->strings(left->GetValue(), right->GetValue());
+        }
+    }
+    ObserveOperands(lhs, rhs);
+    return cmp_(lhs, rhs, context);
+}
+
+bool Comparison::ComparesValues() const
+{
+    return values_ != nullptr;
+}
+
+bool Comparison::CompareNumbers(int lhs, int rhs) const
+{
+    return values_->numbers(lhs, rhs);
+}
+
+void Comparison::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
+const Comparison::Comparator &Comparison::GetComparator() const
+{
+    return cmp_;
 }
 
 NewInstance::NewInstance(const runtime::Class &class_, std::vector<std::unique_ptr<Statement>> &&args)
-    : class_(class_), args_(std::move(args))
+    : class_(&class_), args_(std::move(args))
+{
+}
+
+NewInstance::NewInstance(const runtime::Class &class_) : class_(&class_)
 {
 }
 
-NewInstance::NewInstance(const runtime::Class &class_) : class_(class_)
+void NewInstance::SetClass(const runtime::Class &class_)
 {
+    this->class_ = &class_;
 }
 
 ObjectHolder NewInstance::Execute(Closure &closure, Context &context)
 {
-    ObjectHolder obj = ObjectHolder::Own(ClassInstance(class_));
-    const Method *method = class_.GetMethod(INIT_METHOD);
+    ObjectHolder obj = ObjectHolder::Own(ClassInstance(*class_));
+    const Method *method = class_->GetMethod(INIT_METHOD);
     vector<ObjectHolder> args;
+    const runtime::RootedValues rooted(args);
     if (!method || method->formal_params.size() != args_.size())
     {
         return obj;
@@ -333,13 +980,40 @@ ObjectHolder NewInstance::Execute(Closure &closure, Context &context)
     return obj;
 }
 
+void NewInstance::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
+void NewInstance::RewriteChildren(const Rewriter &rewriter)
+{
+    for (auto &arg : args_)
+    {
+        rewriter(arg);
+    }
+}
+
+const runtime::Class &NewInstance::GetClass() const
+{
+    return *class_;
+}
+
+const std::vector<std::unique_ptr<Statement>> &NewInstance::GetArgs() const
+{
+    return args_;
+}
+
 MethodBody::MethodBody(std::unique_ptr<Statement> &&body) : body_(std::move(body))
 {
 }
 
+MethodBody::MethodBody(BodyParser parser) : parser_(std::move(parser))
+{
+}
+
 ObjectHolder MethodBody::Execute(Closure &closure, Context &context)
 {
-    body_->Execute(closure, context);
+    Body().Execute(closure, context);
     if (closure.count("returned_value"))
     {
         return closure.at("returned_value");
@@ -347,4 +1021,37 @@ ObjectHolder MethodBody::Execute(Closure &closure, Context &context)
     return ObjectHolder::None();
 }
 
+void MethodBody::Accept(Visitor &visitor) const
+{
+    visitor.Visit(*this);
+}
+
+void MethodBody::RewriteChildren(const Rewriter &rewriter)
+{
+    if (body_)
+    {
+        rewriter(body_);
+    }
+}
+
+const Statement &MethodBody::GetBody() const
+{
+    return Body();
+}
+
+Statement &MethodBody::Body() const
+{
+    if (!body_)
+    {
+        body_ = parser_();
+        parser_ = nullptr;
+    }
+    return *body_;
+}
+
+bool MethodBody::IsParsed() const
+{
+    return body_ != nullptr;
+}
+
 } // namespace ast
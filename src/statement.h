@@ -14,10 +14,134 @@ namespace ast
 
 using Statement = runtime::Executable;
 
+template <typename T> class ValueStatement;
+using NumericConst = ValueStatement<runtime::Number>;
+using StringConst = ValueStatement<runtime::String>;
+using BoolConst = ValueStatement<runtime::Bool>;
+class VariableValue;
+class Assignment;
+class FieldAssignment;
+class None;
+class Print;
+class MethodCall;
+class NewInstance;
+class Stringify;
+class Add;
+class Sub;
+class Mult;
+class Div;
+class Or;
+class And;
+class Not;
+class Compound;
+class MethodBody;
+class Return;
+class ClassDefinition;
+class IfElse;
+class Comparison;
+
+//! Operation over syntax tree, every node calls overload for its own type
+class Visitor
+{
+  public:
+    virtual ~Visitor() = default;
+
+    virtual void Visit(const NumericConst &node) = 0;
+    virtual void Visit(const StringConst &node) = 0;
+    virtual void Visit(const BoolConst &node) = 0;
+    virtual void Visit(const VariableValue &node) = 0;
+    virtual void Visit(const Assignment &node) = 0;
+    virtual void Visit(const FieldAssignment &node) = 0;
+    virtual void Visit(const None &node) = 0;
+    virtual void Visit(const Print &node) = 0;
+    virtual void Visit(const MethodCall &node) = 0;
+    virtual void Visit(const NewInstance &node) = 0;
+    virtual void Visit(const Stringify &node) = 0;
+    virtual void Visit(const Add &node) = 0;
+    virtual void Visit(const Sub &node) = 0;
+    virtual void Visit(const Mult &node) = 0;
+    virtual void Visit(const Div &node) = 0;
+    virtual void Visit(const Or &node) = 0;
+    virtual void Visit(const And &node) = 0;
+    virtual void Visit(const Not &node) = 0;
+    virtual void Visit(const Compound &node) = 0;
+    virtual void Visit(const MethodBody &node) = 0;
+    virtual void Visit(const Return &node) = 0;
+    virtual void Visit(const ClassDefinition &node) = 0;
+    virtual void Visit(const IfElse &node) = 0;
+    virtual void Visit(const Comparison &node) = 0;
+};
+
+//! Syntax tree node. Statements that are not nodes (i.e. built-in method bodies) can't be visited
+class Node : public Statement
+{
+  public:
+    //! Receives child statement that may be replaced
+    using Rewriter = std::function<void(std::unique_ptr<Statement> &)>;
+
+    virtual void Accept(Visitor &visitor) const = 0;
+
+    /*!
+     * Calls rewriter for every child statement in order of execution. Class definition passes method bodies
+     * of its class, method body that is not parsed yet has no children
+     */
+    virtual void RewriteChildren([[maybe_unused]] const Rewriter &rewriter)
+    {
+    }
+};
+
+//! Calls visitor for statement, returns false if statement is not a syntax tree node
+bool Accept(const Statement &statement, Visitor &visitor);
+
+/*!
+ * Visitor that visits children of every node in order of execution, derived visitor overrides nodes it's
+ * interested in and calls overload of this class to visit their children. Class definition visits method
+ * bodies of its class, method body that is not parsed yet has no children, statements that are not nodes
+ * are skipped
+ */
+class TreeVisitor : public Visitor
+{
+  public:
+    void Visit(const NumericConst &node) override;
+    void Visit(const StringConst &node) override;
+    void Visit(const BoolConst &node) override;
+    void Visit(const VariableValue &node) override;
+    void Visit(const Assignment &node) override;
+    void Visit(const FieldAssignment &node) override;
+    void Visit(const None &node) override;
+    void Visit(const Print &node) override;
+    void Visit(const MethodCall &node) override;
+    void Visit(const NewInstance &node) override;
+    void Visit(const Stringify &node) override;
+    void Visit(const Add &node) override;
+    void Visit(const Sub &node) override;
+    void Visit(const Mult &node) override;
+    void Visit(const Div &node) override;
+    void Visit(const Or &node) override;
+    void Visit(const And &node) override;
+    void Visit(const Not &node) override;
+    void Visit(const Compound &node) override;
+    void Visit(const MethodBody &node) override;
+    void Visit(const Return &node) override;
+    void Visit(const ClassDefinition &node) override;
+    void Visit(const IfElse &node) override;
+    void Visit(const Comparison &node) override;
+
+  protected:
+    //! Visits child statement, statement that is not a node is skipped
+    virtual void VisitChild(const Statement &statement);
+};
+
+/*!
+ * Calls rewriter for statement and every statement below it, children are rewritten before their parent.
+ * Statements that are not nodes have no children
+ */
+void RewriteTree(std::unique_ptr<Statement> &statement, const Node::Rewriter &rewriter);
+
 /*!
  * Statement that returns value of type T. This is used to create constants.
  */
-template <typename T> class ValueStatement : public Statement
+template <typename T> class ValueStatement : public Node
 {
   public:
     explicit ValueStatement(T v) : value_(std::move(v))
@@ -30,19 +154,25 @@ template <typename T> class ValueStatement : public Statement
         return runtime::ObjectHolder::Share(value_);
     }
 
+    void Accept(Visitor &visitor) const override
+    {
+        visitor.Visit(*this);
+    }
+
+    [[nodiscard]] const T &GetValue() const
+    {
+        return value_;
+    }
+
   private:
     T value_;
 };
 
-using NumericConst = ValueStatement<runtime::Number>;
-using StringConst = ValueStatement<runtime::String>;
-using BoolConst = ValueStatement<runtime::Bool>;
-
 /*!
  * Computes variable or object methods call chain.
  * Example: x = circle.center.x where circle.center.x - call chain
  */
-class VariableValue : public Statement
+class VariableValue : public Node
 {
   public:
     explicit VariableValue(const std::string &name);
@@ -50,31 +180,48 @@ class VariableValue : public Statement
 
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
+    void Accept(Visitor &visitor) const override;
+
+    [[nodiscard]] const std::vector<std::string> &GetIds() const;
+
   private:
     std::vector<std::string> ids_;
 };
 
 //! Assigns the value of the "rv" statement to the variable "var"
-class Assignment : public Statement
+class Assignment : public Node
 {
   public:
     Assignment(std::string var, std::unique_ptr<Statement> &&rv);
 
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
+    void Accept(Visitor &visitor) const override;
+    void RewriteChildren(const Rewriter &rewriter) override;
+
+    [[nodiscard]] const std::string &GetVariable() const;
+    [[nodiscard]] const Statement &GetValue() const;
+
   private:
     std::string var_;
     std::unique_ptr<Statement> rv_;
 };
 
 //! Assigns value of the "rv" to "object.field_name" field
-class FieldAssignment : public Statement
+class FieldAssignment : public Node
 {
   public:
     FieldAssignment(VariableValue object, std::string field_name, std::unique_ptr<Statement> &&rv);
 
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
+    void Accept(Visitor &visitor) const override;
+    void RewriteChildren(const Rewriter &rewriter) override;
+
+    [[nodiscard]] const VariableValue &GetObject() const;
+    [[nodiscard]] const std::string &GetField() const;
+    [[nodiscard]] const Statement &GetValue() const;
+
   private:
     VariableValue object_;
     std::string field_name_;
@@ -82,7 +229,7 @@ class FieldAssignment : public Statement
 };
 
 //! None value
-class None : public Statement
+class None : public Node
 {
   public:
     runtime::ObjectHolder Execute([[maybe_unused]] runtime::Closure &closure,
@@ -90,10 +237,15 @@ class None : public Statement
     {
         return {};
     }
+
+    void Accept(Visitor &visitor) const override
+    {
+        visitor.Visit(*this);
+    }
 };
 
 //! print command
-class Print : public Statement
+class Print : public Node
 {
   public:
     //! Initializes print command to output value of the "argument" statement
@@ -107,22 +259,41 @@ class Print : public Statement
     //! Print outputs to stream given by "context"
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
+    void Accept(Visitor &visitor) const override;
+    void RewriteChildren(const Rewriter &rewriter) override;
+
+    [[nodiscard]] const std::vector<std::unique_ptr<Statement>> &GetArgs() const;
+
   private:
     std::vector<std::unique_ptr<Statement>> args_;
 };
 
 //! Calls method "object.method" with a given arguments "args"
-class MethodCall : public Statement
+class MethodCall : public Node
 {
   public:
     MethodCall(std::unique_ptr<Statement> &&object, std::string method, std::vector<std::unique_ptr<Statement>> &&args);
 
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
+    void Accept(Visitor &visitor) const override;
+    void RewriteChildren(const Rewriter &rewriter) override;
+
+    [[nodiscard]] const Statement &GetObject() const;
+    [[nodiscard]] const std::string &GetMethod() const;
+    [[nodiscard]] const std::vector<std::unique_ptr<Statement>> &GetArgs() const;
+
+    //! Returns class of every object method was called for, nullptr if there were no calls or different classes
+    [[nodiscard]] const runtime::Class *GetReceiverClass() const;
+    //! Records class of object method is called for
+    void ObserveReceiver(const runtime::Class &cls);
+
   private:
     std::unique_ptr<Statement> object_;
     std::string method_;
     std::vector<std::unique_ptr<Statement>> args_;
+    const runtime::Class *receiver_ = nullptr;
+    bool polymorphic_ = false;
 };
 
 /*!
@@ -131,7 +302,7 @@ class MethodCall : public Statement
  * of arguments, then an instance of the class is created without calling the constructor (the object fields
  * will not be initialized):
  */
-class NewInstance : public Statement
+class NewInstance : public Node
 {
   public:
     explicit NewInstance(const runtime::Class &class_);
@@ -139,19 +310,35 @@ class NewInstance : public Statement
     //! Returns object containing value of type ClassInstance
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
+    //! Replaces instantiated class, used to bind classes that were not parsed yet when node was created
+    void SetClass(const runtime::Class &class_);
+
+    void Accept(Visitor &visitor) const override;
+    void RewriteChildren(const Rewriter &rewriter) override;
+
+    [[nodiscard]] const runtime::Class &GetClass() const;
+    [[nodiscard]] const std::vector<std::unique_ptr<Statement>> &GetArgs() const;
+
   private:
-    const runtime::Class &class_;
+    const runtime::Class *class_;
     std::vector<std::unique_ptr<Statement>> args_;
 };
 
 //! Unary operations base class
-class UnaryOperation : public Statement
+class UnaryOperation : public Node
 {
   public:
     explicit UnaryOperation(std::unique_ptr<Statement> &&argument) : argument_(std::move(argument))
     {
     }
 
+    void RewriteChildren(const Rewriter &rewriter) override;
+
+    [[nodiscard]] const Statement &GetArgument() const
+    {
+        return *argument_;
+    }
+
   protected:
     std::unique_ptr<Statement> argument_;
 };
@@ -162,10 +349,24 @@ class Stringify : public UnaryOperation
   public:
     using UnaryOperation::UnaryOperation;
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+    void Accept(Visitor &visitor) const override;
+
+    //! Computes operation for value of argument
+    static runtime::ObjectHolder Compute(const runtime::ObjectHolder &object, runtime::Context &context);
+};
+
+//! Operand types seen by operation. Operation is specialized for the first ones it sees,
+//! operands of other types make it generic for good
+enum class OperandTypes : std::uint8_t
+{
+    Unknown,
+    Numbers,
+    Strings,
+    Generic,
 };
 
 //! Binary operation base class
-class BinaryOperation : public Statement
+class BinaryOperation : public Node
 {
   public:
     BinaryOperation(std::unique_ptr<Statement> &&lhs, std::unique_ptr<Statement> &&rhs)
@@ -173,9 +374,46 @@ class BinaryOperation : public Statement
     {
     }
 
+    void RewriteChildren(const Rewriter &rewriter) override;
+
+    [[nodiscard]] const Statement &GetLeft() const
+    {
+        return *left_;
+    }
+
+    [[nodiscard]] const Statement &GetRight() const
+    {
+        return *right_;
+    }
+
+    //! Returns operand types operation is specialized for, operations that are not specialized stay Unknown
+    [[nodiscard]] OperandTypes GetOperandTypes() const
+    {
+        return operand_types_;
+    }
+
+    //! Returns true if operand types are known statically, so they are not checked
+    [[nodiscard]] bool OperandTypesProven() const
+    {
+        return operand_types_proven_;
+    }
+
+    //! Specializes operation for operand types that are known to be the same every time, their types are not
+    //! checked then. Operation that is generic for good, i.e. comparison with custom comparator, stays generic
+    void ProveOperandTypes(OperandTypes types);
+
+    //! Specializes operation that is not specialized yet for operand types it's expected to see, i.e. the ones
+    //! seen by previous runs. They are checked as observed ones are
+    void ExpectOperandTypes(OperandTypes types);
+
   protected:
+    //! Records types of operands that didn't match specialization
+    void ObserveOperands(const runtime::ObjectHolder &lhs, const runtime::ObjectHolder &rhs);
+
     std::unique_ptr<Statement> left_;
     std::unique_ptr<Statement> right_;
+    OperandTypes operand_types_ = OperandTypes::Unknown;
+    bool operand_types_proven_ = false;
 };
 
 //! Returns result of addition
@@ -185,6 +423,11 @@ class Add : public BinaryOperation
     using BinaryOperation::BinaryOperation;
 
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+    void Accept(Visitor &visitor) const override;
+
+    //! Computes operation for values of operands
+    static runtime::ObjectHolder Compute(const runtime::ObjectHolder &lhs, const runtime::ObjectHolder &rhs,
+                                         runtime::Context &context);
 };
 
 //! Returns result of subtraction
@@ -194,6 +437,11 @@ class Sub : public BinaryOperation
     using BinaryOperation::BinaryOperation;
 
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+    void Accept(Visitor &visitor) const override;
+
+    //! Computes operation for values of operands
+    static runtime::ObjectHolder Compute(const runtime::ObjectHolder &lhs, const runtime::ObjectHolder &rhs,
+                                         runtime::Context &context);
 };
 
 //! Returns result of multiplication
@@ -203,6 +451,11 @@ class Mult : public BinaryOperation
     using BinaryOperation::BinaryOperation;
 
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+    void Accept(Visitor &visitor) const override;
+
+    //! Computes operation for values of operands
+    static runtime::ObjectHolder Compute(const runtime::ObjectHolder &lhs, const runtime::ObjectHolder &rhs,
+                                         runtime::Context &context);
 };
 
 //! Returns result of division
@@ -212,6 +465,11 @@ class Div : public BinaryOperation
     using BinaryOperation::BinaryOperation;
 
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+    void Accept(Visitor &visitor) const override;
+
+    //! Computes operation for values of operands
+    static runtime::ObjectHolder Compute(const runtime::ObjectHolder &lhs, const runtime::ObjectHolder &rhs,
+                                         runtime::Context &context);
 };
 
 //! Returns result of logical OR
@@ -221,6 +479,7 @@ class Or : public BinaryOperation
     using BinaryOperation::BinaryOperation;
 
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+    void Accept(Visitor &visitor) const override;
 };
 
 //! Returns result of logical AND
@@ -230,6 +489,7 @@ class And : public BinaryOperation
     using BinaryOperation::BinaryOperation;
 
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+    void Accept(Visitor &visitor) const override;
 };
 
 //! Returns result of logical NOT
@@ -238,10 +498,11 @@ class Not : public UnaryOperation
   public:
     using UnaryOperation::UnaryOperation;
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
+    void Accept(Visitor &visitor) const override;
 };
 
 //! Compound statement, combines other statements (i.e. method body insides, if-else blocks, etc)
-class Compound : public Statement
+class Compound : public Node
 {
   public:
     template <typename... Args> explicit Compound(Args &&...args)
@@ -258,25 +519,52 @@ class Compound : public Statement
     //! Sequentially executes all compound statements and returns None
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
+    void Accept(Visitor &visitor) const override;
+    void RewriteChildren(const Rewriter &rewriter) override;
+
+    [[nodiscard]] const std::vector<std::unique_ptr<Statement>> &GetStatements() const;
+    //! Same, statements may be removed by passes over syntax tree
+    [[nodiscard]] std::vector<std::unique_ptr<Statement>> &GetStatements();
+
   private:
     std::vector<std::unique_ptr<Statement>> statements_;
 };
 
-//! Method body. Usually contains compound statement
-class MethodBody : public Statement
+/*!
+ * Method body. Usually contains compound statement. Passes over syntax tree keep body that is not parsed yet as it
+ * is, since it has no children until it's parsed
+ */
+class MethodBody : public Node
 {
   public:
+    //! Creates body statement, it may throw the same way parser does
+    using BodyParser = std::function<std::unique_ptr<Statement>()>;
+
     explicit MethodBody(std::unique_ptr<Statement> &&body);
+    //! Body statement is created by "parser" when it's executed or accessed first time
+    explicit MethodBody(BodyParser parser);
 
     //! Computes statement passed as body_, returns None unless there is return statement as body
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
+    void Accept(Visitor &visitor) const override;
+    void RewriteChildren(const Rewriter &rewriter) override;
+
+    //! Creates body statement if it's not created yet
+    [[nodiscard]] const Statement &GetBody() const;
+
+    //! Returns true if body statement is created
+    [[nodiscard]] bool IsParsed() const;
+
   private:
-    std::unique_ptr<Statement> body_;
+    Statement &Body() const;
+
+    mutable BodyParser parser_;
+    mutable std::unique_ptr<Statement> body_;
 };
 
 //! Executes return with a given statement
-class Return : public Statement
+class Return : public Node
 {
   public:
     explicit Return(std::unique_ptr<Statement> &&statement) : statement_(std::move(statement))
@@ -286,12 +574,17 @@ class Return : public Statement
     //! Stops current method execution and returns value of whatever given "statement_"
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
+    void Accept(Visitor &visitor) const override;
+    void RewriteChildren(const Rewriter &rewriter) override;
+
+    [[nodiscard]] const Statement &GetValue() const;
+
   private:
     std::unique_ptr<Statement> statement_;
 };
 
 //! Class definition
-class ClassDefinition : public Statement
+class ClassDefinition : public Node
 {
   public:
     //! It is guaranteed that ObjectHolder contains runtime::Class object
@@ -300,12 +593,17 @@ class ClassDefinition : public Statement
     //! Creates new object in closure with a name equal to class name and value which was passed to constructor
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
+    void Accept(Visitor &visitor) const override;
+    void RewriteChildren(const Rewriter &rewriter) override;
+
+    [[nodiscard]] const runtime::ObjectHolder &GetClass() const;
+
   private:
     runtime::ObjectHolder cls_;
 };
 
 //! if \<condition\> \<if_body\> else \<else_body\>
-class IfElse : public Statement
+class IfElse : public Node
 {
   public:
     //! else_body can be nullptr
@@ -314,10 +612,26 @@ class IfElse : public Statement
 
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
+    void Accept(Visitor &visitor) const override;
+    void RewriteChildren(const Rewriter &rewriter) override;
+
+    [[nodiscard]] const Statement &GetCondition() const;
+    [[nodiscard]] const Statement &GetIfBody() const;
+    //! Returns nullptr if there is no else branch
+    [[nodiscard]] const Statement *GetElseBody() const;
+
+    //! Condition is known to be Bool every time, its value is used without conversion
+    void ProveBoolCondition();
+    [[nodiscard]] bool HasBoolCondition() const
+    {
+        return bool_condition_;
+    }
+
   private:
     std::unique_ptr<Statement> condition_;
     std::unique_ptr<Statement> if_body_;
     std::unique_ptr<Statement> else_body_;
+    bool bool_condition_ = false;
 };
 
 //! Comparison operation
@@ -332,8 +646,24 @@ class Comparison : public BinaryOperation
     //! Computes lhs/rhs and returns comparator execution result, converted into runtime::Bool
     runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override;
 
+    void Accept(Visitor &visitor) const override;
+
+    [[nodiscard]] const Comparator &GetComparator() const;
+
+    //! Compares values of operands, specialized for their types if comparator is one of runtime comparisons
+    bool Compare(const runtime::ObjectHolder &lhs, const runtime::ObjectHolder &rhs, runtime::Context &context);
+
+    //! Returns true if comparator is one of runtime comparisons, so numbers can be compared by CompareNumbers
+    [[nodiscard]] bool ComparesValues() const;
+    //! Compares numbers the way runtime comparison does, without objects holding them
+    [[nodiscard]] bool CompareNumbers(int lhs, int rhs) const;
+
   private:
+    struct ValueComparators;
+
     Comparator cmp_;
+    //! Comparisons of values of the same runtime comparator or nullptr
+    const ValueComparators *values_;
 };
 
 } // namespace ast
@@ -0,0 +1,618 @@
+#include "transpile.h"
+
+#include "statement.h"
+
+#include <algorithm>
+#include <deque>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <unordered_map>
+
+using namespace std;
+
+namespace aot
+{
+
+using ast::Statement;
+using runtime::Class;
+
+namespace
+{
+
+const string RETURNED_VALUE = "returned_value"s;
+const string INIT_METHOD = "__init__"s;
+
+using ComparatorFunction = bool (*)(const runtime::ObjectHolder &, const runtime::ObjectHolder &, runtime::Context &);
+
+struct ComparatorInfo
+{
+    ComparatorFunction function;
+    const char *name;
+    //! C++ operator comparing numbers and strings the same way
+    const char *op;
+};
+
+const ComparatorInfo COMPARATORS[] = {
+    {runtime::Equal, "Equal", "=="},     {runtime::NotEqual, "NotEqual", "!="},
+    {runtime::Less, "Less", "<"},        {runtime::Greater, "Greater", ">"},
+    {runtime::LessOrEqual, "LessOrEqual", "<="}, {runtime::GreaterOrEqual, "GreaterOrEqual", ">="},
+};
+
+//! Helpers of generated code, they repeat what syntax tree nodes do
+const char PRELUDE[] = R"(#include "runtime.h"
+#include "statement.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace runtime;
+
+namespace
+{
+
+const std::string RETURNED_VALUE = "returned_value";
+const std::string INIT_METHOD = "__init__";
+
+ObjectHolder Load(Closure &closure, const std::string &name)
+{
+    auto it = closure.find(name);
+    if (it == closure.end())
+    {
+        throw std::runtime_error("Unknown variable - " + name);
+    }
+    return it->second;
+}
+
+ObjectHolder LoadField(const ObjectHolder &object, const std::string &name)
+{
+    auto *instance = object.TryAs<ClassInstance>();
+    if (!instance)
+    {
+        throw std::runtime_error("Unknown variable - " + name);
+    }
+    return instance->Fields()[name];
+}
+
+ClassInstance &Instance(const ObjectHolder &object, const char *what)
+{
+    if (auto *instance = object.TryAs<ClassInstance>())
+    {
+        return *instance;
+    }
+    throw std::runtime_error(std::string(what) + " of object that is not a class instance");
+}
+
+ObjectHolder New(const ObjectHolder &cls, const std::vector<ObjectHolder> &args, Context &context)
+{
+    const RootedValues rooted(args);
+    ObjectHolder object = ObjectHolder::Own(ClassInstance(*cls.TryAs<Class>()));
+    if (auto post_init_object = object.TryAs<ClassInstance>()->Call(INIT_METHOD, args, context))
+    {
+        return post_init_object;
+    }
+    return object;
+}
+
+void PrintValue(const ObjectHolder &value, Context &context)
+{
+    if (value)
+    {
+        value->Print(context.GetOutputStream(), context);
+    }
+    else
+    {
+        context.GetOutputStream() << "None";
+    }
+}
+
+ObjectHolder MakeBool(bool value)
+{
+    return ObjectHolder::Own(Bool(value));
+}
+
+int AsNumber(const ObjectHolder &object)
+{
+    return static_cast<const Number *>(object.Get())->GetValue();
+}
+
+const std::string &AsString(const ObjectHolder &object)
+{
+    return static_cast<const String *>(object.Get())->GetValue();
+}
+
+bool AsBool(const ObjectHolder &object)
+{
+    return static_cast<const Bool *>(object.Get())->GetValue();
+}
+
+//! Method body, returns "returned_value" as the interpreted one does
+template <void (*Function)(Closure &, Context &)> class Body : public Executable
+{
+  public:
+    ObjectHolder Execute(Closure &closure, Context &context) override
+    {
+        Function(closure, context);
+        auto it = closure.find(RETURNED_VALUE);
+        return it != closure.end() ? it->second : ObjectHolder::None();
+    }
+};
+
+)";
+
+//! Returns C++ string literal
+string Literal(const string &value)
+{
+    ostringstream out;
+    out << '"';
+    for (const char c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out << '\\' << c;
+        }
+        else if (static_cast<unsigned char>(c) < ' ' || c == '\x7F')
+        {
+            // Octal escape has at most three digits, so it can't take the next character
+            out << '\\' << oct << setw(3) << setfill('0') << static_cast<int>(static_cast<unsigned char>(c)) << dec;
+        }
+        else
+        {
+            out << c;
+        }
+    }
+    out << '"';
+    return out.str();
+}
+
+//! Returns true if statement may set "returned_value" in the closure it's executed in
+bool MayReturn(const Statement &statement) // NOLINT
+{
+    if (dynamic_cast<const ast::Return *>(&statement))
+    {
+        return true;
+    }
+    if (const auto *assignment = dynamic_cast<const ast::Assignment *>(&statement))
+    {
+        return assignment->GetVariable() == RETURNED_VALUE;
+    }
+    if (const auto *compound = dynamic_cast<const ast::Compound *>(&statement))
+    {
+        return any_of(compound->GetStatements().begin(), compound->GetStatements().end(),
+                      [](const auto &child) { return MayReturn(*child); });
+    }
+    if (const auto *if_else = dynamic_cast<const ast::IfElse *>(&statement))
+    {
+        return MayReturn(if_else->GetIfBody()) || (if_else->GetElseBody() && MayReturn(*if_else->GetElseBody()));
+    }
+    return !dynamic_cast<const ast::Node *>(&statement);
+}
+
+/*
+ * Every statement becomes a function of closure and context, as Execute is. Values of expressions are kept in
+ * local variables, so operands are computed in the same order as by the interpreter. Statement that sets
+ * "returned_value" returns from the function, since every compound it's in stops then
+ */
+class Transpiler : public ast::Visitor
+{
+  public:
+    void Run(const Statement &program, ostream &output)
+    {
+        BeginFunction("Program"s);
+        Emit(program);
+        EndFunction();
+        // Methods are found while other methods are translated
+        while (!methods_.empty())
+        {
+            const auto [method, name] = methods_.front();
+            methods_.pop_front();
+            TranspileMethod(*method, name);
+        }
+
+        output << "// Generated by mini-python --transpile\n" << PRELUDE;
+        output << globals_.str() << '\n' << declarations_.str() << '\n' << functions_.str();
+        output << "void CreateClasses()\n{\n" << classes_.str() << "}\n\n} // namespace\n\n";
+        output << "int main()\n{\n"
+                  "    CreateClasses();\n"
+                  "    SimpleContext context{std::cout};\n"
+                  "    Closure closure;\n"
+                  "    Program(closure, context);\n"
+                  "}\n";
+    }
+
+  private:
+    void BeginFunction(const string &name)
+    {
+        declarations_ << "void " << name << "(Closure &closure, Context &context);\n";
+        body_.str({});
+        body_ << "void " << name << "(Closure &closure, Context &context)\n{\n";
+        indent_ = 1;
+    }
+
+    void EndFunction()
+    {
+        body_ << "}\n\n";
+        functions_ << body_.str();
+    }
+
+    void TranspileMethod(const runtime::Method &method, const string &name)
+    {
+        const auto *body = dynamic_cast<const ast::MethodBody *>(method.body.get());
+        if (!body)
+        {
+            throw TranspileError("Body of method "s + method.name + " is not a syntax tree node"s);
+        }
+        const auto &params = method.formal_params;
+        // Parameter named "returned_value" stops method after its first statement
+        check_every_statement_ = find(params.begin(), params.end(), RETURNED_VALUE) != params.end();
+        BeginFunction(name);
+        Emit(body->GetBody());
+        EndFunction();
+    }
+
+    void Line(const string &line)
+    {
+        body_ << string(static_cast<size_t>(indent_) * 4, ' ') << line << '\n';
+    }
+
+    //! Emits statement, returns expression of its value
+    string Emit(const Statement &statement)
+    {
+        if (!ast::Accept(statement, *this))
+        {
+            throw TranspileError("Statement that is not a syntax tree node can't be transpiled"s);
+        }
+        return value_;
+    }
+
+    //! Emits statement and keeps its value in new variable, returns its name
+    string Value(const string &expression)
+    {
+        const string name = "v"s + to_string(values_++);
+        Line("ObjectHolder "s + name + " = "s + expression + ";"s);
+        return name;
+    }
+
+    string Args(const vector<unique_ptr<Statement>> &args)
+    {
+        string result = "{"s;
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            result += (i == 0 ? ""s : ", "s) + Emit(*args[i]);
+        }
+        return result + "}"s;
+    }
+
+    const string &Name(const string &name)
+    {
+        auto [it, inserted] = names_.emplace(name, "name_"s + to_string(names_.size()));
+        if (inserted)
+        {
+            globals_ << "const std::string " << it->second << " = " << Literal(name) << ";\n";
+        }
+        return it->second;
+    }
+
+    string Constant(const string &expression)
+    {
+        const string name = "constant_"s + to_string(constants_++);
+        globals_ << "const ObjectHolder " << name << " = Pin(ObjectHolder::Own(" << expression << "));\n";
+        return name;
+    }
+
+    //! Returns name of global variable of class, class and its parents are created at start of program
+    const string &ClassName(const Class &cls) // NOLINT
+    {
+        if (auto it = classes_names_.find(&cls); it != classes_names_.end())
+        {
+            return it->second;
+        }
+        const string parent = cls.GetParent() ? ClassName(*cls.GetParent()) + ".TryAs<Class>()"s : "nullptr"s;
+        const string name = "class_"s + to_string(classes_names_.size());
+        globals_ << "ObjectHolder " << name << ";\n";
+        classes_ << "    {\n        std::vector<Method> methods;\n";
+        for (const auto &method : cls.GetMethods())
+        {
+            const string function = "method_"s + to_string(methods_count_++);
+            string params;
+            for (const auto &param : method.formal_params)
+            {
+                params += (params.empty() ? ""s : ", "s) + Literal(param);
+            }
+            classes_ << "        methods.push_back(Method{" << Literal(method.name) << ", {" << params
+                     << "}, std::make_unique<Body<" << function << ">>()});\n";
+            methods_.emplace_back(&method, function);
+        }
+        classes_ << "        " << name << " = ObjectHolder::Own(Class(" << Literal(cls.GetName())
+                 << ", std::move(methods), " << parent << "));\n    }\n";
+        return classes_names_.emplace(&cls, name).first->second;
+    }
+
+    void Visit(const ast::NumericConst &node) override
+    {
+        value_ = Constant("Number("s + to_string(node.GetValue().GetValue()) + ")"s);
+    }
+
+    void Visit(const ast::StringConst &node) override
+    {
+        value_ = Constant("String("s + Literal(node.GetValue().GetValue()) + ")"s);
+    }
+
+    void Visit(const ast::BoolConst &node) override
+    {
+        value_ = Constant(node.GetValue().GetValue() ? "Bool(true)"s : "Bool(false)"s);
+    }
+
+    void Visit(const ast::VariableValue &node) override
+    {
+        const auto &ids = node.GetIds();
+        string expression = "Load(closure, "s + Name(ids.front()) + ")"s;
+        for (size_t i = 1; i < ids.size(); ++i)
+        {
+            expression = "LoadField("s + expression + ", "s + Name(ids[i]) + ")"s;
+        }
+        value_ = Value(expression);
+    }
+
+    void Visit(const ast::Assignment &node) override
+    {
+        const string value = Emit(node.GetValue());
+        Line("closure["s + Name(node.GetVariable()) + "] = "s + value + ";"s);
+        if (node.GetVariable() == RETURNED_VALUE)
+        {
+            Line("return;"s);
+        }
+        value_ = value;
+    }
+
+    void Visit(const ast::FieldAssignment &node) override
+    {
+        const string object = Emit(node.GetObject());
+        const string value = Emit(node.GetValue());
+        const string what = Literal("Field "s + node.GetField());
+        Line("Instance("s + object + ", "s + what + ").Fields()["s + Name(node.GetField()) + "] = "s + value + ";"s);
+        value_ = value;
+    }
+
+    void Visit([[maybe_unused]] const ast::None &node) override
+    {
+        value_ = "ObjectHolder::None()"s;
+    }
+
+    void Visit(const ast::Print &node) override
+    {
+        // Every argument is printed before the next one is computed
+        const auto &args = node.GetArgs();
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            Line("PrintValue("s + Emit(*args[i]) + ", context);"s);
+            if (i + 1 != args.size())
+            {
+                Line("context.GetOutputStream() << ' ';"s);
+            }
+        }
+        Line("context.GetOutputStream() << '\\n';"s);
+        value_ = "ObjectHolder::None()"s;
+    }
+
+    void Visit(const ast::MethodCall &node) override
+    {
+        // Arguments are computed before object
+        const string args = Args(node.GetArgs());
+        const string object = Emit(node.GetObject());
+        const string what = Literal("Method "s + node.GetMethod());
+        value_ = Value("Instance("s + object + ", "s + what + ").Call("s + Name(node.GetMethod()) + ", "s + args +
+                       ", context)"s);
+    }
+
+    void Visit(const ast::NewInstance &node) override
+    {
+        // Arguments are computed only if there is suitable constructor, and classes don't change after parsing
+        const string &cls = ClassName(node.GetClass());
+        const auto *init = node.GetClass().GetMethod(INIT_METHOD);
+        if (!init || init->formal_params.size() != node.GetArgs().size())
+        {
+            value_ = Value("ObjectHolder::Own(ClassInstance(*"s + cls + ".TryAs<Class>()))"s);
+            return;
+        }
+        value_ = Value("New("s + cls + ", "s + Args(node.GetArgs()) + ", context)"s);
+    }
+
+    void Visit(const ast::Stringify &node) override
+    {
+        value_ = Value("ast::Stringify::Compute("s + Emit(node.GetArgument()) + ", context)"s);
+    }
+
+    //! Operation proven to have numbers or strings is computed directly, others check types of operands
+    void EmitArithmetic(const ast::BinaryOperation &node, const char *operation, const char *op)
+    {
+        const string lhs = Emit(node.GetLeft());
+        const string rhs = Emit(node.GetRight());
+        switch (node.GetOperandTypes())
+        {
+        case ast::OperandTypes::Numbers:
+            value_ = Value("ObjectHolder::Own(Number(AsNumber("s + lhs + ") "s + op + " AsNumber("s + rhs + ")))"s);
+            return;
+        case ast::OperandTypes::Strings:
+            value_ = Value("ObjectHolder::Own(String(AsString("s + lhs + ") "s + op + " AsString("s + rhs + ")))"s);
+            return;
+        default:
+            value_ = Value("ast::"s + operation + "::Compute("s + lhs + ", "s + rhs + ", context)"s);
+        }
+    }
+
+    void Visit(const ast::Add &node) override
+    {
+        EmitArithmetic(node, "Add", "+");
+    }
+
+    void Visit(const ast::Sub &node) override
+    {
+        EmitArithmetic(node, "Sub", "-");
+    }
+
+    void Visit(const ast::Mult &node) override
+    {
+        EmitArithmetic(node, "Mult", "*");
+    }
+
+    void Visit(const ast::Div &node) override
+    {
+        // Division by zero is an error, it's checked by Compute
+        const string lhs = Emit(node.GetLeft());
+        const string rhs = Emit(node.GetRight());
+        value_ = Value("ast::Div::Compute("s + lhs + ", "s + rhs + ", context)"s);
+    }
+
+    //! Right operand is computed only if left one doesn't decide the result
+    void EmitLogical(const ast::BinaryOperation &node, bool is_or)
+    {
+        const string lhs = Emit(node.GetLeft());
+        const string result = "v"s + to_string(values_++);
+        Line("ObjectHolder "s + result + ";"s);
+        Line("if ("s + (is_or ? ""s : "!"s) + "IsTrue("s + lhs + "))"s);
+        Line("{"s);
+        Line("    "s + result + " = MakeBool("s + (is_or ? "true"s : "false"s) + ");"s);
+        Line("}"s);
+        Line("else"s);
+        Line("{"s);
+        ++indent_;
+        const string rhs = Emit(node.GetRight());
+        Line(result + " = MakeBool(IsTrue("s + rhs + "));"s);
+        --indent_;
+        Line("}"s);
+        value_ = result;
+    }
+
+    void Visit(const ast::Or &node) override
+    {
+        EmitLogical(node, true);
+    }
+
+    void Visit(const ast::And &node) override
+    {
+        EmitLogical(node, false);
+    }
+
+    void Visit(const ast::Not &node) override
+    {
+        value_ = Value("MakeBool(!IsTrue("s + Emit(node.GetArgument()) + "))"s);
+    }
+
+    void Visit(const ast::Compound &node) override
+    {
+        for (const auto &statement : node.GetStatements())
+        {
+            Emit(*statement);
+            // Return and assignment of "returned_value" return by themselves, code after them is not reachable
+            if (dynamic_cast<const ast::Return *>(statement.get()) ||
+                (dynamic_cast<const ast::Assignment *>(statement.get()) &&
+                 static_cast<const ast::Assignment &>(*statement).GetVariable() == RETURNED_VALUE))
+            {
+                break;
+            }
+            if (check_every_statement_ || MayReturn(*statement))
+            {
+                Line("if (closure.count(RETURNED_VALUE))"s);
+                Line("{"s);
+                Line("    return;"s);
+                Line("}"s);
+            }
+        }
+        value_ = "ObjectHolder::None()"s;
+    }
+
+    void Visit([[maybe_unused]] const ast::MethodBody &node) override
+    {
+        throw TranspileError("Method body inside of other statement can't be transpiled"s);
+    }
+
+    void Visit(const ast::Return &node) override
+    {
+        Line("closure[RETURNED_VALUE] = "s + Emit(node.GetValue()) + ";"s);
+        Line("return;"s);
+        value_ = "ObjectHolder::None()"s;
+    }
+
+    void Visit(const ast::ClassDefinition &node) override
+    {
+        const auto &cls = *node.GetClass().TryAs<Class>();
+        Line("closure["s + Name(cls.GetName()) + "] = "s + ClassName(cls) + ";"s);
+        value_ = "ObjectHolder::None()"s;
+    }
+
+    void Visit(const ast::IfElse &node) override
+    {
+        const string condition = Emit(node.GetCondition());
+        Line((node.HasBoolCondition() ? "if (AsBool("s : "if (IsTrue("s) + condition + "))"s);
+        Line("{"s);
+        ++indent_;
+        Emit(node.GetIfBody());
+        --indent_;
+        Line("}"s);
+        if (const auto *else_body = node.GetElseBody())
+        {
+            Line("else"s);
+            Line("{"s);
+            ++indent_;
+            Emit(*else_body);
+            --indent_;
+            Line("}"s);
+        }
+        value_ = "ObjectHolder::None()"s;
+    }
+
+    void Visit(const ast::Comparison &node) override
+    {
+        const auto *function = node.GetComparator().target<ComparatorFunction>();
+        const auto *info = find_if(begin(COMPARATORS), end(COMPARATORS), [function](const ComparatorInfo &info) {
+            return function && info.function == *function;
+        });
+        if (info == end(COMPARATORS))
+        {
+            throw TranspileError("Comparison with custom comparator can't be transpiled"s);
+        }
+        const string lhs = Emit(node.GetLeft());
+        const string rhs = Emit(node.GetRight());
+        switch (node.GetOperandTypes())
+        {
+        case ast::OperandTypes::Numbers:
+            value_ = Value("MakeBool(AsNumber("s + lhs + ") "s + info->op + " AsNumber("s + rhs + "))"s);
+            return;
+        case ast::OperandTypes::Strings:
+            value_ = Value("MakeBool(AsString("s + lhs + ") "s + info->op + " AsString("s + rhs + "))"s);
+            return;
+        default:
+            value_ = Value("MakeBool("s + info->name + "("s + lhs + ", "s + rhs + ", context))"s);
+        }
+    }
+
+    string value_;
+    ostringstream body_;
+    int indent_ = 1;
+    size_t values_ = 0;
+    bool check_every_statement_ = false;
+
+    ostringstream globals_;
+    ostringstream declarations_;
+    ostringstream functions_;
+    ostringstream classes_;
+
+    unordered_map<string, string> names_;
+    size_t constants_ = 0;
+    unordered_map<const Class *, string> classes_names_;
+    size_t methods_count_ = 0;
+    //! Methods that are not translated yet and names of their functions
+    deque<pair<const runtime::Method *, string>> methods_;
+};
+
+} // namespace
+
+void Transpile(const runtime::Executable &program, ostream &output)
+{
+    Transpiler().Run(program, output);
+}
+
+} // namespace aot
@@ -0,0 +1,32 @@
+/*!
+ * \file transpile.h
+ * \brief Ahead-of-time compilation: program is translated to C++ source, which is linked with runtime library
+ */
+#pragma once
+
+#include <iosfwd>
+#include <stdexcept>
+
+namespace runtime
+{
+class Executable;
+}
+
+namespace aot
+{
+
+struct TranspileError : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+/*!
+ * Writes C++ translation unit with main function that prints what program prints. Statements become C++
+ * statements working with the same closures, classes and objects as the interpreter, operations that type
+ * inference proved to have numbers or strings are computed directly. Source is compiled with src directory
+ * in include path and linked with mython-runtime library.
+ * Throws TranspileError if program contains statements that are not syntax tree nodes or custom comparisons
+ */
+void Transpile(const runtime::Executable &program, std::ostream &output);
+
+} // namespace aot
@@ -0,0 +1,1224 @@
+#include "vm.h"
+
+#include "jit.h"
+#include "statement.h"
+
+#include <algorithm>
+#include <exception>
+#include <cstdint>
+#include <cstring>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#if defined(MYTHON_COMPUTED_GOTO) && (defined(__GNUC__) || defined(__clang__))
+#define MYTHON_VM_THREADED 1
+#else
+#define MYTHON_VM_THREADED 0
+#endif
+
+using namespace std;
+
+namespace vm
+{
+
+using ast::Statement;
+using runtime::Class;
+using runtime::ClassInstance;
+using runtime::Closure;
+using runtime::Context;
+using runtime::ObjectHolder;
+
+namespace
+{
+
+const string INIT_METHOD = "__init__"s;
+const string RETURNED_VALUE = "returned_value"s;
+
+/*
+ * Instructions and number of their operands, every one of them takes a code word. Target of jump is its first
+ * operand. Stack effect of instruction is given in comments. Instructions of the first list are executed by the
+ * interpreter loop itself, instructions of the second one by calls of their handlers
+ */
+#define MYTHON_VM_INLINE_INSTRUCTIONS(X)                                                                              \
+    X(PushConst, 1)       /* constant index: -> value */                                                               \
+    X(PushNone, 0)        /* -> None */                                                                                \
+    X(LoadVar, 1)         /* name index: -> value */                                                                   \
+    X(StoreVar, 1)        /* name index: value -> value */                                                             \
+    X(Pop, 0)             /* value -> */                                                                               \
+    X(Add, 0)             /* lhs, rhs -> result */                                                                     \
+    X(Sub, 0)             /* lhs, rhs -> result */                                                                     \
+    X(Compare, 1)         /* comparison index: lhs, rhs -> bool */                                                     \
+    X(JumpIfFalse, 1)     /* target: value -> */                                                                       \
+    X(Jump, 1)            /* target */
+
+#define MYTHON_VM_CALLED_INSTRUCTIONS(X)                                                                              \
+    X(LoadField, 1)       /* name index: object -> value */                                                            \
+    X(StoreField, 1)      /* name index: object, value -> value */                                                     \
+    X(Print, 1)           /* separated: value -> */                                                                    \
+    X(PrintEnd, 0)        /* -> None */                                                                                \
+    X(CallMethod, 2)      /* name index, count: arguments, object -> result */                                         \
+    X(NewInstance, 1)     /* class index: -> instance */                                                               \
+    X(NewInstanceInit, 2) /* class index, count: arguments -> instance */                                              \
+    X(Stringify, 0)       /* value -> string */                                                                        \
+    X(Mult, 0)            /* lhs, rhs -> result */                                                                     \
+    X(Div, 0)             /* lhs, rhs -> result */                                                                     \
+    X(Not, 0)             /* value -> bool */                                                                          \
+    X(ToBool, 0)          /* value -> bool */                                                                          \
+    X(OrJump, 1)          /* target: value -> | True */                                                                \
+    X(AndJump, 1)         /* target: value -> | False */                                                               \
+    X(DefineClass, 1)     /* class index: -> None */                                                                   \
+    X(Return, 1)          /* target: value -> */                                                                       \
+    X(CheckReturn, 1)     /* target: stops execution if "returned_value" is set */                                     \
+    X(RunStatement, 1)    /* statement index: -> result */                                                             \
+    X(End, 0)
+
+#define MYTHON_VM_INSTRUCTIONS(X) MYTHON_VM_INLINE_INSTRUCTIONS(X) MYTHON_VM_CALLED_INSTRUCTIONS(X)
+
+enum class Op : uint32_t
+{
+#define MYTHON_VM_ENUM(name, count) name,
+    MYTHON_VM_INSTRUCTIONS(MYTHON_VM_ENUM)
+#undef MYTHON_VM_ENUM
+};
+
+constexpr uint32_t OPERAND_COUNTS[] = {
+#define MYTHON_VM_COUNT(name, count) count,
+    MYTHON_VM_INSTRUCTIONS(MYTHON_VM_COUNT)
+#undef MYTHON_VM_COUNT
+};
+
+//! Returns true if instruction may go to its target
+constexpr bool Jumps(Op op)
+{
+    return op == Op::OrJump || op == Op::AndJump || op == Op::JumpIfFalse || op == Op::Jump || op == Op::Return ||
+           op == Op::CheckReturn;
+}
+
+//! Where execution goes after instruction, machine code compares it as a number
+enum class Flow : uint32_t
+{
+    Next,
+    //! To target of instruction
+    Jump,
+    //! Out of code, result is in frame
+    Exit,
+    //! Out of code by exception, it's in frame
+    Error,
+};
+
+//! Method calls after which method is compiled to machine code
+constexpr size_t JIT_THRESHOLD = 100;
+
+class Code;
+
+//! Execution state of code, shared by interpreter and machine code
+struct Frame
+{
+    const Code &code;
+    Closure &closure;
+    Context &context;
+    ObjectHolder *stack;
+    ObjectHolder *sp;
+    ObjectHolder result;
+    exception_ptr error;
+};
+
+class Classes;
+
+//! Compiled statement: its instructions and everything they refer to
+class Code : public runtime::Executable
+{
+  public:
+    //! Method body returns "returned_value", other statements return their own value
+    explicit Code(bool method_body) : method_body_(method_body)
+    {
+    }
+
+    Code(const Code &) = delete;
+    Code &operator=(const Code &) = delete;
+
+    ObjectHolder Execute(Closure &closure, Context &context) override;
+
+    //! Translates instructions to machine code, which is executed instead of them from now on if it's supported
+    void CompileNative();
+
+  private:
+    friend class Compiler;
+
+    ObjectHolder Interpret(Frame &frame) const;
+
+    // Instruction handlers, used by interpreter and called by machine code
+#define MYTHON_VM_EXEC(name, count) Flow Exec##name(Frame &frame, const uint32_t *operands) const;
+    MYTHON_VM_INSTRUCTIONS(MYTHON_VM_EXEC)
+#undef MYTHON_VM_EXEC
+
+    //! Executes handler for machine code, exception is kept in frame since it can't pass through machine code
+    template <Flow (Code::*Exec)(Frame &, const uint32_t *) const>
+    static uint32_t Thunk(void *frame, const void *operands) noexcept;
+
+    bool method_body_;
+    vector<uint32_t> code_;
+    size_t max_depth_ = 0;
+
+    vector<ObjectHolder> constants_;
+    //! Constants live as long as the code does, compiled copies of program don't pile them up
+    const runtime::RootedValues rooted_constants_{constants_};
+    vector<string> names_;
+    vector<ObjectHolder> classes_;
+    //! Comparisons of the syntax tree, program keeps it
+    vector<const ast::Comparison *> comparisons_;
+    //! Statements that are executed as they are
+    vector<Statement *> statements_;
+
+    unique_ptr<jit::NativeCode> native_;
+};
+
+//! Compiled copies of program classes
+class Classes
+{
+  public:
+    explicit Classes(optional<size_t> jit_threshold) : jit_threshold_(jit_threshold)
+    {
+    }
+
+    //! Returns copy of class, creating it if it doesn't exist yet
+    const ObjectHolder &Get(const Class &original);
+
+    [[nodiscard]] optional<size_t> JitThreshold() const
+    {
+        return jit_threshold_;
+    }
+
+  private:
+    optional<size_t> jit_threshold_;
+    unordered_map<const Class *, ObjectHolder> compiled_;
+};
+
+//! Method body that is compiled when it's executed first time
+class CompiledMethod : public runtime::Executable
+{
+  public:
+    CompiledMethod(const runtime::Method &original, Classes &classes) : original_(original), classes_(classes)
+    {
+    }
+
+    ObjectHolder Execute(Closure &closure, Context &context) override;
+
+  private:
+    const runtime::Method &original_;
+    Classes &classes_;
+    unique_ptr<Code> code_;
+    size_t calls_ = 0;
+};
+
+class Compiler : public ast::Visitor
+{
+  public:
+    //! Statements of compound are followed by check of "returned_value" only where it can be set already,
+    //! that is at top level and in methods with such parameter
+    Compiler(Code &code, Classes &classes, bool check_every_statement)
+        : code_(code), classes_(classes), check_every_statement_(check_every_statement)
+    {
+    }
+
+    //! Compiles statement so that its value is left on stack, statement is executed as it is if it's not
+    //! a syntax tree node
+    void Compile(const Statement &statement)
+    {
+        if (!ast::Accept(statement, *this))
+        {
+            code_.statements_.push_back(const_cast<Statement *>(&statement)); // NOLINT
+            Emit(Op::RunStatement, 1, Index(code_.statements_));
+        }
+    }
+
+    void Finish()
+    {
+        Emit(Op::End, 0);
+        // Return targets the end of code
+        for (size_t at : return_jumps_)
+        {
+            code_.code_[at] = static_cast<uint32_t>(code_.code_.size() - 1);
+        }
+    }
+
+  private:
+    template <typename T> static uint32_t Index(const vector<T> &table)
+    {
+        return static_cast<uint32_t>(table.size() - 1);
+    }
+
+    //! Appends instruction with its operands, "effect" is change of stack depth
+    template <typename... Operands> void Emit(Op op, int effect, Operands... operands)
+    {
+        code_.code_.push_back(static_cast<uint32_t>(op));
+        (code_.code_.push_back(static_cast<uint32_t>(operands)), ...);
+        depth_ += effect;
+        code_.max_depth_ = max(code_.max_depth_, static_cast<size_t>(depth_));
+    }
+
+    //! Appends jump instruction, returns position of its target to be patched later
+    size_t EmitJump(Op op, int effect)
+    {
+        Emit(op, effect, 0);
+        return code_.code_.size() - 1;
+    }
+
+    void PatchJump(size_t at)
+    {
+        code_.code_[at] = static_cast<uint32_t>(code_.code_.size());
+    }
+
+    //! Names and classes are interned, so that their tables grow with the number of distinct ones
+    uint32_t Name(const string &name)
+    {
+        auto [it, inserted] = name_indices_.emplace(name, 0);
+        if (inserted)
+        {
+            code_.names_.push_back(name);
+            it->second = Index(code_.names_);
+        }
+        return it->second;
+    }
+
+    uint32_t ClassIndex(const Class &original)
+    {
+        auto [it, inserted] = class_indices_.emplace(&original, 0);
+        if (inserted)
+        {
+            code_.classes_.push_back(classes_.Get(original));
+            it->second = Index(code_.classes_);
+        }
+        return it->second;
+    }
+
+    void CompileAll(const vector<unique_ptr<Statement>> &statements)
+    {
+        for (const auto &statement : statements)
+        {
+            Compile(*statement);
+        }
+    }
+
+    template <typename T> void PushConst(const T &value)
+    {
+        code_.constants_.push_back(ObjectHolder::Own(T(value)));
+        Emit(Op::PushConst, 1, Index(code_.constants_));
+    }
+
+    void CompileBinary(Op op, const ast::BinaryOperation &node)
+    {
+        Compile(node.GetLeft());
+        Compile(node.GetRight());
+        Emit(op, -1);
+    }
+
+    void Visit(const ast::NumericConst &node) override
+    {
+        PushConst(node.GetValue());
+    }
+
+    void Visit(const ast::StringConst &node) override
+    {
+        PushConst(node.GetValue());
+    }
+
+    void Visit(const ast::BoolConst &node) override
+    {
+        PushConst(node.GetValue());
+    }
+
+    void Visit(const ast::VariableValue &node) override
+    {
+        const auto &ids = node.GetIds();
+        Emit(Op::LoadVar, 1, Name(ids.front()));
+        for (size_t i = 1; i < ids.size(); ++i)
+        {
+            Emit(Op::LoadField, 0, Name(ids[i]));
+        }
+    }
+
+    void Visit(const ast::Assignment &node) override
+    {
+        Compile(node.GetValue());
+        Emit(Op::StoreVar, 0, Name(node.GetVariable()));
+        // Compound stops as soon as "returned_value" is set, and assignment is always inside of compound
+        if (node.GetVariable() == RETURNED_VALUE && !check_every_statement_)
+        {
+            return_jumps_.push_back(EmitJump(Op::CheckReturn, 0));
+        }
+    }
+
+    void Visit(const ast::FieldAssignment &node) override
+    {
+        Visit(node.GetObject());
+        Compile(node.GetValue());
+        Emit(Op::StoreField, -1, Name(node.GetField()));
+    }
+
+    void Visit([[maybe_unused]] const ast::None &node) override
+    {
+        Emit(Op::PushNone, 1);
+    }
+
+    void Visit(const ast::Print &node) override
+    {
+        // Every argument is printed before the next one is computed
+        const auto &args = node.GetArgs();
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            Compile(*args[i]);
+            Emit(Op::Print, -1, i + 1 != args.size());
+        }
+        Emit(Op::PrintEnd, 1);
+    }
+
+    void Visit(const ast::MethodCall &node) override
+    {
+        // Arguments are computed before object
+        CompileAll(node.GetArgs());
+        Compile(node.GetObject());
+        const auto count = static_cast<int>(node.GetArgs().size());
+        const uint32_t name = Name(node.GetMethod());
+        Emit(Op::CallMethod, -count, name, count);
+    }
+
+    void Visit(const ast::NewInstance &node) override
+    {
+        // Arguments are computed only if there is suitable constructor, and classes don't change after parsing
+        const uint32_t cls = ClassIndex(node.GetClass());
+        const auto *init = node.GetClass().GetMethod(INIT_METHOD);
+        const auto count = static_cast<int>(node.GetArgs().size());
+        if (!init || init->formal_params.size() != node.GetArgs().size())
+        {
+            Emit(Op::NewInstance, 1, cls);
+            return;
+        }
+        CompileAll(node.GetArgs());
+        Emit(Op::NewInstanceInit, 1 - count, cls, count);
+    }
+
+    void Visit(const ast::Stringify &node) override
+    {
+        Compile(node.GetArgument());
+        Emit(Op::Stringify, 0);
+    }
+
+    void Visit(const ast::Add &node) override
+    {
+        CompileBinary(Op::Add, node);
+    }
+
+    void Visit(const ast::Sub &node) override
+    {
+        CompileBinary(Op::Sub, node);
+    }
+
+    void Visit(const ast::Mult &node) override
+    {
+        CompileBinary(Op::Mult, node);
+    }
+
+    void Visit(const ast::Div &node) override
+    {
+        CompileBinary(Op::Div, node);
+    }
+
+    void Visit(const ast::Or &node) override
+    {
+        Compile(node.GetLeft());
+        const size_t jump = EmitJump(Op::OrJump, -1);
+        Compile(node.GetRight());
+        Emit(Op::ToBool, 0);
+        PatchJump(jump);
+    }
+
+    void Visit(const ast::And &node) override
+    {
+        Compile(node.GetLeft());
+        const size_t jump = EmitJump(Op::AndJump, -1);
+        Compile(node.GetRight());
+        Emit(Op::ToBool, 0);
+        PatchJump(jump);
+    }
+
+    void Visit(const ast::Not &node) override
+    {
+        Compile(node.GetArgument());
+        Emit(Op::Not, 0);
+    }
+
+    void Visit(const ast::Compound &node) override
+    {
+        for (const auto &statement : node.GetStatements())
+        {
+            Compile(*statement);
+            // Statement that is not a node may set "returned_value" as well
+            if (check_every_statement_ || !dynamic_cast<const ast::Node *>(statement.get()))
+            {
+                return_jumps_.push_back(EmitJump(Op::CheckReturn, 0));
+            }
+            Emit(Op::Pop, -1);
+        }
+        Emit(Op::PushNone, 1);
+    }
+
+    void Visit(const ast::MethodBody &node) override
+    {
+        // Method body inside of other statement is not produced by parser, it keeps its own semantics
+        code_.statements_.push_back(const_cast<ast::MethodBody *>(&node)); // NOLINT
+        Emit(Op::RunStatement, 1, Index(code_.statements_));
+    }
+
+    void Visit(const ast::Return &node) override
+    {
+        Compile(node.GetValue());
+        return_jumps_.push_back(EmitJump(Op::Return, -1));
+        // Code after return is not reachable, but stack depth is counted as if return was a statement
+        ++depth_;
+    }
+
+    void Visit(const ast::ClassDefinition &node) override
+    {
+        Emit(Op::DefineClass, 1, ClassIndex(*node.GetClass().TryAs<Class>()));
+    }
+
+    void Visit(const ast::IfElse &node) override
+    {
+        Compile(node.GetCondition());
+        const size_t else_jump = EmitJump(Op::JumpIfFalse, -1);
+        Compile(node.GetIfBody());
+        Emit(Op::Pop, -1);
+        if (const auto *else_body = node.GetElseBody())
+        {
+            const size_t end_jump = EmitJump(Op::Jump, 0);
+            PatchJump(else_jump);
+            Compile(*else_body);
+            Emit(Op::Pop, -1);
+            PatchJump(end_jump);
+        }
+        else
+        {
+            PatchJump(else_jump);
+        }
+        Emit(Op::PushNone, 1);
+    }
+
+    void Visit(const ast::Comparison &node) override
+    {
+        Compile(node.GetLeft());
+        Compile(node.GetRight());
+        code_.comparisons_.push_back(&node);
+        Emit(Op::Compare, -1, Index(code_.comparisons_));
+    }
+
+    Code &code_;
+    Classes &classes_;
+    bool check_every_statement_;
+    int depth_ = 0;
+    //! Positions of jump targets that must point to the end of code
+    vector<size_t> return_jumps_;
+    unordered_map<string, uint32_t> name_indices_;
+    unordered_map<const Class *, uint32_t> class_indices_;
+};
+
+const ObjectHolder &Classes::Get(const Class &original) // NOLINT
+{
+    if (auto it = compiled_.find(&original); it != compiled_.end())
+    {
+        return it->second;
+    }
+
+    const Class *parent = original.GetParent() ? Get(*original.GetParent()).TryAs<Class>() : nullptr;
+    vector<runtime::Method> methods;
+    for (const auto &method : original.GetMethods())
+    {
+        methods.push_back({method.name, method.formal_params, make_unique<CompiledMethod>(method, *this)});
+    }
+    auto cls = ObjectHolder::Own(Class(original.GetName(), std::move(methods), parent));
+    return compiled_.emplace(&original, std::move(cls)).first->second;
+}
+
+ObjectHolder CompiledMethod::Execute(Closure &closure, Context &context)
+{
+    if (!code_)
+    {
+        // Body that is not produced by parser is executed as it is
+        const auto *body = dynamic_cast<const ast::MethodBody *>(original_.body.get());
+        const auto &params = original_.formal_params;
+        code_ = make_unique<Code>(body != nullptr);
+        Compiler compiler(*code_, classes_, find(params.begin(), params.end(), RETURNED_VALUE) != params.end());
+        compiler.Compile(body ? body->GetBody() : *original_.body);
+        compiler.Finish();
+    }
+    if (const auto threshold = classes_.JitThreshold(); threshold && calls_++ == *threshold)
+    {
+        code_->CompileNative();
+    }
+    return code_->Execute(closure, context);
+}
+
+//! Returns number if object is exactly a Number, it's cheaper than TryAs
+const runtime::Number *ExactNumber(const ObjectHolder &object)
+{
+    const runtime::Object *ptr = object.Get();
+    return ptr && typeid(*ptr) == typeid(runtime::Number) ? static_cast<const runtime::Number *>(ptr) : nullptr;
+}
+
+ClassInstance &AsInstance(const ObjectHolder &object, const string &what)
+{
+    if (auto *instance = object.TryAs<ClassInstance>())
+    {
+        return *instance;
+    }
+    throw runtime_error(what + " of object that is not a class instance"s);
+}
+
+Flow Code::ExecPushConst(Frame &frame, const uint32_t *operands) const
+{
+    *frame.sp++ = constants_[operands[0]];
+    return Flow::Next;
+}
+
+Flow Code::ExecPushNone(Frame &frame, [[maybe_unused]] const uint32_t *operands) const
+{
+    *frame.sp++ = ObjectHolder::None();
+    return Flow::Next;
+}
+
+Flow Code::ExecLoadVar(Frame &frame, const uint32_t *operands) const
+{
+    const string &name = names_[operands[0]];
+    auto it = frame.closure.find(name);
+    if (it == frame.closure.end())
+    {
+        throw runtime_error("Unknown variable - "s + name);
+    }
+    *frame.sp++ = it->second;
+    return Flow::Next;
+}
+
+Flow Code::ExecLoadField(Frame &frame, const uint32_t *operands) const
+{
+    const string &name = names_[operands[0]];
+    auto *instance = frame.sp[-1].TryAs<ClassInstance>();
+    if (!instance)
+    {
+        throw runtime_error("Unknown variable - "s + name);
+    }
+    frame.sp[-1] = instance->Fields()[name];
+    return Flow::Next;
+}
+
+Flow Code::ExecStoreVar(Frame &frame, const uint32_t *operands) const
+{
+    frame.closure[names_[operands[0]]] = frame.sp[-1];
+    return Flow::Next;
+}
+
+Flow Code::ExecStoreField(Frame &frame, const uint32_t *operands) const
+{
+    const string &name = names_[operands[0]];
+    AsInstance(frame.sp[-2], "Field "s + name).Fields()[name] = frame.sp[-1];
+    frame.sp[-2] = std::move(frame.sp[-1]);
+    --frame.sp;
+    return Flow::Next;
+}
+
+Flow Code::ExecPop(Frame &frame, [[maybe_unused]] const uint32_t *operands) const
+{
+    *--frame.sp = ObjectHolder::None();
+    return Flow::Next;
+}
+
+Flow Code::ExecPrint(Frame &frame, const uint32_t *operands) const
+{
+    const bool separated = operands[0] != 0;
+    ostream &out = frame.context.GetOutputStream();
+    const ObjectHolder value = std::move(*--frame.sp);
+    if (value)
+    {
+        value->Print(out, frame.context);
+    }
+    else
+    {
+        out << "None"s;
+    }
+    if (separated)
+    {
+        out << ' ';
+    }
+    return Flow::Next;
+}
+
+Flow Code::ExecPrintEnd(Frame &frame, [[maybe_unused]] const uint32_t *operands) const
+{
+    frame.context.GetOutputStream() << '\n';
+    *frame.sp++ = ObjectHolder::None();
+    return Flow::Next;
+}
+
+Flow Code::ExecCallMethod(Frame &frame, const uint32_t *operands) const
+{
+    const string &name = names_[operands[0]];
+    const uint32_t count = operands[1];
+    ObjectHolder object = std::move(*--frame.sp);
+    ObjectHolder *args = frame.sp - count;
+    vector<ObjectHolder> actual_args(make_move_iterator(args), make_move_iterator(frame.sp));
+    frame.sp = args;
+    *frame.sp++ = AsInstance(object, "Method "s + name).Call(name, actual_args, frame.context);
+    return Flow::Next;
+}
+
+Flow Code::ExecNewInstance(Frame &frame, const uint32_t *operands) const
+{
+    *frame.sp++ = ObjectHolder::Own(ClassInstance(*classes_[operands[0]].TryAs<Class>()));
+    return Flow::Next;
+}
+
+Flow Code::ExecNewInstanceInit(Frame &frame, const uint32_t *operands) const
+{
+    const Class &cls = *classes_[operands[0]].TryAs<Class>();
+    const uint32_t count = operands[1];
+    ObjectHolder *args = frame.sp - count;
+    vector<ObjectHolder> actual_args(make_move_iterator(args), make_move_iterator(frame.sp));
+    const runtime::RootedValues rooted(actual_args);
+    frame.sp = args;
+    ObjectHolder object = ObjectHolder::Own(ClassInstance(cls));
+    if (auto post_init_object = object.TryAs<ClassInstance>()->Call(INIT_METHOD, actual_args, frame.context))
+    {
+        object = std::move(post_init_object);
+    }
+    *frame.sp++ = std::move(object);
+    return Flow::Next;
+}
+
+Flow Code::ExecStringify(Frame &frame, [[maybe_unused]] const uint32_t *operands) const
+{
+    frame.sp[-1] = ast::Stringify::Compute(frame.sp[-1], frame.context);
+    return Flow::Next;
+}
+
+Flow Code::ExecAdd(Frame &frame, [[maybe_unused]] const uint32_t *operands) const
+{
+    frame.sp[-2] = ast::Add::Compute(frame.sp[-2], frame.sp[-1], frame.context);
+    *--frame.sp = ObjectHolder::None();
+    return Flow::Next;
+}
+
+Flow Code::ExecSub(Frame &frame, [[maybe_unused]] const uint32_t *operands) const
+{
+    frame.sp[-2] = ast::Sub::Compute(frame.sp[-2], frame.sp[-1], frame.context);
+    *--frame.sp = ObjectHolder::None();
+    return Flow::Next;
+}
+
+Flow Code::ExecMult(Frame &frame, [[maybe_unused]] const uint32_t *operands) const
+{
+    frame.sp[-2] = ast::Mult::Compute(frame.sp[-2], frame.sp[-1], frame.context);
+    *--frame.sp = ObjectHolder::None();
+    return Flow::Next;
+}
+
+Flow Code::ExecDiv(Frame &frame, [[maybe_unused]] const uint32_t *operands) const
+{
+    frame.sp[-2] = ast::Div::Compute(frame.sp[-2], frame.sp[-1], frame.context);
+    *--frame.sp = ObjectHolder::None();
+    return Flow::Next;
+}
+
+Flow Code::ExecNot(Frame &frame, [[maybe_unused]] const uint32_t *operands) const
+{
+    frame.sp[-1] = ObjectHolder::Own(runtime::Bool(!runtime::IsTrue(frame.sp[-1])));
+    return Flow::Next;
+}
+
+Flow Code::ExecToBool(Frame &frame, [[maybe_unused]] const uint32_t *operands) const
+{
+    frame.sp[-1] = ObjectHolder::Own(runtime::Bool(runtime::IsTrue(frame.sp[-1])));
+    return Flow::Next;
+}
+
+Flow Code::ExecOrJump(Frame &frame, [[maybe_unused]] const uint32_t *operands) const
+{
+    if (runtime::IsTrue(frame.sp[-1]))
+    {
+        frame.sp[-1] = ObjectHolder::Own(runtime::Bool(true));
+        return Flow::Jump;
+    }
+    *--frame.sp = ObjectHolder::None();
+    return Flow::Next;
+}
+
+Flow Code::ExecAndJump(Frame &frame, [[maybe_unused]] const uint32_t *operands) const
+{
+    if (!runtime::IsTrue(frame.sp[-1]))
+    {
+        frame.sp[-1] = ObjectHolder::Own(runtime::Bool(false));
+        return Flow::Jump;
+    }
+    *--frame.sp = ObjectHolder::None();
+    return Flow::Next;
+}
+
+Flow Code::ExecCompare(Frame &frame, const uint32_t *operands) const
+{
+    const bool result = comparisons_[operands[0]]->GetComparator()(frame.sp[-2], frame.sp[-1], frame.context);
+    frame.sp[-2] = ObjectHolder::Own(runtime::Bool(result));
+    *--frame.sp = ObjectHolder::None();
+    return Flow::Next;
+}
+
+Flow Code::ExecJumpIfFalse(Frame &frame, [[maybe_unused]] const uint32_t *operands) const
+{
+    const bool condition = runtime::IsTrue(frame.sp[-1]);
+    *--frame.sp = ObjectHolder::None();
+    return condition ? Flow::Next : Flow::Jump;
+}
+
+Flow Code::ExecJump([[maybe_unused]] Frame &frame, [[maybe_unused]] const uint32_t *operands) const
+{
+    return Flow::Jump;
+}
+
+Flow Code::ExecDefineClass(Frame &frame, const uint32_t *operands) const
+{
+    const ObjectHolder &cls = classes_[operands[0]];
+    frame.closure[cls.TryAs<Class>()->GetName()] = cls;
+    *frame.sp++ = ObjectHolder::None();
+    return Flow::Next;
+}
+
+Flow Code::ExecReturn(Frame &frame, [[maybe_unused]] const uint32_t *operands) const
+{
+    frame.closure[RETURNED_VALUE] = std::move(*--frame.sp);
+    // Compound that is stopped by return has no value
+    frame.sp = frame.stack;
+    *frame.sp++ = ObjectHolder::None();
+    return Flow::Jump;
+}
+
+Flow Code::ExecCheckReturn(Frame &frame, [[maybe_unused]] const uint32_t *operands) const
+{
+    if (frame.closure.count(RETURNED_VALUE))
+    {
+        frame.sp = frame.stack;
+        *frame.sp++ = ObjectHolder::None();
+        return Flow::Jump;
+    }
+    return Flow::Next;
+}
+
+Flow Code::ExecRunStatement(Frame &frame, const uint32_t *operands) const
+{
+    *frame.sp++ = statements_[operands[0]]->Execute(frame.closure, frame.context);
+    return Flow::Next;
+}
+
+Flow Code::ExecEnd(Frame &frame, [[maybe_unused]] const uint32_t *operands) const
+{
+    if (method_body_)
+    {
+        auto it = frame.closure.find(RETURNED_VALUE);
+        frame.result = it != frame.closure.end() ? it->second : ObjectHolder::None();
+    }
+    else
+    {
+        frame.result = frame.sp != frame.stack ? frame.sp[-1] : ObjectHolder::None();
+    }
+    return Flow::Exit;
+}
+
+ObjectHolder Code::Execute(Closure &closure, Context &context)
+{
+    vector<ObjectHolder> stack(max_depth_);
+    const runtime::RootedValues rooted(stack);
+    Frame frame{*this, closure, context, stack.data(), stack.data(), {}, {}};
+    if (!native_)
+    {
+        return Interpret(frame);
+    }
+    native_->Run(&frame);
+    if (frame.error)
+    {
+        rethrow_exception(frame.error);
+    }
+    return std::move(frame.result);
+}
+
+ObjectHolder Code::Interpret(Frame &frame) const
+{
+    const uint32_t *code = code_.data();
+    const uint32_t *pc = code;
+
+#if MYTHON_VM_THREADED
+    // Every handler dispatches the next instruction itself, so that each of them has its own indirect jump
+    static const void *const handlers[] = {
+#define MYTHON_VM_LABEL(name, count) &&handle_##name,
+        MYTHON_VM_INSTRUCTIONS(MYTHON_VM_LABEL)
+#undef MYTHON_VM_LABEL
+    };
+#define VM_HANDLER(name) handle_##name:
+#define VM_NEXT() goto *handlers[*pc++]
+    VM_NEXT();
+#else
+#define VM_HANDLER(name) case Op::name:
+#define VM_NEXT() continue
+    while (true)
+    {
+        switch (static_cast<Op>(*pc++))
+        {
+#endif
+
+    // Hot instructions are executed here, so that they don't pay for a call and a check of its result
+    VM_HANDLER(PushConst)
+    {
+        *frame.sp++ = constants_[*pc++];
+        VM_NEXT();
+    }
+    VM_HANDLER(PushNone)
+    {
+        *frame.sp++ = ObjectHolder::None();
+        VM_NEXT();
+    }
+    VM_HANDLER(LoadVar)
+    {
+        const string &name = names_[*pc++];
+        auto it = frame.closure.find(name);
+        if (it == frame.closure.end())
+        {
+            throw runtime_error("Unknown variable - "s + name);
+        }
+        *frame.sp++ = it->second;
+        VM_NEXT();
+    }
+    VM_HANDLER(StoreVar)
+    {
+        frame.closure[names_[*pc++]] = frame.sp[-1];
+        VM_NEXT();
+    }
+    VM_HANDLER(Pop)
+    {
+        *--frame.sp = ObjectHolder::None();
+        VM_NEXT();
+    }
+    VM_HANDLER(Add)
+    {
+        const auto *lhs = ExactNumber(frame.sp[-2]);
+        const auto *rhs = ExactNumber(frame.sp[-1]);
+        frame.sp[-2] = lhs && rhs ? ObjectHolder::Own(runtime::Number(lhs->GetValue() + rhs->GetValue()))
+                                  : ast::Add::Compute(frame.sp[-2], frame.sp[-1], frame.context);
+        *--frame.sp = ObjectHolder::None();
+        VM_NEXT();
+    }
+    VM_HANDLER(Sub)
+    {
+        const auto *lhs = ExactNumber(frame.sp[-2]);
+        const auto *rhs = ExactNumber(frame.sp[-1]);
+        frame.sp[-2] = lhs && rhs ? ObjectHolder::Own(runtime::Number(lhs->GetValue() - rhs->GetValue()))
+                                  : ast::Sub::Compute(frame.sp[-2], frame.sp[-1], frame.context);
+        *--frame.sp = ObjectHolder::None();
+        VM_NEXT();
+    }
+    VM_HANDLER(Compare)
+    {
+        const ast::Comparison &comparison = *comparisons_[*pc++];
+        const auto *lhs = ExactNumber(frame.sp[-2]);
+        const auto *rhs = ExactNumber(frame.sp[-1]);
+        const bool result = lhs && rhs && comparison.ComparesValues()
+                                ? comparison.CompareNumbers(lhs->GetValue(), rhs->GetValue())
+                                : comparison.GetComparator()(frame.sp[-2], frame.sp[-1], frame.context);
+        frame.sp[-2] = ObjectHolder::Own(runtime::Bool(result));
+        *--frame.sp = ObjectHolder::None();
+        VM_NEXT();
+    }
+    VM_HANDLER(JumpIfFalse)
+    {
+        const bool condition = runtime::IsTrue(frame.sp[-1]);
+        *--frame.sp = ObjectHolder::None();
+        pc = condition ? pc + 1 : code + *pc;
+        VM_NEXT();
+    }
+    VM_HANDLER(Jump)
+    {
+        pc = code + *pc;
+        VM_NEXT();
+    }
+
+#define MYTHON_VM_STEP(name, count)                                                                                    \
+    VM_HANDLER(name)                                                                                                   \
+    {                                                                                                                  \
+        const Flow flow = Exec##name(frame, pc);                                                                       \
+        if (flow == Flow::Exit)                                                                                        \
+        {                                                                                                              \
+            return std::move(frame.result);                                                                            \
+        }                                                                                                              \
+        pc = flow == Flow::Jump ? code + *pc : pc + (count);                                                           \
+        VM_NEXT();                                                                                                     \
+    }
+    MYTHON_VM_CALLED_INSTRUCTIONS(MYTHON_VM_STEP)
+#undef MYTHON_VM_STEP
+
+#if !MYTHON_VM_THREADED
+        }
+    }
+#endif
+#undef VM_HANDLER
+#undef VM_NEXT
+}
+
+//! Runs operation for machine code, exception is kept in frame since it can't pass through machine code
+template <typename Operation> uint32_t Guarded(void *frame, Operation operation) noexcept
+{
+    auto &state = *static_cast<Frame *>(frame);
+    try
+    {
+        return static_cast<uint32_t>(operation(state));
+    }
+    catch (...)
+    {
+        state.error = current_exception();
+        return static_cast<uint32_t>(Flow::Error);
+    }
+}
+
+template <Flow (Code::*Exec)(Frame &, const uint32_t *) const>
+uint32_t Code::Thunk(void *frame, const void *operands) noexcept
+{
+    return Guarded(frame, [operands](Frame &state) {
+        return (state.code.*Exec)(state, static_cast<const uint32_t *>(operands));
+    });
+}
+
+//! Returns int that machine code computed and passed as operand
+int ResultOf(const void *operand)
+{
+    return static_cast<int>(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(operand))); // NOLINT
+}
+
+//! Replaces operands on top of stack by number computed by machine code
+uint32_t PushNumber(void *frame, const void *result) noexcept
+{
+    return Guarded(frame, [result](Frame &state) {
+        state.sp[-2] = ObjectHolder::Own(runtime::Number(ResultOf(result)));
+        *--state.sp = ObjectHolder::None();
+        return Flow::Next;
+    });
+}
+
+//! Replaces operands on top of stack by result of comparison computed by machine code
+uint32_t PushBool(void *frame, const void *result) noexcept
+{
+    return Guarded(frame, [result](Frame &state) {
+        state.sp[-2] = ObjectHolder::Own(runtime::Bool(ResultOf(result) != 0));
+        *--state.sp = ObjectHolder::None();
+        return Flow::Next;
+    });
+}
+
+//! Removes operands of comparison computed by machine code, goes to target of the jump if it's false
+uint32_t DropOperands(void *frame, const void *result) noexcept
+{
+    return Guarded(frame, [result](Frame &state) {
+        *--state.sp = ObjectHolder::None();
+        *--state.sp = ObjectHolder::None();
+        return ResultOf(result) != 0 ? Flow::Next : Flow::Jump;
+    });
+}
+
+//! Returns where machine code finds numbers on stack of frame, nothing if values don't start with object pointer
+optional<jit::NumberLayout> DetectNumberLayout()
+{
+    runtime::Number number(0);
+    const ObjectHolder holder = ObjectHolder::Share(number);
+    const runtime::Object *object = nullptr;
+    memcpy(&object, reinterpret_cast<const unsigned char *>(&holder), sizeof(object)); // NOLINT
+    if (object != &number)
+    {
+        return nullopt;
+    }
+    const void *number_type = nullptr;
+    memcpy(&number_type, reinterpret_cast<const unsigned char *>(&number), sizeof(number_type)); // NOLINT
+
+    // Frame is not standard layout, so offset of its member is measured on an instance
+    const Code code(false);
+    Closure closure;
+    runtime::DummyContext context;
+    const Frame frame{code, closure, context, nullptr, nullptr, {}, {}};
+    const auto offset = [](const void *member, const void *object) {
+        return static_cast<size_t>(static_cast<const char *>(member) - static_cast<const char *>(object));
+    };
+    return jit::NumberLayout{offset(&frame.sp, &frame), sizeof(ObjectHolder), number_type,
+                             offset(&number.GetValue(), &number)};
+}
+
+//! Returns condition of comparison of two numbers, it's found by comparing sample numbers.
+//! Nothing if comparison is not one of runtime comparisons
+optional<jit::Assembler::Condition> ConditionOf(const ast::Comparison &comparison)
+{
+    using Condition = jit::Assembler::Condition;
+    if (!comparison.ComparesValues())
+    {
+        return nullopt;
+    }
+    const bool less = comparison.CompareNumbers(0, 1);
+    const bool equal = comparison.CompareNumbers(0, 0);
+    const bool greater = comparison.CompareNumbers(1, 0);
+    if (less != greater)
+    {
+        if (equal)
+        {
+            return less ? Condition::LessOrEqual : Condition::GreaterOrEqual;
+        }
+        return less ? Condition::Less : Condition::Greater;
+    }
+    if (less && !equal)
+    {
+        return Condition::NotEqual;
+    }
+    if (!less && equal)
+    {
+        return Condition::Equal;
+    }
+    return nullopt;
+}
+
+void Code::CompileNative()
+{
+    // Every instruction is a call of its handler followed by jumps that depend on its result,
+    // unconditional jump is the only one that is not called. Numbers are added, subtracted and compared by
+    // machine code itself, handler is called for other operands
+    static const jit::Assembler::Function thunks[] = {
+#define MYTHON_VM_THUNK(name, count) &Thunk<&Code::Exec##name>,
+        MYTHON_VM_INSTRUCTIONS(MYTHON_VM_THUNK)
+#undef MYTHON_VM_THUNK
+    };
+    static const optional<jit::NumberLayout> layout = DetectNumberLayout();
+    jit::Assembler assembler;
+    vector<jit::Assembler::Label> labels;
+    for (size_t i = 0; i < code_.size(); ++i)
+    {
+        labels.push_back(assembler.NewLabel());
+    }
+    const auto exit = assembler.NewLabel();
+    for (size_t pc = 0; pc < code_.size(); pc += 1 + OPERAND_COUNTS[code_[pc]])
+    {
+        const auto op = static_cast<Op>(code_[pc]);
+        const uint32_t *operands = code_.data() + pc + 1;
+        const size_t next = pc + 1 + OPERAND_COUNTS[code_[pc]];
+        assembler.Bind(labels[pc]);
+        if (op == Op::Jump)
+        {
+            assembler.Jump(labels[operands[0]]);
+            continue;
+        }
+        const auto condition = op == Op::Compare ? ConditionOf(*comparisons_[operands[0]]) : nullopt;
+        if (layout && (op == Op::Add || op == Op::Sub || condition))
+        {
+            const auto generic = assembler.NewLabel();
+            assembler.LoadNumbers(*layout, generic);
+            if (op == Op::Add)
+            {
+                assembler.AddNumbers(generic);
+            }
+            else if (op == Op::Sub)
+            {
+                assembler.SubtractNumbers(generic);
+            }
+            else
+            {
+                assembler.CompareNumbers(*condition);
+            }
+            if (condition && static_cast<Op>(code_[next]) == Op::JumpIfFalse)
+            {
+                // Condition is checked right away, Bool is not created
+                assembler.CallWithResult(&DropOperands);
+                assembler.JumpIfEqual(static_cast<uint32_t>(Flow::Jump), labels[code_[next + 1]]);
+                assembler.JumpIfAbove(static_cast<uint32_t>(Flow::Jump), exit);
+                assembler.Jump(labels[next + 1 + OPERAND_COUNTS[code_[next]]]);
+            }
+            else
+            {
+                assembler.CallWithResult(condition ? &PushBool : &PushNumber);
+                assembler.JumpIfAbove(static_cast<uint32_t>(Flow::Jump), exit);
+                assembler.Jump(labels[next]);
+            }
+            assembler.Bind(generic);
+        }
+        assembler.Call(thunks[code_[pc]], operands);
+        if (Jumps(op))
+        {
+            assembler.JumpIfEqual(static_cast<uint32_t>(Flow::Jump), labels[operands[0]]);
+        }
+        assembler.JumpIfAbove(static_cast<uint32_t>(Flow::Jump), exit);
+    }
+    assembler.Bind(exit);
+    assembler.Return();
+    native_ = assembler.Finish();
+}
+
+//! Compiled program, keeps the original one unless it's kept by caller
+class Program : public runtime::Executable
+{
+  public:
+    Program(unique_ptr<runtime::Executable> original, const Options &options) : Program(*original, options)
+    {
+        original_ = std::move(original);
+    }
+
+    Program(const runtime::Executable &original, const Options &options)
+        : classes_(options.jit_threshold), code_(false)
+    {
+        Compiler compiler(code_, classes_, true);
+        compiler.Compile(original);
+        compiler.Finish();
+        // Program is executed once, so it's compiled to machine code only if everything is
+        if (options.jit_threshold == 0U)
+        {
+            code_.CompileNative();
+        }
+    }
+
+    ObjectHolder Execute(Closure &closure, Context &context) override
+    {
+        return code_.Execute(closure, context);
+    }
+
+  private:
+    unique_ptr<runtime::Executable> original_;
+    Classes classes_;
+    Code code_;
+};
+
+} // namespace
+
+optional<size_t> DefaultJitThreshold()
+{
+    if (!jit::Supported())
+    {
+        return nullopt;
+    }
+#ifdef MYTHON_JIT_TEST
+    return 0;
+#else
+    return JIT_THRESHOLD;
+#endif
+}
+
+unique_ptr<runtime::Executable> Compile(unique_ptr<runtime::Executable> program, const Options &options)
+{
+    return make_unique<Program>(std::move(program), options);
+}
+
+unique_ptr<runtime::Executable> Compile(const runtime::Executable &program, const Options &options)
+{
+    return make_unique<Program>(program, options);
+}
+
+string_view DispatchName()
+{
+    return MYTHON_VM_THREADED ? "computed goto"sv : "switch"sv;
+}
+
+} // namespace vm
@@ -0,0 +1,42 @@
+/*!
+ * \file vm.h
+ * \brief Bytecode interpreter, alternative to executing syntax tree directly
+ */
+#pragma once
+
+#include "runtime.h"
+
+#include <memory>
+#include <optional>
+#include <string_view>
+
+namespace vm
+{
+
+//! Returns number of calls after which method is compiled to machine code, nothing if it's not supported.
+//! Everything is compiled at once by build made for testing machine code
+std::optional<size_t> DefaultJitThreshold();
+
+struct Options
+{
+    //! Method is compiled to machine code after this number of calls, program itself is compiled if it's zero.
+    //! Machine code is not used if it's not set
+    std::optional<size_t> jit_threshold = DefaultJitThreshold();
+};
+
+/*!
+ * Compiles program into bytecode of stack machine. Compiled program keeps the original one,
+ * statements that are not syntax tree nodes are executed as they are. Classes are copied, methods of copies
+ * are compiled when they are called first time, and to machine code when they become hot.
+ * Compiled program must outlive objects it created
+ */
+std::unique_ptr<runtime::Executable> Compile(std::unique_ptr<runtime::Executable> program,
+                                             const Options &options = {});
+
+//! Compiles program the same way, but compiled program refers to the given one, which must outlive it
+std::unique_ptr<runtime::Executable> Compile(const runtime::Executable &program, const Options &options = {});
+
+//! Returns name of instructions dispatch technique interpreter is built with
+std::string_view DispatchName();
+
+} // namespace vm
@@ -0,0 +1,192 @@
+#include "cache.h"
+#include "lexer.h"
+#include "parse.h"
+#include "statement.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+#include <cstdio>
+
+using namespace std;
+
+namespace cache
+{
+
+namespace
+{
+// Uses every kind of statement, classes with inheritance and instantiation inside methods
+const string PROGRAM = R"(
+class Shape:
+  def __init__(name):
+    self.name = name
+
+  def __str__():
+    return 'Shape ' + self.name
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.name = "rect"
+    self.w = w
+    self.h = h
+
+  def Area():
+    return self.w * self.h
+
+  def __eq__(other):
+    return self.Area() == other.Area()
+
+class Factory:
+  def Make(n):
+    if n > 10 or not n >= 0:
+      return None
+    else:
+      return Rect(n, n / 2 - 1)
+
+f = Factory()
+r = f.Make(6)
+big = f.Make(20)
+print r, r.Area(), big, str(r.w) + "x" + str(r.h)
+print r == Rect(3, 4), r != Rect(1, 1), 2 < 3 and 3 <= 3, True, False
+)"s;
+
+string Write(const runtime::Executable &program, string_view source)
+{
+    ostringstream output;
+    WriteProgram(output, program, source);
+    return output.str();
+}
+} // namespace
+
+void TestCachedProgramRunsSame()
+{
+    auto program = TestProgram::Parse(PROGRAM);
+    const string expected = TestProgram::Run(*program);
+    ASSERT_EQUAL(expected, "Shape rect 12 None 6x2\nTrue True True True False\n"s);
+
+    const string data = Write(*program, PROGRAM);
+    auto loaded = ReadProgram(data, PROGRAM);
+    ASSERT(loaded != nullptr);
+    ASSERT_EQUAL(TestProgram::Run(*loaded), expected);
+
+    // Loaded program is written exactly the same way
+    ASSERT_EQUAL(Write(*loaded, PROGRAM), data);
+}
+
+void TestStaleCacheIsIgnored()
+{
+    auto program = TestProgram::Parse(PROGRAM);
+    string data = Write(*program, PROGRAM);
+
+    ASSERT(ReadProgram(data, PROGRAM + "print 1\n"s) == nullptr);
+
+    // Format version follows the magic
+    data[4] = static_cast<char>(FORMAT_VERSION + 1);
+    ASSERT(ReadProgram(data, PROGRAM) == nullptr);
+}
+
+void TestDamagedCache()
+{
+    auto program = TestProgram::Parse(PROGRAM);
+    const string data = Write(*program, PROGRAM);
+
+    ASSERT_THROWS(ReadProgram("garbage"sv, PROGRAM), CacheError);
+    for (size_t size : {data.size() / 2, data.size() - 1})
+    {
+        ASSERT_THROWS(ReadProgram(string_view(data).substr(0, size), PROGRAM), CacheError);
+    }
+    ASSERT_THROWS(ReadProgram(data + "x"s, PROGRAM), CacheError);
+}
+
+void TestDeeplyNestedCache()
+{
+    // Data ends with tags of "not" and None
+    const string data = Write(ast::Not(make_unique<ast::None>()), ""sv);
+    const string header = data.substr(0, data.size() - 2);
+    const auto nested = [&](size_t depth) {
+        return header + string(depth, data[header.size()]) + data.back();
+    };
+    ASSERT(ReadProgram(nested(100), ""sv) != nullptr);
+    // Stack isn't overflowed by damaged data
+    ASSERT_THROWS(ReadProgram(nested(1'000'000), ""sv), CacheError);
+}
+
+void TestDeeplyNestedProgram()
+{
+    const auto sum = [](size_t terms) {
+        string source = "x = 1"s;
+        for (size_t i = 1; i < terms; ++i)
+        {
+            source += " + 1"s;
+        }
+        return source + "\nprint x\n"s;
+    };
+    const string shallow = sum(100);
+    auto program = TestProgram::Parse(shallow);
+    ASSERT(ReadProgram(Write(*program, shallow), shallow) != nullptr);
+
+    // Program that can't be read back isn't written, so that it isn't rewritten on every run
+    const string deep = sum(1500);
+    program = TestProgram::Parse(deep);
+    ASSERT_THROWS(Write(*program, deep), CacheError);
+
+    // Writer and reader agree on the deepest program
+    unique_ptr<ast::Statement> chain = make_unique<ast::None>();
+    for (size_t depth = 1; depth < MAX_DEPTH; ++depth)
+    {
+        chain = make_unique<ast::Not>(std::move(chain));
+    }
+    ASSERT(ReadProgram(Write(*chain, ""sv), ""sv) != nullptr);
+    chain = make_unique<ast::Not>(std::move(chain));
+    ASSERT_THROWS(Write(*chain, ""sv), CacheError);
+}
+
+void TestNotCacheableProgram()
+{
+    struct Builtin : runtime::Executable
+    {
+        runtime::ObjectHolder Execute([[maybe_unused]] runtime::Closure &closure,
+                                      [[maybe_unused]] runtime::Context &context) override
+        {
+            return {};
+        }
+    };
+    vector<runtime::Method> methods;
+    methods.push_back({"f"s, {}, make_unique<Builtin>()});
+    auto cls = runtime::ObjectHolder::Own(runtime::Class("Builtin"s, std::move(methods), nullptr));
+
+    // Class with built-in method, and class that is not defined by program
+    ASSERT_THROWS(Write(ast::ClassDefinition(cls), ""sv), CacheError);
+    const runtime::Class empty("Empty"s, {}, nullptr);
+    ASSERT_THROWS(Write(ast::NewInstance(empty), ""sv), CacheError);
+}
+
+void TestCacheFile()
+{
+    const string path = "mini_python_cache_test.myc"s;
+    remove(path.c_str());
+    ASSERT(LoadProgram(path, PROGRAM) == nullptr);
+
+    auto program = TestProgram::Parse(PROGRAM);
+    StoreProgram(path, *program, PROGRAM);
+    ASSERT(!MappedFile(path).Data().empty());
+
+    auto loaded = LoadProgram(path, PROGRAM);
+    ASSERT(loaded != nullptr);
+    ASSERT_EQUAL(TestProgram::Run(*loaded), TestProgram::Run(*program));
+    ASSERT(LoadProgram(path, "print 1\n"sv) == nullptr);
+
+    remove(path.c_str());
+}
+
+void RunCacheTests(TestRunner &tr)
+{
+    RUN_TEST(tr, cache::TestCachedProgramRunsSame);
+    RUN_TEST(tr, cache::TestStaleCacheIsIgnored);
+    RUN_TEST(tr, cache::TestDamagedCache);
+    RUN_TEST(tr, cache::TestDeeplyNestedCache);
+    RUN_TEST(tr, cache::TestDeeplyNestedProgram);
+    RUN_TEST(tr, cache::TestNotCacheableProgram);
+    RUN_TEST(tr, cache::TestCacheFile);
+}
+
+} // namespace cache
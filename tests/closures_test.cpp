@@ -0,0 +1,172 @@
+#include "closures.h"
+#include "infer.h"
+#include "statement.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace closures
+{
+
+namespace
+{
+
+//! Runs program, with types inferred if asked, compiled to closures if tier-up threshold is given
+string Run(const string &source, optional<size_t> tier_up_threshold, bool infer = false, Stats *stats = nullptr)
+{
+    auto program = TestProgram::Parse(source);
+    if (infer)
+    {
+        ast::InferTypes(program);
+    }
+    if (tier_up_threshold)
+    {
+        program = Compile(std::move(program), Options{*tier_up_threshold, stats, {}});
+    }
+    return TestProgram::Run(*program);
+}
+
+} // namespace
+
+void TestCompiledRunsSame()
+{
+    const string programs[] = {
+        R"(
+x = 4
+y = 'a'
+print x + 2 * 3 - 8 / 4, y + 'b', str(x) + y, str(None), not x
+print x > 3 and y == 'a', x < 3 or y != 'a', x <= 4, x >= 5, 0 or 0, 1 and 'b', 'a' < 'b'
+)",
+        R"(
+class Fib:
+  def calc(n):
+    if n < 2:
+      return n
+    return self.calc(n - 1) + self.calc(n - 2)
+
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add(n):
+    if n > 0:
+      self.value = self.value + n
+      self.add(n - 1)
+
+  def __str__():
+    return 'Counter ' + str(self.value)
+
+class Named(Counter):
+  def __init__(name):
+    self.name = name
+    self.value = 1
+
+  def __eq__(other):
+    return self.value == other.value
+
+  def __lt__(other):
+    return self.value < other.value
+
+fib = Fib()
+counter = Counter()
+counter.add(20)
+named = Named('n')
+named.add(19)
+print fib.calc(15), counter, named, named.name, named == counter, named < counter, named >= counter
+)",
+        // Statements after return and after assignment of "returned_value" are not executed
+        R"(
+class A:
+  def f(n):
+    if n:
+      print 'then'
+      return 1
+    else:
+      returned_value = 2
+      print 'not printed'
+    print 'not printed either'
+
+  def g(returned_value):
+    print 'stops after this'
+    print 'not printed'
+
+a = A()
+print a.f(True), a.f(False), a.g(3)
+)",
+        R"(
+class A:
+  def div(n):
+    if n > 0:
+      return self.div(n - 1)
+    return 1 / n
+
+a = A()
+print a.div(5)
+)",
+        R"(
+x = 1
+print x.y
+)",
+    };
+    for (const auto &program : programs)
+    {
+        const string tree = Run(program, nullopt);
+        // Everything compiled at once, methods compiled while they are executed, and methods that are never hot
+        for (const size_t threshold : {0U, 3U, 1000000U})
+        {
+            ASSERT_EQUAL(Run(program, threshold), tree);
+            ASSERT_EQUAL(Run(program, threshold, true), tree);
+        }
+    }
+}
+
+void TestCompiledErrors()
+{
+    // Method call of not an instance is an error rather than undefined behavior
+    ASSERT_EQUAL(Run("x = 1\nprint x.f()\n", 0), "error: Method f of object that is not a class instance"s);
+    ASSERT_EQUAL(Run("x = 1\nx.y = 2\n", 0), "error: Field y of object that is not a class instance"s);
+}
+
+void TestTierUp()
+{
+    const string program = R"(
+class Fib:
+  def __init__():
+    self.calls = 0
+
+  def calc(n):
+    self.calls = self.calls + 1
+    if n < 2:
+      return n
+    return self.calc(n - 1) + self.calc(n - 2)
+
+  def unused():
+    return 0
+
+fib = Fib()
+print fib.calc(5), fib.calls
+)";
+    Stats stats;
+    ASSERT_EQUAL(Run(program, 4, false, &stats), "5 15\n"s);
+    ASSERT_EQUAL(stats.methods.size(), 3U);
+    ASSERT_EQUAL(stats.methods[0].name, "Fib.__init__"s);
+    ASSERT_EQUAL(stats.methods[0].calls, 1U);
+    ASSERT(!stats.methods[0].compiled_after);
+    ASSERT_EQUAL(stats.methods[1].name, "Fib.calc"s);
+    ASSERT_EQUAL(stats.methods[1].calls, 15U);
+    ASSERT_EQUAL(stats.methods[1].compiled_after.value_or(0), 4U);
+
+    ostringstream output;
+    PrintStats(stats, output);
+    ASSERT_EQUAL(output.str(), "Fib.calc: 15 calls, compiled after 4\nFib.__init__: 1 call, not compiled\n"s);
+}
+
+void RunClosuresTests(TestRunner &tr)
+{
+    RUN_TEST(tr, closures::TestCompiledRunsSame);
+    RUN_TEST(tr, closures::TestCompiledErrors);
+    RUN_TEST(tr, closures::TestTierUp);
+}
+
+} // namespace closures
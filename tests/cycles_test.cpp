@@ -0,0 +1,264 @@
+#include "cycles.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace runtime
+{
+
+namespace
+{
+
+//! Disables automatic collection while it exists, so tests count instances themselves
+class ManualCollection
+{
+  public:
+    ManualCollection() : options_(GetCollectorOptions())
+    {
+        CollectorOptions manual = options_;
+        manual.thresholds[0] = 0;
+        SetCollectorOptions(manual);
+        CollectCycles();
+    }
+
+    ManualCollection(const ManualCollection &) = delete;
+    ManualCollection &operator=(const ManualCollection &) = delete;
+
+    ~ManualCollection()
+    {
+        SetCollectorOptions(options_);
+    }
+
+  private:
+    CollectorOptions options_;
+};
+
+#ifndef MYTHON_TRACING_GC
+
+//! Method body that collects every generation while the method is executed
+class CollectingBody : public Executable
+{
+  public:
+    ObjectHolder Execute([[maybe_unused]] Closure &closure, [[maybe_unused]] Context &context) override
+    {
+        return ObjectHolder::Own(Number(static_cast<int>(CollectCycles())));
+    }
+};
+
+#endif
+
+//! Program that leaves 200 cycles of two instances as garbage
+const string CYCLES_PROGRAM = R"(
+class Node:
+  def __init__(next):
+    self.next = next
+
+class Maker:
+  def pair():
+    a = Node(None)
+    b = Node(a)
+    a.next = b
+
+  def make(n):
+    if n > 0:
+      self.pair()
+      self.make(n - 1)
+
+m = Maker()
+m.make(200)
+print 'done'
+)";
+
+void RunProgram(const string &source)
+{
+    auto program = TestProgram::Parse(source);
+    ASSERT_EQUAL(TestProgram::Run(*program), "done\n"s);
+}
+
+} // namespace
+
+#ifndef MYTHON_TRACING_GC
+
+void TestSelfReference()
+{
+    ManualCollection manual;
+    Class cls{"Node"s, {}, nullptr};
+    const size_t tracked = TrackedInstances();
+    {
+        ObjectHolder node = ObjectHolder::Own(ClassInstance(cls));
+        node.TryAs<ClassInstance>()->Fields()["me"s] = node;
+        ASSERT_EQUAL(TrackedInstances(), tracked + 1);
+        // Instance is referred to by variable
+        ASSERT_EQUAL(CollectCycles(), 0U);
+    }
+    ASSERT_EQUAL(TrackedInstances(), tracked + 1);
+    ASSERT_EQUAL(CollectCycles(), 1U);
+    ASSERT_EQUAL(TrackedInstances(), tracked);
+}
+
+void TestLinkedInstances()
+{
+    ManualCollection manual;
+    Class cls{"Node"s, {}, nullptr};
+    const size_t tracked = TrackedInstances();
+    ObjectHolder head = ObjectHolder::Own(ClassInstance(cls));
+    ObjectHolder tail = head;
+    for (int i = 0; i < 10; ++i)
+    {
+        ObjectHolder node = ObjectHolder::Own(ClassInstance(cls));
+        tail.TryAs<ClassInstance>()->Fields()["next"s] = node;
+        node.TryAs<ClassInstance>()->Fields()["prev"s] = tail;
+        node.TryAs<ClassInstance>()->Fields()["value"s] = ObjectHolder::Own(Number(i));
+        tail = node;
+    }
+    tail = ObjectHolder::None();
+    ASSERT_EQUAL(CollectCycles(), 0U);
+    // Instance that doesn't own what it refers to keeps it from being collected
+    ObjectHolder observer = ObjectHolder::Own(ClassInstance(cls));
+    observer.TryAs<ClassInstance>()->Fields()["list"s] = ObjectHolder::Share(*head);
+    head = ObjectHolder::None();
+    ASSERT_EQUAL(CollectCycles(), 0U);
+    observer = ObjectHolder::None();
+    ASSERT_EQUAL(CollectCycles(), 11U);
+    ASSERT_EQUAL(TrackedInstances(), tracked);
+}
+
+void TestGenerations()
+{
+    ManualCollection manual;
+    Class cls{"Node"s, {}, nullptr};
+    const CollectorStats before = GetCollectorStats();
+    ObjectHolder node = ObjectHolder::Own(ClassInstance(cls));
+    node.TryAs<ClassInstance>()->Fields()["me"s] = node;
+    // Instance survives collection of young generation and becomes older
+    ASSERT_EQUAL(CollectCycles(0), 0U);
+    node = ObjectHolder::None();
+    ASSERT_EQUAL(CollectCycles(0), 0U);
+    ASSERT_EQUAL(CollectCycles(1), 1U);
+    const CollectorStats &after = GetCollectorStats();
+    ASSERT_EQUAL(after.collections[0], before.collections[0] + 2);
+    ASSERT_EQUAL(after.collections[1], before.collections[1] + 1);
+    ASSERT_EQUAL(after.collected, before.collected + 1);
+}
+
+void TestInstanceOfExecutedMethod()
+{
+    ManualCollection manual;
+    vector<Method> methods;
+    methods.push_back({"collect"s, {}, make_unique<CollectingBody>()});
+    Class cls{"Node"s, std::move(methods), nullptr};
+    ObjectHolder node = ObjectHolder::Own(ClassInstance(cls));
+    node.TryAs<ClassInstance>()->Fields()["me"s] = node;
+    auto *instance = node.TryAs<ClassInstance>();
+    node = ObjectHolder::None();
+    DummyContext context;
+    // Method is executed for instance that is referred to only by itself
+    ASSERT_EQUAL(instance->Call("collect"s, {}, context).TryAs<Number>()->GetValue(), 0);
+    ASSERT_EQUAL(CollectCycles(), 1U);
+}
+
+void TestAutomaticCollection()
+{
+    const CollectorOptions options = GetCollectorOptions();
+    CollectorOptions small = options;
+    small.thresholds = {20, 2, 2};
+    SetCollectorOptions(small);
+    const CollectorStats before = GetCollectorStats();
+    const size_t tracked = TrackedInstances();
+    RunProgram(CYCLES_PROGRAM);
+    SetCollectorOptions(options);
+    const CollectorStats &after = GetCollectorStats();
+    ASSERT(after.collections[0] > before.collections[0]);
+    ASSERT(after.collections[2] > before.collections[2]);
+    ASSERT(after.collected > before.collected);
+    CollectCycles();
+    ASSERT_EQUAL(TrackedInstances(), tracked);
+    ASSERT_EQUAL(GetCollectorStats().collected, before.collected + 400);
+}
+
+#else
+
+void TestRootedObjects()
+{
+    ManualCollection manual;
+    Class cls{"Node"s, {}, nullptr};
+    Closure closure;
+    closure["node"s] = ObjectHolder::Own(ClassInstance(cls));
+    closure["node"s].TryAs<ClassInstance>()->Fields()["value"s] = ObjectHolder::Own(Number(42));
+    const vector<ObjectHolder> args = {ObjectHolder::Own(String("arg"s))};
+    const RootedValues rooted(args);
+    const size_t objects = TrackedInstances();
+    CollectCycles();
+    // Objects of closure, fields of instances and rooted values survive collection
+    ASSERT_EQUAL(TrackedInstances(), objects);
+    ASSERT_EQUAL(closure.at("node"s).TryAs<ClassInstance>()->Fields().at("value"s).TryAs<Number>()->GetValue(), 42);
+    ASSERT_EQUAL(args[0].TryAs<String>()->GetValue(), "arg"s);
+}
+
+//! Returns fields of new instance, the instance itself isn't referred to by the caller
+[[gnu::noinline]] Closure &NewFields(const Class &cls)
+{
+    return ObjectHolder::Own(ClassInstance(cls)).TryAs<ClassInstance>()->Fields();
+}
+
+void TestInteriorPointers()
+{
+    ManualCollection manual;
+    Class cls{"Node"s, {}, nullptr};
+    const size_t objects = TrackedInstances();
+    // Stack refers to the middle of instance, as statement that assigns field does
+    Closure *volatile fields = &NewFields(cls);
+    (*fields)["value"s] = ObjectHolder::Own(Number(42));
+    CollectCycles();
+    ASSERT_EQUAL(TrackedInstances(), objects + 2);
+    ASSERT_EQUAL(fields->at("value"s).TryAs<Number>()->GetValue(), 42);
+}
+
+void TestAutomaticCollection()
+{
+    const CollectorOptions options = GetCollectorOptions();
+    CollectorOptions small = options;
+    small.thresholds = {20, 2, 2};
+    SetCollectorOptions(small);
+    const CollectorStats before = GetCollectorStats();
+    RunProgram(CYCLES_PROGRAM);
+    SetCollectorOptions(options);
+    const CollectorStats &after = GetCollectorStats();
+    ASSERT(after.collections[0] > before.collections[0]);
+    // Numbers and strings are collected along with instances of cycles
+    CollectCycles();
+    ASSERT(GetCollectorStats().collected >= before.collected + 400);
+}
+
+#endif
+
+void TestPrintStats()
+{
+    ostringstream output;
+    PrintCollectorStats(CollectorStats{{3, 2, 1}, 10, 4}, output);
+#ifdef MYTHON_TRACING_GC
+    // Heap isn't divided into generations
+    ASSERT_EQUAL(output.str(), "gc: 3 collections, 10 examined, 4 collected\n"s);
+#else
+    ASSERT_EQUAL(output.str(), "gc: 3 collections of generation 0, 2 collections of generation 1, 1 collections of "
+                               "generation 2, 10 examined, 4 collected\n"s);
+#endif
+}
+
+void RunCyclesTests(TestRunner &tr)
+{
+#ifndef MYTHON_TRACING_GC
+    RUN_TEST(tr, runtime::TestSelfReference);
+    RUN_TEST(tr, runtime::TestLinkedInstances);
+    RUN_TEST(tr, runtime::TestGenerations);
+    RUN_TEST(tr, runtime::TestInstanceOfExecutedMethod);
+#else
+    RUN_TEST(tr, runtime::TestRootedObjects);
+    RUN_TEST(tr, runtime::TestInteriorPointers);
+#endif
+    RUN_TEST(tr, runtime::TestAutomaticCollection);
+    RUN_TEST(tr, runtime::TestPrintStats);
+}
+
+} // namespace runtime
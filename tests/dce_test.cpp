@@ -0,0 +1,201 @@
+#include "dce.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace ast
+{
+
+namespace
+{
+
+//! Counts conditional and print statements, names defined classes with their methods
+class Counter : public TreeVisitor
+{
+  public:
+    void Visit(const IfElse &node) override
+    {
+        ++conditions;
+        TreeVisitor::Visit(node);
+    }
+
+    void Visit(const Print &node) override
+    {
+        ++prints;
+        TreeVisitor::Visit(node);
+    }
+
+    void Visit(const ClassDefinition &node) override
+    {
+        const auto &cls = *node.GetClass().TryAs<runtime::Class>();
+        classes += cls.GetName() + "("s;
+        for (const auto &method : cls.GetMethods())
+        {
+            classes += " "s + method.name;
+        }
+        classes += " ) "s;
+        TreeVisitor::Visit(node);
+    }
+
+    size_t conditions = 0;
+    size_t prints = 0;
+    string classes;
+};
+
+Counter Count(const Statement &program)
+{
+    Counter counter;
+    Accept(program, counter);
+    return counter;
+}
+
+} // namespace
+
+void TestConstantBranches()
+{
+    const string source = R"(
+if True:
+  print 'then'
+else:
+  print 'else'
+if 0:
+  print 'number'
+if '':
+  print 'empty'
+else:
+  print 'string'
+if None:
+  print 'none'
+x = 1
+if x:
+  print 'variable'
+)";
+    auto program = TestProgram::Parse(source);
+    const string expected = TestProgram::Run(*program);
+    EliminateDeadCode(program);
+    ASSERT_EQUAL(TestProgram::Run(*program), expected);
+    ASSERT_EQUAL(TestProgram::Run(*program), "then\nstring\nvariable\n"s);
+    ASSERT_EQUAL(Count(*program).conditions, 1U);
+    ASSERT_EQUAL(Count(*program).prints, 3U);
+}
+
+void TestStatementsAfterReturn()
+{
+    const string source = R"(
+class Sign:
+  def of(x):
+    if x < 0:
+      return -1
+      print 'after return'
+    else:
+      if x > 0:
+        return 1
+      else:
+        return 0
+      print 'after both branches'
+    print 'after if'
+    return 2
+
+  def first(x):
+    if True:
+      return x
+    print 'after constant branch'
+
+s = Sign()
+print s.of(-5), s.of(5), s.of(0), s.first(7)
+)";
+    auto program = TestProgram::Parse(source);
+    const string expected = TestProgram::Run(*program);
+    EliminateDeadCode(program);
+    ASSERT_EQUAL(TestProgram::Run(*program), expected);
+    ASSERT_EQUAL(Count(*program).prints, 1U);
+}
+
+void TestUnusedClasses()
+{
+    const string source = R"(
+class Helper:
+  def help():
+    return 1
+
+class Base:
+  def __str__():
+    return 'base'
+
+  def unused():
+    return Helper()
+
+class Lonely:
+  def __init__():
+    self.x = 0
+
+class Shape(Base):
+  def area():
+    return self.side()
+
+  def side():
+    return 2
+
+  def unused():
+    return Lonely()
+
+class Named:
+  def name():
+    return 'named'
+
+class Nested:
+  def make():
+    if True:
+      class Inner:
+        def call():
+          return 3
+
+        def never():
+          return 4
+      inner = Inner()
+      return inner.call()
+
+s = Shape()
+print s, s.area()
+print Named
+nested = Nested()
+print nested.make()
+)";
+    auto program = TestProgram::Parse(source);
+    const string expected = TestProgram::Run(*program);
+    RemoveUnusedClasses(program);
+    ASSERT_EQUAL(TestProgram::Run(*program), expected);
+    ASSERT_EQUAL(Count(*program).classes,
+                 "Base( __str__ ) Shape( area side ) Named( ) Nested( make ) Inner( call ) "s);
+}
+
+void TestUnknownCodeKeepsClasses()
+{
+    const string source = R"(
+class Unused:
+  def method():
+    return 1
+
+class Used:
+  def method():
+    return 2
+
+used = Used()
+print used.method()
+)";
+    auto program = TestProgram::Parse(source, MethodParsing::Lazy);
+    RemoveUnusedClasses(program);
+    ASSERT_EQUAL(Count(*program).classes, "Unused( method ) Used( method ) "s);
+    ASSERT_EQUAL(TestProgram::Run(*program), "2\n"s);
+}
+
+void RunDceTests(TestRunner &tr)
+{
+    RUN_TEST(tr, ast::TestConstantBranches);
+    RUN_TEST(tr, ast::TestStatementsAfterReturn);
+    RUN_TEST(tr, ast::TestUnusedClasses);
+    RUN_TEST(tr, ast::TestUnknownCodeKeepsClasses);
+}
+
+} // namespace ast
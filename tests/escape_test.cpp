@@ -0,0 +1,138 @@
+#include "cache.h"
+#include "escape.h"
+#include "passes.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace ast
+{
+
+namespace
+{
+
+//! Checks that program prints the same with and without local temporaries, returns number of replaced nodes
+size_t CheckSame(const string &source, const string &expected)
+{
+    auto program = TestProgram::Parse(source);
+    ASSERT_EQUAL(TestProgram::Run(*program), expected);
+    auto local = TestProgram::Parse(source);
+    KeepTemporariesLocal(local);
+    ASSERT_EQUAL(TestProgram::Run(*local), expected);
+    return TestProgram::CountReplaced(local);
+}
+
+} // namespace
+
+void TestLocalArithmetic()
+{
+    const size_t replaced = CheckSame(R"(
+a = 3
+b = 4
+c = 5
+x = a * b + c
+print x, a * b - c * 2, (a + b) * (c - a) / 2, a + 1
+print 'a' + 'b' + 'c', 'x' + str(a * b)
+)",
+                                      "17 2 7 4\nabc x12\n"s);
+    // Operations whose operands are not arithmetic, such as "a + 1", aren't replaced
+    ASSERT_EQUAL(replaced, 4U);
+}
+
+void TestLocalConditions()
+{
+    const size_t replaced = CheckSame(R"(
+a = 3
+b = 4
+if a * b > 10 and not a + b == 8:
+  print 'yes'
+else:
+  print 'no'
+if a < b or 1 / 0:
+  print 'short'
+if a:
+  print 'plain'
+x = a + 1 < b
+y = a < b and b < a
+print x, y, not a > b
+)",
+                                      "yes\nshort\nplain\nFalse False True\n"s);
+    // "if a:" whose condition is a variable isn't replaced
+    ASSERT_EQUAL(replaced, 5U);
+}
+
+void TestMixedOperands()
+{
+    CheckSame(R"(
+class Money:
+  def __init__(amount):
+    self.amount = amount
+
+  def __add__(other):
+    return self.amount + other * 2
+
+  def __lt__(other):
+    return self.amount < other
+
+m = Money(10)
+print m + 1 * 3, 'x' + 'y' * 2
+)",
+              "16 error: Incorrect multiplication"s);
+    CheckSame(R"(
+class Money:
+  def __init__(amount):
+    self.amount = amount
+
+  def __add__(other):
+    return self.amount + other * 2
+
+  def __lt__(other):
+    return self.amount < other
+
+m = Money(10)
+if m < 5 + 6:
+  print m + 1 * 3
+print 1 + 2 * 3 / (2 - 2)
+)",
+              "16\nerror: Incorrect division"s);
+}
+
+void TestReplacedNodesAreVisitedAsOriginal()
+{
+    const string source = R"(
+class Point:
+  def dist(x, y):
+    if x * x + y * y > 25 or not x < y:
+      return x * x + y * y
+    return 0
+
+p = Point()
+print p.dist(3, 4), p.dist(5, 1)
+)";
+    auto program = TestProgram::Parse(source);
+    // Cache is written by visitor of the tree
+    ostringstream original;
+    cache::WriteProgram(original, *program, source);
+    KeepTemporariesLocal(program);
+    ostringstream local;
+    cache::WriteProgram(local, *program, source);
+    ASSERT_EQUAL(local.str(), original.str());
+    ASSERT_EQUAL(TestProgram::Run(*program), "0 26\n"s);
+
+    // Dump shows replaced nodes
+    ostringstream dump;
+    passes::DumpTree(*program, dump);
+    ASSERT(dump.str().find("LocalIfElse\n"s) != string::npos);
+    ASSERT(dump.str().find("LocalArithmetic\n"s) != string::npos);
+}
+
+void RunEscapeTests(TestRunner &tr)
+{
+    RUN_TEST(tr, ast::TestLocalArithmetic);
+    RUN_TEST(tr, ast::TestLocalConditions);
+    RUN_TEST(tr, ast::TestMixedOperands);
+    RUN_TEST(tr, ast::TestReplacedNodesAreVisitedAsOriginal);
+}
+
+} // namespace ast
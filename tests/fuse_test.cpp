@@ -0,0 +1,162 @@
+#include "fuse.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace ast
+{
+
+namespace
+{
+
+//! Runs program, with common statement shapes fused into single nodes if asked
+string Run(const string &source, bool fuse)
+{
+    auto program = TestProgram::Parse(source);
+    if (fuse)
+    {
+        FuseStatements(program);
+    }
+    return TestProgram::Run(*program);
+}
+
+} // namespace
+
+void TestFusedShapes()
+{
+    const string source = R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def move(dx):
+    if dx > 0:
+      x = self.x
+      x = x + dx
+      self.x = x
+    else:
+      self.x = self.x + dx
+    return self.x
+
+x = 1
+x = x + 2
+s = 'a'
+s = s + 'b'
+p = Point(x, s)
+if p.move(3) < 7:
+  print 'less', p.x, p.y
+if p.move(-1) < 7:
+  print 'moved back'
+print x, s, p.move(1)
+)";
+    ASSERT_EQUAL(Run(source, true), Run(source, false));
+    ASSERT_EQUAL(Run(source, true), "less 6 ab\nmoved back\n3 ab 6\n"s);
+
+    auto program = TestProgram::Parse(source);
+    FuseStatements(program);
+    // Field assignments in __init__ and move, return, both conditions in move and at top level, both increments
+    ASSERT_EQUAL(TestProgram::CountReplaced(program), 9U);
+}
+
+void TestFusedSemantics()
+{
+    // Errors and non-numeric operands go the same way as in the original nodes
+    const string programs[] = {
+        "x = x + 1\n",
+        "x = 'a'\nx = x + 1\n",
+        "x = None\nx = x + 'a'\n",
+        R"(
+class Money:
+  def __init__(value):
+    self.value = value
+
+  def __add__(other):
+    self.value = self.value + other
+    return self.value
+
+  def get():
+    return self.value
+
+m = Money(2)
+x = m + 3
+x = x + 1
+print x, m.get()
+)",
+        R"(
+class A:
+  def set(value):
+    self.field = value
+
+  def set_unknown():
+    self.field = unknown
+
+  def get():
+    return self.field
+
+a = A()
+print a.get()
+a.set(5)
+print a.get()
+a.set_unknown()
+)",
+        R"(
+class A:
+  def get(x):
+    return x.y
+
+a = A()
+print a.get(1)
+)",
+        R"(
+if 'a' < 'b':
+  print 'strings'
+if True > False:
+  print 'bools'
+if 1 <= 1:
+  print 'le'
+if 2 >= 3:
+  print 'ge'
+else:
+  print 'not ge'
+if 1 != 2:
+  print 'ne'
+if 1 < 'a':
+  print 'error'
+)",
+    };
+    for (const auto &program : programs)
+    {
+        ASSERT_EQUAL(Run(program, true), Run(program, false));
+    }
+}
+
+void TestRewriteAfterFusion()
+{
+    auto program = TestProgram::Parse("x = 1\nx = x + 1\nprint x\n"s);
+    FuseStatements(program);
+
+    // Constant of fused statement is replaced, so the fused node executes the original one
+    Node::Rewriter replace_constants = [&replace_constants](unique_ptr<Statement> &statement) {
+        if (dynamic_cast<NumericConst *>(statement.get()))
+        {
+            statement = make_unique<StringConst>(runtime::String("s"s));
+        }
+        else if (auto *node = dynamic_cast<Node *>(statement.get()))
+        {
+            node->RewriteChildren(replace_constants);
+        }
+    };
+    replace_constants(program);
+    ASSERT_EQUAL(TestProgram::Run(*program), "ss\n"s);
+}
+
+void RunFuseTests(TestRunner &tr)
+{
+    RUN_TEST(tr, ast::TestFusedShapes);
+    RUN_TEST(tr, ast::TestFusedSemantics);
+    RUN_TEST(tr, ast::TestRewriteAfterFusion);
+}
+
+} // namespace ast
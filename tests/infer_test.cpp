@@ -0,0 +1,209 @@
+#include "fuse.h"
+#include "infer.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace ast
+{
+
+namespace
+{
+
+//! Runs program, with operand types inferred and statements fused after that if asked
+string Run(const string &source, bool infer)
+{
+    auto program = TestProgram::Parse(source);
+    if (infer)
+    {
+        InferTypes(program);
+        FuseStatements(program);
+    }
+    return TestProgram::Run(*program);
+}
+
+struct Proven
+{
+    size_t numbers = 0;
+    size_t strings = 0;
+    size_t conditions = 0;
+};
+
+//! Counts operations of program and its classes specialized before execution
+void CountProven(unique_ptr<Statement> &statement, Proven &proven) // NOLINT
+{
+    auto *node = dynamic_cast<Node *>(statement.get());
+    if (!node)
+    {
+        return;
+    }
+    if (const auto *operation = dynamic_cast<const BinaryOperation *>(node))
+    {
+        proven.numbers += operation->GetOperandTypes() == OperandTypes::Numbers ? 1 : 0;
+        proven.strings += operation->GetOperandTypes() == OperandTypes::Strings ? 1 : 0;
+    }
+    if (const auto *if_else = dynamic_cast<const IfElse *>(node))
+    {
+        proven.conditions += if_else->HasBoolCondition() ? 1 : 0;
+    }
+    node->RewriteChildren([&proven](unique_ptr<Statement> &child) { CountProven(child, proven); });
+}
+
+Proven Infer(const string &source, MethodParsing methods = MethodParsing::Eager)
+{
+    auto program = TestProgram::Parse(source, methods);
+    InferTypes(program);
+    Proven proven;
+    CountProven(program, proven);
+    return proven;
+}
+
+const string counter_program = R"(
+class Counter:
+  def __init__(start):
+    self.value = start
+    self.name = 'counter'
+
+  def add(step):
+    if step > 0:
+      self.value = self.value + step
+    return self.value
+
+  def label():
+    return self.name + ':'
+
+c = Counter(1)
+i = 0
+small = i < 3
+if small:
+  i = c.add(2) * 2
+print c.label(), i, c.add(i - 1)
+)";
+
+} // namespace
+
+void TestInferredTypes()
+{
+    const Proven proven = Infer(counter_program);
+    // step > 0, self.value + step, i < 3, c.add(2) * 2 and i - 1
+    ASSERT_EQUAL(proven.numbers, 5U);
+    // self.name + ':'
+    ASSERT_EQUAL(proven.strings, 1U);
+    // Both conditions are comparisons
+    ASSERT_EQUAL(proven.conditions, 2U);
+    ASSERT_EQUAL(Run(counter_program, true), Run(counter_program, false));
+    ASSERT_EQUAL(Run(counter_program, true), "counter: 6 8\n"s);
+}
+
+void TestUnknownTypes()
+{
+    // Variable holds both numbers and strings
+    ASSERT_EQUAL(Infer("x = 1\nx = 'a'\ny = 2\nprint x + x, y + y\n").numbers, 1U);
+    ASSERT_EQUAL(Infer("x = 1\nx = 'a'\nprint x + x\n").strings, 0U);
+
+    // Field read outside of the class may be None, the one not assigned first in __init__ may be None too
+    const string fields = R"(
+class A:
+  def __init__(x):
+    print x
+    self.x = x
+
+  def get():
+    return self.x + 1
+
+a = A(1)
+print a.x + 1, a.get()
+)";
+    ASSERT_EQUAL(Infer(fields).numbers, 0U);
+    ASSERT_EQUAL(Run(fields, true), "1\n2 2\n"s);
+
+    // Instance created without __init__ arguments
+    const string no_init = R"(
+class A:
+  def __init__(x):
+    self.x = x
+
+  def get():
+    return self.x + 1
+
+a = A()
+print a.get()
+)";
+    ASSERT_EQUAL(Infer(no_init).numbers, 0U);
+    ASSERT_EQUAL(Run(no_init, true), Run(no_init, false));
+
+    // __add__ may return anything, condition that is not a Bool is converted
+    const string custom = R"(
+class Money:
+  def __init__(value):
+    self.value = value
+
+  def __add__(other):
+    return self.value + other
+
+m = Money(2)
+x = m + 3
+print x * 2
+if x:
+  print 'yes'
+)";
+    const Proven custom_proven = Infer(custom);
+    ASSERT_EQUAL(custom_proven.numbers, 0U);
+    ASSERT_EQUAL(custom_proven.conditions, 0U);
+    ASSERT_EQUAL(Run(custom, true), "10\nyes\n"s);
+
+    // Effects of methods that are not parsed yet are unknown
+    ASSERT_EQUAL(Infer(counter_program, MethodParsing::Lazy).numbers, 0U);
+}
+
+void TestInferredSemantics()
+{
+    // Proven operations behave the same, including errors
+    const string programs[] = {
+        "x = 1\ny = 0\nprint x / y\n",
+        "x = 'a'\nprint x < 'b', x + 'c', x == 'a'\n",
+        "print 1 + 2 < 4, 'a' + 'b', 3 * 4 >= 12\n",
+        R"(
+class A:
+  def __init__():
+    self = 5
+
+  def get():
+    return 1
+
+a = A()
+print a + 1
+)",
+        R"(
+class Base:
+  def __init__(v):
+    self.v = v
+
+  def twice():
+    return self.v + self.v
+
+class Derived(Base):
+  def __init__():
+    self.w = 1
+
+b = Base(2)
+d = Derived()
+print b.twice()
+print d.twice()
+)",
+    };
+    for (const auto &program : programs)
+    {
+        ASSERT_EQUAL(Run(program, true), Run(program, false));
+    }
+}
+
+void RunInferTests(TestRunner &tr)
+{
+    RUN_TEST(tr, ast::TestInferredTypes);
+    RUN_TEST(tr, ast::TestUnknownTypes);
+    RUN_TEST(tr, ast::TestInferredSemantics);
+}
+
+} // namespace ast
@@ -0,0 +1,152 @@
+#include "fuse.h"
+#include "inline.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace ast
+{
+
+namespace
+{
+
+//! Runs program, with trivial methods inlined at call sites and statements fused after that if asked
+string Run(const string &source, bool inline_methods)
+{
+    auto program = TestProgram::Parse(source);
+    if (inline_methods)
+    {
+        InlineMethods(program);
+        FuseStatements(program);
+    }
+    return TestProgram::Run(*program);
+}
+
+} // namespace
+
+void TestInlinedAccessors()
+{
+    const string source = R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def get_x():
+    return self.x
+
+  def set_x(x):
+    self.x = x
+
+  def get_z():
+    return self.z
+
+  def origin():
+    return 0
+
+  def name():
+    return 'point'
+
+p = Point(1, 2)
+print p.get_x(), p.get_z(), p.origin(), p.name()
+print p.set_x(p.get_x() + 4)
+print p.get_x(), p.x, p.z
+)";
+    ASSERT_EQUAL(Run(source, true), Run(source, false));
+    ASSERT_EQUAL(Run(source, true), "1 None 0 point\nNone\n5 5 None\n"s);
+}
+
+void TestInlineGuard()
+{
+    // The same call site sees classes with trivial and non-trivial methods of the same name
+    const string source = R"(
+class Field:
+  def __init__(v):
+    self.v = v
+
+  def get():
+    return self.v
+
+class Twice(Field):
+  def get():
+    return self.v * 2
+
+class Fixed:
+  def get():
+    return 7
+
+class Holder:
+  def show(obj):
+    print obj.get()
+
+h = Holder()
+h.show(Field(1))
+h.show(Twice(2))
+h.show(Field(3))
+h.show(Fixed())
+h.show(Field(4))
+)";
+    ASSERT_EQUAL(Run(source, true), Run(source, false));
+    ASSERT_EQUAL(Run(source, true), "1\n4\n3\n7\n4\n"s);
+}
+
+void TestNotInlinedMethods()
+{
+    const string programs[] = {
+        // Parameter hides self, parameter named returned_value is the result
+        R"(
+class A:
+  def __init__():
+    self.x = 1
+
+  def get(self):
+    return self.x
+
+  def put(returned_value):
+    self.y = returned_value
+
+class B:
+  def __str__():
+    return 'b'
+
+a = A()
+print a.get(B()), a.put(3), a.y
+)",
+        // Method that assigns self returns the new object
+        R"(
+class A:
+  def __init__():
+    self.x = 1
+
+  def get():
+    self = 5
+    return self.x
+
+a = A()
+print a.get()
+)",
+        // Wrong number of arguments
+        R"(
+class A:
+  def get():
+    return 1
+
+a = A()
+print a.get(2)
+)",
+    };
+    for (const auto &program : programs)
+    {
+        ASSERT_EQUAL(Run(program, true), Run(program, false));
+    }
+}
+
+void RunInlineTests(TestRunner &tr)
+{
+    RUN_TEST(tr, ast::TestInlinedAccessors);
+    RUN_TEST(tr, ast::TestInlineGuard);
+    RUN_TEST(tr, ast::TestNotInlinedMethods);
+}
+
+} // namespace ast
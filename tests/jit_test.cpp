@@ -0,0 +1,258 @@
+#include "jit.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+#include "vm.h"
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+
+using namespace std;
+
+namespace jit
+{
+
+namespace
+{
+
+//! Runs program by syntax tree interpreter, or compiles it to bytecode whose methods are translated to machine
+//! code after given number of calls
+string Run(const string &source, optional<size_t> jit_threshold)
+{
+    auto program = TestProgram::Parse(source);
+    if (jit_threshold)
+    {
+        program = vm::Compile(std::move(program), vm::Options{jit_threshold});
+    }
+    return TestProgram::RunAsIs(*program);
+}
+
+uint32_t CountToFive(void *argument, const void *operand)
+{
+    auto &counter = *static_cast<int *>(argument);
+    counter += *static_cast<const int *>(operand);
+    return counter < 5 ? 1 : 2;
+}
+
+//! Number the way machine code sees it: pointer to its type followed by value
+struct FakeNumber
+{
+    const void *type;
+    int value;
+};
+
+//! Argument of code that operates on two numbers
+struct Operands
+{
+    FakeNumber **top;
+    bool computed;
+    int result;
+};
+
+const int FAKE_NUMBER_TYPE = 0;
+
+uint32_t Computed(void *argument, const void *operand)
+{
+    auto &operands = *static_cast<Operands *>(argument);
+    operands.computed = true;
+    operands.result = static_cast<int>(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(operand))); // NOLINT
+    return 0;
+}
+
+uint32_t NotComputed(void *argument, [[maybe_unused]] const void *operand)
+{
+    static_cast<Operands *>(argument)->computed = false;
+    return 0;
+}
+
+//! Returns result of operation emitted by "emit" on two values, or "call" if code falls back to a call
+string Compute(FakeNumber lhs, FakeNumber rhs, const function<void(Assembler &, Assembler::Label)> &emit)
+{
+    Assembler assembler;
+    const auto generic = assembler.NewLabel();
+    const auto done = assembler.NewLabel();
+    const NumberLayout layout{offsetof(Operands, top), sizeof(FakeNumber *), &FAKE_NUMBER_TYPE,
+                              offsetof(FakeNumber, value)};
+    assembler.LoadNumbers(layout, generic);
+    emit(assembler, generic);
+    assembler.CallWithResult(Computed);
+    assembler.Jump(done);
+    assembler.Bind(generic);
+    assembler.Call(NotComputed, nullptr);
+    assembler.Bind(done);
+    assembler.Return();
+    auto code = assembler.Finish();
+    if (!code)
+    {
+        return "not supported"s;
+    }
+
+    FakeNumber *stack[] = {&lhs, &rhs};
+    Operands operands{stack + 2, false, 0};
+    code->Run(&operands);
+    return operands.computed ? to_string(operands.result) : "call"s;
+}
+
+} // namespace
+
+void TestAssembler()
+{
+    const int step = 1;
+    Assembler assembler;
+    const auto loop = assembler.NewLabel();
+    const auto exit = assembler.NewLabel();
+    assembler.Bind(loop);
+    assembler.Call(CountToFive, &step);
+    assembler.JumpIfEqual(1, loop);
+    assembler.JumpIfAbove(1, exit);
+    // Not reachable
+    assembler.Call(CountToFive, &step);
+    assembler.Bind(exit);
+    assembler.Return();
+    auto code = assembler.Finish();
+    ASSERT_EQUAL(code != nullptr, Supported());
+    if (code)
+    {
+        int counter = 0;
+        code->Run(&counter);
+        ASSERT_EQUAL(counter, 5);
+    }
+}
+
+void TestMachineCodeRunsSame()
+{
+    const string programs[] = {
+        R"(
+x = 4
+y = 'a'
+print x + 2 * 3 - 8 / 4, y + 'b', str(x) + y, str(None), not x
+print x > 3 and y == 'a', x < 3 or y != 'a', x <= 4, x >= 5, 0 or 0, 1 and 'b'
+)",
+        R"(
+class Fib:
+  def calc(n):
+    if n < 2:
+      return n
+    return self.calc(n - 1) + self.calc(n - 2)
+
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add(n):
+    if n > 0:
+      self.value = self.value + n
+      self.add(n - 1)
+
+  def __str__():
+    return 'Counter ' + str(self.value)
+
+fib = Fib()
+counter = Counter()
+counter.add(20)
+print fib.calc(15), counter
+)",
+        // Numbers are added, subtracted and compared by machine code, other values by handlers
+        R"(
+class Numbers:
+  def check(a, b):
+    if a < b:
+      print 'lt', a - b
+    if a <= b:
+      print 'le'
+    if a > b:
+      print 'gt', a + b
+    if a >= b:
+      print 'ge'
+    if a == b:
+      print 'eq'
+    if a != b:
+      print 'ne'
+    print a < b, a == b, a != b, a > b and a - 1 > b
+    return a + b
+
+n = Numbers()
+print n.check(1, 2), n.check(2, 1), n.check(3, 3), n.check(-4, 2), n.check('x', 'x')
+print n.check(None, 1)
+)",
+        // Errors leave machine code through the handler that raised them
+        R"(
+class A:
+  def div(n):
+    if n > 0:
+      return self.div(n - 1)
+    return 1 / n
+
+a = A()
+print a.div(5)
+)",
+        R"(
+class A:
+  def get():
+    return missing
+
+a = A()
+print 'before'
+print a.get()
+print 'after'
+)",
+    };
+    for (const auto &program : programs)
+    {
+        const string tree = Run(program, nullopt);
+        // Everything compiled at once, methods compiled while they are executed, and methods that are never hot
+        ASSERT_EQUAL(Run(program, 0), tree);
+        ASSERT_EQUAL(Run(program, 3), tree);
+        ASSERT_EQUAL(Run(program, 1000000), tree);
+    }
+}
+
+void TestNumberOperations()
+{
+    if (!Supported())
+    {
+        return;
+    }
+    const auto add = [](Assembler &assembler, Assembler::Label overflow) { assembler.AddNumbers(overflow); };
+    const auto subtract = [](Assembler &assembler, Assembler::Label overflow) {
+        assembler.SubtractNumbers(overflow);
+    };
+    const auto compare = [](Assembler::Condition condition) {
+        return [condition](Assembler &assembler, [[maybe_unused]] Assembler::Label label) {
+            assembler.CompareNumbers(condition);
+        };
+    };
+    const FakeNumber two{&FAKE_NUMBER_TYPE, 2};
+    const FakeNumber five{&FAKE_NUMBER_TYPE, 5};
+    const FakeNumber minus{&FAKE_NUMBER_TYPE, -7};
+    const FakeNumber max{&FAKE_NUMBER_TYPE, numeric_limits<int>::max()};
+    const FakeNumber other{&two, 2};
+
+    ASSERT_EQUAL(Compute(two, five, add), "7"s);
+    ASSERT_EQUAL(Compute(two, minus, add), "-5"s);
+    ASSERT_EQUAL(Compute(two, five, subtract), "-3"s);
+    ASSERT_EQUAL(Compute(minus, five, subtract), "-12"s);
+    // Overflow and objects of other types are left to the call
+    ASSERT_EQUAL(Compute(max, two, add), "call"s);
+    ASSERT_EQUAL(Compute(minus, max, subtract), "call"s);
+    ASSERT_EQUAL(Compute(other, two, add), "call"s);
+    ASSERT_EQUAL(Compute(two, other, subtract), "call"s);
+
+    ASSERT_EQUAL(Compute(two, five, compare(Assembler::Condition::Less)), "1"s);
+    ASSERT_EQUAL(Compute(five, two, compare(Assembler::Condition::Less)), "0"s);
+    ASSERT_EQUAL(Compute(minus, two, compare(Assembler::Condition::Greater)), "0"s);
+    ASSERT_EQUAL(Compute(two, two, compare(Assembler::Condition::Equal)), "1"s);
+    ASSERT_EQUAL(Compute(two, two, compare(Assembler::Condition::NotEqual)), "0"s);
+    ASSERT_EQUAL(Compute(two, two, compare(Assembler::Condition::LessOrEqual)), "1"s);
+    ASSERT_EQUAL(Compute(minus, two, compare(Assembler::Condition::GreaterOrEqual)), "0"s);
+    ASSERT_EQUAL(Compute(two, other, compare(Assembler::Condition::Equal)), "call"s);
+}
+
+void RunJitTests(TestRunner &tr)
+{
+    RUN_TEST(tr, jit::TestAssembler);
+    RUN_TEST(tr, jit::TestNumberOperations);
+    RUN_TEST(tr, jit::TestMachineCodeRunsSame);
+}
+
+} // namespace jit
@@ -1,4 +1,5 @@
 #include "lexer.h"
+#include "scan.h"
 #include "test_runner_p.h"
 
 #include <sstream>
@@ -44,6 +45,24 @@ void TestKeywords()
     ASSERT_EQUAL(lexer.NextToken(), Token(token_type::False{}));
 }
 
+void TestKeywordLikeIds()
+{
+    istringstream input("classes iff el se definition printer nor Nonexistent _True False_ x1"s);
+    Lexer lexer(input);
+
+    ASSERT_EQUAL(lexer.CurrentToken(), Token(token_type::Id{"classes"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"iff"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"el"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"se"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"definition"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"printer"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"nor"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"Nonexistent"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"_True"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"False_"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"x1"s}));
+}
+
 void TestNumbers()
 {
     istringstream input("42 15 -53"s);
@@ -81,6 +100,61 @@ void TestStrings()
     ASSERT_EQUAL(lexer.NextToken(), Token(token_type::String{"another long string with single quote ' inside"s}));
 }
 
+void TestNamesAreInterned()
+{
+    istringstream input("value = 'text'\nvalue = value\n"s);
+    Lexer lexer(input);
+
+    const Token first = lexer.CurrentToken();
+    lexer.NextToken();
+    const Token literal = lexer.NextToken();
+    lexer.NextToken();
+    const Token second = lexer.NextToken();
+    lexer.NextToken();
+    const Token third = lexer.NextToken();
+
+    ASSERT_EQUAL(first, Token(token_type::Id{"value"s}));
+    ASSERT_EQUAL(second, first);
+    ASSERT_EQUAL(third, first);
+    ASSERT(first.As<token_type::Id>().value.data() == second.As<token_type::Id>().value.data());
+    ASSERT(first.As<token_type::Id>().value.data() == third.As<token_type::Id>().value.data());
+    ASSERT_EQUAL(literal, Token(token_type::String{"text"s}));
+}
+
+void TestStringsReferSource()
+{
+    const string source = R"(x = 'plain' + "tab\tand\\slash"
+print 'it\'s')"s;
+    Lexer lexer(string_view{source});
+
+    lexer.NextToken();
+    const auto plain = lexer.NextToken().As<token_type::String>().value;
+    ASSERT_EQUAL(plain, "plain"s);
+    ASSERT(plain.data() >= source.data() && plain.data() < source.data() + source.size());
+
+    lexer.NextToken();
+    const auto escaped = lexer.NextToken().As<token_type::String>().value;
+    ASSERT_EQUAL(escaped, "tab\tand\\slash"s);
+    ASSERT(escaped.data() < source.data() || escaped.data() >= source.data() + source.size());
+
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Print{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::String{"it's"s}));
+    ASSERT_EQUAL(plain, "plain"s);
+    ASSERT_EQUAL(escaped, "tab\tand\\slash"s);
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Eof{}));
+}
+
+void TestUnterminatedString()
+{
+    istringstream input("x = 'text"s);
+    Lexer lexer(input);
+
+    lexer.NextToken();
+    ASSERT_THROWS(lexer.NextToken(), LexerError);
+}
+
 void TestOperations()
 {
     istringstream input("+-*/= > < != == <> <= >="s);
@@ -362,16 +436,144 @@ abc#
         ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
         ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Eof{}));
     }
+    {
+        istringstream is(R"(if x: # comment
+  y
+)"s);
+
+        Lexer lexer(is);
+        ASSERT_EQUAL(lexer.CurrentToken(), Token(token_type::If{}));
+        ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"x"s}));
+        ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Char{':'}));
+        ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
+        ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Indent{}));
+        ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"y"s}));
+        ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
+        ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Dedent{}));
+        ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Eof{}));
+    }
+}
+void TestScanningIsConsistent()
+{
+    string text(200, ' ');
+    text[37] = '#';
+    text[70] = '\n';
+    text[140] = '"';
+    text[171] = '\\';
+
+    const scan::Isa initial = scan::ActiveIsa();
+    for (scan::Isa isa : {scan::Isa::Scalar, scan::Isa::Sse2, scan::Isa::Avx2})
+    {
+        scan::UseIsa(isa);
+        for (size_t pos = 0; pos <= text.size(); ++pos)
+        {
+            const size_t next_non_space = pos <= 37    ? 37U
+                                          : pos <= 70  ? 70U
+                                          : pos <= 140 ? 140U
+                                          : pos <= 171 ? 171U
+                                                       : text.size();
+            ASSERT_EQUAL(scan::SkipSpaces(text, pos), next_non_space);
+            ASSERT_EQUAL(scan::Find(text, pos, '\n'), pos <= 70 ? 70U : text.size());
+            ASSERT_EQUAL(scan::FindEither(text, pos, '"', '\\'), pos <= 140 ? 140U : pos <= 171 ? 171U : text.size());
+        }
+    }
+    scan::UseIsa(initial);
 }
+
+void TestDeepIndentation()
+{
+    string program;
+    for (int level = 0; level < 40; ++level)
+    {
+        program += string(level * 2, ' ') + "x\n"s;
+    }
+    program += "# "s + string(100, '-') + "\n"s;
+    program += "y\n"s;
+
+    Lexer lexer(string_view{program});
+    for (int level = 0; level < 40; ++level)
+    {
+        if (level > 0)
+        {
+            ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Indent{}));
+            lexer.NextToken();
+        }
+        ASSERT_EQUAL(lexer.CurrentToken(), Token(token_type::Id{"x"s}));
+        ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
+    }
+    for (int level = 1; level < 40; ++level)
+    {
+        ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Dedent{}));
+    }
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Id{"y"s}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Newline{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Eof{}));
+}
+
+void TestSkipBlock()
+{
+    const string program = R"(class A:
+  def f():
+    x = 1
+
+# comment at the left
+    if x:
+      y = 'a  b'
+  def g():
+    return 2
+print 3)"s;
+
+    for (bool from_stream : {false, true})
+    {
+        istringstream input(program);
+        unique_ptr<Lexer> lexer = from_stream ? make_unique<Lexer>(input) : make_unique<Lexer>(string_view{program});
+
+        while (!lexer->CurrentToken().Is<token_type::Indent>() || lexer->NextToken() != Token(token_type::Def{}))
+        {
+            lexer->NextToken();
+        }
+        while (!lexer->NextToken().Is<token_type::Indent>())
+        {
+        }
+        ASSERT_EQUAL(lexer->SkipBlock(), "x = 1\n\n# comment at the left\nif x:\n  y = 'a  b'\n"s);
+        ASSERT_EQUAL(lexer->CurrentToken(), Token(token_type::Dedent{}));
+        ASSERT_EQUAL(lexer->NextToken(), Token(token_type::Def{}));
+
+        while (!lexer->NextToken().Is<token_type::Indent>())
+        {
+        }
+        ASSERT_EQUAL(lexer->SkipBlock(), "return 2\n"s);
+        ASSERT_EQUAL(lexer->CurrentToken(), Token(token_type::Dedent{}));
+        ASSERT_EQUAL(lexer->NextToken(), Token(token_type::Dedent{}));
+        ASSERT_EQUAL(lexer->NextToken(), Token(token_type::Print{}));
+        ASSERT_EQUAL(lexer->NextToken(), Token(token_type::Number{3}));
+        ASSERT_EQUAL(lexer->NextToken(), Token(token_type::Newline{}));
+        ASSERT_EQUAL(lexer->NextToken(), Token(token_type::Eof{}));
+    }
+
+    // Block at the end of text is closed by dedents before Eof
+    Lexer lexer(string_view{"if x:\n  y = 1"});
+    while (!lexer.NextToken().Is<token_type::Indent>())
+    {
+    }
+    ASSERT_EQUAL(lexer.SkipBlock(), "y = 1\n"s);
+    ASSERT_EQUAL(lexer.CurrentToken(), Token(token_type::Dedent{}));
+    ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Eof{}));
+}
+
 } // namespace
 
 void RunOpenLexerTests(TestRunner &tr)
 {
     RUN_TEST(tr, parse::TestSimpleAssignment);
     RUN_TEST(tr, parse::TestKeywords);
+    RUN_TEST(tr, parse::TestKeywordLikeIds);
     RUN_TEST(tr, parse::TestNumbers);
     RUN_TEST(tr, parse::TestIds);
     RUN_TEST(tr, parse::TestStrings);
+    RUN_TEST(tr, parse::TestNamesAreInterned);
+    RUN_TEST(tr, parse::TestStringsReferSource);
+    RUN_TEST(tr, parse::TestUnterminatedString);
     RUN_TEST(tr, parse::TestOperations);
     RUN_TEST(tr, parse::TestIndentsAndNewlines);
     RUN_TEST(tr, parse::TestEmptyLinesAreIgnored);
@@ -380,6 +582,9 @@ void RunOpenLexerTests(TestRunner &tr)
     RUN_TEST(tr, parse::TestMythonProgram);
     RUN_TEST(tr, parse::TestAlwaysEmitsNewlineAtTheEndOfNonemptyLine);
     RUN_TEST(tr, parse::TestCommentsAreIgnored);
+    RUN_TEST(tr, parse::TestScanningIsConsistent);
+    RUN_TEST(tr, parse::TestDeepIndentation);
+    RUN_TEST(tr, parse::TestSkipBlock);
 }
 
 } // namespace parse
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "parse.h"
 #include "runtime.h"
 #include "statement.h"
+#include "test_program_p.h"
 #include "test_runner_p.h"
 
 #include <iostream>
@@ -13,15 +14,57 @@ namespace parse
 void RunOpenLexerTests(TestRunner &tr);
 } // namespace parse
 
+namespace aot
+{
+void RunTranspileTests(TestRunner &tr);
+}
 namespace ast
 {
 void RunUnitTests(TestRunner &tr);
+void RunDceTests(TestRunner &tr);
+void RunEscapeTests(TestRunner &tr);
+void RunFuseTests(TestRunner &tr);
+void RunInferTests(TestRunner &tr);
+void RunInlineTests(TestRunner &tr);
+} // namespace ast
+namespace cache
+{
+void RunCacheTests(TestRunner &tr);
+}
+namespace closures
+{
+void RunClosuresTests(TestRunner &tr);
+}
+namespace jit
+{
+void RunJitTests(TestRunner &tr);
+}
+namespace memo
+{
+void RunMemoTests(TestRunner &tr);
+}
+namespace passes
+{
+void RunPassesTests(TestRunner &tr);
+}
+namespace profile
+{
+void RunProfileTests(TestRunner &tr);
+}
+namespace repl
+{
+void RunReplTests(TestRunner &tr);
 }
 namespace runtime
 {
+void RunCyclesTests(TestRunner &tr);
 void RunObjectHolderTests(TestRunner &tr);
 void RunObjectsTests(TestRunner &tr);
 } // namespace runtime
+namespace vm
+{
+void RunVmTests(TestRunner &tr);
+}
 
 void TestParseProgram(TestRunner &tr);
 
@@ -32,10 +75,7 @@ void RunMythonProgram(istream &input, ostream &output)
 {
     parse::Lexer lexer(input);
     auto program = ParseProgram(lexer);
-
-    runtime::SimpleContext context{output};
-    runtime::Closure closure;
-    program->Execute(closure, context);
+    TestProgram::Execute(*program, output);
 }
 
 void TestSimplePrints()
@@ -128,6 +168,21 @@ void TestAll()
     runtime::RunObjectsTests(tr);
     ast::RunUnitTests(tr);
     TestParseProgram(tr);
+    ast::RunDceTests(tr);
+    ast::RunEscapeTests(tr);
+    ast::RunFuseTests(tr);
+    ast::RunInferTests(tr);
+    ast::RunInlineTests(tr);
+    cache::RunCacheTests(tr);
+    repl::RunReplTests(tr);
+    vm::RunVmTests(tr);
+    jit::RunJitTests(tr);
+    closures::RunClosuresTests(tr);
+    aot::RunTranspileTests(tr);
+    profile::RunProfileTests(tr);
+    passes::RunPassesTests(tr);
+    memo::RunMemoTests(tr);
+    runtime::RunCyclesTests(tr);
 
     RUN_TEST(tr, TestSimplePrints);
     RUN_TEST(tr, TestAssignments);
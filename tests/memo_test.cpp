@@ -0,0 +1,180 @@
+#include "memo.h"
+#include "test_program_p.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace memo
+{
+
+namespace
+{
+
+//! Runs program with pure methods memoized by given options
+string Run(const string &source, const Options &options)
+{
+    auto program = TestProgram::Parse(source);
+    MemoizePureMethods(program, options);
+    // Memoized calls are made by syntax tree interpreter only
+    return TestProgram::RunAsIs(*program);
+}
+
+} // namespace
+
+void TestRecursion()
+{
+    const string source = R"(
+class Fib:
+  def fib(n):
+    if n < 2:
+      return n
+    return self.fib(n - 1) + self.fib(n - 2)
+
+f = Fib()
+print f.fib(30), f.fib(30), f.fib(10)
+)";
+    Stats stats;
+    Options options;
+    options.stats = &stats;
+    ASSERT_EQUAL(Run(source, options), "832040 832040 55\n"s);
+    // Every number is computed once, without memoization there would be millions of calls
+    ASSERT_EQUAL(stats.misses, 31U);
+    ASSERT_EQUAL(stats.hits, 30U);
+    ASSERT_EQUAL(stats.evicted, 0U);
+
+    ostringstream output;
+    PrintStats(stats, output);
+    ASSERT_EQUAL(output.str(), "memo: 30 hits, 31 misses, 0 evicted\n"s);
+}
+
+void TestEffectsAreKept()
+{
+    const string source = R"(
+class Counter:
+  def __init__():
+    self.count = 0
+
+  def twice(x):
+    return self.add(x) + self.add(x)
+
+  def add(x):
+    self.count = self.count + 1
+    return x + self.count
+
+  def loud(x):
+    return self.say(x)
+
+  def say(x):
+    print 'say', x
+    return x
+
+c = Counter()
+x = c.loud(2)
+y = c.loud(2)
+print c.twice(1), c.twice(1), x, y
+)";
+    Stats stats;
+    Options options;
+    options.stats = &stats;
+    ASSERT_EQUAL(Run(source, options), "say 2\nsay 2\n5 9 2 2\n"s);
+    ASSERT_EQUAL(stats.hits + stats.misses, 0U);
+}
+
+void TestOverriddenMethods()
+{
+    const string source = R"(
+class Base:
+  def total(n):
+    if n == 0:
+      return 0
+    return self.step(n) + self.total(n - 1)
+
+  def step(n):
+    return n
+
+class Squares(Base):
+  def step(n):
+    return n * n
+
+class Loud(Base):
+  def step(n):
+    print n
+    return n
+
+b = Base()
+s = Squares()
+l = Loud()
+print b.total(3), s.total(3), b.total(3), s.total(3)
+x = l.total(2)
+y = l.total(2)
+print x, y
+)";
+    Stats stats;
+    Options options;
+    options.stats = &stats;
+    ASSERT_EQUAL(Run(source, options), "6 14 6 14\n2\n1\n2\n1\n3 3\n"s);
+    // Calls of "total" are kept for both classes, "step" doesn't call methods and is not memoized
+    ASSERT_EQUAL(stats.misses, 8U);
+    ASSERT_EQUAL(stats.hits, 2U);
+}
+
+void TestArgumentsAndResults()
+{
+    const string source = R"(
+class Box:
+  def __init__(v):
+    self.v = v
+
+class Text:
+  def join(a, b):
+    return self.id(a) + self.id(b)
+
+  def id(x):
+    return x
+
+  def same(x):
+    return self.id(x)
+
+t = Text()
+b = t.same(Box(1))
+print t.join('a', 'b'), t.join('a', 'b'), t.join(1, 2), t.same(True), t.same(None), b.v
+)";
+    Stats stats;
+    Options options;
+    options.stats = &stats;
+    ASSERT_EQUAL(Run(source, options), "ab ab 3 True None 1\n"s);
+    // Call with object argument is not kept
+    ASSERT_EQUAL(stats.misses, 4U);
+    ASSERT_EQUAL(stats.hits, 1U);
+}
+
+void TestBoundedTable()
+{
+    const string source = R"(
+class Fib:
+  def fib(n):
+    if n < 2:
+      return n
+    return self.fib(n - 1) + self.fib(n - 2)
+
+f = Fib()
+print f.fib(25)
+)";
+    Stats stats;
+    Options options;
+    options.capacity = 4;
+    options.stats = &stats;
+    ASSERT_EQUAL(Run(source, options), "75025\n"s);
+    ASSERT(stats.evicted > 0);
+}
+
+void RunMemoTests(TestRunner &tr)
+{
+    RUN_TEST(tr, memo::TestRecursion);
+    RUN_TEST(tr, memo::TestEffectsAreKept);
+    RUN_TEST(tr, memo::TestOverriddenMethods);
+    RUN_TEST(tr, memo::TestArgumentsAndResults);
+    RUN_TEST(tr, memo::TestBoundedTable);
+}
+
+} // namespace memo
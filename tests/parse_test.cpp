@@ -253,6 +253,226 @@ print r, c, t1, t2
     ASSERT_EQUAL(context.output.str(), "Rect(10x20) Circle(52) Triangle(3, 4, 5) Wrong triangle\n"s);
 }
 
+string RunProgram(runtime::Executable &program)
+{
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    program.Execute(closure, context);
+    return context.output.str();
+}
+
+void TestParallelParsing()
+{
+    // Many small top-level definitions, so that parts boundaries fall between classes that refer to each other
+    string program = R"(
+class Base:
+  def __init__():
+    self.n = 0
+
+  def Get():
+    return self.n
+
+)"s;
+    for (int i = 0; i < 64; ++i)
+    {
+        const string name = "C"s + to_string(i);
+        const string parent = i == 0 ? "Base"s : "C"s + to_string(i - 1);
+        program += "class "s + name + "("s + parent + "):\n"s;
+        program += "  def Get():\n    # more than parent\n    return "s + to_string(i) + "\n\n"s;
+        program += "x = "s + name + "()\nif x.Get() > 31:\n  print x.Get()\nelse:\n  y = x.Get()\n"s;
+    }
+    program += "b = Base()\nprint y, b.Get()\n"s;
+
+    const string expected = RunProgram(*ParseProgramFromString(program));
+    for (size_t threads : {1, 2, 3, 8})
+    {
+        ASSERT_EQUAL(RunProgram(*ParseProgramParallel(program, threads)), expected);
+    }
+    ASSERT_EQUAL(RunProgram(*ParseProgramParallel(program)), expected);
+}
+
+void TestParallelParsingErrors()
+{
+    // Class is declared after its first use
+    string program;
+    for (int i = 0; i < 16; ++i)
+    {
+        program += "x = "s + to_string(i) + "\n"s;
+    }
+    program += "y = Late()\n"s;
+    for (int i = 0; i < 16; ++i)
+    {
+        program += "x = "s + to_string(i) + "\n"s;
+    }
+    program += "class Late:\n  def __init__():\n    self.x = 1\n"s;
+    ASSERT_THROWS(ParseProgramParallel(program, 4), ParseError);
+
+    // Same class is declared twice in different parts
+    program = "class Twice:\n  def f():\n    return 1\n"s;
+    for (int i = 0; i < 16; ++i)
+    {
+        program += "x = Twice()\n"s;
+    }
+    program += "class Twice:\n  def f():\n    return 2\n"s;
+    ASSERT_THROWS(ParseProgramParallel(program, 4), ParseError);
+
+    // Unknown base class
+    program = "class Orphan(Nobody):\n  def f():\n    return 1\n"s;
+    ASSERT_THROWS(ParseProgramParallel(program, 4), ParseError);
+}
+
+void TestLazyMethodParsing()
+{
+    const string program = R"(
+class Base:
+  def Make():
+    return Base()
+
+class Point(Base):
+  def __init__(x):
+    self.x = x
+
+  def Twice():
+    base = Base()
+    self.x = self.x * 2
+    return self
+
+  def __str__():
+    return 'Point(' + str(self.x) + ')'
+
+  def Broken():
+    return Later()
+
+  def Wrong():
+    return ) (
+
+class Later:
+  def f():
+    return 1
+
+p = Point(21)
+print p.Twice()
+)"s;
+
+    // Syntax errors and unknown classes in methods that are never called are not reported
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    auto tree = ParseProgram(lexer, MethodParsing::Lazy);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    tree->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "Point(42)\n"s);
+
+    const auto &point = *closure.at("Point"s).TryAs<runtime::Class>();
+    auto is_parsed = [&point](const string &method) {
+        return dynamic_cast<const ast::MethodBody &>(*point.GetMethod(method)->body).IsParsed();
+    };
+    ASSERT(is_parsed("__init__"s));
+    ASSERT(is_parsed("Twice"s));
+    ASSERT(!is_parsed("Broken"s));
+    ASSERT(!is_parsed("Wrong"s));
+
+    // Errors are reported when method is called, classes declared after method are not visible to it
+    auto instance = runtime::ObjectHolder::Own(runtime::ClassInstance(point));
+    ASSERT_THROWS(instance.TryAs<runtime::ClassInstance>()->Call("Broken"s, {}, context), ParseError);
+    ASSERT_THROWS(instance.TryAs<runtime::ClassInstance>()->Call("Wrong"s, {}, context), runtime_error);
+    ASSERT(!is_parsed("Broken"s));
+
+    // Inherited method creates instance of its own class, which is declared after it
+    ASSERT_THROWS(instance.TryAs<runtime::ClassInstance>()->Call("Make"s, {}, context), ParseError);
+}
+
+void TestLazyMethodDeclaringClass()
+{
+    const string program = R"(
+class Outer:
+  def declare():
+    x = 1
+    class Inner:
+      def f():
+        return 'inner'
+
+  def other():
+    return Inner()
+
+o = Outer()
+i = Inner()
+print i.f()
+)"s;
+
+    // Class declared in method body is known to statements after it, whether bodies are parsed lazily or not
+    for (auto methods : {MethodParsing::Eager, MethodParsing::Lazy})
+    {
+        istringstream input(program);
+        parse::Lexer lexer(input);
+        auto tree = ParseProgram(lexer, methods);
+
+        runtime::DummyContext context;
+        runtime::Closure closure;
+        tree->Execute(closure, context);
+        ASSERT_EQUAL(context.output.str(), "inner\n"s);
+    }
+}
+
+void TestStatementStream()
+{
+    const string program = R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def Add():
+    self.value = self.value + 1
+
+c = Counter()
+print 'first'
+c.Add()
+if c.value > 0:
+  print c.value
+else:
+  print 'none'
+# trailing comment
+print 'last')"s;
+
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    StatementStream statements(lexer);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    vector<unique_ptr<runtime::Executable>> executed;
+    vector<string> outputs;
+    vector<streampos> positions;
+    while (auto statement = statements.Next())
+    {
+        statement->Execute(closure, context);
+        executed.push_back(std::move(statement));
+        outputs.push_back(context.output.str());
+        positions.push_back(input.tellg());
+    }
+
+    ASSERT_EQUAL(outputs.size(), 6U);
+    ASSERT_EQUAL(outputs.back(), "first\n1\nlast\n"s);
+    ASSERT_EQUAL(outputs[2], "first\n"s);
+
+    // Simple statement is executed before the next line is read
+    ASSERT_EQUAL(positions[2], streampos(program.find("c.Add()"s)));
+}
+
+void TestStatementStreamRunsBeforeErrors()
+{
+    istringstream input("print 'before'\nprint ) (\n"s);
+    parse::Lexer lexer(input);
+    StatementStream statements(lexer);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    statements.Next()->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "before\n"s);
+    ASSERT_THROWS(statements.Next(), runtime_error);
+}
+
 } // namespace parse
 
 void TestParseProgram(TestRunner &tr)
@@ -265,4 +485,10 @@ void TestParseProgram(TestRunner &tr)
     RUN_TEST(tr, parse::TestRecursion2);
     RUN_TEST(tr, parse::TestComplexLogicalExpression);
     RUN_TEST(tr, parse::TestClassicalPolymorphism);
+    RUN_TEST(tr, parse::TestParallelParsing);
+    RUN_TEST(tr, parse::TestParallelParsingErrors);
+    RUN_TEST(tr, parse::TestLazyMethodParsing);
+    RUN_TEST(tr, parse::TestLazyMethodDeclaringClass);
+    RUN_TEST(tr, parse::TestStatementStream);
+    RUN_TEST(tr, parse::TestStatementStreamRunsBeforeErrors);
 }
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include "fuse.h"
+#include "lexer.h"
+#include "parse.h"
+#include "passes.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace passes
+{
+
+namespace
+{
+
+unique_ptr<ast::Statement> Parse(const string &source)
+{
+    istringstream input(source);
+    parse::Lexer lexer(input);
+    return ParseProgram(lexer);
+}
+
+//! Adds passes that record their names to "ran"
+PassManager MakeManager(Level level, vector<string> &ran)
+{
+    PassManager manager(level);
+    for (const auto &[name, pass_level] :
+         {pair{"always"s, Level::O0}, pair{"local"s, Level::O1}, pair{"global"s, Level::O2}})
+    {
+        manager.Add(name, pass_level, [&ran, name = name](unique_ptr<ast::Statement> &) { ran.push_back(name); });
+    }
+    return manager;
+}
+
+} // namespace
+
+void TestLevels()
+{
+    auto program = Parse("x = 1\n"s);
+    for (const auto &[level, expected] :
+         {pair{Level::O0, vector{"always"s}}, pair{Level::O1, vector{"always"s, "local"s}},
+          pair{Level::O2, vector{"always"s, "local"s, "global"s}}})
+    {
+        vector<string> ran;
+        auto manager = MakeManager(level, ran);
+        ASSERT_EQUAL(manager.Enabled(), expected);
+        manager.Run(program);
+        ASSERT_EQUAL(ran, expected);
+        ASSERT_EQUAL(manager.GetTimings().size(), expected.size());
+        ASSERT_EQUAL(manager.GetTimings().back().name, expected.back());
+    }
+
+    ASSERT(ParseLevel("2"sv) == Level::O2);
+    ASSERT(!ParseLevel("3"sv));
+}
+
+void TestDisabledPass()
+{
+    auto program = Parse("x = 1\n"s);
+    vector<string> ran;
+    auto manager = MakeManager(Level::O2, ran);
+    manager.Disable("local"s);
+    manager.Disable("unknown"s);
+    manager.Run(program);
+    ASSERT_EQUAL(ran, (vector{"always"s, "global"s}));
+}
+
+void TestDump()
+{
+    auto program = Parse(R"(
+class Counter:
+  def add(n):
+    self.value = self.value + n
+    return self.value
+
+c = Counter()
+if c.add(1) > 0:
+  print 'positive', not True
+)"s);
+
+    ostringstream dump;
+    PassManager manager;
+    manager.Add("fuse"s, Level::O1, ast::FuseStatements);
+    manager.SetDump(&dump);
+    manager.Run(program);
+
+    const string parsed = R"(Compound
+  ClassDefinition Counter
+    def add(n)
+      MethodBody
+        Compound
+          FieldAssignment .value
+            VariableValue self
+            Add
+              VariableValue self.value
+              VariableValue n
+          Return
+            VariableValue self.value
+  Assignment c
+    NewInstance Counter
+  IfElse
+    Comparison >
+      MethodCall add
+        VariableValue c
+        NumericConst 1
+      NumericConst 0
+    Compound
+      Print
+        StringConst 'positive'
+        Not
+          BoolConst True
+)"s;
+    // Fused nodes are dumped with the nodes they replaced
+    const string fused = R"(Compound
+  ClassDefinition Counter
+    def add(n)
+      MethodBody
+        Compound
+          FieldAssignment .value
+            VariableValue self
+            Add
+              VariableValue self.value
+              VariableValue n
+          Fused FieldReturn
+            Return
+              VariableValue self.value
+  Assignment c
+    NewInstance Counter
+  Fused ComparisonIfElse
+    IfElse
+      Comparison >
+        MethodCall add
+          VariableValue c
+          NumericConst 1
+        NumericConst 0
+      Compound
+        Print
+          StringConst 'positive'
+          Not
+            BoolConst True
+)"s;
+    ASSERT_EQUAL(dump.str(), "=== parsed ===\n"s + parsed + "=== after fuse ===\n"s + fused);
+}
+
+void RunPassesTests(TestRunner &tr)
+{
+    RUN_TEST(tr, passes::TestLevels);
+    RUN_TEST(tr, passes::TestDisabledPass);
+    RUN_TEST(tr, passes::TestDump);
+}
+
+} // namespace passes
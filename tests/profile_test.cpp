@@ -0,0 +1,166 @@
+#include "profile.h"
+#include "lexer.h"
+#include "parse.h"
+#include "statement.h"
+#include "test_runner_p.h"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace std;
+
+namespace profile
+{
+
+namespace
+{
+
+const string PROFILE_PATH = "mini_python_profile_test.prof"s;
+
+const string PROGRAM = R"(
+class Fib:
+  def __init__():
+    self.calls = 0
+
+  def calc(n):
+    self.calls = self.calls + 1
+    if n < 2:
+      return n
+    return self.calc(n - 1) + self.calc(n - 2)
+
+fib = Fib()
+print fib.calc(10), fib.calls
+)";
+
+unique_ptr<runtime::Executable> Parse(const string &source)
+{
+    istringstream input(source);
+    parse::Lexer lexer(input);
+    return ParseProgram(lexer);
+}
+
+//! Returns output of program compiled with methods that are hot, and counts calls of methods
+string Run(unique_ptr<runtime::Executable> program, unordered_set<const runtime::Method *> hot_methods,
+           closures::Stats &stats)
+{
+    program = closures::Compile(std::move(program), closures::Options{3, &stats, std::move(hot_methods)});
+    ostringstream output;
+    runtime::SimpleContext context{output};
+    runtime::Closure closure;
+    program->Execute(closure, context);
+    return output.str();
+}
+
+//! Finds operations and calls of program, methods of classes included
+void FindNodes(unique_ptr<runtime::Executable> &statement, vector<const ast::BinaryOperation *> &operations,
+               vector<const ast::MethodCall *> &calls)
+{
+    auto *node = dynamic_cast<ast::Node *>(statement.get());
+    if (!node)
+    {
+        return;
+    }
+    if (const auto *operation = dynamic_cast<const ast::BinaryOperation *>(node))
+    {
+        operations.push_back(operation);
+    }
+    if (const auto *call = dynamic_cast<const ast::MethodCall *>(node))
+    {
+        calls.push_back(call);
+    }
+    node->RewriteChildren([&](unique_ptr<runtime::Executable> &child) { FindNodes(child, operations, calls); });
+}
+
+} // namespace
+
+void TestProfileRoundTrip()
+{
+    remove(PROFILE_PATH.c_str());
+    {
+        Profile profile(PROFILE_PATH);
+        auto program = Parse(PROGRAM);
+        ASSERT(profile.Apply(*program, 3).empty());
+        closures::Stats stats;
+        ASSERT_EQUAL(Run(std::move(program), {}, stats), "55 177\n"s);
+        profile.Store(stats);
+    }
+
+    Profile profile(PROFILE_PATH);
+    auto program = Parse(PROGRAM);
+    const auto hot_methods = profile.Apply(*program, 3);
+    ASSERT_EQUAL(hot_methods.size(), 1U);
+    ASSERT_EQUAL((*hot_methods.begin())->name, "calc"s);
+
+    // Operations and calls of methods are specialized before they run, top-level code is not
+    vector<const ast::BinaryOperation *> operations;
+    vector<const ast::MethodCall *> calls;
+    FindNodes(program, operations, calls);
+    ASSERT_EQUAL(operations.size(), 5U);
+    for (const auto *operation : operations)
+    {
+        ASSERT(operation->GetOperandTypes() == ast::OperandTypes::Numbers);
+        ASSERT(!operation->OperandTypesProven());
+    }
+    ASSERT_EQUAL(calls.size(), 3U);
+    ASSERT_EQUAL(calls[0]->GetReceiverClass()->GetName(), "Fib"s);
+    ASSERT_EQUAL(calls[1]->GetReceiverClass()->GetName(), "Fib"s);
+    ASSERT(!calls[2]->GetReceiverClass());
+
+    closures::Stats stats;
+    ASSERT_EQUAL(Run(std::move(program), hot_methods, stats), "55 177\n"s);
+    ASSERT_EQUAL(stats.methods[1].name, "Fib.calc"s);
+    ASSERT_EQUAL(stats.methods[1].compiled_after.value_or(1), 0U);
+    remove(PROFILE_PATH.c_str());
+}
+
+void TestChangedMethodNotProfiled()
+{
+    remove(PROFILE_PATH.c_str());
+    {
+        Profile profile(PROFILE_PATH);
+        auto program = Parse(PROGRAM);
+        profile.Apply(*program, 3);
+        closures::Stats stats;
+        Run(std::move(program), {}, stats);
+        profile.Store(stats);
+    }
+
+    string changed = PROGRAM;
+    changed.replace(changed.find("n - 2"s), 5, "n - 3"s);
+    Profile profile(PROFILE_PATH);
+    auto program = Parse(changed);
+    ASSERT(profile.Apply(*program, 3).empty());
+    vector<const ast::BinaryOperation *> operations;
+    vector<const ast::MethodCall *> calls;
+    FindNodes(program, operations, calls);
+    for (const auto *operation : operations)
+    {
+        ASSERT(operation->GetOperandTypes() == ast::OperandTypes::Unknown);
+    }
+    remove(PROFILE_PATH.c_str());
+}
+
+void TestDamagedProfileIgnored()
+{
+    for (const string &text : {"mython-profile 1\nmethod zz 1\n"s, "mython-profile 2\n"s, "not a profile"s,
+                               "mython-profile 1\nmethod 1 100 1 7 0\n"s})
+    {
+        {
+            ofstream file(PROFILE_PATH);
+            file << text;
+        }
+        Profile profile(PROFILE_PATH);
+        auto program = Parse(PROGRAM);
+        ASSERT(profile.Apply(*program, 3).empty());
+    }
+    remove(PROFILE_PATH.c_str());
+}
+
+void RunProfileTests(TestRunner &tr)
+{
+    RUN_TEST(tr, profile::TestProfileRoundTrip);
+    RUN_TEST(tr, profile::TestChangedMethodNotProfiled);
+    RUN_TEST(tr, profile::TestDamagedProfileIgnored);
+}
+
+} // namespace profile
@@ -0,0 +1,94 @@
+#include "parse.h"
+#include "repl.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace repl
+{
+
+void TestSessionKeepsState()
+{
+    ostringstream output;
+    Session session(output);
+
+    session.Execute("x = 2\n"sv);
+    session.Execute(R"(class Counter:
+  def __init__(start):
+    self.value = start
+
+  def Add():
+    self.value = self.value + 1
+)"sv);
+    session.Execute("c = Counter(x)\nc.Add()\n"sv);
+    session.Execute("print c.value, x\n"sv);
+
+    ASSERT_EQUAL(output.str(), "3 2\n"s);
+    ASSERT_EQUAL(session.GetClosure().size(), 3U);
+}
+
+void TestSessionErrors()
+{
+    ostringstream output;
+    Session session(output);
+
+    session.Execute("x = 1\n"sv);
+    ASSERT_THROWS(session.Execute("y = Unknown()\n"sv), ParseError);
+    ASSERT_THROWS(session.Execute("print undefined\n"sv), runtime_error);
+    // Class of block that failed to parse is not declared
+    ASSERT_THROWS(session.Execute("class A:\n  def f():\n    return 1\nprint ) (\n"sv), runtime_error);
+    ASSERT_THROWS(session.Execute("a = A()\n"sv), ParseError);
+
+    session.Execute("print x\n"sv);
+    ASSERT_EQUAL(output.str(), "1\n"s);
+}
+
+void TestClassRedefinition()
+{
+    ostringstream output;
+    Session session(output);
+
+    session.Execute("class A:\n  def f():\n    return 1\n"sv);
+    session.Execute("class B(A):\n  def g():\n    return A()\n"sv);
+    session.Execute("class A:\n  def f():\n    return 2\n"sv);
+    session.Execute("a = A()\nb = B()\nold = b.g()\nprint a.f(), b.f(), old.f()\n"sv);
+
+    // Only A is rebuilt, B and its methods keep referring to the old A
+    ASSERT_EQUAL(output.str(), "2 1 1\n"s);
+}
+
+void TestRun()
+{
+    istringstream input(R"(x = 5
+class A:
+  def f(n):
+    # comment inside of block
+    if n > 3:
+      return 'big'
+    return 'small'
+
+a = A()
+print a.f(x)
+print ) (
+if x > 3:
+  print 'yes'
+else:
+  print 'no'
+
+print x # comment
+)"s);
+    ostringstream output;
+    Run(input, output, false);
+
+    ASSERT_EQUAL(output.str(), "big\nError: Incorrect token\nyes\n5\n"s);
+}
+
+void RunReplTests(TestRunner &tr)
+{
+    RUN_TEST(tr, repl::TestSessionKeepsState);
+    RUN_TEST(tr, repl::TestSessionErrors);
+    RUN_TEST(tr, repl::TestClassRedefinition);
+    RUN_TEST(tr, repl::TestRun);
+}
+
+} // namespace repl
@@ -464,6 +464,61 @@ void TestNot()
     test_not(false);
 }
 
+void TestQuickenedArithmetic()
+{
+    runtime::DummyContext context;
+    Closure closure = {{"x"s, ObjectHolder::Own(runtime::Number(7))}, {"y"s, ObjectHolder::Own(runtime::Number(2))}};
+    Add add(make_unique<VariableValue>("x"s), make_unique<VariableValue>("y"s));
+    Div div(make_unique<VariableValue>("x"s), make_unique<VariableValue>("y"s));
+    ASSERT(add.GetOperandTypes() == OperandTypes::Unknown);
+
+    ASSERT_OBJECT_VALUE_EQUAL(add.Execute(closure, context), 9);
+    ASSERT_OBJECT_VALUE_EQUAL(div.Execute(closure, context), 3);
+    ASSERT(add.GetOperandTypes() == OperandTypes::Numbers);
+    ASSERT_OBJECT_VALUE_EQUAL(add.Execute(closure, context), 9);
+
+    // Specialized division still checks divisor
+    closure["y"s] = ObjectHolder::Own(runtime::Number(0));
+    ASSERT_THROWS(div.Execute(closure, context), runtime_error);
+
+    // Operands of other types make operation generic
+    closure["x"s] = ObjectHolder::Own(runtime::String("a"s));
+    closure["y"s] = ObjectHolder::Own(runtime::String("b"s));
+    ASSERT_OBJECT_VALUE_EQUAL(add.Execute(closure, context), "ab"s);
+    ASSERT(add.GetOperandTypes() == OperandTypes::Generic);
+    closure["y"s] = ObjectHolder::Own(runtime::Number(1));
+    ASSERT_THROWS(add.Execute(closure, context), runtime_error);
+    closure["x"s] = ObjectHolder::Own(runtime::Number(1));
+    ASSERT_OBJECT_VALUE_EQUAL(add.Execute(closure, context), 2);
+    ASSERT(add.GetOperandTypes() == OperandTypes::Generic);
+}
+
+void TestQuickenedComparison()
+{
+    runtime::DummyContext context;
+    Closure closure = {{"x"s, ObjectHolder::Own(runtime::String("a"s))},
+                       {"y"s, ObjectHolder::Own(runtime::String("b"s))}};
+    Comparison less(runtime::Less, make_unique<VariableValue>("x"s), make_unique<VariableValue>("y"s));
+    Comparison greater_or_equal(runtime::GreaterOrEqual, make_unique<VariableValue>("x"s),
+                                make_unique<VariableValue>("y"s));
+
+    ASSERT(less.Compare(closure["x"s], closure["y"s], context));
+    ASSERT(!greater_or_equal.Compare(closure["x"s], closure["y"s], context));
+    ASSERT(less.GetOperandTypes() == OperandTypes::Strings);
+    ASSERT_OBJECT_VALUE_EQUAL(less.Execute(closure, context), "True"s);
+    ASSERT_OBJECT_VALUE_EQUAL(greater_or_equal.Execute(closure, context), "False"s);
+
+    closure["y"s] = ObjectHolder::Own(runtime::Number(1));
+    ASSERT_THROWS(less.Execute(closure, context), runtime_error);
+    ASSERT(less.GetOperandTypes() == OperandTypes::Generic);
+
+    // Custom comparator is never specialized
+    Comparison custom([](const ObjectHolder &, const ObjectHolder &, runtime::Context &) { return true; },
+                      make_unique<NumericConst>(2), make_unique<NumericConst>(1));
+    ASSERT(custom.GetOperandTypes() == OperandTypes::Generic);
+    ASSERT_OBJECT_VALUE_EQUAL(custom.Execute(closure, context), "True"s);
+}
+
 } // namespace
 
 void RunUnitTests(TestRunner &tr)
@@ -488,6 +543,8 @@ void RunUnitTests(TestRunner &tr)
     RUN_TEST(tr, ast::TestOr);
     RUN_TEST(tr, ast::TestAnd);
     RUN_TEST(tr, ast::TestNot);
+    RUN_TEST(tr, ast::TestQuickenedArithmetic);
+    RUN_TEST(tr, ast::TestQuickenedComparison);
 }
 
 } // namespace ast
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "fuse.h"
+#include "lexer.h"
+#include "parse.h"
+#include "runtime.h"
+#include "statement.h"
+#include "vm.h"
+
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+//! Programs of tests, they are parsed from source text and write their output to a string
+namespace TestProgram
+{
+
+inline std::unique_ptr<ast::Statement> Parse(const std::string &source, MethodParsing methods = MethodParsing::Eager)
+{
+    std::istringstream input(source);
+    parse::Lexer lexer(input);
+    return ParseProgram(lexer, methods);
+}
+
+//! Returns output of program executed as it is, execution error is written to the output as well
+inline std::string RunAsIs(runtime::Executable &program)
+{
+    std::ostringstream output;
+    runtime::SimpleContext context{output};
+    runtime::Closure closure;
+    try
+    {
+        program.Execute(closure, context);
+    }
+    catch (const std::runtime_error &e)
+    {
+        output << "error: " << e.what();
+    }
+    return output.str();
+}
+
+//! Returns output of program the same way. Build made for testing machine code compiles program to it before it
+//! runs, so that tests of program output run machine code
+inline std::string Run(runtime::Executable &program)
+{
+#ifdef MYTHON_JIT_TEST
+    const auto compiled = vm::Compile(program);
+    return RunAsIs(*compiled);
+#else
+    return RunAsIs(program);
+#endif
+}
+
+//! Executes program with output to the given stream, execution error is passed to the caller. Program is compiled
+//! to machine code before it runs the same way as by Run
+inline void Execute(runtime::Executable &program, std::ostream &output)
+{
+    runtime::SimpleContext context{output};
+    runtime::Closure closure;
+#ifdef MYTHON_JIT_TEST
+    vm::Compile(program)->Execute(closure, context);
+#else
+    program.Execute(closure, context);
+#endif
+}
+
+//! Counts nodes of program and its classes that replace other nodes, i.e. fused ones
+inline size_t CountReplaced(std::unique_ptr<ast::Statement> &statement) // NOLINT
+{
+    auto *node = dynamic_cast<ast::Node *>(statement.get());
+    if (!node)
+    {
+        return 0;
+    }
+    size_t count = dynamic_cast<const ast::Replacement *>(node) ? 1 : 0;
+    node->RewriteChildren([&count](std::unique_ptr<ast::Statement> &child) { count += CountReplaced(child); });
+    return count;
+}
+
+} // namespace TestProgram
@@ -0,0 +1,90 @@
+#include "infer.h"
+#include "lexer.h"
+#include "parse.h"
+#include "statement.h"
+#include "test_runner_p.h"
+#include "transpile.h"
+
+using namespace std;
+
+namespace aot
+{
+
+namespace
+{
+
+string Translate(const string &source, MethodParsing methods = MethodParsing::Eager)
+{
+    istringstream input(source);
+    parse::Lexer lexer(input);
+    auto program = ParseProgram(lexer, methods);
+    ast::InferTypes(program);
+    ostringstream output;
+    Transpile(*program, output);
+    return output.str();
+}
+
+const string COUNTER = R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add(n):
+    if n > 0:
+      self.value = self.value + n
+      return self.add(n - 1)
+    return self.value
+
+counter = Counter()
+print counter.add(10), 'a"b\n' + 'c'
+)";
+
+} // namespace
+
+void TestTranspiledProgram()
+{
+    const string code = Translate(COUNTER);
+    ASSERT(code.find("int main()") != string::npos);
+    ASSERT(code.find("\"Counter\"") != string::npos);
+    // Methods are functions, class is created before the program starts
+    ASSERT(code.find("void method_1(Closure &closure, Context &context)") != string::npos);
+    ASSERT(code.find("CreateClasses();") != string::npos);
+    // Operations with proven types are computed directly
+    ASSERT(code.find("AsNumber(") != string::npos);
+    ASSERT(code.find("AsString(") != string::npos);
+    ASSERT(code.find("\"a\\\"b\\012\"") != string::npos);
+}
+
+void TestNotTranspiledStatements()
+{
+    // Lazily parsed method bodies are parsed to be translated
+    ASSERT(Translate(COUNTER, MethodParsing::Lazy).find("void method_1(") != string::npos);
+
+    // Statement that is not a syntax tree node
+    struct Native : runtime::Executable
+    {
+        runtime::ObjectHolder Execute([[maybe_unused]] runtime::Closure &closure,
+                                      [[maybe_unused]] runtime::Context &context) override
+        {
+            return runtime::ObjectHolder::None();
+        }
+    };
+    ast::Compound program(make_unique<ast::Print>(make_unique<ast::NumericConst>(1)), make_unique<Native>());
+    ostringstream output;
+    try
+    {
+        Transpile(program, output);
+        ASSERT(false);
+    }
+    catch (const TranspileError &)
+    {
+    }
+}
+
+void RunTranspileTests(TestRunner &tr)
+{
+    RUN_TEST(tr, aot::TestTranspiledProgram);
+    RUN_TEST(tr, aot::TestNotTranspiledStatements);
+}
+
+} // namespace aot
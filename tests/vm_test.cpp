@@ -0,0 +1,171 @@
+#include "test_program_p.h"
+#include "test_runner_p.h"
+#include "vm.h"
+
+using namespace std;
+
+namespace vm
+{
+
+namespace
+{
+
+//! Runs program by syntax tree interpreter, or compiles it to bytecode first
+string Run(const string &source, bool compiled)
+{
+    auto program = TestProgram::Parse(source);
+    if (compiled)
+    {
+        program = Compile(std::move(program));
+    }
+    return TestProgram::RunAsIs(*program);
+}
+
+//! Executes program by syntax tree interpreter and by bytecode one, returns outputs of both
+pair<string, string> RunBoth(const string &source)
+{
+    return {Run(source, false), Run(source, true)};
+}
+
+} // namespace
+
+void TestExpressions()
+{
+    const auto [tree, compiled] = RunBoth(R"(
+x = 4
+y = 'a'
+print x + 2 * 3 - 8 / 4, y + 'b', str(x) + y, str(None), not x
+print x > 3 and y == 'a', x < 3 or y != 'a', x <= 4, x >= 5, 0 or 0, 1 and 'b'
+z = None
+print z, True, False
+)");
+    ASSERT_EQUAL(compiled, tree);
+    ASSERT_EQUAL(compiled, "8 ab 4a None False\nTrue False True False False True\nNone True False\n"s);
+}
+
+void TestClassesAndMethods()
+{
+    const auto [tree, compiled] = RunBoth(R"(
+class Shape:
+  def __init__(w, h):
+    self.w = w
+    self.h = h
+
+  def area():
+    return self.w * self.h
+
+  def __str__():
+    return 'Shape ' + str(self.area())
+
+class Square(Shape):
+  def __init__(side):
+    self.w = side
+    self.h = side
+
+  def grow(n):
+    if n < 1:
+      return self
+    self.w = self.w + 1
+    self.h = self.h + 1
+    return self.grow(n - 1)
+
+class Point:
+  def __eq__(other):
+    return True
+
+s = Shape(3, 4)
+q = Square(2)
+q.grow(2)
+print s, q, q.area(), s.w
+print Point() == Point()
+p = Point(1)
+print p.x
+)");
+    ASSERT_EQUAL(compiled, tree);
+    ASSERT_EQUAL(compiled, "Shape 12 Shape 16 16 3\nTrue\nNone\n"s);
+}
+
+void TestReturnStopsExecution()
+{
+    const auto [tree, compiled] = RunBoth(R"(
+class Test:
+  def first(x):
+    if x > 0:
+      if x > 5:
+        return 'big'
+      print 'not big'
+      return 'small'
+    print 'not positive'
+
+  def second(returned_value):
+    print 'printed'
+    print 'not printed'
+
+t = Test()
+print t.first(10), t.first(1), t.first(0)
+print t.second(1)
+print 'before'
+return 1
+print 'after'
+)");
+    ASSERT_EQUAL(compiled, tree);
+    // Arguments of print are printed one by one
+    ASSERT_EQUAL(compiled, "big not big\nsmall not positive\nNone\nprinted\n1\nbefore\n"s);
+}
+
+void TestRuntimeErrors()
+{
+    ASSERT_EQUAL(RunBoth("print 1\nprint x\n").second, "1\nerror: Unknown variable - x"s);
+    ASSERT_EQUAL(RunBoth("print 1 + 'a'\n").second, "error: Incorrect addition"s);
+    ASSERT_EQUAL(RunBoth("print 1 / 0\n").second, RunBoth("print 1 / 0\n").first);
+    ASSERT_EQUAL(RunBoth("class A:\n  def f():\n    return 1\na = A()\nprint a.g()\n").second,
+                 "error: Method does not exist"s);
+    // Syntax tree interpreter doesn't check that object is an instance
+    ASSERT_EQUAL(Run("x = 1\nx.f()\n", true), "error: Method f of object that is not a class instance"s);
+    ASSERT_EQUAL(Run("x = 1\nx.y = 2\n", true), "error: Field y of object that is not a class instance"s);
+}
+
+void TestStatementsThatAreNotNodes()
+{
+    struct Answer : runtime::Executable
+    {
+        runtime::ObjectHolder Execute(runtime::Closure &closure, runtime::Context &context) override
+        {
+            context.GetOutputStream() << "answer of "s << closure.at("x"s).TryAs<runtime::Number>()->GetValue() << '\n';
+            return runtime::ObjectHolder::Own(runtime::Number(42));
+        }
+    };
+
+    vector<runtime::Method> methods;
+    methods.push_back({"f"s, {"x"s}, make_unique<Answer>()});
+    auto cls = runtime::ObjectHolder::Own(runtime::Class("A"s, std::move(methods), nullptr));
+
+    auto program = make_unique<ast::Compound>();
+    program->AddStatement(make_unique<ast::ClassDefinition>(cls));
+    program->AddStatement(make_unique<ast::Assignment>(
+        "a"s, make_unique<ast::NewInstance>(*cls.TryAs<runtime::Class>())));
+    vector<unique_ptr<ast::Statement>> args;
+    args.push_back(make_unique<ast::NumericConst>(7));
+    program->AddStatement(make_unique<ast::Print>(
+        make_unique<ast::MethodCall>(make_unique<ast::VariableValue>("a"s), "f"s, std::move(args))));
+    program->AddStatement(make_unique<Answer>());
+
+    auto compiled = Compile(std::move(program));
+    ostringstream output;
+    runtime::SimpleContext context{output};
+    runtime::Closure closure{{"x"s, runtime::ObjectHolder::Own(runtime::Number(1))}};
+    compiled->Execute(closure, context);
+
+    ASSERT_EQUAL(output.str(), "answer of 7\n42\nanswer of 1\n"s);
+}
+
+void RunVmTests(TestRunner &tr)
+{
+    RUN_TEST(tr, vm::TestExpressions);
+    RUN_TEST(tr, vm::TestClassesAndMethods);
+    RUN_TEST(tr, vm::TestReturnStopsExecution);
+    RUN_TEST(tr, vm::TestRuntimeErrors);
+    RUN_TEST(tr, vm::TestStatementsThatAreNotNodes);
+}
+
+} // namespace vm